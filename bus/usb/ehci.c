@@ -0,0 +1,823 @@
+/* ehci.c - EHCI Support.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2010  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/dl.h>
+#include <grub/mm.h>
+#include <grub/usb.h>
+#include <grub/usbtrans.h>
+#include <grub/misc.h>
+#include <grub/pci.h>
+#include <grub/cpu/pci.h>
+#include <grub/time.h>
+
+/* EHCI only drives high speed devices.  Full and low speed devices on
+   the root ports are handed over to the companion UHCI or OHCI
+   controllers, so ehci.mod has to be loaded before uhci.mod and
+   ohci.mod.  */
+
+/* Link pointer bits.  */
+#define GRUB_EHCI_LINK_TERMINATE	1
+#define GRUB_EHCI_LINK_QH		(1 << 1)
+
+/* qTD token bits.  */
+#define GRUB_EHCI_TOKEN_ACTIVE		(1 << 7)
+#define GRUB_EHCI_TOKEN_HALTED		(1 << 6)
+#define GRUB_EHCI_TOKEN_BUFERR		(1 << 5)
+#define GRUB_EHCI_TOKEN_BABBLE		(1 << 4)
+#define GRUB_EHCI_TOKEN_XACTERR		(1 << 3)
+#define GRUB_EHCI_TOKEN_PID_OUT		(0 << 8)
+#define GRUB_EHCI_TOKEN_PID_IN		(1 << 8)
+#define GRUB_EHCI_TOKEN_PID_SETUP	(2 << 8)
+#define GRUB_EHCI_TOKEN_CERR_SHIFT	10
+#define GRUB_EHCI_TOKEN_SIZE_SHIFT	16
+#define GRUB_EHCI_TOKEN_SIZE_MASK	0x7fff
+#define GRUB_EHCI_TOKEN_TOGGLE_SHIFT	31
+
+/* QH endpoint characteristics and capabilities.  */
+#define GRUB_EHCI_EP_ENDPOINT_SHIFT	8
+#define GRUB_EHCI_EP_SPEED_HIGH		(2 << 12)
+#define GRUB_EHCI_EP_DTC		(1 << 14)
+#define GRUB_EHCI_EP_HEAD		(1 << 15)
+#define GRUB_EHCI_EP_MAXPKT_SHIFT	16
+#define GRUB_EHCI_EP_MULT_ONE		(1 << 30)
+
+/* A qTD addresses at most five pages.  */
+#define GRUB_EHCI_QTD_PAGES		5
+#define GRUB_EHCI_QTD_MAX_SIZE		(GRUB_EHCI_QTD_PAGES * 4096)
+
+/* Time to wait for a transfer to complete, in ms.  */
+#define GRUB_EHCI_TIMEOUT		5000
+
+/* EHCI Queue Element Transfer Descriptor.  The high buffer pointers
+   are only used by controllers with 64 bit addressing, GRUB keeps
+   them zero.  */
+struct grub_ehci_qtd
+{
+  grub_uint32_t next;
+  grub_uint32_t alt_next;
+  grub_uint32_t token;
+  grub_uint32_t buffer[GRUB_EHCI_QTD_PAGES];
+  grub_uint32_t buffer_hi[GRUB_EHCI_QTD_PAGES];
+  /* Pad to a multiple of 32 bytes.  */
+  grub_uint32_t pad[3];
+} __attribute__((packed));
+
+/* EHCI Queue Head.  */
+struct grub_ehci_qh
+{
+  grub_uint32_t horiz;
+  grub_uint32_t ep_char;
+  grub_uint32_t ep_cap;
+  grub_uint32_t current;
+  /* The transfer overlay area.  */
+  grub_uint32_t next;
+  grub_uint32_t alt_next;
+  grub_uint32_t token;
+  grub_uint32_t buffer[GRUB_EHCI_QTD_PAGES];
+  grub_uint32_t buffer_hi[GRUB_EHCI_QTD_PAGES];
+  /* Pad to a multiple of 32 bytes.  */
+  grub_uint32_t pad[7];
+} __attribute__((packed));
+
+typedef volatile struct grub_ehci_qtd *grub_ehci_qtd_t;
+typedef volatile struct grub_ehci_qh *grub_ehci_qh_t;
+
+struct grub_ehci
+{
+  volatile grub_uint32_t *iobase;
+
+  /* The permanent head of the asynchronous schedule.  */
+  grub_ehci_qh_t head;
+
+  /* Amount of root hub ports.  */
+  int ports;
+
+  struct grub_ehci *next;
+};
+
+static struct grub_ehci *ehci;
+
+/* Capability registers, byte offsets.  */
+typedef enum
+{
+  GRUB_EHCI_CAP_CAPLENGTH = 0x00,
+  GRUB_EHCI_CAP_HCSPARAMS = 0x04,
+  GRUB_EHCI_CAP_HCCPARAMS = 0x08
+} grub_ehci_cap_t;
+
+#define GRUB_EHCI_HCSPARAMS_PORTS_MASK	0xf
+#define GRUB_EHCI_HCSPARAMS_PPC		(1 << 4)
+#define GRUB_EHCI_HCCPARAMS_64BIT	(1 << 0)
+#define GRUB_EHCI_HCCPARAMS_EECP_SHIFT	8
+
+/* Operational registers, in 32 bit words from the end of the
+   capability registers.  */
+typedef enum
+{
+  GRUB_EHCI_REG_USBCMD = 0x00,
+  GRUB_EHCI_REG_USBSTS,
+  GRUB_EHCI_REG_USBINTR,
+  GRUB_EHCI_REG_FRINDEX,
+  GRUB_EHCI_REG_CTRLDSSEGMENT,
+  GRUB_EHCI_REG_PERIODICLIST,
+  GRUB_EHCI_REG_ASYNCLIST,
+  GRUB_EHCI_REG_CONFIGFLAG = 0x10,
+  GRUB_EHCI_REG_PORTSC = 0x11
+} grub_ehci_reg_t;
+
+#define GRUB_EHCI_CMD_RUN		(1 << 0)
+#define GRUB_EHCI_CMD_HCRESET		(1 << 1)
+#define GRUB_EHCI_CMD_ASYNC_ENABLE	(1 << 5)
+#define GRUB_EHCI_CMD_ASYNC_DOORBELL	(1 << 6)
+#define GRUB_EHCI_CMD_ITC_8		(8 << 16)
+
+#define GRUB_EHCI_STS_ASYNC_ADVANCE	(1 << 5)
+#define GRUB_EHCI_STS_HALTED		(1 << 12)
+#define GRUB_EHCI_STS_ASYNC		(1 << 15)
+
+#define GRUB_EHCI_PORT_CONNECTED	(1 << 0)
+#define GRUB_EHCI_PORT_ENABLED		(1 << 2)
+#define GRUB_EHCI_PORT_RESET		(1 << 8)
+#define GRUB_EHCI_PORT_LINE_MASK	(3 << 10)
+#define GRUB_EHCI_PORT_LINE_K		(1 << 10)
+#define GRUB_EHCI_PORT_POWER		(1 << 12)
+#define GRUB_EHCI_PORT_OWNER		(1 << 13)
+/* Status change bits, which are cleared by writing ones.  */
+#define GRUB_EHCI_PORT_WC		((1 << 1) | (1 << 3) | (1 << 5))
+
+/* USB legacy support extended capability in PCI configuration
+   space.  */
+#define GRUB_EHCI_LEGSUP_ID		1
+#define GRUB_EHCI_LEGSUP_BIOS_OWNED	(1 << 16)
+#define GRUB_EHCI_LEGSUP_OS_OWNED	(1 << 24)
+
+static grub_uint32_t
+grub_ehci_readreg32 (struct grub_ehci *e, grub_ehci_reg_t reg)
+{
+  return grub_le_to_cpu32 (*(e->iobase + reg));
+}
+
+static void
+grub_ehci_writereg32 (struct grub_ehci *e,
+		      grub_ehci_reg_t reg, grub_uint32_t val)
+{
+  *(e->iobase + reg) = grub_cpu_to_le32 (val);
+}
+
+/* Wait until the bits MASK of register REG equal VALUE.  Return 0 on
+   success, 1 after TIMEOUT ms.  */
+static int
+grub_ehci_wait (struct grub_ehci *e, grub_ehci_reg_t reg,
+		grub_uint32_t mask, grub_uint32_t value, int timeout)
+{
+  grub_uint64_t endtime = grub_get_time_ms () + timeout;
+
+  while ((grub_ehci_readreg32 (e, reg) & mask) != value)
+    {
+      if (grub_get_time_ms () > endtime)
+	return 1;
+      grub_cpu_idle ();
+    }
+
+  return 0;
+}
+
+/* Take the controller DEV over from the BIOS, which may still drive it
+   for legacy keyboard and mass storage support.  */
+static void
+grub_ehci_bios_handoff (grub_pci_device_t dev, grub_uint32_t hccparams)
+{
+  grub_pci_address_t addr;
+  grub_uint32_t legsup;
+  grub_uint64_t endtime;
+  int eecp;
+
+  eecp = (hccparams >> GRUB_EHCI_HCCPARAMS_EECP_SHIFT) & 0xff;
+  if (eecp < 0x40)
+    return;
+
+  addr = grub_pci_make_address (dev, eecp);
+  legsup = grub_pci_read (addr);
+  if ((legsup & 0xff) != GRUB_EHCI_LEGSUP_ID
+      || ! (legsup & GRUB_EHCI_LEGSUP_BIOS_OWNED))
+    return;
+
+  grub_pci_write (addr, legsup | GRUB_EHCI_LEGSUP_OS_OWNED);
+
+  endtime = grub_get_time_ms () + 1000;
+  while (grub_pci_read (addr) & GRUB_EHCI_LEGSUP_BIOS_OWNED)
+    if (grub_get_time_ms () > endtime)
+      {
+	/* Take it anyway.  */
+	grub_dprintf ("ehci", "BIOS did not release the controller\n");
+	grub_pci_write (addr, (legsup & ~GRUB_EHCI_LEGSUP_BIOS_OWNED)
+			| GRUB_EHCI_LEGSUP_OS_OWNED);
+	break;
+      }
+
+  /* Disable the SMIs the BIOS may have enabled.  */
+  addr = grub_pci_make_address (dev, eecp + 4);
+  grub_pci_write (addr, 0);
+}
+
+/* Iterate over all PCI devices.  Determine if a device is an EHCI
+   controller.  If this is the case, initialize it.  */
+static int NESTED_FUNC_ATTR
+grub_ehci_pci_iter (grub_pci_device_t dev,
+		    grub_pci_id_t pciid __attribute__((unused)))
+{
+  grub_uint32_t class_code;
+  grub_uint32_t class;
+  grub_uint32_t subclass;
+  grub_uint32_t interf;
+  grub_uint32_t base;
+  grub_uint32_t hcsparams;
+  grub_uint32_t hccparams;
+  grub_uint16_t cmd;
+  volatile grub_uint8_t *caps;
+  grub_pci_address_t addr;
+  struct grub_ehci *e;
+  int i;
+
+  addr = grub_pci_make_address (dev, GRUB_PCI_REG_CLASS);
+  class_code = grub_pci_read (addr) >> 8;
+
+  interf = class_code & 0xFF;
+  subclass = (class_code >> 8) & 0xFF;
+  class = class_code >> 16;
+
+  /* If this is not an EHCI controller, just return.  */
+  if (class != 0x0c || subclass != 0x03 || interf != 0x20)
+    return 0;
+
+  /* Determine the memory base address.  */
+  addr = grub_pci_make_address (dev, GRUB_PCI_REG_ADDRESS_REG0);
+  base = grub_pci_read (addr);
+  if ((base & GRUB_PCI_ADDR_SPACE_MASK) != GRUB_PCI_ADDR_SPACE_MEMORY)
+    return 0;
+
+  /* Enable memory space and bus mastering.  */
+  addr = grub_pci_make_address (dev, GRUB_PCI_REG_COMMAND);
+  cmd = grub_pci_read_word (addr);
+  grub_pci_write_word (addr, cmd | 0x6);
+
+  caps = (volatile grub_uint8_t *) (grub_addr_t)
+    (base & GRUB_PCI_ADDR_MEM_MASK);
+  hcsparams = grub_le_to_cpu32 (*(volatile grub_uint32_t *)
+				(caps + GRUB_EHCI_CAP_HCSPARAMS));
+  hccparams = grub_le_to_cpu32 (*(volatile grub_uint32_t *)
+				(caps + GRUB_EHCI_CAP_HCCPARAMS));
+
+  grub_ehci_bios_handoff (dev, hccparams);
+
+  /* Allocate memory for the controller and register it.  */
+  e = grub_zalloc (sizeof (*e));
+  if (! e)
+    return 1;
+
+  e->iobase = (volatile grub_uint32_t *) (caps
+					  + caps[GRUB_EHCI_CAP_CAPLENGTH]);
+  e->ports = hcsparams & GRUB_EHCI_HCSPARAMS_PORTS_MASK;
+
+  grub_dprintf ("ehci", "class=0x%02x 0x%02x interface 0x%02x base=%p "
+		"ports=%d\n", class, subclass, interf, e->iobase, e->ports);
+
+  /* Stop and reset the controller.  */
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_USBCMD, 0);
+  if (grub_ehci_wait (e, GRUB_EHCI_REG_USBSTS, GRUB_EHCI_STS_HALTED,
+		      GRUB_EHCI_STS_HALTED, 100))
+    goto fail;
+
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_USBCMD, GRUB_EHCI_CMD_HCRESET);
+  if (grub_ehci_wait (e, GRUB_EHCI_REG_USBCMD, GRUB_EHCI_CMD_HCRESET, 0,
+		      250))
+    goto fail;
+
+  /* Setup the head of the asynchronous schedule.  It never carries
+     transfers itself, every transfer gets a QH linked in after it.  */
+  e->head = grub_memalign (32, sizeof (*e->head));
+  if (! e->head)
+    goto fail;
+
+  grub_memset ((void *) e->head, 0, sizeof (*e->head));
+  e->head->horiz = grub_cpu_to_le32 ((grub_uint32_t) (grub_addr_t) e->head
+				     | GRUB_EHCI_LINK_QH);
+  e->head->ep_char = grub_cpu_to_le32 (GRUB_EHCI_EP_HEAD);
+  e->head->next = grub_cpu_to_le32 (GRUB_EHCI_LINK_TERMINATE);
+  e->head->alt_next = grub_cpu_to_le32 (GRUB_EHCI_LINK_TERMINATE);
+  e->head->token = grub_cpu_to_le32 (GRUB_EHCI_TOKEN_HALTED);
+
+  /* All data structures are below 4GiB.  */
+  if (hccparams & GRUB_EHCI_HCCPARAMS_64BIT)
+    grub_ehci_writereg32 (e, GRUB_EHCI_REG_CTRLDSSEGMENT, 0);
+
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_USBINTR, 0);
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_ASYNCLIST,
+			(grub_uint32_t) (grub_addr_t) e->head);
+
+  /* Start the controller with only the asynchronous schedule
+     enabled.  */
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_USBCMD,
+			GRUB_EHCI_CMD_RUN | GRUB_EHCI_CMD_ASYNC_ENABLE
+			| GRUB_EHCI_CMD_ITC_8);
+  if (grub_ehci_wait (e, GRUB_EHCI_REG_USBSTS, GRUB_EHCI_STS_ASYNC,
+		      GRUB_EHCI_STS_ASYNC, 100))
+    goto fail;
+
+  /* Route all ports to this controller.  */
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_CONFIGFLAG, 1);
+
+  /* Power the ports if the controller leaves that to software.  */
+  if (hcsparams & GRUB_EHCI_HCSPARAMS_PPC)
+    {
+      for (i = 0; i < e->ports; i++)
+	{
+	  grub_uint32_t status;
+
+	  status = grub_ehci_readreg32 (e, GRUB_EHCI_REG_PORTSC + i);
+	  status &= ~GRUB_EHCI_PORT_WC;
+	  grub_ehci_writereg32 (e, GRUB_EHCI_REG_PORTSC + i,
+				status | GRUB_EHCI_PORT_POWER);
+	}
+      grub_millisleep (20);
+    }
+
+  grub_dprintf ("ehci", "EHCI running, status=0x%08x\n",
+		grub_ehci_readreg32 (e, GRUB_EHCI_REG_USBSTS));
+
+  /* Link to ehci now that initialisation is successful.  */
+  e->next = ehci;
+  ehci = e;
+
+  return 0;
+
+ fail:
+  grub_dprintf ("ehci", "EHCI initialisation failed\n");
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_USBCMD, 0);
+  grub_free ((void *) e->head);
+  grub_free (e);
+
+  return 0;
+}
+
+
+static void
+grub_ehci_inithw (void)
+{
+  grub_pci_iterate (grub_ehci_pci_iter);
+}
+
+
+
+static int
+grub_ehci_iterate (int (*hook) (grub_usb_controller_t dev))
+{
+  struct grub_ehci *e;
+  struct grub_usb_controller dev;
+
+  for (e = ehci; e; e = e->next)
+    {
+      dev.data = e;
+      if (hook (&dev))
+	return 1;
+    }
+
+  return 0;
+}
+
+static void
+grub_ehci_transaction (grub_ehci_qtd_t td,
+		       grub_transfer_type_t type, unsigned int toggle,
+		       grub_size_t size, char *data)
+{
+  grub_uint32_t token;
+  grub_uint32_t buffer;
+  int i;
+
+  grub_dprintf ("ehci", "EHCI transaction td=%p type=%d, toggle=%d, "
+		"size=%d\n", td, type, toggle, size);
+
+  switch (type)
+    {
+    case GRUB_USB_TRANSFER_TYPE_SETUP:
+      token = GRUB_EHCI_TOKEN_PID_SETUP;
+      break;
+    case GRUB_USB_TRANSFER_TYPE_IN:
+      token = GRUB_EHCI_TOKEN_PID_IN;
+      break;
+    case GRUB_USB_TRANSFER_TYPE_OUT:
+    default:
+      token = GRUB_EHCI_TOKEN_PID_OUT;
+      break;
+    }
+
+  token |= GRUB_EHCI_TOKEN_ACTIVE;
+  token |= 3 << GRUB_EHCI_TOKEN_CERR_SHIFT;
+  token |= size << GRUB_EHCI_TOKEN_SIZE_SHIFT;
+  token |= toggle << GRUB_EHCI_TOKEN_TOGGLE_SHIFT;
+
+  /* The first buffer pointer holds the offset, the others point to
+     the following pages.  */
+  buffer = (grub_uint32_t) (grub_addr_t) data;
+  td->buffer[0] = grub_cpu_to_le32 (buffer);
+  for (i = 1; i < GRUB_EHCI_QTD_PAGES; i++)
+    td->buffer[i] = grub_cpu_to_le32 ((buffer & ~0xfff) + i * 4096);
+  for (i = 0; i < GRUB_EHCI_QTD_PAGES; i++)
+    td->buffer_hi[i] = 0;
+
+  td->next = grub_cpu_to_le32 (GRUB_EHCI_LINK_TERMINATE);
+  td->alt_next = grub_cpu_to_le32 (GRUB_EHCI_LINK_TERMINATE);
+  td->token = grub_cpu_to_le32 (token);
+}
+
+/* Merge the bulk transactions of TRANSFER starting at I into one qTD,
+   which may carry several packets of contiguous data as long as its
+   buffer fits in five pages.  Return the amount of transactions
+   merged and their total size in SIZE.  */
+static int
+grub_ehci_merge (grub_usb_transfer_t transfer, int i, grub_size_t *size)
+{
+  grub_usb_transaction_t first = &transfer->transactions[i];
+  grub_size_t offset = (grub_addr_t) first->data & 0xfff;
+  int n = 1;
+
+  *size = first->size;
+  if (transfer->type != GRUB_USB_TRANSACTION_TYPE_BULK)
+    return 1;
+
+  while (i + n < transfer->transcnt)
+    {
+      grub_usb_transaction_t prev = &transfer->transactions[i + n - 1];
+      grub_usb_transaction_t tr = &transfer->transactions[i + n];
+
+      /* Only a full packet can be followed by more data in the same
+	 qTD.  */
+      if (prev->size != transfer->max || tr->pid != first->pid
+	  || tr->data != prev->data + prev->size || ! tr->size
+	  || offset + *size + tr->size > GRUB_EHCI_QTD_MAX_SIZE)
+	break;
+
+      *size += tr->size;
+      n++;
+    }
+
+  return n;
+}
+
+/* Return the first of the NTDS qTDs in TD_LIST which completed with a
+   short packet, or -1 if there is none.  */
+static int
+grub_ehci_short (grub_ehci_qtd_t td_list, int ntds)
+{
+  int i;
+
+  for (i = 0; i < ntds; i++)
+    {
+      grub_uint32_t token = grub_le_to_cpu32 (td_list[i].token);
+
+      if (! (token & (GRUB_EHCI_TOKEN_ACTIVE | GRUB_EHCI_TOKEN_HALTED))
+	  && ((token >> GRUB_EHCI_TOKEN_SIZE_SHIFT)
+	      & GRUB_EHCI_TOKEN_SIZE_MASK))
+	return i;
+    }
+
+  return -1;
+}
+
+/* Remove QH from the asynchronous schedule of E.  The controller may
+   still hold a reference to it until the doorbell is answered.  */
+static void
+grub_ehci_unlink (struct grub_ehci *e, grub_ehci_qh_t qh)
+{
+  e->head->horiz = qh->horiz;
+
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_USBCMD,
+			grub_ehci_readreg32 (e, GRUB_EHCI_REG_USBCMD)
+			| GRUB_EHCI_CMD_ASYNC_DOORBELL);
+  if (grub_ehci_wait (e, GRUB_EHCI_REG_USBSTS, GRUB_EHCI_STS_ASYNC_ADVANCE,
+		      GRUB_EHCI_STS_ASYNC_ADVANCE, 100))
+    grub_dprintf ("ehci", "async advance doorbell timed out\n");
+
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_USBSTS,
+			GRUB_EHCI_STS_ASYNC_ADVANCE);
+}
+
+static grub_usb_err_t
+grub_ehci_transfer (grub_usb_controller_t dev,
+		    grub_usb_transfer_t transfer)
+{
+  struct grub_ehci *e = (struct grub_ehci *) dev->data;
+  grub_ehci_qh_t qh;
+  grub_ehci_qtd_t td_list;
+  grub_uint32_t token;
+  grub_uint64_t endtime;
+  grub_usb_err_t err;
+  grub_size_t size;
+  int ntds;
+  int short_td;
+  int i;
+
+  /* Split transactions to full and low speed devices behind high
+     speed hubs are not supported.  */
+  if (transfer->dev->speed != GRUB_USB_SPEED_HIGH)
+    {
+      grub_dprintf ("ehci", "device speed %d not supported\n",
+		    transfer->dev->speed);
+      return GRUB_USB_ERR_INTERNAL;
+    }
+
+  /* Count the qTDs needed.  */
+  for (i = 0, ntds = 0; i < transfer->transcnt; ntds++)
+    i += grub_ehci_merge (transfer, i, &size);
+
+  if (! ntds)
+    return GRUB_USB_ERR_NONE;
+
+  qh = grub_memalign (32, sizeof (*qh));
+  if (! qh)
+    return GRUB_USB_ERR_INTERNAL;
+
+  /* One more, inactive qTD stops the queue after a short packet.  */
+  td_list = grub_memalign (32, sizeof (*td_list) * (ntds + 1));
+  if (! td_list)
+    {
+      grub_free ((void *) qh);
+      return GRUB_USB_ERR_INTERNAL;
+    }
+
+  /* Setup all qTDs.  Within a qTD the controller alternates the data
+     toggle itself.  */
+  for (i = 0, ntds = 0; i < transfer->transcnt; ntds++)
+    {
+      grub_usb_transaction_t tr = &transfer->transactions[i];
+
+      i += grub_ehci_merge (transfer, i, &size);
+      grub_ehci_transaction (&td_list[ntds], tr->pid, tr->toggle,
+			     size, tr->data);
+
+      if (ntds)
+	td_list[ntds - 1].next
+	  = grub_cpu_to_le32 ((grub_uint32_t) (grub_addr_t) &td_list[ntds]);
+    }
+
+  grub_memset ((void *) &td_list[ntds], 0, sizeof (td_list[ntds]));
+  td_list[ntds].next = grub_cpu_to_le32 (GRUB_EHCI_LINK_TERMINATE);
+  td_list[ntds].alt_next = grub_cpu_to_le32 (GRUB_EHCI_LINK_TERMINATE);
+
+  /* A short packet ends a bulk transfer, but the status stage of a
+     control transfer still has to follow it.  */
+  for (i = 0; i < ntds - 1; i++)
+    td_list[i].alt_next
+      = grub_cpu_to_le32 ((grub_uint32_t) (grub_addr_t)
+			  &td_list[transfer->type
+				   == GRUB_USB_TRANSACTION_TYPE_CONTROL
+				   ? ntds - 1 : ntds]);
+
+  /* Setup the QH, the data toggle is taken from the qTDs.  */
+  grub_memset ((void *) qh, 0, sizeof (*qh));
+  qh->ep_char = grub_cpu_to_le32 (transfer->devaddr
+				  | (transfer->endpoint
+				     << GRUB_EHCI_EP_ENDPOINT_SHIFT)
+				  | GRUB_EHCI_EP_SPEED_HIGH
+				  | GRUB_EHCI_EP_DTC
+				  | (transfer->max
+				     << GRUB_EHCI_EP_MAXPKT_SHIFT));
+  qh->ep_cap = grub_cpu_to_le32 (GRUB_EHCI_EP_MULT_ONE);
+  qh->next = grub_cpu_to_le32 ((grub_uint32_t) (grub_addr_t) td_list);
+  qh->alt_next = grub_cpu_to_le32 (GRUB_EHCI_LINK_TERMINATE);
+
+  /* Link it into the asynchronous schedule.  Now the transfer can
+     take place.  */
+  qh->horiz = e->head->horiz;
+  e->head->horiz = grub_cpu_to_le32 ((grub_uint32_t) (grub_addr_t) qh
+				     | GRUB_EHCI_LINK_QH);
+
+  grub_dprintf ("ehci", "wait for completion of %d qTDs\n", ntds);
+
+  /* Wait until the last qTD completed, a short packet ended the
+     transfer or an error halted the queue.  */
+  err = GRUB_USB_ERR_NONE;
+  endtime = grub_get_time_ms () + GRUB_EHCI_TIMEOUT;
+  for (;;)
+    {
+      if (! (grub_le_to_cpu32 (td_list[ntds - 1].token)
+	     & GRUB_EHCI_TOKEN_ACTIVE))
+	break;
+
+      if (transfer->type == GRUB_USB_TRANSACTION_TYPE_BULK
+	  && grub_ehci_short (td_list, ntds) >= 0)
+	break;
+
+      if (grub_le_to_cpu32 (qh->token) & GRUB_EHCI_TOKEN_HALTED)
+	{
+	  err = GRUB_USB_ERR_STALL;
+	  break;
+	}
+
+      if (grub_get_time_ms () > endtime)
+	{
+	  grub_dprintf ("ehci", "transfer timed out\n");
+	  err = GRUB_USB_ERR_TIMEOUT;
+	  break;
+	}
+
+      grub_cpu_idle ();
+    }
+
+  grub_ehci_unlink (e, qh);
+
+  /* Tell which transaction received the short packet, the data toggle
+     of the next transfer follows from it.  */
+  short_td = grub_ehci_short (td_list, ntds);
+  if (! err && transfer->type == GRUB_USB_TRANSACTION_TYPE_BULK
+      && short_td >= 0)
+    {
+      int n;
+
+      for (i = 0, n = 0; n < short_td; n++)
+	i += grub_ehci_merge (transfer, i, &size);
+      grub_ehci_merge (transfer, i, &size);
+
+      token = grub_le_to_cpu32 (td_list[short_td].token);
+      size -= ((token >> GRUB_EHCI_TOKEN_SIZE_SHIFT)
+	       & GRUB_EHCI_TOKEN_SIZE_MASK);
+      transfer->last_trans = i + size / transfer->max;
+      grub_dprintf ("ehci", "short packet in transaction %d\n",
+		    transfer->last_trans);
+    }
+
+  /* Determine why the queue halted.  */
+  for (i = 0; i < ntds; i++)
+    {
+      token = grub_le_to_cpu32 (td_list[i].token);
+      if (! (token & GRUB_EHCI_TOKEN_HALTED))
+	continue;
+
+      grub_dprintf ("ehci", "qTD %d halted, token=0x%08x\n", i, token);
+
+      if (token & GRUB_EHCI_TOKEN_BABBLE)
+	err = GRUB_USB_ERR_BABBLE;
+      else if (token & GRUB_EHCI_TOKEN_BUFERR)
+	err = GRUB_USB_ERR_DATA;
+      else if (token & GRUB_EHCI_TOKEN_XACTERR)
+	err = GRUB_USB_ERR_TIMEOUT;
+      else
+	err = GRUB_USB_ERR_STALL;
+      break;
+    }
+
+  grub_free ((void *) td_list);
+  grub_free ((void *) qh);
+
+  return err;
+}
+
+/* Give the port PORT of E to the companion controller.  */
+static void
+grub_ehci_release_port (struct grub_ehci *e, unsigned int port)
+{
+  grub_uint32_t status;
+
+  grub_dprintf ("ehci", "releasing port %d to the companion controller\n",
+		port);
+
+  status = grub_ehci_readreg32 (e, GRUB_EHCI_REG_PORTSC + port);
+  status &= ~GRUB_EHCI_PORT_WC;
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_PORTSC + port,
+			status | GRUB_EHCI_PORT_OWNER);
+}
+
+static grub_err_t
+grub_ehci_portstatus (grub_usb_controller_t dev,
+		      unsigned int port, unsigned int enable)
+{
+  struct grub_ehci *e = (struct grub_ehci *) dev->data;
+  grub_uint32_t status;
+
+  grub_dprintf ("ehci", "enable=%d port=%d\n", enable, port);
+
+  if (port >= (unsigned int) e->ports)
+    return grub_error (GRUB_ERR_OUT_OF_RANGE,
+		       "EHCI Root Hub port does not exist");
+
+  status = grub_ehci_readreg32 (e, GRUB_EHCI_REG_PORTSC + port);
+  status &= ~GRUB_EHCI_PORT_WC;
+
+  if (! enable)
+    {
+      grub_ehci_writereg32 (e, GRUB_EHCI_REG_PORTSC + port,
+			    status & ~GRUB_EHCI_PORT_ENABLED);
+      return GRUB_ERR_NONE;
+    }
+
+  /* Reset the port.  */
+  status &= ~GRUB_EHCI_PORT_ENABLED;
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_PORTSC + port,
+			status | GRUB_EHCI_PORT_RESET);
+  grub_millisleep (50);
+
+  /* End the reset signaling and wait for the controller to finish
+     it.  */
+  grub_ehci_writereg32 (e, GRUB_EHCI_REG_PORTSC + port, status);
+  if (grub_ehci_wait (e, GRUB_EHCI_REG_PORTSC + port, GRUB_EHCI_PORT_RESET,
+		      0, 100))
+    return grub_error (GRUB_ERR_IO, "EHCI port reset timed out");
+  grub_millisleep (10);
+
+  /* Only high speed devices are enabled by the reset.  */
+  status = grub_ehci_readreg32 (e, GRUB_EHCI_REG_PORTSC + port);
+  grub_dprintf ("ehci", "portstatus=0x%08x\n", status);
+  if (! (status & GRUB_EHCI_PORT_ENABLED))
+    {
+      /* Not an error, the companion controller takes over.  */
+      grub_ehci_release_port (e, port);
+      return GRUB_ERR_IO;
+    }
+
+  return GRUB_ERR_NONE;
+}
+
+static grub_usb_speed_t
+grub_ehci_detect_dev (grub_usb_controller_t dev, int port)
+{
+  struct grub_ehci *e = (struct grub_ehci *) dev->data;
+  grub_uint32_t status;
+
+  status = grub_ehci_readreg32 (e, GRUB_EHCI_REG_PORTSC + port);
+
+  grub_dprintf ("ehci", "detect_dev status=0x%08x\n", status);
+
+  if (! (status & GRUB_EHCI_PORT_CONNECTED)
+      || (status & GRUB_EHCI_PORT_OWNER))
+    return GRUB_USB_SPEED_NONE;
+
+  /* A low speed device holds the line in K state.  */
+  if ((status & GRUB_EHCI_PORT_LINE_MASK) == GRUB_EHCI_PORT_LINE_K)
+    {
+      grub_ehci_release_port (e, port);
+      return GRUB_USB_SPEED_NONE;
+    }
+
+  /* Full speed devices are only told apart by the port reset, they are
+     released in grub_ehci_portstatus.  */
+  return GRUB_USB_SPEED_HIGH;
+}
+
+static int
+grub_ehci_hubports (grub_usb_controller_t dev)
+{
+  struct grub_ehci *e = (struct grub_ehci *) dev->data;
+
+  grub_dprintf ("ehci", "root hub ports=%d\n", e->ports);
+
+  return e->ports;
+}
+
+
+
+static struct grub_usb_controller_dev usb_controller =
+{
+  .name = "ehci",
+  .iterate = grub_ehci_iterate,
+  .transfer = grub_ehci_transfer,
+  .hubports = grub_ehci_hubports,
+  .portstatus = grub_ehci_portstatus,
+  .detect_dev = grub_ehci_detect_dev
+};
+
+GRUB_MOD_INIT(ehci)
+{
+  grub_ehci_inithw ();
+  grub_usb_controller_dev_register (&usb_controller);
+}
+
+GRUB_MOD_FINI(ehci)
+{
+  struct grub_ehci *e;
+
+  /* Stop all EHCI controllers and give the ports back to the companion
+     controllers.  */
+  for (e = ehci; e; e = e->next)
+    {
+      grub_ehci_writereg32 (e, GRUB_EHCI_REG_USBCMD, 0);
+      grub_ehci_writereg32 (e, GRUB_EHCI_REG_CONFIGFLAG, 0);
+    }
+
+  grub_usb_controller_dev_unregister (&usb_controller);
+}
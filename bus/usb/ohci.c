@@ -270,6 +270,40 @@ grub_ohci_transaction (grub_ohci_td_t td,
   td->buffer_end = grub_cpu_to_le32 (buffer_end);
 }
 
+/* Merge the bulk transactions of TRANSFER starting at I into one TD,
+   which may carry several packets of contiguous data as long as its
+   buffer crosses at most one page boundary.  Return the amount of
+   transactions merged and their total size in SIZE.  */
+static int
+grub_ohci_merge (grub_usb_transfer_t transfer, int i, grub_size_t *size)
+{
+  grub_usb_transaction_t first = &transfer->transactions[i];
+  grub_uint32_t start = (grub_uint32_t) first->data;
+  int n = 1;
+
+  *size = first->size;
+  if (transfer->type != GRUB_USB_TRANSACTION_TYPE_BULK)
+    return 1;
+
+  while (i + n < transfer->transcnt)
+    {
+      grub_usb_transaction_t prev = &transfer->transactions[i + n - 1];
+      grub_usb_transaction_t tr = &transfer->transactions[i + n];
+
+      /* Only a full packet can be followed by more data in the same
+	 TD.  */
+      if (prev->size != transfer->max || tr->pid != first->pid
+	  || tr->data != prev->data + prev->size || ! tr->size
+	  || ((start + *size + tr->size - 1) >> 12) - (start >> 12) > 1)
+	break;
+
+      *size += tr->size;
+      n++;
+    }
+
+  return n;
+}
+
 static grub_usb_err_t
 grub_ohci_transfer (grub_usb_controller_t dev,
 		    grub_usb_transfer_t transfer)
@@ -283,14 +317,20 @@ grub_ohci_transfer (grub_usb_controller_t dev,
   grub_uint32_t status;
   grub_uint32_t control;
   grub_usb_err_t err;
+  grub_size_t size;
+  int ntds;
   int i;
 
+  /* Count the TDs needed.  */
+  for (i = 0, ntds = 0; i < transfer->transcnt; ntds++)
+    i += grub_ohci_merge (transfer, i, &size);
+
   /* Allocate an Endpoint Descriptor.  */
   ed = grub_memalign (16, sizeof (*ed));
   if (! ed)
     return GRUB_USB_ERR_INTERNAL;
 
-  td_list = grub_memalign (16, sizeof (*td_list) * (transfer->transcnt + 1));
+  td_list = grub_memalign (16, sizeof (*td_list) * (ntds + 1));
   if (! td_list)
     {
       grub_free ((void *) ed);
@@ -299,15 +339,17 @@ grub_ohci_transfer (grub_usb_controller_t dev,
 
   grub_dprintf ("ohci", "alloc=%p\n", td_list);
 
-  /* Setup all Transfer Descriptors.  */
-  for (i = 0; i < transfer->transcnt; i++)
+  /* Setup all Transfer Descriptors.  Within a TD the controller
+     alternates the data toggle itself.  */
+  for (i = 0, ntds = 0; i < transfer->transcnt; ntds++)
     {
       grub_usb_transaction_t tr = &transfer->transactions[i];
 
-      grub_ohci_transaction (&td_list[i], tr->pid, tr->toggle,
-			     tr->size, tr->data);
+      i += grub_ohci_merge (transfer, i, &size);
+      grub_ohci_transaction (&td_list[ntds], tr->pid, tr->toggle,
+			     size, tr->data);
 
-      td_list[i].next_td = grub_cpu_to_le32 (&td_list[i + 1]);
+      td_list[ntds].next_td = grub_cpu_to_le32 (&td_list[ntds + 1]);
     }
 
   /* Setup the Endpoint Descriptor.  */
@@ -326,7 +368,7 @@ grub_ohci_transfer (grub_usb_controller_t dev,
 
   td_head = (grub_uint32_t) td_list;
 
-  td_tail = (grub_uint32_t) &td_list[transfer->transcnt];
+  td_tail = (grub_uint32_t) &td_list[ntds];
 
   ed->target = grub_cpu_to_le32 (target);
   ed->td_head = grub_cpu_to_le32 (td_head);
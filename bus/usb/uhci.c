@@ -39,6 +39,9 @@ typedef enum
 #define GRUB_UHCI_LINK_TERMINATE	1
 #define GRUB_UHCI_LINK_QUEUE_HEAD	2
 
+/* The maximum amount of TDs queued at once for a single transfer.  */
+#define GRUB_UHCI_BATCH_TDS	128
+
 
 /* UHCI Queue Head.  */
 struct grub_uhci_qh
@@ -430,10 +433,11 @@ grub_uhci_transfer (grub_usb_controller_t dev,
   struct grub_uhci *u = (struct grub_uhci *) dev->data;
   grub_uhci_qh_t qh;
   grub_uhci_td_t td;
-  grub_uhci_td_t td_first = NULL;
-  grub_uhci_td_t td_prev = NULL;
+  grub_uhci_td_t td_first;
+  grub_uhci_td_t td_prev;
   grub_usb_err_t err = GRUB_USB_ERR_NONE;
   int i;
+  int start;
   grub_uint64_t endtime;
 
   /* Allocate a queue head for the transfer queue.  */
@@ -441,111 +445,130 @@ grub_uhci_transfer (grub_usb_controller_t dev,
   if (! qh)
     return grub_errno;
 
-  for (i = 0; i < transfer->transcnt; i++)
+  /* Large transfers would exhaust the TD pool, queue them in batches
+     of GRUB_UHCI_BATCH_TDS TDs.  */
+  for (start = 0; start < transfer->transcnt; start = i)
     {
-      grub_usb_transaction_t tr = &transfer->transactions[i];
+      td_first = NULL;
+      td_prev = NULL;
 
-      td = grub_uhci_transaction (u, transfer->endpoint, tr->pid,
-				  transfer->devaddr, tr->toggle,
-				  tr->size, tr->data);
-      if (! td)
+      for (i = start; i < transfer->transcnt
+	     && i - start < GRUB_UHCI_BATCH_TDS; i++)
 	{
-	  /* Terminate and free.  */
-	  td_prev->linkptr2 = 0;
-	  td_prev->linkptr = 1;
-
-	  if (td_first)
-	    grub_free_queue (u, td_first);
-
-	  return GRUB_USB_ERR_INTERNAL;
+	  grub_usb_transaction_t tr = &transfer->transactions[i];
+
+	  td = grub_uhci_transaction (u, transfer->endpoint, tr->pid,
+				      transfer->devaddr, tr->toggle,
+				      tr->size, tr->data);
+	  if (! td)
+	    {
+	      /* Terminate and free.  */
+	      if (td_prev)
+		{
+		  td_prev->linkptr2 = 0;
+		  td_prev->linkptr = 1;
+		}
+
+	      if (td_first)
+		grub_free_queue (u, td_first);
+
+	      qh->elinkptr = 1;
+	      return GRUB_USB_ERR_INTERNAL;
+	    }
+
+	  if (! td_first)
+	    td_first = td;
+	  else
+	    {
+	      td_prev->linkptr2 = (grub_uint32_t) td;
+	      td_prev->linkptr = (grub_uint32_t) td;
+	      td_prev->linkptr |= 4;
+	    }
+	  td_prev = td;
 	}
+      td_prev->linkptr2 = 0;
+      td_prev->linkptr = 1;
 
-      if (! td_first)
-	td_first = td;
-      else
-	{
-	  td_prev->linkptr2 = (grub_uint32_t) td;
-	  td_prev->linkptr = (grub_uint32_t) td;
-	  td_prev->linkptr |= 4;
-	}
-      td_prev = td;
-    }
-  td_prev->linkptr2 = 0;
-  td_prev->linkptr = 1;
-
-  grub_dprintf ("uhci", "setup transaction %d\n", transfer->type);
+      grub_dprintf ("uhci", "setup transaction %d\n", transfer->type);
 
-  /* Link it into the queue and terminate.  Now the transaction can
-     take place.  */
-  qh->elinkptr = (grub_uint32_t) td_first;
+      /* Link it into the queue and terminate.  Now the transaction can
+	 take place.  */
+      qh->elinkptr = (grub_uint32_t) td_first;
 
-  grub_dprintf ("uhci", "initiate transaction\n");
-
-  /* Wait until either the transaction completed or an error
-     occurred.  */
-  endtime = grub_get_time_ms () + 1000;
-  for (;;)
-    {
-      grub_uhci_td_t errtd;
-
-      errtd = (grub_uhci_td_t) (qh->elinkptr & ~0x0f);
-
-      grub_dprintf ("uhci", ">t status=0x%02x data=0x%02x td=%p\n",
-		    errtd->ctrl_status, errtd->buffer & (~15), errtd);
-
-      /* Check if the transaction completed.  */
-      if (qh->elinkptr & 1)
-	break;
+      grub_dprintf ("uhci", "initiate transaction\n");
 
-      grub_dprintf ("uhci", "t status=0x%02x\n", errtd->ctrl_status);
-
-      /* Check if the TD is not longer active.  */
-      if (! (errtd->ctrl_status & (1 << 23)))
+      /* Wait until either the transaction completed or an error
+	 occurred.  */
+      endtime = grub_get_time_ms () + 1000;
+      for (;;)
 	{
-	  grub_dprintf ("uhci", ">>t status=0x%02x\n", errtd->ctrl_status);
-
-	  /* Check if the endpoint is stalled.  */
-	  if (errtd->ctrl_status & (1 << 22))
-	    err = GRUB_USB_ERR_STALL;
-
-	  /* Check if an error related to the data buffer occurred.  */
-	  if (errtd->ctrl_status & (1 << 21))
-	    err = GRUB_USB_ERR_DATA;
-
-	  /* Check if a babble error occurred.  */
-	  if (errtd->ctrl_status & (1 << 20))
-	    err = GRUB_USB_ERR_BABBLE;
-
-	  /* Check if a NAK occurred.  */
-	  if (errtd->ctrl_status & (1 << 19))
-	    err = GRUB_USB_ERR_NAK;
-
-	  /* Check if a timeout occurred.  */
-	  if (errtd->ctrl_status & (1 << 18))
-	    err = GRUB_USB_ERR_TIMEOUT;
-
-	  /* Check if a bitstuff error occurred.  */
-	  if (errtd->ctrl_status & (1 << 17))
-	    err = GRUB_USB_ERR_BITSTUFF;
-
-	  if (err)
-	    goto fail;
-
-	  /* Fall through, no errors occurred, so the QH might be
-	     updated.  */
-	  grub_dprintf ("uhci", "transaction fallthrough\n");
-	}
-      if (grub_get_time_ms () > endtime)
-	{
-	  err = GRUB_USB_ERR_STALL;
-	  grub_dprintf ("uhci", "transaction timed out\n");
-	  goto fail;
+	  grub_uhci_td_t errtd;
+
+	  errtd = (grub_uhci_td_t) (qh->elinkptr & ~0x0f);
+
+	  grub_dprintf ("uhci", ">t status=0x%02x data=0x%02x td=%p\n",
+			errtd->ctrl_status, errtd->buffer & (~15), errtd);
+
+	  /* Check if the transaction completed.  */
+	  if (qh->elinkptr & 1)
+	    break;
+
+	  grub_dprintf ("uhci", "t status=0x%02x\n", errtd->ctrl_status);
+
+	  /* Check if the TD is not longer active.  */
+	  if (! (errtd->ctrl_status & (1 << 23)))
+	    {
+	      grub_dprintf ("uhci", ">>t status=0x%02x\n", errtd->ctrl_status);
+
+	      /* Check if the endpoint is stalled.  */
+	      if (errtd->ctrl_status & (1 << 22))
+		err = GRUB_USB_ERR_STALL;
+
+	      /* Check if an error related to the data buffer occurred.  */
+	      if (errtd->ctrl_status & (1 << 21))
+		err = GRUB_USB_ERR_DATA;
+
+	      /* Check if a babble error occurred.  */
+	      if (errtd->ctrl_status & (1 << 20))
+		err = GRUB_USB_ERR_BABBLE;
+
+	      /* Check if a NAK occurred.  */
+	      if (errtd->ctrl_status & (1 << 19))
+		err = GRUB_USB_ERR_NAK;
+
+	      /* Check if a timeout occurred.  */
+	      if (errtd->ctrl_status & (1 << 18))
+		err = GRUB_USB_ERR_TIMEOUT;
+
+	      /* Check if a bitstuff error occurred.  */
+	      if (errtd->ctrl_status & (1 << 17))
+		err = GRUB_USB_ERR_BITSTUFF;
+
+	      if (err)
+		goto fail;
+
+	      /* Fall through, no errors occurred, so the QH might be
+		 updated.  */
+	      grub_dprintf ("uhci", "transaction fallthrough\n");
+	    }
+	  if (grub_get_time_ms () > endtime)
+	    {
+	      err = GRUB_USB_ERR_STALL;
+	      grub_dprintf ("uhci", "transaction timed out\n");
+	      goto fail;
+	    }
+	  grub_cpu_idle ();
 	}
-      grub_cpu_idle ();
+
+      /* Deallocate the TDs of this batch.  */
+      qh->elinkptr = 1;
+      grub_free_queue (u, td_first);
     }
 
   grub_dprintf ("uhci", "transaction complete\n");
 
+  return GRUB_USB_ERR_NONE;
+
  fail:
 
   grub_dprintf ("uhci", "transaction failed\n");
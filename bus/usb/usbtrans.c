@@ -64,6 +64,7 @@ grub_usb_control_msg (grub_usb_device_t dev,
   transfer->type = GRUB_USB_TRANSACTION_TYPE_CONTROL;
   transfer->max = max;
   transfer->dev = dev;
+  transfer->last_trans = -1;
 
   /* Allocate an array of transfer data structures.  */
   transfer->transactions = grub_malloc (transfer->transcnt
@@ -121,25 +122,33 @@ grub_usb_control_msg (grub_usb_device_t dev,
   return err;
 }
 
+/* Transfer the NSEGS buffers in SEGS to or from ENDPOINT as one bulk
+   transfer.  Every segment starts with a new packet, so that for
+   example the data stage and the status of a mass storage command can
+   be read in one go.  */
 static grub_usb_err_t
-grub_usb_bulk_readwrite (grub_usb_device_t dev,
-			 int endpoint, grub_size_t size, char *data,
+grub_usb_bulk_readwrite (grub_usb_device_t dev, int endpoint,
+			 int nsegs, struct grub_usb_bulk_segment *segs,
 			 grub_transfer_type_t type)
 {
   int i;
+  int seg;
   grub_usb_transfer_t transfer;
   int datablocks;
   unsigned int max;
   grub_usb_err_t err;
   int toggle = dev->toggle[endpoint];
+  grub_size_t total = 0;
 
   /* Use the maximum packet size given in the endpoint descriptor.  */
   if (dev->initialized)
     {
       struct grub_usb_desc_endp *endpdesc;
-      endpdesc = grub_usb_get_endpdescriptor (dev, 0);
+      endpdesc = grub_usb_get_endpdescriptor (dev, endpoint
+					      | (type == GRUB_USB_TRANSFER_TYPE_IN
+						 ? 0x80 : 0));
 
-      if (endpdesc)
+      if (endpdesc && endpdesc->maxpacket)
 	max = endpdesc->maxpacket;
       else
 	max = 64;
@@ -152,40 +161,60 @@ grub_usb_bulk_readwrite (grub_usb_device_t dev,
   if (! transfer)
     return grub_errno;
 
-  datablocks = ((size + max - 1) / max);
+  datablocks = 0;
+  for (seg = 0; seg < nsegs; seg++)
+    {
+      datablocks += (segs[seg].size + max - 1) / max;
+      total += segs[seg].size;
+    }
   transfer->transcnt = datablocks;
-  transfer->size = size - 1;
+  transfer->size = total - 1;
   transfer->endpoint = endpoint;
   transfer->devaddr = dev->addr;
   transfer->type = GRUB_USB_TRANSACTION_TYPE_BULK;
   transfer->max = max;
   transfer->dev = dev;
+  transfer->last_trans = -1;
 
   /* Allocate an array of transfer data structures.  */
   transfer->transactions = grub_malloc (transfer->transcnt
-					* sizeof (struct grub_usb_transfer));
+					* sizeof (struct grub_usb_transaction));
   if (! transfer->transactions)
     {
       grub_free (transfer);
       return grub_errno;
     }
 
-  /* Set up all transfers.  */
-  for (i = 0; i < datablocks; i++)
+  /* Set up all transfers.  Host controllers which can move several
+     packets per descriptor merge the transactions of contiguous
+     data again.  */
+  i = 0;
+  for (seg = 0; seg < nsegs; seg++)
     {
-      grub_usb_transaction_t tr = &transfer->transactions[i];
-
-      tr->size = (size > max) ? max : size;
-      /* XXX: Use the right most bit as the data toggle.  Simple and
-	 effective.  */
-      tr->toggle = toggle;
-      toggle = toggle ? 0 : 1;
-      tr->pid = type;
-      tr->data = &data[i * max];
-      size -= tr->size;
+      grub_size_t size = segs[seg].size;
+      char *data = segs[seg].data;
+
+      while (size)
+	{
+	  grub_usb_transaction_t tr = &transfer->transactions[i++];
+
+	  tr->size = (size > max) ? max : size;
+	  /* XXX: Use the right most bit as the data toggle.  Simple and
+	     effective.  */
+	  tr->toggle = toggle;
+	  toggle = toggle ? 0 : 1;
+	  tr->pid = type;
+	  tr->data = data;
+	  data += tr->size;
+	  size -= tr->size;
+	}
     }
 
   err = dev->controller.dev->transfer (&dev->controller, transfer);
+  /* The transactions after a short packet were not done, so continue
+     with the toggle of the one after it.  */
+  if (! err && transfer->last_trans >= 0)
+    toggle = transfer->transactions[transfer->last_trans].toggle ? 0 : 1;
   grub_dprintf ("usb", "toggle=%d\n", toggle);
   dev->toggle[endpoint] = toggle;
 
@@ -199,7 +228,9 @@ grub_usb_err_t
 grub_usb_bulk_write (grub_usb_device_t dev,
 		     int endpoint, grub_size_t size, char *data)
 {
-  return grub_usb_bulk_readwrite (dev, endpoint, size, data,
+  struct grub_usb_bulk_segment seg = { .size = size, .data = data };
+
+  return grub_usb_bulk_readwrite (dev, endpoint, 1, &seg,
 				  GRUB_USB_TRANSFER_TYPE_OUT);
 }
 
@@ -207,6 +238,16 @@ grub_usb_err_t
 grub_usb_bulk_read (grub_usb_device_t dev,
 		    int endpoint, grub_size_t size, char *data)
 {
-  return grub_usb_bulk_readwrite (dev, endpoint, size, data,
+  struct grub_usb_bulk_segment seg = { .size = size, .data = data };
+
+  return grub_usb_bulk_readwrite (dev, endpoint, 1, &seg,
+				  GRUB_USB_TRANSFER_TYPE_IN);
+}
+
+grub_usb_err_t
+grub_usb_bulk_read_segments (grub_usb_device_t dev, int endpoint,
+			     int nsegs, struct grub_usb_bulk_segment *segs)
+{
+  return grub_usb_bulk_readwrite (dev, endpoint, nsegs, segs,
 				  GRUB_USB_TRANSFER_TYPE_IN);
 }
@@ -45,7 +45,8 @@ grub_emu_SOURCES = commands/minicmd.c commands/cat.c commands/cmp.c	\
 	\
 	video/video.c video/fb/video_fb.c video/fb/fbblit.c             \
         video/fb/fbfill.c video/fb/fbutil.c commands/videotest.c        \
-	video/bitmap.c video/bitmap_scale.c video/readers/tga.c 	\
+	video/bitmap.c video/bitmap_scale.c video/bitmap_cache.c	\
+	video/readers/tga.c						\
 	video/readers/jpeg.c video/readers/png.c font/font_cmd.c 	\
 	font/font.c term/gfxterm.c io/bufio.c				\
 	\
@@ -67,16 +68,16 @@ grub_emu_SOURCES = commands/minicmd.c commands/cat.c commands/cmp.c	\
 	grub_emu_init.c gnulib/progname.c
 
 clean-utility-grub-emu.1:
-	rm -f grub-emu$(EXEEXT) grub_emu-commands_minicmd.o grub_emu-commands_cat.o grub_emu-commands_cmp.o grub_emu-commands_configfile.o grub_emu-commands_echo.o grub_emu-commands_help.o grub_emu-commands_handler.o grub_emu-commands_ls.o grub_emu-commands_test.o grub_emu-commands_search_wrap.o grub_emu-commands_search_file.o grub_emu-commands_search_label.o grub_emu-commands_search_uuid.o grub_emu-commands_blocklist.o grub_emu-commands_hexdump.o grub_emu-lib_hexdump.o grub_emu-commands_halt.o grub_emu-commands_reboot.o grub_emu-lib_envblk.o grub_emu-commands_loadenv.o grub_emu-commands_gptsync.o grub_emu-commands_probe.o grub_emu-commands_xnu_uuid.o grub_emu-commands_password.o grub_emu-commands_keystatus.o grub_emu-disk_host.o grub_emu-disk_loopback.o grub_emu-disk_scsi.o grub_emu-fs_fshelp.o grub_emu-io_gzio.o grub_emu-kern_device.o grub_emu-kern_disk.o grub_emu-kern_dl.o grub_emu-kern_elf.o grub_emu-kern_env.o grub_emu-kern_err.o grub_emu-kern_list.o grub_emu-kern_handler.o grub_emu-kern_command.o grub_emu-kern_corecmd.o grub_emu-commands_extcmd.o grub_emu-kern_file.o grub_emu-kern_fs.o grub_emu-commands_boot.o grub_emu-kern_main.o grub_emu-kern_misc.o grub_emu-kern_parser.o grub_emu-kern_partition.o grub_emu-kern_term.o grub_emu-kern_rescue_reader.o grub_emu-kern_rescue_parser.o grub_emu-lib_arg.o grub_emu-normal_cmdline.o grub_emu-normal_datetime.o grub_emu-normal_misc.o grub_emu-normal_handler.o grub_emu-normal_auth.o grub_emu-lib_crypto.o grub_emu-normal_autofs.o grub_emu-normal_completion.o grub_emu-normal_main.o grub_emu-normal_color.o grub_emu-normal_menu.o grub_emu-normal_menu_entry.o grub_emu-normal_menu_text.o grub_emu-normal_crypto.o grub_emu-normal_term.o grub_emu-commands_terminal.o grub_emu-normal_context.o grub_emu-lib_charset.o grub_emu-script_main.o grub_emu-script_execute.o grub_emu-script_function.o grub_emu-script_lexer.o grub_emu-script_script.o grub_emu-grub_script_tab.o grub_emu-partmap_amiga.o grub_emu-partmap_apple.o grub_emu-partmap_msdos.o grub_emu-partmap_sun.o grub_emu-partmap_acorn.o grub_emu-partmap_gpt.o grub_emu-fs_affs.o grub_emu-fs_cpio.o grub_emu-fs_fat.o grub_emu-fs_ext2.o grub_emu-fs_hfs.o grub_emu-fs_hfsplus.o grub_emu-fs_iso9660.o grub_emu-fs_udf.o grub_emu-fs_jfs.o grub_emu-fs_minix.o grub_emu-fs_ntfs.o grub_emu-fs_ntfscomp.o grub_emu-fs_reiserfs.o grub_emu-fs_sfs.o grub_emu-fs_ufs.o grub_emu-fs_ufs2.o grub_emu-fs_xfs.o grub_emu-fs_afs.o grub_emu-fs_afs_be.o grub_emu-fs_befs.o grub_emu-fs_befs_be.o grub_emu-fs_tar.o grub_emu-video_video.o grub_emu-video_fb_video_fb.o grub_emu-video_fb_fbblit.o grub_emu-video_fb_fbfill.o grub_emu-video_fb_fbutil.o grub_emu-commands_videotest.o grub_emu-video_bitmap.o grub_emu-video_bitmap_scale.o grub_emu-video_readers_tga.o grub_emu-video_readers_jpeg.o grub_emu-video_readers_png.o grub_emu-font_font_cmd.o grub_emu-font_font.o grub_emu-term_gfxterm.o grub_emu-io_bufio.o grub_emu-gfxmenu_gfxmenu.o grub_emu-gfxmenu_model.o grub_emu-gfxmenu_view.o grub_emu-gfxmenu_icon_manager.o grub_emu-gfxmenu_theme_loader.o grub_emu-gfxmenu_widget_box.o grub_emu-gfxmenu_gui_canvas.o grub_emu-gfxmenu_gui_circular_progress.o grub_emu-gfxmenu_gui_box.o grub_emu-gfxmenu_gui_label.o grub_emu-gfxmenu_gui_list.o grub_emu-gfxmenu_gui_image.o grub_emu-gfxmenu_gui_progress_bar.o grub_emu-gfxmenu_gui_util.o grub_emu-gfxmenu_gui_string_util.o grub_emu-gfxmenu_named_colors.o grub_emu-trigtables.o grub_emu-util_console.o grub_emu-util_hostfs.o grub_emu-util_grub_emu.o grub_emu-util_misc.o grub_emu-util_hostdisk.o grub_emu-util_getroot.o grub_emu-disk_raid.o grub_emu-disk_raid5_recover.o grub_emu-disk_raid6_recover.o grub_emu-disk_mdraid_linux.o grub_emu-disk_dmraid_nvidia.o grub_emu-disk_lvm.o grub_emu-commands_parttool.o grub_emu-parttool_msdospart.o grub_emu-lib_libgcrypt_grub_cipher_md5.o grub_emu-grub_emu_init.o grub_emu-gnulib_progname.o
+	rm -f grub-emu$(EXEEXT) grub_emu-commands_minicmd.o grub_emu-commands_cat.o grub_emu-commands_cmp.o grub_emu-commands_configfile.o grub_emu-commands_echo.o grub_emu-commands_help.o grub_emu-commands_handler.o grub_emu-commands_ls.o grub_emu-commands_test.o grub_emu-commands_search_wrap.o grub_emu-commands_search_file.o grub_emu-commands_search_label.o grub_emu-commands_search_uuid.o grub_emu-commands_blocklist.o grub_emu-commands_hexdump.o grub_emu-lib_hexdump.o grub_emu-commands_halt.o grub_emu-commands_reboot.o grub_emu-lib_envblk.o grub_emu-commands_loadenv.o grub_emu-commands_gptsync.o grub_emu-commands_probe.o grub_emu-commands_xnu_uuid.o grub_emu-commands_password.o grub_emu-commands_keystatus.o grub_emu-disk_host.o grub_emu-disk_loopback.o grub_emu-disk_scsi.o grub_emu-fs_fshelp.o grub_emu-io_gzio.o grub_emu-kern_device.o grub_emu-kern_disk.o grub_emu-kern_dl.o grub_emu-kern_elf.o grub_emu-kern_env.o grub_emu-kern_err.o grub_emu-kern_list.o grub_emu-kern_handler.o grub_emu-kern_command.o grub_emu-kern_corecmd.o grub_emu-commands_extcmd.o grub_emu-kern_file.o grub_emu-kern_fs.o grub_emu-commands_boot.o grub_emu-kern_main.o grub_emu-kern_misc.o grub_emu-kern_parser.o grub_emu-kern_partition.o grub_emu-kern_term.o grub_emu-kern_rescue_reader.o grub_emu-kern_rescue_parser.o grub_emu-lib_arg.o grub_emu-normal_cmdline.o grub_emu-normal_datetime.o grub_emu-normal_misc.o grub_emu-normal_handler.o grub_emu-normal_auth.o grub_emu-lib_crypto.o grub_emu-normal_autofs.o grub_emu-normal_completion.o grub_emu-normal_main.o grub_emu-normal_color.o grub_emu-normal_menu.o grub_emu-normal_menu_entry.o grub_emu-normal_menu_text.o grub_emu-normal_crypto.o grub_emu-normal_term.o grub_emu-commands_terminal.o grub_emu-normal_context.o grub_emu-lib_charset.o grub_emu-script_main.o grub_emu-script_execute.o grub_emu-script_function.o grub_emu-script_lexer.o grub_emu-script_script.o grub_emu-grub_script_tab.o grub_emu-partmap_amiga.o grub_emu-partmap_apple.o grub_emu-partmap_msdos.o grub_emu-partmap_sun.o grub_emu-partmap_acorn.o grub_emu-partmap_gpt.o grub_emu-fs_affs.o grub_emu-fs_cpio.o grub_emu-fs_fat.o grub_emu-fs_ext2.o grub_emu-fs_hfs.o grub_emu-fs_hfsplus.o grub_emu-fs_iso9660.o grub_emu-fs_udf.o grub_emu-fs_jfs.o grub_emu-fs_minix.o grub_emu-fs_ntfs.o grub_emu-fs_ntfscomp.o grub_emu-fs_reiserfs.o grub_emu-fs_sfs.o grub_emu-fs_ufs.o grub_emu-fs_ufs2.o grub_emu-fs_xfs.o grub_emu-fs_afs.o grub_emu-fs_afs_be.o grub_emu-fs_befs.o grub_emu-fs_befs_be.o grub_emu-fs_tar.o grub_emu-video_video.o grub_emu-video_fb_video_fb.o grub_emu-video_fb_fbblit.o grub_emu-video_fb_fbfill.o grub_emu-video_fb_fbutil.o grub_emu-commands_videotest.o grub_emu-video_bitmap.o grub_emu-video_bitmap_scale.o grub_emu-video_bitmap_cache.o grub_emu-video_readers_tga.o grub_emu-video_readers_jpeg.o grub_emu-video_readers_png.o grub_emu-font_font_cmd.o grub_emu-font_font.o grub_emu-term_gfxterm.o grub_emu-io_bufio.o grub_emu-gfxmenu_gfxmenu.o grub_emu-gfxmenu_model.o grub_emu-gfxmenu_view.o grub_emu-gfxmenu_icon_manager.o grub_emu-gfxmenu_theme_loader.o grub_emu-gfxmenu_widget_box.o grub_emu-gfxmenu_gui_canvas.o grub_emu-gfxmenu_gui_circular_progress.o grub_emu-gfxmenu_gui_box.o grub_emu-gfxmenu_gui_label.o grub_emu-gfxmenu_gui_list.o grub_emu-gfxmenu_gui_image.o grub_emu-gfxmenu_gui_progress_bar.o grub_emu-gfxmenu_gui_util.o grub_emu-gfxmenu_gui_string_util.o grub_emu-gfxmenu_named_colors.o grub_emu-trigtables.o grub_emu-util_console.o grub_emu-util_hostfs.o grub_emu-util_grub_emu.o grub_emu-util_misc.o grub_emu-util_hostdisk.o grub_emu-util_getroot.o grub_emu-disk_raid.o grub_emu-disk_raid5_recover.o grub_emu-disk_raid6_recover.o grub_emu-disk_mdraid_linux.o grub_emu-disk_dmraid_nvidia.o grub_emu-disk_lvm.o grub_emu-commands_parttool.o grub_emu-parttool_msdospart.o grub_emu-lib_libgcrypt_grub_cipher_md5.o grub_emu-grub_emu_init.o grub_emu-gnulib_progname.o
 
 CLEAN_UTILITY_TARGETS += clean-utility-grub-emu.1
 
 mostlyclean-utility-grub-emu.1:
-	rm -f grub_emu-commands_minicmd.d grub_emu-commands_cat.d grub_emu-commands_cmp.d grub_emu-commands_configfile.d grub_emu-commands_echo.d grub_emu-commands_help.d grub_emu-commands_handler.d grub_emu-commands_ls.d grub_emu-commands_test.d grub_emu-commands_search_wrap.d grub_emu-commands_search_file.d grub_emu-commands_search_label.d grub_emu-commands_search_uuid.d grub_emu-commands_blocklist.d grub_emu-commands_hexdump.d grub_emu-lib_hexdump.d grub_emu-commands_halt.d grub_emu-commands_reboot.d grub_emu-lib_envblk.d grub_emu-commands_loadenv.d grub_emu-commands_gptsync.d grub_emu-commands_probe.d grub_emu-commands_xnu_uuid.d grub_emu-commands_password.d grub_emu-commands_keystatus.d grub_emu-disk_host.d grub_emu-disk_loopback.d grub_emu-disk_scsi.d grub_emu-fs_fshelp.d grub_emu-io_gzio.d grub_emu-kern_device.d grub_emu-kern_disk.d grub_emu-kern_dl.d grub_emu-kern_elf.d grub_emu-kern_env.d grub_emu-kern_err.d grub_emu-kern_list.d grub_emu-kern_handler.d grub_emu-kern_command.d grub_emu-kern_corecmd.d grub_emu-commands_extcmd.d grub_emu-kern_file.d grub_emu-kern_fs.d grub_emu-commands_boot.d grub_emu-kern_main.d grub_emu-kern_misc.d grub_emu-kern_parser.d grub_emu-kern_partition.d grub_emu-kern_term.d grub_emu-kern_rescue_reader.d grub_emu-kern_rescue_parser.d grub_emu-lib_arg.d grub_emu-normal_cmdline.d grub_emu-normal_datetime.d grub_emu-normal_misc.d grub_emu-normal_handler.d grub_emu-normal_auth.d grub_emu-lib_crypto.d grub_emu-normal_autofs.d grub_emu-normal_completion.d grub_emu-normal_main.d grub_emu-normal_color.d grub_emu-normal_menu.d grub_emu-normal_menu_entry.d grub_emu-normal_menu_text.d grub_emu-normal_crypto.d grub_emu-normal_term.d grub_emu-commands_terminal.d grub_emu-normal_context.d grub_emu-lib_charset.d grub_emu-script_main.d grub_emu-script_execute.d grub_emu-script_function.d grub_emu-script_lexer.d grub_emu-script_script.d grub_emu-grub_script_tab.d grub_emu-partmap_amiga.d grub_emu-partmap_apple.d grub_emu-partmap_msdos.d grub_emu-partmap_sun.d grub_emu-partmap_acorn.d grub_emu-partmap_gpt.d grub_emu-fs_affs.d grub_emu-fs_cpio.d grub_emu-fs_fat.d grub_emu-fs_ext2.d grub_emu-fs_hfs.d grub_emu-fs_hfsplus.d grub_emu-fs_iso9660.d grub_emu-fs_udf.d grub_emu-fs_jfs.d grub_emu-fs_minix.d grub_emu-fs_ntfs.d grub_emu-fs_ntfscomp.d grub_emu-fs_reiserfs.d grub_emu-fs_sfs.d grub_emu-fs_ufs.d grub_emu-fs_ufs2.d grub_emu-fs_xfs.d grub_emu-fs_afs.d grub_emu-fs_afs_be.d grub_emu-fs_befs.d grub_emu-fs_befs_be.d grub_emu-fs_tar.d grub_emu-video_video.d grub_emu-video_fb_video_fb.d grub_emu-video_fb_fbblit.d grub_emu-video_fb_fbfill.d grub_emu-video_fb_fbutil.d grub_emu-commands_videotest.d grub_emu-video_bitmap.d grub_emu-video_bitmap_scale.d grub_emu-video_readers_tga.d grub_emu-video_readers_jpeg.d grub_emu-video_readers_png.d grub_emu-font_font_cmd.d grub_emu-font_font.d grub_emu-term_gfxterm.d grub_emu-io_bufio.d grub_emu-gfxmenu_gfxmenu.d grub_emu-gfxmenu_model.d grub_emu-gfxmenu_view.d grub_emu-gfxmenu_icon_manager.d grub_emu-gfxmenu_theme_loader.d grub_emu-gfxmenu_widget_box.d grub_emu-gfxmenu_gui_canvas.d grub_emu-gfxmenu_gui_circular_progress.d grub_emu-gfxmenu_gui_box.d grub_emu-gfxmenu_gui_label.d grub_emu-gfxmenu_gui_list.d grub_emu-gfxmenu_gui_image.d grub_emu-gfxmenu_gui_progress_bar.d grub_emu-gfxmenu_gui_util.d grub_emu-gfxmenu_gui_string_util.d grub_emu-gfxmenu_named_colors.d grub_emu-trigtables.d grub_emu-util_console.d grub_emu-util_hostfs.d grub_emu-util_grub_emu.d grub_emu-util_misc.d grub_emu-util_hostdisk.d grub_emu-util_getroot.d grub_emu-disk_raid.d grub_emu-disk_raid5_recover.d grub_emu-disk_raid6_recover.d grub_emu-disk_mdraid_linux.d grub_emu-disk_dmraid_nvidia.d grub_emu-disk_lvm.d grub_emu-commands_parttool.d grub_emu-parttool_msdospart.d grub_emu-lib_libgcrypt_grub_cipher_md5.d grub_emu-grub_emu_init.d grub_emu-gnulib_progname.d
+	rm -f grub_emu-commands_minicmd.d grub_emu-commands_cat.d grub_emu-commands_cmp.d grub_emu-commands_configfile.d grub_emu-commands_echo.d grub_emu-commands_help.d grub_emu-commands_handler.d grub_emu-commands_ls.d grub_emu-commands_test.d grub_emu-commands_search_wrap.d grub_emu-commands_search_file.d grub_emu-commands_search_label.d grub_emu-commands_search_uuid.d grub_emu-commands_blocklist.d grub_emu-commands_hexdump.d grub_emu-lib_hexdump.d grub_emu-commands_halt.d grub_emu-commands_reboot.d grub_emu-lib_envblk.d grub_emu-commands_loadenv.d grub_emu-commands_gptsync.d grub_emu-commands_probe.d grub_emu-commands_xnu_uuid.d grub_emu-commands_password.d grub_emu-commands_keystatus.d grub_emu-disk_host.d grub_emu-disk_loopback.d grub_emu-disk_scsi.d grub_emu-fs_fshelp.d grub_emu-io_gzio.d grub_emu-kern_device.d grub_emu-kern_disk.d grub_emu-kern_dl.d grub_emu-kern_elf.d grub_emu-kern_env.d grub_emu-kern_err.d grub_emu-kern_list.d grub_emu-kern_handler.d grub_emu-kern_command.d grub_emu-kern_corecmd.d grub_emu-commands_extcmd.d grub_emu-kern_file.d grub_emu-kern_fs.d grub_emu-commands_boot.d grub_emu-kern_main.d grub_emu-kern_misc.d grub_emu-kern_parser.d grub_emu-kern_partition.d grub_emu-kern_term.d grub_emu-kern_rescue_reader.d grub_emu-kern_rescue_parser.d grub_emu-lib_arg.d grub_emu-normal_cmdline.d grub_emu-normal_datetime.d grub_emu-normal_misc.d grub_emu-normal_handler.d grub_emu-normal_auth.d grub_emu-lib_crypto.d grub_emu-normal_autofs.d grub_emu-normal_completion.d grub_emu-normal_main.d grub_emu-normal_color.d grub_emu-normal_menu.d grub_emu-normal_menu_entry.d grub_emu-normal_menu_text.d grub_emu-normal_crypto.d grub_emu-normal_term.d grub_emu-commands_terminal.d grub_emu-normal_context.d grub_emu-lib_charset.d grub_emu-script_main.d grub_emu-script_execute.d grub_emu-script_function.d grub_emu-script_lexer.d grub_emu-script_script.d grub_emu-grub_script_tab.d grub_emu-partmap_amiga.d grub_emu-partmap_apple.d grub_emu-partmap_msdos.d grub_emu-partmap_sun.d grub_emu-partmap_acorn.d grub_emu-partmap_gpt.d grub_emu-fs_affs.d grub_emu-fs_cpio.d grub_emu-fs_fat.d grub_emu-fs_ext2.d grub_emu-fs_hfs.d grub_emu-fs_hfsplus.d grub_emu-fs_iso9660.d grub_emu-fs_udf.d grub_emu-fs_jfs.d grub_emu-fs_minix.d grub_emu-fs_ntfs.d grub_emu-fs_ntfscomp.d grub_emu-fs_reiserfs.d grub_emu-fs_sfs.d grub_emu-fs_ufs.d grub_emu-fs_ufs2.d grub_emu-fs_xfs.d grub_emu-fs_afs.d grub_emu-fs_afs_be.d grub_emu-fs_befs.d grub_emu-fs_befs_be.d grub_emu-fs_tar.d grub_emu-video_video.d grub_emu-video_fb_video_fb.d grub_emu-video_fb_fbblit.d grub_emu-video_fb_fbfill.d grub_emu-video_fb_fbutil.d grub_emu-commands_videotest.d grub_emu-video_bitmap.d grub_emu-video_bitmap_scale.d grub_emu-video_bitmap_cache.d grub_emu-video_readers_tga.d grub_emu-video_readers_jpeg.d grub_emu-video_readers_png.d grub_emu-font_font_cmd.d grub_emu-font_font.d grub_emu-term_gfxterm.d grub_emu-io_bufio.d grub_emu-gfxmenu_gfxmenu.d grub_emu-gfxmenu_model.d grub_emu-gfxmenu_view.d grub_emu-gfxmenu_icon_manager.d grub_emu-gfxmenu_theme_loader.d grub_emu-gfxmenu_widget_box.d grub_emu-gfxmenu_gui_canvas.d grub_emu-gfxmenu_gui_circular_progress.d grub_emu-gfxmenu_gui_box.d grub_emu-gfxmenu_gui_label.d grub_emu-gfxmenu_gui_list.d grub_emu-gfxmenu_gui_image.d grub_emu-gfxmenu_gui_progress_bar.d grub_emu-gfxmenu_gui_util.d grub_emu-gfxmenu_gui_string_util.d grub_emu-gfxmenu_named_colors.d grub_emu-trigtables.d grub_emu-util_console.d grub_emu-util_hostfs.d grub_emu-util_grub_emu.d grub_emu-util_misc.d grub_emu-util_hostdisk.d grub_emu-util_getroot.d grub_emu-disk_raid.d grub_emu-disk_raid5_recover.d grub_emu-disk_raid6_recover.d grub_emu-disk_mdraid_linux.d grub_emu-disk_dmraid_nvidia.d grub_emu-disk_lvm.d grub_emu-commands_parttool.d grub_emu-parttool_msdospart.d grub_emu-lib_libgcrypt_grub_cipher_md5.d grub_emu-grub_emu_init.d grub_emu-gnulib_progname.d
 
 MOSTLYCLEAN_UTILITY_TARGETS += mostlyclean-utility-grub-emu.1
 
-grub_emu_OBJECTS += grub_emu-commands_minicmd.o grub_emu-commands_cat.o grub_emu-commands_cmp.o grub_emu-commands_configfile.o grub_emu-commands_echo.o grub_emu-commands_help.o grub_emu-commands_handler.o grub_emu-commands_ls.o grub_emu-commands_test.o grub_emu-commands_search_wrap.o grub_emu-commands_search_file.o grub_emu-commands_search_label.o grub_emu-commands_search_uuid.o grub_emu-commands_blocklist.o grub_emu-commands_hexdump.o grub_emu-lib_hexdump.o grub_emu-commands_halt.o grub_emu-commands_reboot.o grub_emu-lib_envblk.o grub_emu-commands_loadenv.o grub_emu-commands_gptsync.o grub_emu-commands_probe.o grub_emu-commands_xnu_uuid.o grub_emu-commands_password.o grub_emu-commands_keystatus.o grub_emu-disk_host.o grub_emu-disk_loopback.o grub_emu-disk_scsi.o grub_emu-fs_fshelp.o grub_emu-io_gzio.o grub_emu-kern_device.o grub_emu-kern_disk.o grub_emu-kern_dl.o grub_emu-kern_elf.o grub_emu-kern_env.o grub_emu-kern_err.o grub_emu-kern_list.o grub_emu-kern_handler.o grub_emu-kern_command.o grub_emu-kern_corecmd.o grub_emu-commands_extcmd.o grub_emu-kern_file.o grub_emu-kern_fs.o grub_emu-commands_boot.o grub_emu-kern_main.o grub_emu-kern_misc.o grub_emu-kern_parser.o grub_emu-kern_partition.o grub_emu-kern_term.o grub_emu-kern_rescue_reader.o grub_emu-kern_rescue_parser.o grub_emu-lib_arg.o grub_emu-normal_cmdline.o grub_emu-normal_datetime.o grub_emu-normal_misc.o grub_emu-normal_handler.o grub_emu-normal_auth.o grub_emu-lib_crypto.o grub_emu-normal_autofs.o grub_emu-normal_completion.o grub_emu-normal_main.o grub_emu-normal_color.o grub_emu-normal_menu.o grub_emu-normal_menu_entry.o grub_emu-normal_menu_text.o grub_emu-normal_crypto.o grub_emu-normal_term.o grub_emu-commands_terminal.o grub_emu-normal_context.o grub_emu-lib_charset.o grub_emu-script_main.o grub_emu-script_execute.o grub_emu-script_function.o grub_emu-script_lexer.o grub_emu-script_script.o grub_emu-grub_script_tab.o grub_emu-partmap_amiga.o grub_emu-partmap_apple.o grub_emu-partmap_msdos.o grub_emu-partmap_sun.o grub_emu-partmap_acorn.o grub_emu-partmap_gpt.o grub_emu-fs_affs.o grub_emu-fs_cpio.o grub_emu-fs_fat.o grub_emu-fs_ext2.o grub_emu-fs_hfs.o grub_emu-fs_hfsplus.o grub_emu-fs_iso9660.o grub_emu-fs_udf.o grub_emu-fs_jfs.o grub_emu-fs_minix.o grub_emu-fs_ntfs.o grub_emu-fs_ntfscomp.o grub_emu-fs_reiserfs.o grub_emu-fs_sfs.o grub_emu-fs_ufs.o grub_emu-fs_ufs2.o grub_emu-fs_xfs.o grub_emu-fs_afs.o grub_emu-fs_afs_be.o grub_emu-fs_befs.o grub_emu-fs_befs_be.o grub_emu-fs_tar.o grub_emu-video_video.o grub_emu-video_fb_video_fb.o grub_emu-video_fb_fbblit.o grub_emu-video_fb_fbfill.o grub_emu-video_fb_fbutil.o grub_emu-commands_videotest.o grub_emu-video_bitmap.o grub_emu-video_bitmap_scale.o grub_emu-video_readers_tga.o grub_emu-video_readers_jpeg.o grub_emu-video_readers_png.o grub_emu-font_font_cmd.o grub_emu-font_font.o grub_emu-term_gfxterm.o grub_emu-io_bufio.o grub_emu-gfxmenu_gfxmenu.o grub_emu-gfxmenu_model.o grub_emu-gfxmenu_view.o grub_emu-gfxmenu_icon_manager.o grub_emu-gfxmenu_theme_loader.o grub_emu-gfxmenu_widget_box.o grub_emu-gfxmenu_gui_canvas.o grub_emu-gfxmenu_gui_circular_progress.o grub_emu-gfxmenu_gui_box.o grub_emu-gfxmenu_gui_label.o grub_emu-gfxmenu_gui_list.o grub_emu-gfxmenu_gui_image.o grub_emu-gfxmenu_gui_progress_bar.o grub_emu-gfxmenu_gui_util.o grub_emu-gfxmenu_gui_string_util.o grub_emu-gfxmenu_named_colors.o grub_emu-trigtables.o grub_emu-util_console.o grub_emu-util_hostfs.o grub_emu-util_grub_emu.o grub_emu-util_misc.o grub_emu-util_hostdisk.o grub_emu-util_getroot.o grub_emu-disk_raid.o grub_emu-disk_raid5_recover.o grub_emu-disk_raid6_recover.o grub_emu-disk_mdraid_linux.o grub_emu-disk_dmraid_nvidia.o grub_emu-disk_lvm.o grub_emu-commands_parttool.o grub_emu-parttool_msdospart.o grub_emu-lib_libgcrypt_grub_cipher_md5.o grub_emu-grub_emu_init.o grub_emu-gnulib_progname.o
+grub_emu_OBJECTS += grub_emu-commands_minicmd.o grub_emu-commands_cat.o grub_emu-commands_cmp.o grub_emu-commands_configfile.o grub_emu-commands_echo.o grub_emu-commands_help.o grub_emu-commands_handler.o grub_emu-commands_ls.o grub_emu-commands_test.o grub_emu-commands_search_wrap.o grub_emu-commands_search_file.o grub_emu-commands_search_label.o grub_emu-commands_search_uuid.o grub_emu-commands_blocklist.o grub_emu-commands_hexdump.o grub_emu-lib_hexdump.o grub_emu-commands_halt.o grub_emu-commands_reboot.o grub_emu-lib_envblk.o grub_emu-commands_loadenv.o grub_emu-commands_gptsync.o grub_emu-commands_probe.o grub_emu-commands_xnu_uuid.o grub_emu-commands_password.o grub_emu-commands_keystatus.o grub_emu-disk_host.o grub_emu-disk_loopback.o grub_emu-disk_scsi.o grub_emu-fs_fshelp.o grub_emu-io_gzio.o grub_emu-kern_device.o grub_emu-kern_disk.o grub_emu-kern_dl.o grub_emu-kern_elf.o grub_emu-kern_env.o grub_emu-kern_err.o grub_emu-kern_list.o grub_emu-kern_handler.o grub_emu-kern_command.o grub_emu-kern_corecmd.o grub_emu-commands_extcmd.o grub_emu-kern_file.o grub_emu-kern_fs.o grub_emu-commands_boot.o grub_emu-kern_main.o grub_emu-kern_misc.o grub_emu-kern_parser.o grub_emu-kern_partition.o grub_emu-kern_term.o grub_emu-kern_rescue_reader.o grub_emu-kern_rescue_parser.o grub_emu-lib_arg.o grub_emu-normal_cmdline.o grub_emu-normal_datetime.o grub_emu-normal_misc.o grub_emu-normal_handler.o grub_emu-normal_auth.o grub_emu-lib_crypto.o grub_emu-normal_autofs.o grub_emu-normal_completion.o grub_emu-normal_main.o grub_emu-normal_color.o grub_emu-normal_menu.o grub_emu-normal_menu_entry.o grub_emu-normal_menu_text.o grub_emu-normal_crypto.o grub_emu-normal_term.o grub_emu-commands_terminal.o grub_emu-normal_context.o grub_emu-lib_charset.o grub_emu-script_main.o grub_emu-script_execute.o grub_emu-script_function.o grub_emu-script_lexer.o grub_emu-script_script.o grub_emu-grub_script_tab.o grub_emu-partmap_amiga.o grub_emu-partmap_apple.o grub_emu-partmap_msdos.o grub_emu-partmap_sun.o grub_emu-partmap_acorn.o grub_emu-partmap_gpt.o grub_emu-fs_affs.o grub_emu-fs_cpio.o grub_emu-fs_fat.o grub_emu-fs_ext2.o grub_emu-fs_hfs.o grub_emu-fs_hfsplus.o grub_emu-fs_iso9660.o grub_emu-fs_udf.o grub_emu-fs_jfs.o grub_emu-fs_minix.o grub_emu-fs_ntfs.o grub_emu-fs_ntfscomp.o grub_emu-fs_reiserfs.o grub_emu-fs_sfs.o grub_emu-fs_ufs.o grub_emu-fs_ufs2.o grub_emu-fs_xfs.o grub_emu-fs_afs.o grub_emu-fs_afs_be.o grub_emu-fs_befs.o grub_emu-fs_befs_be.o grub_emu-fs_tar.o grub_emu-video_video.o grub_emu-video_fb_video_fb.o grub_emu-video_fb_fbblit.o grub_emu-video_fb_fbfill.o grub_emu-video_fb_fbutil.o grub_emu-commands_videotest.o grub_emu-video_bitmap.o grub_emu-video_bitmap_scale.o grub_emu-video_bitmap_cache.o grub_emu-video_readers_tga.o grub_emu-video_readers_jpeg.o grub_emu-video_readers_png.o grub_emu-font_font_cmd.o grub_emu-font_font.o grub_emu-term_gfxterm.o grub_emu-io_bufio.o grub_emu-gfxmenu_gfxmenu.o grub_emu-gfxmenu_model.o grub_emu-gfxmenu_view.o grub_emu-gfxmenu_icon_manager.o grub_emu-gfxmenu_theme_loader.o grub_emu-gfxmenu_widget_box.o grub_emu-gfxmenu_gui_canvas.o grub_emu-gfxmenu_gui_circular_progress.o grub_emu-gfxmenu_gui_box.o grub_emu-gfxmenu_gui_label.o grub_emu-gfxmenu_gui_list.o grub_emu-gfxmenu_gui_image.o grub_emu-gfxmenu_gui_progress_bar.o grub_emu-gfxmenu_gui_util.o grub_emu-gfxmenu_gui_string_util.o grub_emu-gfxmenu_named_colors.o grub_emu-trigtables.o grub_emu-util_console.o grub_emu-util_hostfs.o grub_emu-util_grub_emu.o grub_emu-util_misc.o grub_emu-util_hostdisk.o grub_emu-util_getroot.o grub_emu-disk_raid.o grub_emu-disk_raid5_recover.o grub_emu-disk_raid6_recover.o grub_emu-disk_mdraid_linux.o grub_emu-disk_dmraid_nvidia.o grub_emu-disk_lvm.o grub_emu-commands_parttool.o grub_emu-parttool_msdospart.o grub_emu-lib_libgcrypt_grub_cipher_md5.o grub_emu-grub_emu_init.o grub_emu-gnulib_progname.o
 
 grub_emu-commands_minicmd.o: commands/minicmd.c $(commands/minicmd.c_DEPENDENCIES)
 	$(CC) -Icommands -I$(srcdir)/commands $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_emu_CFLAGS) -MD -c -o $@ $<
@@ -526,6 +527,10 @@ grub_emu-video_bitmap_scale.o: video/bitmap_scale.c $(video/bitmap_scale.c_DEPEN
 	$(CC) -Ivideo -I$(srcdir)/video $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_emu_CFLAGS) -MD -c -o $@ $<
 -include grub_emu-video_bitmap_scale.d
 
+grub_emu-video_bitmap_cache.o: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES)
+	$(CC) -Ivideo -I$(srcdir)/video $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_emu_CFLAGS) -MD -c -o $@ $<
+-include grub_emu-video_bitmap_cache.d
+
 grub_emu-video_readers_tga.o: video/readers/tga.c $(video/readers/tga.c_DEPENDENCIES)
 	$(CC) -Ivideo/readers -I$(srcdir)/video/readers $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_emu_CFLAGS) -MD -c -o $@ $<
 -include grub_emu-video_readers_tga.d
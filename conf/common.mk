@@ -4,19 +4,20 @@
 sbin_UTILITIES += grub-mkdevicemap
 grub_mkdevicemap_SOURCES = gnulib/progname.c util/grub-mkdevicemap.c \
 	util/deviceiter.c \
-	util/misc.c
+	util/misc.c \
+	kern/env.c kern/err.c kern/list.c kern/misc.c
 
 clean-utility-grub-mkdevicemap.1:
-	rm -f grub-mkdevicemap$(EXEEXT) grub_mkdevicemap-gnulib_progname.o grub_mkdevicemap-util_grub_mkdevicemap.o grub_mkdevicemap-util_deviceiter.o grub_mkdevicemap-util_misc.o
+	rm -f grub-mkdevicemap$(EXEEXT) grub_mkdevicemap-gnulib_progname.o grub_mkdevicemap-util_grub_mkdevicemap.o grub_mkdevicemap-util_deviceiter.o grub_mkdevicemap-util_misc.o grub_mkdevicemap-kern_env.o grub_mkdevicemap-kern_err.o grub_mkdevicemap-kern_list.o grub_mkdevicemap-kern_misc.o
 
 CLEAN_UTILITY_TARGETS += clean-utility-grub-mkdevicemap.1
 
 mostlyclean-utility-grub-mkdevicemap.1:
-	rm -f grub_mkdevicemap-gnulib_progname.d grub_mkdevicemap-util_grub_mkdevicemap.d grub_mkdevicemap-util_deviceiter.d grub_mkdevicemap-util_misc.d
+	rm -f grub_mkdevicemap-gnulib_progname.d grub_mkdevicemap-util_grub_mkdevicemap.d grub_mkdevicemap-util_deviceiter.d grub_mkdevicemap-util_misc.d grub_mkdevicemap-kern_env.d grub_mkdevicemap-kern_err.d grub_mkdevicemap-kern_list.d grub_mkdevicemap-kern_misc.d
 
 MOSTLYCLEAN_UTILITY_TARGETS += mostlyclean-utility-grub-mkdevicemap.1
 
-grub_mkdevicemap_OBJECTS += grub_mkdevicemap-gnulib_progname.o grub_mkdevicemap-util_grub_mkdevicemap.o grub_mkdevicemap-util_deviceiter.o grub_mkdevicemap-util_misc.o
+grub_mkdevicemap_OBJECTS += grub_mkdevicemap-gnulib_progname.o grub_mkdevicemap-util_grub_mkdevicemap.o grub_mkdevicemap-util_deviceiter.o grub_mkdevicemap-util_misc.o grub_mkdevicemap-kern_env.o grub_mkdevicemap-kern_err.o grub_mkdevicemap-kern_list.o grub_mkdevicemap-kern_misc.o
 
 grub_mkdevicemap-gnulib_progname.o: gnulib/progname.c $(gnulib/progname.c_DEPENDENCIES)
 	$(CC) -Ignulib -I$(srcdir)/gnulib $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_mkdevicemap_CFLAGS) -MD -c -o $@ $<
@@ -34,6 +35,22 @@ grub_mkdevicemap-util_misc.o: util/misc.c $(util/misc.c_DEPENDENCIES)
 	$(CC) -Iutil -I$(srcdir)/util $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_mkdevicemap_CFLAGS) -MD -c -o $@ $<
 -include grub_mkdevicemap-util_misc.d
 
+grub_mkdevicemap-kern_env.o: kern/env.c $(kern/env.c_DEPENDENCIES)
+	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_mkdevicemap_CFLAGS) -MD -c -o $@ $<
+-include grub_mkdevicemap-kern_env.d
+
+grub_mkdevicemap-kern_err.o: kern/err.c $(kern/err.c_DEPENDENCIES)
+	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_mkdevicemap_CFLAGS) -MD -c -o $@ $<
+-include grub_mkdevicemap-kern_err.d
+
+grub_mkdevicemap-kern_list.o: kern/list.c $(kern/list.c_DEPENDENCIES)
+	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_mkdevicemap_CFLAGS) -MD -c -o $@ $<
+-include grub_mkdevicemap-kern_list.d
+
+grub_mkdevicemap-kern_misc.o: kern/misc.c $(kern/misc.c_DEPENDENCIES)
+	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_mkdevicemap_CFLAGS) -MD -c -o $@ $<
+-include grub_mkdevicemap-kern_misc.d
+
 
 ifeq ($(target_cpu)-$(platform), sparc64-ieee1275)
 grub_mkdevicemap_SOURCES += util/ieee1275/ofpath.c util/ieee1275/devicemap.c
@@ -120,8 +137,9 @@ sbin_UTILITIES += grub-probe
 util/grub-probe.c_DEPENDENCIES = grub_probe_init.h
 grub_probe_SOURCES = gnulib/progname.c util/grub-probe.c	\
 	util/hostdisk.c	util/misc.c util/getroot.c		\
+	util/deviceiter.c					\
 	kern/device.c kern/disk.c kern/err.c kern/misc.c	\
-	kern/parser.c kern/partition.c kern/file.c		\
+	kern/parser.c kern/partition.c kern/file.c kern/list.c	\
 	\
 	fs/affs.c fs/cpio.c fs/fat.c fs/ext2.c fs/hfs.c		\
 	fs/hfsplus.c fs/iso9660.c fs/udf.c fs/jfs.c fs/minix.c	\
@@ -134,16 +152,16 @@ grub_probe_SOURCES = gnulib/progname.c util/grub-probe.c	\
 	disk/raid.c disk/mdraid_linux.c disk/lvm.c grub_probe_init.c
 
 clean-utility-grub-probe.1:
-	rm -f grub-probe$(EXEEXT) grub_probe-gnulib_progname.o grub_probe-util_grub_probe.o grub_probe-util_hostdisk.o grub_probe-util_misc.o grub_probe-util_getroot.o grub_probe-kern_device.o grub_probe-kern_disk.o grub_probe-kern_err.o grub_probe-kern_misc.o grub_probe-kern_parser.o grub_probe-kern_partition.o grub_probe-kern_file.o grub_probe-fs_affs.o grub_probe-fs_cpio.o grub_probe-fs_fat.o grub_probe-fs_ext2.o grub_probe-fs_hfs.o grub_probe-fs_hfsplus.o grub_probe-fs_iso9660.o grub_probe-fs_udf.o grub_probe-fs_jfs.o grub_probe-fs_minix.o grub_probe-fs_ntfs.o grub_probe-fs_ntfscomp.o grub_probe-fs_reiserfs.o grub_probe-fs_sfs.o grub_probe-fs_ufs.o grub_probe-fs_ufs2.o grub_probe-fs_xfs.o grub_probe-fs_afs.o grub_probe-fs_afs_be.o grub_probe-fs_befs.o grub_probe-fs_befs_be.o grub_probe-fs_tar.o grub_probe-partmap_msdos.o grub_probe-partmap_apple.o grub_probe-partmap_sun.o grub_probe-partmap_gpt.o grub_probe-kern_fs.o grub_probe-kern_env.o grub_probe-fs_fshelp.o grub_probe-disk_raid.o grub_probe-disk_mdraid_linux.o grub_probe-disk_lvm.o grub_probe-grub_probe_init.o
+	rm -f grub-probe$(EXEEXT) grub_probe-gnulib_progname.o grub_probe-util_grub_probe.o grub_probe-util_hostdisk.o grub_probe-util_misc.o grub_probe-util_getroot.o grub_probe-util_deviceiter.o grub_probe-kern_device.o grub_probe-kern_disk.o grub_probe-kern_err.o grub_probe-kern_misc.o grub_probe-kern_parser.o grub_probe-kern_partition.o grub_probe-kern_file.o grub_probe-kern_list.o grub_probe-fs_affs.o grub_probe-fs_cpio.o grub_probe-fs_fat.o grub_probe-fs_ext2.o grub_probe-fs_hfs.o grub_probe-fs_hfsplus.o grub_probe-fs_iso9660.o grub_probe-fs_udf.o grub_probe-fs_jfs.o grub_probe-fs_minix.o grub_probe-fs_ntfs.o grub_probe-fs_ntfscomp.o grub_probe-fs_reiserfs.o grub_probe-fs_sfs.o grub_probe-fs_ufs.o grub_probe-fs_ufs2.o grub_probe-fs_xfs.o grub_probe-fs_afs.o grub_probe-fs_afs_be.o grub_probe-fs_befs.o grub_probe-fs_befs_be.o grub_probe-fs_tar.o grub_probe-partmap_msdos.o grub_probe-partmap_apple.o grub_probe-partmap_sun.o grub_probe-partmap_gpt.o grub_probe-kern_fs.o grub_probe-kern_env.o grub_probe-fs_fshelp.o grub_probe-disk_raid.o grub_probe-disk_mdraid_linux.o grub_probe-disk_lvm.o grub_probe-grub_probe_init.o
 
 CLEAN_UTILITY_TARGETS += clean-utility-grub-probe.1
 
 mostlyclean-utility-grub-probe.1:
-	rm -f grub_probe-gnulib_progname.d grub_probe-util_grub_probe.d grub_probe-util_hostdisk.d grub_probe-util_misc.d grub_probe-util_getroot.d grub_probe-kern_device.d grub_probe-kern_disk.d grub_probe-kern_err.d grub_probe-kern_misc.d grub_probe-kern_parser.d grub_probe-kern_partition.d grub_probe-kern_file.d grub_probe-fs_affs.d grub_probe-fs_cpio.d grub_probe-fs_fat.d grub_probe-fs_ext2.d grub_probe-fs_hfs.d grub_probe-fs_hfsplus.d grub_probe-fs_iso9660.d grub_probe-fs_udf.d grub_probe-fs_jfs.d grub_probe-fs_minix.d grub_probe-fs_ntfs.d grub_probe-fs_ntfscomp.d grub_probe-fs_reiserfs.d grub_probe-fs_sfs.d grub_probe-fs_ufs.d grub_probe-fs_ufs2.d grub_probe-fs_xfs.d grub_probe-fs_afs.d grub_probe-fs_afs_be.d grub_probe-fs_befs.d grub_probe-fs_befs_be.d grub_probe-fs_tar.d grub_probe-partmap_msdos.d grub_probe-partmap_apple.d grub_probe-partmap_sun.d grub_probe-partmap_gpt.d grub_probe-kern_fs.d grub_probe-kern_env.d grub_probe-fs_fshelp.d grub_probe-disk_raid.d grub_probe-disk_mdraid_linux.d grub_probe-disk_lvm.d grub_probe-grub_probe_init.d
+	rm -f grub_probe-gnulib_progname.d grub_probe-util_grub_probe.d grub_probe-util_hostdisk.d grub_probe-util_misc.d grub_probe-util_getroot.d grub_probe-util_deviceiter.d grub_probe-kern_device.d grub_probe-kern_disk.d grub_probe-kern_err.d grub_probe-kern_misc.d grub_probe-kern_parser.d grub_probe-kern_partition.d grub_probe-kern_file.d grub_probe-kern_list.d grub_probe-fs_affs.d grub_probe-fs_cpio.d grub_probe-fs_fat.d grub_probe-fs_ext2.d grub_probe-fs_hfs.d grub_probe-fs_hfsplus.d grub_probe-fs_iso9660.d grub_probe-fs_udf.d grub_probe-fs_jfs.d grub_probe-fs_minix.d grub_probe-fs_ntfs.d grub_probe-fs_ntfscomp.d grub_probe-fs_reiserfs.d grub_probe-fs_sfs.d grub_probe-fs_ufs.d grub_probe-fs_ufs2.d grub_probe-fs_xfs.d grub_probe-fs_afs.d grub_probe-fs_afs_be.d grub_probe-fs_befs.d grub_probe-fs_befs_be.d grub_probe-fs_tar.d grub_probe-partmap_msdos.d grub_probe-partmap_apple.d grub_probe-partmap_sun.d grub_probe-partmap_gpt.d grub_probe-kern_fs.d grub_probe-kern_env.d grub_probe-fs_fshelp.d grub_probe-disk_raid.d grub_probe-disk_mdraid_linux.d grub_probe-disk_lvm.d grub_probe-grub_probe_init.d
 
 MOSTLYCLEAN_UTILITY_TARGETS += mostlyclean-utility-grub-probe.1
 
-grub_probe_OBJECTS += grub_probe-gnulib_progname.o grub_probe-util_grub_probe.o grub_probe-util_hostdisk.o grub_probe-util_misc.o grub_probe-util_getroot.o grub_probe-kern_device.o grub_probe-kern_disk.o grub_probe-kern_err.o grub_probe-kern_misc.o grub_probe-kern_parser.o grub_probe-kern_partition.o grub_probe-kern_file.o grub_probe-fs_affs.o grub_probe-fs_cpio.o grub_probe-fs_fat.o grub_probe-fs_ext2.o grub_probe-fs_hfs.o grub_probe-fs_hfsplus.o grub_probe-fs_iso9660.o grub_probe-fs_udf.o grub_probe-fs_jfs.o grub_probe-fs_minix.o grub_probe-fs_ntfs.o grub_probe-fs_ntfscomp.o grub_probe-fs_reiserfs.o grub_probe-fs_sfs.o grub_probe-fs_ufs.o grub_probe-fs_ufs2.o grub_probe-fs_xfs.o grub_probe-fs_afs.o grub_probe-fs_afs_be.o grub_probe-fs_befs.o grub_probe-fs_befs_be.o grub_probe-fs_tar.o grub_probe-partmap_msdos.o grub_probe-partmap_apple.o grub_probe-partmap_sun.o grub_probe-partmap_gpt.o grub_probe-kern_fs.o grub_probe-kern_env.o grub_probe-fs_fshelp.o grub_probe-disk_raid.o grub_probe-disk_mdraid_linux.o grub_probe-disk_lvm.o grub_probe-grub_probe_init.o
+grub_probe_OBJECTS += grub_probe-gnulib_progname.o grub_probe-util_grub_probe.o grub_probe-util_hostdisk.o grub_probe-util_misc.o grub_probe-util_getroot.o grub_probe-util_deviceiter.o grub_probe-kern_device.o grub_probe-kern_disk.o grub_probe-kern_err.o grub_probe-kern_misc.o grub_probe-kern_parser.o grub_probe-kern_partition.o grub_probe-kern_file.o grub_probe-kern_list.o grub_probe-fs_affs.o grub_probe-fs_cpio.o grub_probe-fs_fat.o grub_probe-fs_ext2.o grub_probe-fs_hfs.o grub_probe-fs_hfsplus.o grub_probe-fs_iso9660.o grub_probe-fs_udf.o grub_probe-fs_jfs.o grub_probe-fs_minix.o grub_probe-fs_ntfs.o grub_probe-fs_ntfscomp.o grub_probe-fs_reiserfs.o grub_probe-fs_sfs.o grub_probe-fs_ufs.o grub_probe-fs_ufs2.o grub_probe-fs_xfs.o grub_probe-fs_afs.o grub_probe-fs_afs_be.o grub_probe-fs_befs.o grub_probe-fs_befs_be.o grub_probe-fs_tar.o grub_probe-partmap_msdos.o grub_probe-partmap_apple.o grub_probe-partmap_sun.o grub_probe-partmap_gpt.o grub_probe-kern_fs.o grub_probe-kern_env.o grub_probe-fs_fshelp.o grub_probe-disk_raid.o grub_probe-disk_mdraid_linux.o grub_probe-disk_lvm.o grub_probe-grub_probe_init.o
 
 grub_probe-gnulib_progname.o: gnulib/progname.c $(gnulib/progname.c_DEPENDENCIES)
 	$(CC) -Ignulib -I$(srcdir)/gnulib $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_probe_CFLAGS) -MD -c -o $@ $<
@@ -165,6 +183,10 @@ grub_probe-util_getroot.o: util/getroot.c $(util/getroot.c_DEPENDENCIES)
 	$(CC) -Iutil -I$(srcdir)/util $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_probe_CFLAGS) -MD -c -o $@ $<
 -include grub_probe-util_getroot.d
 
+grub_probe-util_deviceiter.o: util/deviceiter.c $(util/deviceiter.c_DEPENDENCIES)
+	$(CC) -Iutil -I$(srcdir)/util $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_probe_CFLAGS) -MD -c -o $@ $<
+-include grub_probe-util_deviceiter.d
+
 grub_probe-kern_device.o: kern/device.c $(kern/device.c_DEPENDENCIES)
 	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_probe_CFLAGS) -MD -c -o $@ $<
 -include grub_probe-kern_device.d
@@ -193,6 +215,10 @@ grub_probe-kern_file.o: kern/file.c $(kern/file.c_DEPENDENCIES)
 	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_probe_CFLAGS) -MD -c -o $@ $<
 -include grub_probe-kern_file.d
 
+grub_probe-kern_list.o: kern/list.c $(kern/list.c_DEPENDENCIES)
+	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_probe_CFLAGS) -MD -c -o $@ $<
+-include grub_probe-kern_list.d
+
 grub_probe-fs_affs.o: fs/affs.c $(fs/affs.c_DEPENDENCIES)
 	$(CC) -Ifs -I$(srcdir)/fs $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_probe_CFLAGS) -MD -c -o $@ $<
 -include grub_probe-fs_affs.d
@@ -9934,6 +9960,104 @@ video-bitmap_scale_mod-video_bitmap_scale.lst: video/bitmap_scale.c $(video/bitm
 bitmap_scale_mod_CFLAGS = $(COMMON_CFLAGS)
 bitmap_scale_mod_LDFLAGS = $(COMMON_LDFLAGS)
 
+# For bitmap_cache.mod
+pkglib_MODULES += bitmap_cache.mod
+bitmap_cache_mod_SOURCES = video/bitmap_cache.c
+
+clean-module-bitmap_cache.mod.1:
+	rm -f bitmap_cache.mod mod-bitmap_cache.o mod-bitmap_cache.c pre-bitmap_cache.o bitmap_cache_mod-video_bitmap_cache.o und-bitmap_cache.lst
+
+CLEAN_MODULE_TARGETS += clean-module-bitmap_cache.mod.1
+
+clean-module-bitmap_cache.mod-symbol.1:
+	rm -f def-bitmap_cache.lst
+
+CLEAN_MODULE_TARGETS += clean-module-bitmap_cache.mod-symbol.1
+DEFSYMFILES += def-bitmap_cache.lst
+mostlyclean-module-bitmap_cache.mod.1:
+	rm -f bitmap_cache_mod-video_bitmap_cache.d
+
+MOSTLYCLEAN_MODULE_TARGETS += mostlyclean-module-bitmap_cache.mod.1
+UNDSYMFILES += und-bitmap_cache.lst
+
+ifneq ($(TARGET_APPLE_CC),1)
+bitmap_cache.mod: pre-bitmap_cache.o mod-bitmap_cache.o $(TARGET_OBJ2ELF)
+	-rm -f $@
+	$(TARGET_CC) $(bitmap_cache_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@ pre-bitmap_cache.o mod-bitmap_cache.o
+	if test ! -z "$(TARGET_OBJ2ELF)"; then ./$(TARGET_OBJ2ELF) $@ || (rm -f $@; exit 1); fi
+	$(STRIP) --strip-unneeded -K grub_mod_init -K grub_mod_fini -K _grub_mod_init -K _grub_mod_fini -R .note -R .comment $@
+else
+bitmap_cache.mod: pre-bitmap_cache.o mod-bitmap_cache.o $(TARGET_OBJ2ELF)
+	-rm -f $@
+	-rm -f $@.bin
+	$(TARGET_CC) $(bitmap_cache_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@.bin pre-bitmap_cache.o mod-bitmap_cache.o
+	$(OBJCONV) -f$(TARGET_MODULE_FORMAT) -nr:_grub_mod_init:grub_mod_init -nr:_grub_mod_fini:grub_mod_fini -wd1106 -nu -nd $@.bin $@
+	-rm -f $@.bin
+endif
+
+pre-bitmap_cache.o: $(bitmap_cache_mod_DEPENDENCIES) bitmap_cache_mod-video_bitmap_cache.o
+	-rm -f $@
+	$(TARGET_CC) $(bitmap_cache_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@ bitmap_cache_mod-video_bitmap_cache.o
+
+mod-bitmap_cache.o: mod-bitmap_cache.c
+	$(TARGET_CC) $(TARGET_CPPFLAGS) $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -c -o $@ $<
+
+mod-bitmap_cache.c: $(builddir)/moddep.lst $(srcdir)/genmodsrc.sh
+	sh $(srcdir)/genmodsrc.sh 'bitmap_cache' $< > $@ || (rm -f $@; exit 1)
+
+ifneq ($(TARGET_APPLE_CC),1)
+def-bitmap_cache.lst: pre-bitmap_cache.o
+	$(NM) -g --defined-only -P -p $< | sed 's/^\([^ ]*\).*/\1 bitmap_cache/' > $@
+else
+def-bitmap_cache.lst: pre-bitmap_cache.o
+	$(NM) -g -P -p $< | grep -E '^[a-zA-Z0-9_]* [TDS]'  | sed 's/^\([^ ]*\).*/\1 bitmap_cache/' > $@
+endif
+
+und-bitmap_cache.lst: pre-bitmap_cache.o
+	echo 'bitmap_cache' > $@
+	$(NM) -u -P -p $< | cut -f1 -d' ' >> $@
+
+bitmap_cache_mod-video_bitmap_cache.o: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES)
+	$(TARGET_CC) -Ivideo -I$(srcdir)/video $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -MD -c -o $@ $<
+-include bitmap_cache_mod-video_bitmap_cache.d
+
+clean-module-bitmap_cache_mod-video_bitmap_cache-extra.1:
+	rm -f cmd-bitmap_cache_mod-video_bitmap_cache.lst fs-bitmap_cache_mod-video_bitmap_cache.lst partmap-bitmap_cache_mod-video_bitmap_cache.lst handler-bitmap_cache_mod-video_bitmap_cache.lst parttool-bitmap_cache_mod-video_bitmap_cache.lst video-bitmap_cache_mod-video_bitmap_cache.lst terminal-bitmap_cache_mod-video_bitmap_cache.lst
+
+CLEAN_MODULE_TARGETS += clean-module-bitmap_cache_mod-video_bitmap_cache-extra.1
+
+COMMANDFILES += cmd-bitmap_cache_mod-video_bitmap_cache.lst
+FSFILES += fs-bitmap_cache_mod-video_bitmap_cache.lst
+PARTTOOLFILES += parttool-bitmap_cache_mod-video_bitmap_cache.lst
+PARTMAPFILES += partmap-bitmap_cache_mod-video_bitmap_cache.lst
+HANDLERFILES += handler-bitmap_cache_mod-video_bitmap_cache.lst
+TERMINALFILES += terminal-bitmap_cache_mod-video_bitmap_cache.lst
+VIDEOFILES += video-bitmap_cache_mod-video_bitmap_cache.lst
+
+cmd-bitmap_cache_mod-video_bitmap_cache.lst: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES) gencmdlist.sh
+	set -e; 	  $(TARGET_CC) -Ivideo -I$(srcdir)/video $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -E $< 	  | sh $(srcdir)/gencmdlist.sh bitmap_cache > $@ || (rm -f $@; exit 1)
+
+fs-bitmap_cache_mod-video_bitmap_cache.lst: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES) genfslist.sh
+	set -e; 	  $(TARGET_CC) -Ivideo -I$(srcdir)/video $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genfslist.sh bitmap_cache > $@ || (rm -f $@; exit 1)
+
+parttool-bitmap_cache_mod-video_bitmap_cache.lst: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES) genparttoollist.sh
+	set -e; 	  $(TARGET_CC) -Ivideo -I$(srcdir)/video $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genparttoollist.sh bitmap_cache > $@ || (rm -f $@; exit 1)
+
+partmap-bitmap_cache_mod-video_bitmap_cache.lst: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES) genpartmaplist.sh
+	set -e; 	  $(TARGET_CC) -Ivideo -I$(srcdir)/video $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genpartmaplist.sh bitmap_cache > $@ || (rm -f $@; exit 1)
+
+handler-bitmap_cache_mod-video_bitmap_cache.lst: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES) genhandlerlist.sh
+	set -e; 	  $(TARGET_CC) -Ivideo -I$(srcdir)/video $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genhandlerlist.sh bitmap_cache > $@ || (rm -f $@; exit 1)
+
+terminal-bitmap_cache_mod-video_bitmap_cache.lst: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES) genterminallist.sh
+	set -e; 	  $(TARGET_CC) -Ivideo -I$(srcdir)/video $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genterminallist.sh bitmap_cache > $@ || (rm -f $@; exit 1)
+
+video-bitmap_cache_mod-video_bitmap_cache.lst: video/bitmap_cache.c $(video/bitmap_cache.c_DEPENDENCIES) genvideolist.sh
+	set -e; 	  $(TARGET_CC) -Ivideo -I$(srcdir)/video $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(bitmap_cache_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genvideolist.sh bitmap_cache > $@ || (rm -f $@; exit 1)
+
+bitmap_cache_mod_CFLAGS = $(COMMON_CFLAGS)
+bitmap_cache_mod_LDFLAGS = $(COMMON_LDFLAGS)
+
 pkglib_MODULES += font.mod
 font_mod_SOURCES = font/font_cmd.c font/font.c
 
@@ -442,9 +442,11 @@ util/grub-mkrawimage.c_DEPENDENCIES = Makefile
 util/i386/pc/grub-setup.c_DEPENDENCIES = grub_setup_init.h
 grub_setup_SOURCES = gnulib/progname.c \
 	util/i386/pc/grub-setup.c util/hostdisk.c	\
-	util/misc.c util/getroot.c kern/device.c kern/disk.c	\
+	util/misc.c util/getroot.c util/deviceiter.c		\
+	kern/device.c kern/disk.c				\
 	kern/err.c kern/misc.c kern/parser.c kern/partition.c	\
-	kern/file.c kern/fs.c kern/env.c fs/fshelp.c		\
+	kern/file.c kern/fs.c kern/env.c kern/list.c		\
+	fs/fshelp.c						\
 	\
 	fs/affs.c fs/cpio.c fs/ext2.c fs/fat.c fs/hfs.c		\
 	fs/hfsplus.c fs/iso9660.c fs/udf.c fs/jfs.c fs/minix.c	\
@@ -459,16 +461,16 @@ grub_setup_SOURCES = gnulib/progname.c \
 	grub_setup_init.c
 
 clean-utility-grub-setup.1:
-	rm -f grub-setup$(EXEEXT) grub_setup-gnulib_progname.o grub_setup-util_i386_pc_grub_setup.o grub_setup-util_hostdisk.o grub_setup-util_misc.o grub_setup-util_getroot.o grub_setup-kern_device.o grub_setup-kern_disk.o grub_setup-kern_err.o grub_setup-kern_misc.o grub_setup-kern_parser.o grub_setup-kern_partition.o grub_setup-kern_file.o grub_setup-kern_fs.o grub_setup-kern_env.o grub_setup-fs_fshelp.o grub_setup-fs_affs.o grub_setup-fs_cpio.o grub_setup-fs_ext2.o grub_setup-fs_fat.o grub_setup-fs_hfs.o grub_setup-fs_hfsplus.o grub_setup-fs_iso9660.o grub_setup-fs_udf.o grub_setup-fs_jfs.o grub_setup-fs_minix.o grub_setup-fs_ntfs.o grub_setup-fs_ntfscomp.o grub_setup-fs_reiserfs.o grub_setup-fs_sfs.o grub_setup-fs_ufs.o grub_setup-fs_ufs2.o grub_setup-fs_xfs.o grub_setup-fs_afs.o grub_setup-fs_afs_be.o grub_setup-fs_befs.o grub_setup-fs_befs_be.o grub_setup-fs_tar.o grub_setup-partmap_msdos.o grub_setup-partmap_gpt.o grub_setup-disk_raid.o grub_setup-disk_mdraid_linux.o grub_setup-disk_lvm.o grub_setup-util_raid.o grub_setup-util_lvm.o grub_setup-grub_setup_init.o
+	rm -f grub-setup$(EXEEXT) grub_setup-gnulib_progname.o grub_setup-util_i386_pc_grub_setup.o grub_setup-util_hostdisk.o grub_setup-util_misc.o grub_setup-util_getroot.o grub_setup-util_deviceiter.o grub_setup-kern_device.o grub_setup-kern_disk.o grub_setup-kern_err.o grub_setup-kern_misc.o grub_setup-kern_parser.o grub_setup-kern_partition.o grub_setup-kern_file.o grub_setup-kern_fs.o grub_setup-kern_env.o grub_setup-kern_list.o grub_setup-fs_fshelp.o grub_setup-fs_affs.o grub_setup-fs_cpio.o grub_setup-fs_ext2.o grub_setup-fs_fat.o grub_setup-fs_hfs.o grub_setup-fs_hfsplus.o grub_setup-fs_iso9660.o grub_setup-fs_udf.o grub_setup-fs_jfs.o grub_setup-fs_minix.o grub_setup-fs_ntfs.o grub_setup-fs_ntfscomp.o grub_setup-fs_reiserfs.o grub_setup-fs_sfs.o grub_setup-fs_ufs.o grub_setup-fs_ufs2.o grub_setup-fs_xfs.o grub_setup-fs_afs.o grub_setup-fs_afs_be.o grub_setup-fs_befs.o grub_setup-fs_befs_be.o grub_setup-fs_tar.o grub_setup-partmap_msdos.o grub_setup-partmap_gpt.o grub_setup-disk_raid.o grub_setup-disk_mdraid_linux.o grub_setup-disk_lvm.o grub_setup-util_raid.o grub_setup-util_lvm.o grub_setup-grub_setup_init.o
 
 CLEAN_UTILITY_TARGETS += clean-utility-grub-setup.1
 
 mostlyclean-utility-grub-setup.1:
-	rm -f grub_setup-gnulib_progname.d grub_setup-util_i386_pc_grub_setup.d grub_setup-util_hostdisk.d grub_setup-util_misc.d grub_setup-util_getroot.d grub_setup-kern_device.d grub_setup-kern_disk.d grub_setup-kern_err.d grub_setup-kern_misc.d grub_setup-kern_parser.d grub_setup-kern_partition.d grub_setup-kern_file.d grub_setup-kern_fs.d grub_setup-kern_env.d grub_setup-fs_fshelp.d grub_setup-fs_affs.d grub_setup-fs_cpio.d grub_setup-fs_ext2.d grub_setup-fs_fat.d grub_setup-fs_hfs.d grub_setup-fs_hfsplus.d grub_setup-fs_iso9660.d grub_setup-fs_udf.d grub_setup-fs_jfs.d grub_setup-fs_minix.d grub_setup-fs_ntfs.d grub_setup-fs_ntfscomp.d grub_setup-fs_reiserfs.d grub_setup-fs_sfs.d grub_setup-fs_ufs.d grub_setup-fs_ufs2.d grub_setup-fs_xfs.d grub_setup-fs_afs.d grub_setup-fs_afs_be.d grub_setup-fs_befs.d grub_setup-fs_befs_be.d grub_setup-fs_tar.d grub_setup-partmap_msdos.d grub_setup-partmap_gpt.d grub_setup-disk_raid.d grub_setup-disk_mdraid_linux.d grub_setup-disk_lvm.d grub_setup-util_raid.d grub_setup-util_lvm.d grub_setup-grub_setup_init.d
+	rm -f grub_setup-gnulib_progname.d grub_setup-util_i386_pc_grub_setup.d grub_setup-util_hostdisk.d grub_setup-util_misc.d grub_setup-util_getroot.d grub_setup-util_deviceiter.d grub_setup-kern_device.d grub_setup-kern_disk.d grub_setup-kern_err.d grub_setup-kern_misc.d grub_setup-kern_parser.d grub_setup-kern_partition.d grub_setup-kern_file.d grub_setup-kern_fs.d grub_setup-kern_env.d grub_setup-kern_list.d grub_setup-fs_fshelp.d grub_setup-fs_affs.d grub_setup-fs_cpio.d grub_setup-fs_ext2.d grub_setup-fs_fat.d grub_setup-fs_hfs.d grub_setup-fs_hfsplus.d grub_setup-fs_iso9660.d grub_setup-fs_udf.d grub_setup-fs_jfs.d grub_setup-fs_minix.d grub_setup-fs_ntfs.d grub_setup-fs_ntfscomp.d grub_setup-fs_reiserfs.d grub_setup-fs_sfs.d grub_setup-fs_ufs.d grub_setup-fs_ufs2.d grub_setup-fs_xfs.d grub_setup-fs_afs.d grub_setup-fs_afs_be.d grub_setup-fs_befs.d grub_setup-fs_befs_be.d grub_setup-fs_tar.d grub_setup-partmap_msdos.d grub_setup-partmap_gpt.d grub_setup-disk_raid.d grub_setup-disk_mdraid_linux.d grub_setup-disk_lvm.d grub_setup-util_raid.d grub_setup-util_lvm.d grub_setup-grub_setup_init.d
 
 MOSTLYCLEAN_UTILITY_TARGETS += mostlyclean-utility-grub-setup.1
 
-grub_setup_OBJECTS += grub_setup-gnulib_progname.o grub_setup-util_i386_pc_grub_setup.o grub_setup-util_hostdisk.o grub_setup-util_misc.o grub_setup-util_getroot.o grub_setup-kern_device.o grub_setup-kern_disk.o grub_setup-kern_err.o grub_setup-kern_misc.o grub_setup-kern_parser.o grub_setup-kern_partition.o grub_setup-kern_file.o grub_setup-kern_fs.o grub_setup-kern_env.o grub_setup-fs_fshelp.o grub_setup-fs_affs.o grub_setup-fs_cpio.o grub_setup-fs_ext2.o grub_setup-fs_fat.o grub_setup-fs_hfs.o grub_setup-fs_hfsplus.o grub_setup-fs_iso9660.o grub_setup-fs_udf.o grub_setup-fs_jfs.o grub_setup-fs_minix.o grub_setup-fs_ntfs.o grub_setup-fs_ntfscomp.o grub_setup-fs_reiserfs.o grub_setup-fs_sfs.o grub_setup-fs_ufs.o grub_setup-fs_ufs2.o grub_setup-fs_xfs.o grub_setup-fs_afs.o grub_setup-fs_afs_be.o grub_setup-fs_befs.o grub_setup-fs_befs_be.o grub_setup-fs_tar.o grub_setup-partmap_msdos.o grub_setup-partmap_gpt.o grub_setup-disk_raid.o grub_setup-disk_mdraid_linux.o grub_setup-disk_lvm.o grub_setup-util_raid.o grub_setup-util_lvm.o grub_setup-grub_setup_init.o
+grub_setup_OBJECTS += grub_setup-gnulib_progname.o grub_setup-util_i386_pc_grub_setup.o grub_setup-util_hostdisk.o grub_setup-util_misc.o grub_setup-util_getroot.o grub_setup-util_deviceiter.o grub_setup-kern_device.o grub_setup-kern_disk.o grub_setup-kern_err.o grub_setup-kern_misc.o grub_setup-kern_parser.o grub_setup-kern_partition.o grub_setup-kern_file.o grub_setup-kern_fs.o grub_setup-kern_env.o grub_setup-kern_list.o grub_setup-fs_fshelp.o grub_setup-fs_affs.o grub_setup-fs_cpio.o grub_setup-fs_ext2.o grub_setup-fs_fat.o grub_setup-fs_hfs.o grub_setup-fs_hfsplus.o grub_setup-fs_iso9660.o grub_setup-fs_udf.o grub_setup-fs_jfs.o grub_setup-fs_minix.o grub_setup-fs_ntfs.o grub_setup-fs_ntfscomp.o grub_setup-fs_reiserfs.o grub_setup-fs_sfs.o grub_setup-fs_ufs.o grub_setup-fs_ufs2.o grub_setup-fs_xfs.o grub_setup-fs_afs.o grub_setup-fs_afs_be.o grub_setup-fs_befs.o grub_setup-fs_befs_be.o grub_setup-fs_tar.o grub_setup-partmap_msdos.o grub_setup-partmap_gpt.o grub_setup-disk_raid.o grub_setup-disk_mdraid_linux.o grub_setup-disk_lvm.o grub_setup-util_raid.o grub_setup-util_lvm.o grub_setup-grub_setup_init.o
 
 grub_setup-gnulib_progname.o: gnulib/progname.c $(gnulib/progname.c_DEPENDENCIES)
 	$(CC) -Ignulib -I$(srcdir)/gnulib $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_setup_CFLAGS) -MD -c -o $@ $<
@@ -490,6 +492,10 @@ grub_setup-util_getroot.o: util/getroot.c $(util/getroot.c_DEPENDENCIES)
 	$(CC) -Iutil -I$(srcdir)/util $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_setup_CFLAGS) -MD -c -o $@ $<
 -include grub_setup-util_getroot.d
 
+grub_setup-util_deviceiter.o: util/deviceiter.c $(util/deviceiter.c_DEPENDENCIES)
+	$(CC) -Iutil -I$(srcdir)/util $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_setup_CFLAGS) -MD -c -o $@ $<
+-include grub_setup-util_deviceiter.d
+
 grub_setup-kern_device.o: kern/device.c $(kern/device.c_DEPENDENCIES)
 	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_setup_CFLAGS) -MD -c -o $@ $<
 -include grub_setup-kern_device.d
@@ -526,6 +532,10 @@ grub_setup-kern_env.o: kern/env.c $(kern/env.c_DEPENDENCIES)
 	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_setup_CFLAGS) -MD -c -o $@ $<
 -include grub_setup-kern_env.d
 
+grub_setup-kern_list.o: kern/list.c $(kern/list.c_DEPENDENCIES)
+	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_setup_CFLAGS) -MD -c -o $@ $<
+-include grub_setup-kern_list.d
+
 grub_setup-fs_fshelp.o: fs/fshelp.c $(fs/fshelp.c_DEPENDENCIES)
 	$(CC) -Ifs -I$(srcdir)/fs $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(grub_setup_CFLAGS) -MD -c -o $@ $<
 -include grub_setup-fs_fshelp.d
@@ -675,7 +685,8 @@ pkglib_MODULES = biosdisk.mod chain.mod 				\
 	vga.mod memdisk.mod pci.mod lspci.mod				\
 	aout.mod bsd.mod pxe.mod pxecmd.mod datetime.mod date.mod 	\
 	datehook.mod lsmmap.mod ata_pthru.mod hdparm.mod 		\
-	usb.mod uhci.mod ohci.mod usbtest.mod usbms.mod usb_keyboard.mod \
+	usb.mod uhci.mod ohci.mod ehci.mod usbtest.mod usbms.mod	\
+	usb_keyboard.mod \
 	efiemu.mod mmap.mod acpi.mod drivemap.mod
 
 # For boot.mod.
@@ -4488,6 +4499,103 @@ video-ohci_mod-bus_usb_ohci.lst: bus/usb/ohci.c $(bus/usb/ohci.c_DEPENDENCIES) g
 ohci_mod_CFLAGS = $(COMMON_CFLAGS)
 ohci_mod_LDFLAGS = $(COMMON_LDFLAGS)
 
+# For ehci.mod
+ehci_mod_SOURCES = bus/usb/ehci.c
+
+clean-module-ehci.mod.1:
+	rm -f ehci.mod mod-ehci.o mod-ehci.c pre-ehci.o ehci_mod-bus_usb_ehci.o und-ehci.lst
+
+CLEAN_MODULE_TARGETS += clean-module-ehci.mod.1
+
+clean-module-ehci.mod-symbol.1:
+	rm -f def-ehci.lst
+
+CLEAN_MODULE_TARGETS += clean-module-ehci.mod-symbol.1
+DEFSYMFILES += def-ehci.lst
+mostlyclean-module-ehci.mod.1:
+	rm -f ehci_mod-bus_usb_ehci.d
+
+MOSTLYCLEAN_MODULE_TARGETS += mostlyclean-module-ehci.mod.1
+UNDSYMFILES += und-ehci.lst
+
+ifneq ($(TARGET_APPLE_CC),1)
+ehci.mod: pre-ehci.o mod-ehci.o $(TARGET_OBJ2ELF)
+	-rm -f $@
+	$(TARGET_CC) $(ehci_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@ pre-ehci.o mod-ehci.o
+	if test ! -z "$(TARGET_OBJ2ELF)"; then ./$(TARGET_OBJ2ELF) $@ || (rm -f $@; exit 1); fi
+	$(STRIP) --strip-unneeded -K grub_mod_init -K grub_mod_fini -K _grub_mod_init -K _grub_mod_fini -R .note -R .comment $@
+else
+ehci.mod: pre-ehci.o mod-ehci.o $(TARGET_OBJ2ELF)
+	-rm -f $@
+	-rm -f $@.bin
+	$(TARGET_CC) $(ehci_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@.bin pre-ehci.o mod-ehci.o
+	$(OBJCONV) -f$(TARGET_MODULE_FORMAT) -nr:_grub_mod_init:grub_mod_init -nr:_grub_mod_fini:grub_mod_fini -wd1106 -nu -nd $@.bin $@
+	-rm -f $@.bin
+endif
+
+pre-ehci.o: $(ehci_mod_DEPENDENCIES) ehci_mod-bus_usb_ehci.o
+	-rm -f $@
+	$(TARGET_CC) $(ehci_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@ ehci_mod-bus_usb_ehci.o
+
+mod-ehci.o: mod-ehci.c
+	$(TARGET_CC) $(TARGET_CPPFLAGS) $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -c -o $@ $<
+
+mod-ehci.c: $(builddir)/moddep.lst $(srcdir)/genmodsrc.sh
+	sh $(srcdir)/genmodsrc.sh 'ehci' $< > $@ || (rm -f $@; exit 1)
+
+ifneq ($(TARGET_APPLE_CC),1)
+def-ehci.lst: pre-ehci.o
+	$(NM) -g --defined-only -P -p $< | sed 's/^\([^ ]*\).*/\1 ehci/' > $@
+else
+def-ehci.lst: pre-ehci.o
+	$(NM) -g -P -p $< | grep -E '^[a-zA-Z0-9_]* [TDS]'  | sed 's/^\([^ ]*\).*/\1 ehci/' > $@
+endif
+
+und-ehci.lst: pre-ehci.o
+	echo 'ehci' > $@
+	$(NM) -u -P -p $< | cut -f1 -d' ' >> $@
+
+ehci_mod-bus_usb_ehci.o: bus/usb/ehci.c $(bus/usb/ehci.c_DEPENDENCIES)
+	$(TARGET_CC) -Ibus/usb -I$(srcdir)/bus/usb $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -MD -c -o $@ $<
+-include ehci_mod-bus_usb_ehci.d
+
+clean-module-ehci_mod-bus_usb_ehci-extra.1:
+	rm -f cmd-ehci_mod-bus_usb_ehci.lst fs-ehci_mod-bus_usb_ehci.lst partmap-ehci_mod-bus_usb_ehci.lst handler-ehci_mod-bus_usb_ehci.lst parttool-ehci_mod-bus_usb_ehci.lst video-ehci_mod-bus_usb_ehci.lst terminal-ehci_mod-bus_usb_ehci.lst
+
+CLEAN_MODULE_TARGETS += clean-module-ehci_mod-bus_usb_ehci-extra.1
+
+COMMANDFILES += cmd-ehci_mod-bus_usb_ehci.lst
+FSFILES += fs-ehci_mod-bus_usb_ehci.lst
+PARTTOOLFILES += parttool-ehci_mod-bus_usb_ehci.lst
+PARTMAPFILES += partmap-ehci_mod-bus_usb_ehci.lst
+HANDLERFILES += handler-ehci_mod-bus_usb_ehci.lst
+TERMINALFILES += terminal-ehci_mod-bus_usb_ehci.lst
+VIDEOFILES += video-ehci_mod-bus_usb_ehci.lst
+
+cmd-ehci_mod-bus_usb_ehci.lst: bus/usb/ehci.c $(bus/usb/ehci.c_DEPENDENCIES) gencmdlist.sh
+	set -e; 	  $(TARGET_CC) -Ibus/usb -I$(srcdir)/bus/usb $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/gencmdlist.sh ehci > $@ || (rm -f $@; exit 1)
+
+fs-ehci_mod-bus_usb_ehci.lst: bus/usb/ehci.c $(bus/usb/ehci.c_DEPENDENCIES) genfslist.sh
+	set -e; 	  $(TARGET_CC) -Ibus/usb -I$(srcdir)/bus/usb $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genfslist.sh ehci > $@ || (rm -f $@; exit 1)
+
+parttool-ehci_mod-bus_usb_ehci.lst: bus/usb/ehci.c $(bus/usb/ehci.c_DEPENDENCIES) genparttoollist.sh
+	set -e; 	  $(TARGET_CC) -Ibus/usb -I$(srcdir)/bus/usb $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genparttoollist.sh ehci > $@ || (rm -f $@; exit 1)
+
+partmap-ehci_mod-bus_usb_ehci.lst: bus/usb/ehci.c $(bus/usb/ehci.c_DEPENDENCIES) genpartmaplist.sh
+	set -e; 	  $(TARGET_CC) -Ibus/usb -I$(srcdir)/bus/usb $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genpartmaplist.sh ehci > $@ || (rm -f $@; exit 1)
+
+handler-ehci_mod-bus_usb_ehci.lst: bus/usb/ehci.c $(bus/usb/ehci.c_DEPENDENCIES) genhandlerlist.sh
+	set -e; 	  $(TARGET_CC) -Ibus/usb -I$(srcdir)/bus/usb $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genhandlerlist.sh ehci > $@ || (rm -f $@; exit 1)
+
+terminal-ehci_mod-bus_usb_ehci.lst: bus/usb/ehci.c $(bus/usb/ehci.c_DEPENDENCIES) genterminallist.sh
+	set -e; 	  $(TARGET_CC) -Ibus/usb -I$(srcdir)/bus/usb $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genterminallist.sh ehci > $@ || (rm -f $@; exit 1)
+
+video-ehci_mod-bus_usb_ehci.lst: bus/usb/ehci.c $(bus/usb/ehci.c_DEPENDENCIES) genvideolist.sh
+	set -e; 	  $(TARGET_CC) -Ibus/usb -I$(srcdir)/bus/usb $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ehci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genvideolist.sh ehci > $@ || (rm -f $@; exit 1)
+
+ehci_mod_CFLAGS = $(COMMON_CFLAGS)
+ehci_mod_LDFLAGS = $(COMMON_LDFLAGS)
+
 # For usbms.mod
 usbms_mod_SOURCES = disk/usbms.c
 
@@ -601,6 +601,103 @@ video-ata_mod-disk_ata.lst: disk/ata.c $(disk/ata.c_DEPENDENCIES) genvideolist.s
 ata_mod_CFLAGS = $(COMMON_CFLAGS)
 ata_mod_LDFLAGS = $(COMMON_LDFLAGS)
 
+pkglib_MODULES += ahci.mod
+ahci_mod_SOURCES = disk/ahci.c
+
+clean-module-ahci.mod.1:
+	rm -f ahci.mod mod-ahci.o mod-ahci.c pre-ahci.o ahci_mod-disk_ahci.o und-ahci.lst
+
+CLEAN_MODULE_TARGETS += clean-module-ahci.mod.1
+
+clean-module-ahci.mod-symbol.1:
+	rm -f def-ahci.lst
+
+CLEAN_MODULE_TARGETS += clean-module-ahci.mod-symbol.1
+DEFSYMFILES += def-ahci.lst
+mostlyclean-module-ahci.mod.1:
+	rm -f ahci_mod-disk_ahci.d
+
+MOSTLYCLEAN_MODULE_TARGETS += mostlyclean-module-ahci.mod.1
+UNDSYMFILES += und-ahci.lst
+
+ifneq ($(TARGET_APPLE_CC),1)
+ahci.mod: pre-ahci.o mod-ahci.o $(TARGET_OBJ2ELF)
+	-rm -f $@
+	$(TARGET_CC) $(ahci_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@ pre-ahci.o mod-ahci.o
+	if test ! -z "$(TARGET_OBJ2ELF)"; then ./$(TARGET_OBJ2ELF) $@ || (rm -f $@; exit 1); fi
+	$(STRIP) --strip-unneeded -K grub_mod_init -K grub_mod_fini -K _grub_mod_init -K _grub_mod_fini -R .note -R .comment $@
+else
+ahci.mod: pre-ahci.o mod-ahci.o $(TARGET_OBJ2ELF)
+	-rm -f $@
+	-rm -f $@.bin
+	$(TARGET_CC) $(ahci_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@.bin pre-ahci.o mod-ahci.o
+	$(OBJCONV) -f$(TARGET_MODULE_FORMAT) -nr:_grub_mod_init:grub_mod_init -nr:_grub_mod_fini:grub_mod_fini -wd1106 -nu -nd $@.bin $@
+	-rm -f $@.bin
+endif
+
+pre-ahci.o: $(ahci_mod_DEPENDENCIES) ahci_mod-disk_ahci.o
+	-rm -f $@
+	$(TARGET_CC) $(ahci_mod_LDFLAGS) $(TARGET_LDFLAGS) -Wl,-r,-d -o $@ ahci_mod-disk_ahci.o
+
+mod-ahci.o: mod-ahci.c
+	$(TARGET_CC) $(TARGET_CPPFLAGS) $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -c -o $@ $<
+
+mod-ahci.c: $(builddir)/moddep.lst $(srcdir)/genmodsrc.sh
+	sh $(srcdir)/genmodsrc.sh 'ahci' $< > $@ || (rm -f $@; exit 1)
+
+ifneq ($(TARGET_APPLE_CC),1)
+def-ahci.lst: pre-ahci.o
+	$(NM) -g --defined-only -P -p $< | sed 's/^\([^ ]*\).*/\1 ahci/' > $@
+else
+def-ahci.lst: pre-ahci.o
+	$(NM) -g -P -p $< | grep -E '^[a-zA-Z0-9_]* [TDS]'  | sed 's/^\([^ ]*\).*/\1 ahci/' > $@
+endif
+
+und-ahci.lst: pre-ahci.o
+	echo 'ahci' > $@
+	$(NM) -u -P -p $< | cut -f1 -d' ' >> $@
+
+ahci_mod-disk_ahci.o: disk/ahci.c $(disk/ahci.c_DEPENDENCIES)
+	$(TARGET_CC) -Idisk -I$(srcdir)/disk $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -MD -c -o $@ $<
+-include ahci_mod-disk_ahci.d
+
+clean-module-ahci_mod-disk_ahci-extra.1:
+	rm -f cmd-ahci_mod-disk_ahci.lst fs-ahci_mod-disk_ahci.lst partmap-ahci_mod-disk_ahci.lst handler-ahci_mod-disk_ahci.lst parttool-ahci_mod-disk_ahci.lst video-ahci_mod-disk_ahci.lst terminal-ahci_mod-disk_ahci.lst
+
+CLEAN_MODULE_TARGETS += clean-module-ahci_mod-disk_ahci-extra.1
+
+COMMANDFILES += cmd-ahci_mod-disk_ahci.lst
+FSFILES += fs-ahci_mod-disk_ahci.lst
+PARTTOOLFILES += parttool-ahci_mod-disk_ahci.lst
+PARTMAPFILES += partmap-ahci_mod-disk_ahci.lst
+HANDLERFILES += handler-ahci_mod-disk_ahci.lst
+TERMINALFILES += terminal-ahci_mod-disk_ahci.lst
+VIDEOFILES += video-ahci_mod-disk_ahci.lst
+
+cmd-ahci_mod-disk_ahci.lst: disk/ahci.c $(disk/ahci.c_DEPENDENCIES) gencmdlist.sh
+	set -e; 	  $(TARGET_CC) -Idisk -I$(srcdir)/disk $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/gencmdlist.sh ahci > $@ || (rm -f $@; exit 1)
+
+fs-ahci_mod-disk_ahci.lst: disk/ahci.c $(disk/ahci.c_DEPENDENCIES) genfslist.sh
+	set -e; 	  $(TARGET_CC) -Idisk -I$(srcdir)/disk $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genfslist.sh ahci > $@ || (rm -f $@; exit 1)
+
+parttool-ahci_mod-disk_ahci.lst: disk/ahci.c $(disk/ahci.c_DEPENDENCIES) genparttoollist.sh
+	set -e; 	  $(TARGET_CC) -Idisk -I$(srcdir)/disk $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genparttoollist.sh ahci > $@ || (rm -f $@; exit 1)
+
+partmap-ahci_mod-disk_ahci.lst: disk/ahci.c $(disk/ahci.c_DEPENDENCIES) genpartmaplist.sh
+	set -e; 	  $(TARGET_CC) -Idisk -I$(srcdir)/disk $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genpartmaplist.sh ahci > $@ || (rm -f $@; exit 1)
+
+handler-ahci_mod-disk_ahci.lst: disk/ahci.c $(disk/ahci.c_DEPENDENCIES) genhandlerlist.sh
+	set -e; 	  $(TARGET_CC) -Idisk -I$(srcdir)/disk $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genhandlerlist.sh ahci > $@ || (rm -f $@; exit 1)
+
+terminal-ahci_mod-disk_ahci.lst: disk/ahci.c $(disk/ahci.c_DEPENDENCIES) genterminallist.sh
+	set -e; 	  $(TARGET_CC) -Idisk -I$(srcdir)/disk $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genterminallist.sh ahci > $@ || (rm -f $@; exit 1)
+
+video-ahci_mod-disk_ahci.lst: disk/ahci.c $(disk/ahci.c_DEPENDENCIES) genvideolist.sh
+	set -e; 	  $(TARGET_CC) -Idisk -I$(srcdir)/disk $(TARGET_CPPFLAGS)  $(TARGET_CFLAGS) $(ahci_mod_CFLAGS) -E $< 	  | sh $(srcdir)/genvideolist.sh ahci > $@ || (rm -f $@; exit 1)
+
+ahci_mod_CFLAGS = $(COMMON_CFLAGS)
+ahci_mod_LDFLAGS = $(COMMON_LDFLAGS)
+
 # For setpci.mod
 pkglib_MODULES += setpci.mod
 setpci_mod_SOURCES = commands/setpci.c
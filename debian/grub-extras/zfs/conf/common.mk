@@ -310,3 +310,57 @@ video-zfsinfo_mod-__GRUB_CONTRIB__zfs_zfsinfo.lst: $(GRUB_CONTRIB)/zfs/zfsinfo.c
 
 zfsinfo_mod_CFLAGS = $(COMMON_CFLAGS) -Wno-error
 zfsinfo_mod_LDFLAGS = $(COMMON_LDFLAGS)
+
+# Correctness checks and timings for the checksum and decompression kernels.
+check_UTILITIES += zfs_kernels_test
+zfs_kernels_test_SOURCES = $(GRUB_CONTRIB)/zfs/zfs_kernels_test.c $(GRUB_CONTRIB)/zfs/zfs_lzjb.c $(GRUB_CONTRIB)/zfs/zfs_sha256.c $(GRUB_CONTRIB)/zfs/zfs_fletcher.c kern/list.c kern/misc.c tests/lib/test.c tests/lib/unit_test.c
+
+clean-utility-zfs_kernels_test.1:
+	rm -f zfs_kernels_test$(EXEEXT) zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_kernels_test.o zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_lzjb.o zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_sha256.o zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_fletcher.o zfs_kernels_test-kern_list.o zfs_kernels_test-kern_misc.o zfs_kernels_test-tests_lib_test.o zfs_kernels_test-tests_lib_unit_test.o
+
+CLEAN_UTILITY_TARGETS += clean-utility-zfs_kernels_test.1
+
+mostlyclean-utility-zfs_kernels_test.1:
+	rm -f zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_kernels_test.d zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_lzjb.d zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_sha256.d zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_fletcher.d zfs_kernels_test-kern_list.d zfs_kernels_test-kern_misc.d zfs_kernels_test-tests_lib_test.d zfs_kernels_test-tests_lib_unit_test.d
+
+MOSTLYCLEAN_UTILITY_TARGETS += mostlyclean-utility-zfs_kernels_test.1
+
+zfs_kernels_test_OBJECTS += zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_kernels_test.o zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_lzjb.o zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_sha256.o zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_fletcher.o zfs_kernels_test-kern_list.o zfs_kernels_test-kern_misc.o zfs_kernels_test-tests_lib_test.o zfs_kernels_test-tests_lib_unit_test.o
+
+zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_kernels_test.o: $(GRUB_CONTRIB)/zfs/zfs_kernels_test.c $($(GRUB_CONTRIB)/zfs/zfs_kernels_test.c_DEPENDENCIES)
+	$(CC) -I$(GRUB_CONTRIB)/zfs -I$(srcdir)/$(GRUB_CONTRIB)/zfs $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(zfs_kernels_test_CFLAGS) -MD -c -o $@ $<
+-include zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_kernels_test.d
+
+zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_lzjb.o: $(GRUB_CONTRIB)/zfs/zfs_lzjb.c $($(GRUB_CONTRIB)/zfs/zfs_lzjb.c_DEPENDENCIES)
+	$(CC) -I$(GRUB_CONTRIB)/zfs -I$(srcdir)/$(GRUB_CONTRIB)/zfs $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(zfs_kernels_test_CFLAGS) -MD -c -o $@ $<
+-include zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_lzjb.d
+
+zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_sha256.o: $(GRUB_CONTRIB)/zfs/zfs_sha256.c $($(GRUB_CONTRIB)/zfs/zfs_sha256.c_DEPENDENCIES)
+	$(CC) -I$(GRUB_CONTRIB)/zfs -I$(srcdir)/$(GRUB_CONTRIB)/zfs $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(zfs_kernels_test_CFLAGS) -MD -c -o $@ $<
+-include zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_sha256.d
+
+zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_fletcher.o: $(GRUB_CONTRIB)/zfs/zfs_fletcher.c $($(GRUB_CONTRIB)/zfs/zfs_fletcher.c_DEPENDENCIES)
+	$(CC) -I$(GRUB_CONTRIB)/zfs -I$(srcdir)/$(GRUB_CONTRIB)/zfs $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(zfs_kernels_test_CFLAGS) -MD -c -o $@ $<
+-include zfs_kernels_test-__GRUB_CONTRIB__zfs_zfs_fletcher.d
+
+zfs_kernels_test-kern_list.o: kern/list.c $(kern/list.c_DEPENDENCIES)
+	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(zfs_kernels_test_CFLAGS) -MD -c -o $@ $<
+-include zfs_kernels_test-kern_list.d
+
+zfs_kernels_test-kern_misc.o: kern/misc.c $(kern/misc.c_DEPENDENCIES)
+	$(CC) -Ikern -I$(srcdir)/kern $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(zfs_kernels_test_CFLAGS) -MD -c -o $@ $<
+-include zfs_kernels_test-kern_misc.d
+
+zfs_kernels_test-tests_lib_test.o: tests/lib/test.c $(tests/lib/test.c_DEPENDENCIES)
+	$(CC) -Itests/lib -I$(srcdir)/tests/lib $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(zfs_kernels_test_CFLAGS) -MD -c -o $@ $<
+-include zfs_kernels_test-tests_lib_test.d
+
+zfs_kernels_test-tests_lib_unit_test.o: tests/lib/unit_test.c $(tests/lib/unit_test.c_DEPENDENCIES)
+	$(CC) -Itests/lib -I$(srcdir)/tests/lib $(CPPFLAGS) $(CFLAGS) -DGRUB_UTIL=1 $(zfs_kernels_test_CFLAGS) -MD -c -o $@ $<
+-include zfs_kernels_test-tests_lib_unit_test.d
+
+zfs_kernels_test_CFLAGS = -Wno-format -I$(GRUB_CONTRIB)/zfs/include
+UNIT_TESTS += zfs_kernels_test
+zfs_kernels_test: $(zfs_kernels_test_DEPENDENCIES) $(zfs_kernels_test_OBJECTS)
+	$(CC) -o $@ $(zfs_kernels_test_OBJECTS) $(LDFLAGS) $(zfs_kernels_test_LDFLAGS)
+
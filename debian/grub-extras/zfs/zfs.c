@@ -138,6 +138,31 @@ typedef struct dnode_end
   grub_zfs_endian_t endian;
 } dnode_end_t;
 
+/*
+ * ZAP blocks and name lookups are cached per mount.  A ZAP object is
+ * identified by the first block pointer of its dnode: that pointer
+ * changes whenever any block of the object does.
+ */
+#define	ZAP_CACHE_BLOCKS	8
+#define	ZAP_NAME_CACHE_SIZE	32
+
+struct zap_cache_block
+{
+  blkptr_t owner;
+  grub_uint64_t blkid;
+  grub_zfs_endian_t endian;
+  unsigned last_use;
+  void *buf;			/* NULL if the entry is unused.  */
+};
+
+struct zap_name_cache_entry
+{
+  blkptr_t owner;
+  grub_uint64_t value;
+  unsigned last_use;
+  char *name;			/* NULL if the entry is unused.  */
+};
+
 struct grub_zfs_data
 {
   /* cache for a file block of the currently zfs_open()-ed file */
@@ -152,6 +177,11 @@ struct grub_zfs_data
   grub_uint64_t dnode_end;
   grub_zfs_endian_t dnode_endian;
 
+  /* cache for ZAP blocks and names looked up in them */
+  struct zap_cache_block zap_blocks[ZAP_CACHE_BLOCKS];
+  struct zap_name_cache_entry zap_names[ZAP_NAME_CACHE_SIZE];
+  unsigned zap_clock;
+
   uberblock_t current_uberblock;
   grub_disk_t disk;
 
@@ -173,6 +203,32 @@ decomp_entry_t decomp_table[ZIO_COMPRESS_FUNCTIONS] = {
 static grub_err_t zio_read_data (blkptr_t * bp, grub_zfs_endian_t endian,
 				 void *buf, struct grub_zfs_data *data);
 
+/*
+ * Cache of verified and decompressed blocks, shared by all mounts.
+ * Blocks are never overwritten in place, so a block pointer's DVA, birth
+ * txg and checksum identify its contents for as long as the pool exists.
+ */
+#define	ZIO_CACHE_ENTRIES	64
+#define	ZIO_CACHE_MAX_BYTES	(4 << 20)
+#define	ZIO_CACHE_MAX_BLOCK	(ZIO_CACHE_MAX_BYTES / 8)
+
+struct zio_cache_entry
+{
+  unsigned long dev_id;
+  unsigned long disk_id;
+  grub_disk_addr_t part_start;
+  dva_t dva;
+  grub_uint64_t birth;
+  zio_cksum_t cksum;
+  grub_size_t size;
+  unsigned last_use;
+  void *buf;			/* NULL if the entry is unused.  */
+};
+
+static struct zio_cache_entry zio_cache[ZIO_CACHE_ENTRIES];
+static grub_size_t zio_cache_bytes;
+static unsigned zio_cache_clock;
+
 /*
  * Our own version of log2().  Same thing as highbit()-1.
  */
@@ -506,6 +562,139 @@ zio_read_data (blkptr_t * bp, grub_zfs_endian_t endian, void *buf,
   return err;
 }
 
+/*
+ * Only metadata and indirect blocks are worth keeping: plain file data
+ * is normally read once and would only push them out.
+ */
+static int
+zio_cache_wanted (blkptr_t * bp, grub_zfs_endian_t endian, grub_size_t lsize)
+{
+  grub_uint64_t prop = grub_zfs_to_cpu64 (bp->blk_prop, endian);
+
+  if (BP_IS_HOLE (bp) || lsize > ZIO_CACHE_MAX_BLOCK)
+    return 0;
+  return ((prop >> 48) & 0xff) != DMU_OT_PLAIN_FILE_CONTENTS
+    || ((prop >> 56) & 0x1f) != 0;
+}
+
+static grub_disk_addr_t
+zio_cache_part_start (struct grub_zfs_data *data)
+{
+  return data->disk->partition
+    ? grub_partition_get_start (data->disk->partition) : 0;
+}
+
+static int
+zio_cache_match (struct zio_cache_entry *e, blkptr_t * bp,
+		 struct grub_zfs_data *data)
+{
+  return e->buf
+    && e->dev_id == data->disk->dev->id
+    && e->disk_id == data->disk->id
+    && e->part_start == zio_cache_part_start (data)
+    && e->birth == bp->blk_birth
+    && grub_memcmp (&e->dva, &bp->blk_dva[0], sizeof (e->dva)) == 0
+    && grub_memcmp (&e->cksum, &bp->blk_cksum, sizeof (e->cksum)) == 0;
+}
+
+static void
+zio_cache_drop (struct zio_cache_entry *e)
+{
+  zio_cache_bytes -= e->size;
+  grub_free (e->buf);
+  e->buf = 0;
+}
+
+/*
+ * Return a freshly allocated copy of the cached block BP, or NULL if it
+ * isn't cached.
+ */
+static void *
+zio_cache_get (blkptr_t * bp, grub_size_t lsize, struct grub_zfs_data *data)
+{
+  int i;
+
+  for (i = 0; i < ZIO_CACHE_ENTRIES; i++)
+    if (zio_cache_match (&zio_cache[i], bp, data) && zio_cache[i].size == lsize)
+      {
+	void *buf = grub_malloc (lsize);
+	if (!buf)
+	  {
+	    grub_errno = GRUB_ERR_NONE;
+	    return 0;
+	  }
+	grub_memcpy (buf, zio_cache[i].buf, lsize);
+	zio_cache[i].last_use = ++zio_cache_clock;
+	return buf;
+      }
+  return 0;
+}
+
+/*
+ * Remember a copy of BUF, the verified and decompressed contents of BP.
+ * Failing to do so is not an error.
+ */
+static void
+zio_cache_put (blkptr_t * bp, void *buf, grub_size_t lsize,
+	       struct grub_zfs_data *data)
+{
+  struct zio_cache_entry *e = 0;
+  int i;
+
+  /* Make room, evicting the least recently used blocks.  */
+  while (1)
+    {
+      struct zio_cache_entry *lru = 0;
+      int nused = 0;
+
+      e = 0;
+      for (i = 0; i < ZIO_CACHE_ENTRIES; i++)
+	{
+	  if (!zio_cache[i].buf)
+	    {
+	      if (!e)
+		e = &zio_cache[i];
+	      continue;
+	    }
+	  nused++;
+	  if (!lru || zio_cache[i].last_use < lru->last_use)
+	    lru = &zio_cache[i];
+	}
+      if (e && zio_cache_bytes + lsize <= ZIO_CACHE_MAX_BYTES)
+	break;
+      if (!nused)
+	return;
+      zio_cache_drop (lru);
+    }
+
+  e->buf = grub_malloc (lsize);
+  if (!e->buf)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+  grub_memcpy (e->buf, buf, lsize);
+  e->dev_id = data->disk->dev->id;
+  e->disk_id = data->disk->id;
+  e->part_start = zio_cache_part_start (data);
+  e->dva = bp->blk_dva[0];
+  e->birth = bp->blk_birth;
+  e->cksum = bp->blk_cksum;
+  e->size = lsize;
+  e->last_use = ++zio_cache_clock;
+  zio_cache_bytes += lsize;
+}
+
+static void
+zio_cache_flush (void)
+{
+  int i;
+
+  for (i = 0; i < ZIO_CACHE_ENTRIES; i++)
+    if (zio_cache[i].buf)
+      zio_cache_drop (&zio_cache[i]);
+}
+
 /*
  * Read in a block of data, verify its checksum, decompress if needed,
  * and put the uncompressed data in buf.
@@ -520,6 +709,7 @@ zio_read (blkptr_t * bp, grub_zfs_endian_t endian, void **buf,
   grub_err_t err;
   zio_cksum_t zc = bp->blk_cksum;
   grub_uint32_t checksum;
+  int cache;
 
   checksum = (grub_zfs_to_cpu64((bp)->blk_prop, endian) >> 40) & 0xff;
   comp = (grub_zfs_to_cpu64((bp)->blk_prop, endian)>>32) & 0xff;
@@ -539,6 +729,14 @@ zio_read (blkptr_t * bp, grub_zfs_endian_t endian, void **buf,
 			 "compression algorithm not supported\n");
     }
 
+  cache = zio_cache_wanted (bp, endian, lsize);
+  if (cache)
+    {
+      *buf = zio_cache_get (bp, lsize, data);
+      if (*buf)
+	return GRUB_ERR_NONE;
+    }
+
   if (comp != ZIO_COMPRESS_OFF)
     {
       compbuf = grub_malloc (psize);
@@ -573,6 +771,9 @@ zio_read (blkptr_t * bp, grub_zfs_endian_t endian, void **buf,
 	return err;
     }
 
+  if (cache)
+    zio_cache_put (bp, *buf, lsize, data);
+
   return GRUB_ERR_NONE;
 }
 
@@ -646,6 +847,115 @@ dmu_read (dnode_end_t * dn, grub_uint64_t blkid, void **buf,
   return err;
 }
 
+/*
+ * Read block BLKID of the ZAP object ZAP_DNODE through the mount's ZAP
+ * block cache.  The returned buffer belongs to the cache and must not be
+ * freed; it stays valid until ZAP_CACHE_BLOCKS - 1 other blocks have been
+ * read this way.
+ */
+static grub_err_t
+zap_cache_read (dnode_end_t * zap_dnode, grub_uint64_t blkid, void **buf,
+		grub_zfs_endian_t * endian, struct grub_zfs_data *data)
+{
+  blkptr_t *owner = &zap_dnode->dn.dn_blkptr[0];
+  struct zap_cache_block *b, *victim = 0;
+  grub_err_t err;
+  int i;
+
+  for (i = 0; i < ZAP_CACHE_BLOCKS; i++)
+    {
+      b = &data->zap_blocks[i];
+      if (b->buf && b->blkid == blkid
+	  && grub_memcmp (&b->owner, owner, sizeof (*owner)) == 0)
+	{
+	  b->last_use = ++data->zap_clock;
+	  *buf = b->buf;
+	  *endian = b->endian;
+	  return GRUB_ERR_NONE;
+	}
+      if (! victim || (victim->buf && (! b->buf
+				       || b->last_use < victim->last_use)))
+	victim = b;
+    }
+
+  err = dmu_read (zap_dnode, blkid, buf, endian, data);
+  if (err)
+    return err;
+
+  grub_free (victim->buf);
+  grub_memcpy (&victim->owner, owner, sizeof (*owner));
+  victim->blkid = blkid;
+  victim->endian = *endian;
+  victim->last_use = ++data->zap_clock;
+  victim->buf = *buf;
+  return GRUB_ERR_NONE;
+}
+
+static int
+zap_name_cache_get (dnode_end_t * zap_dnode, const char *name,
+		    grub_uint64_t * value, struct grub_zfs_data *data)
+{
+  blkptr_t *owner = &zap_dnode->dn.dn_blkptr[0];
+  struct zap_name_cache_entry *e;
+  int i;
+
+  for (i = 0; i < ZAP_NAME_CACHE_SIZE; i++)
+    {
+      e = &data->zap_names[i];
+      if (e->name && grub_strcmp (e->name, name) == 0
+	  && grub_memcmp (&e->owner, owner, sizeof (*owner)) == 0)
+	{
+	  e->last_use = ++data->zap_clock;
+	  *value = e->value;
+	  return 1;
+	}
+    }
+  return 0;
+}
+
+static void
+zap_name_cache_put (dnode_end_t * zap_dnode, const char *name,
+		    grub_uint64_t value, struct grub_zfs_data *data)
+{
+  struct zap_name_cache_entry *e, *victim = 0;
+  char *copy;
+  int i;
+
+  for (i = 0; i < ZAP_NAME_CACHE_SIZE; i++)
+    {
+      e = &data->zap_names[i];
+      if (! victim || (victim->name && (! e->name
+					|| e->last_use < victim->last_use)))
+	victim = e;
+    }
+
+  /* The cache is only an optimisation: ignore allocation failures.  */
+  copy = grub_strdup (name);
+  if (! copy)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  grub_free (victim->name);
+  grub_memcpy (&victim->owner, &zap_dnode->dn.dn_blkptr[0],
+	       sizeof (victim->owner));
+  victim->value = value;
+  victim->last_use = ++data->zap_clock;
+  victim->name = copy;
+}
+
+static void
+zap_cache_free (struct grub_zfs_data *data)
+{
+  int i;
+
+  for (i = 0; i < ZAP_CACHE_BLOCKS; i++)
+    grub_free (data->zap_blocks[i].buf);
+  for (i = 0; i < ZAP_NAME_CACHE_SIZE; i++)
+    grub_free (data->zap_names[i].name);
+}
+
 /*
  * mzap_lookup: Looks up property described by "name" and returns the value
  * in "value".
@@ -873,13 +1183,11 @@ fzap_lookup (dnode_end_t * zap_dnode, zap_phys_t * zap,
   /* Get the leaf block */
   if ((1U << blksft) < sizeof (zap_leaf_phys_t))
     return grub_error (GRUB_ERR_BAD_FS, "ZAP leaf is too small");
-  err = dmu_read (zap_dnode, blkid, (void **) &l, &leafendian, data);
+  err = zap_cache_read (zap_dnode, blkid, (void **) &l, &leafendian, data);
   if (err)
     return err;
 
-  err = zap_leaf_lookup (l, leafendian, blksft, hash, name, value);
-  grub_free (l);
-  return err;
+  return zap_leaf_lookup (l, leafendian, blksft, hash, name, value);
 }
 
 /* XXX */
@@ -995,10 +1303,13 @@ zap_lookup (dnode_end_t * zap_dnode, char *name, grub_uint64_t * val,
 
   grub_dprintf ("zfs", "looking for '%s'\n", name);
 
+  if (zap_name_cache_get (zap_dnode, name, val, data))
+    return GRUB_ERR_NONE;
+
   /* Read in the first block of the zap object data. */
   size = grub_zfs_to_cpu16 (zap_dnode->dn.dn_datablkszsec, 
 			    zap_dnode->endian) << SPA_MINBLOCKSHIFT;
-  err = dmu_read (zap_dnode, 0, &zapbuf, &endian, data);
+  err = zap_cache_read (zap_dnode, 0, &zapbuf, &endian, data);
   if (err)
     return err;
   block_type = grub_zfs_to_cpu64 (*((grub_uint64_t *) zapbuf), endian);
@@ -1010,8 +1321,6 @@ zap_lookup (dnode_end_t * zap_dnode, char *name, grub_uint64_t * val,
       grub_dprintf ("zfs", "micro zap\n");
       err = (mzap_lookup (zapbuf, endian, size, name, val));
       grub_dprintf ("zfs", "returned %d\n", err);      
-      grub_free (zapbuf);
-      return err;
     }
   else if (block_type == ZBT_HEADER)
     {
@@ -1019,11 +1328,13 @@ zap_lookup (dnode_end_t * zap_dnode, char *name, grub_uint64_t * val,
       /* this is a fat zap */
       err = (fzap_lookup (zap_dnode, zapbuf, name, val, data));
       grub_dprintf ("zfs", "returned %d\n", err);      
-      grub_free (zapbuf);
-      return err;
     }
+  else
+    return grub_error (GRUB_ERR_BAD_FS, "unknown ZAP type");
 
-  return grub_error (GRUB_ERR_BAD_FS, "unknown ZAP type");
+  if (! err)
+    zap_name_cache_put (zap_dnode, name, *val, data);
+  return err;
 }
 
 static int
@@ -1914,6 +2225,7 @@ check_pool_label (struct grub_zfs_data *data)
 static void
 zfs_unmount (struct grub_zfs_data *data)
 {
+  zap_cache_free (data);
   grub_free (data->dnode_buf);
   grub_free (data->dnode_mdn);
   grub_free (data->file_buf);
@@ -2479,4 +2791,5 @@ GRUB_MOD_INIT (zfs)
 GRUB_MOD_FINI (zfs)
 {
   grub_fs_unregister (&grub_zfs_fs);
+  zio_cache_flush ();
 }
@@ -62,25 +62,59 @@ fletcher_2(const void *buf, grub_uint64_t size, grub_zfs_endian_t endian,
   zcp->zc_word[3] = grub_cpu_to_zfs64 (b1, endian);
 }
 
+/*
+ * Fletcher-4 is computed as four interleaved streams, one for every
+ * fourth word, which don't depend on each other and so keep several
+ * additions in flight.  The per-lane sums are folded back into the
+ * serial a, b, c and d afterwards.
+ */
+#define FLETCHER_4_LANES(conv)						\
+  for (; ip < ipend4; ip += 4)						\
+    {									\
+      a[0] += conv (ip[0]); a[1] += conv (ip[1]);			\
+      a[2] += conv (ip[2]); a[3] += conv (ip[3]);			\
+      b[0] += a[0]; b[1] += a[1]; b[2] += a[2]; b[3] += a[3];		\
+      c[0] += b[0]; c[1] += b[1]; c[2] += b[2]; c[3] += b[3];		\
+      d[0] += c[0]; d[1] += c[1]; d[2] += c[2]; d[3] += c[3];		\
+    }
+
 void
 fletcher_4 (const void *buf, grub_uint64_t size, grub_zfs_endian_t endian, 
 	    zio_cksum_t *zcp)
 {
   const grub_uint32_t *ip = buf;
   const grub_uint32_t *ipend = ip + (size / sizeof (grub_uint32_t));
-  grub_uint64_t a, b, c, d;
-  
-  for (a = b = c = d = 0; ip < ipend; ip++) 
+  const grub_uint32_t *ipend4 = ip + ((size / sizeof (grub_uint32_t)) & ~3);
+  grub_uint64_t a[4] = { 0, 0, 0, 0 }, b[4] = { 0, 0, 0, 0 };
+  grub_uint64_t c[4] = { 0, 0, 0, 0 }, d[4] = { 0, 0, 0, 0 };
+  grub_uint64_t A, B, C, D;
+
+  if (endian == BIG_ENDIAN)
+    FLETCHER_4_LANES (grub_be_to_cpu32)
+  else
+    FLETCHER_4_LANES (grub_le_to_cpu32)
+
+  A = a[0] + a[1] + a[2] + a[3];
+  B = 4 * (b[0] + b[1] + b[2] + b[3]) - a[1] - 2 * a[2] - 3 * a[3];
+  C = 16 * (c[0] + c[1] + c[2] + c[3])
+    - 6 * b[0] - 10 * b[1] - 14 * b[2] - 18 * b[3]
+    + a[2] + 3 * a[3];
+  D = 64 * (d[0] + d[1] + d[2] + d[3])
+    - 48 * c[0] - 64 * c[1] - 80 * c[2] - 96 * c[3]
+    + 4 * b[0] + 10 * b[1] + 20 * b[2] + 34 * b[3]
+    - a[3];
+
+  /* Whatever doesn't fill all four lanes.  */
+  for (; ip < ipend; ip++)
     {
-      a += grub_zfs_to_cpu32 (ip[0], endian);;
-      b += a;
-      c += b;
-      d += c;
+      A += grub_zfs_to_cpu32 (ip[0], endian);
+      B += A;
+      C += B;
+      D += C;
     }
 
-  zcp->zc_word[0] = grub_cpu_to_zfs64 (a, endian);
-  zcp->zc_word[1] = grub_cpu_to_zfs64 (b, endian);
-  zcp->zc_word[2] = grub_cpu_to_zfs64 (c, endian);
-  zcp->zc_word[3] = grub_cpu_to_zfs64 (d, endian);
+  zcp->zc_word[0] = grub_cpu_to_zfs64 (A, endian);
+  zcp->zc_word[1] = grub_cpu_to_zfs64 (B, endian);
+  zcp->zc_word[2] = grub_cpu_to_zfs64 (C, endian);
+  zcp->zc_word[3] = grub_cpu_to_zfs64 (D, endian);
 }
-
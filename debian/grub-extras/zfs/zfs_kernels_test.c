@@ -0,0 +1,349 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2010  Free Software Foundation, Inc.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Checks the ZFS checksum and decompression kernels against plain
+   reference versions and reports how fast they run.  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* The host headers use these names for byte order macros, spa.h uses them
+   for grub_zfs_endian_t.  */
+#undef LITTLE_ENDIAN
+#undef BIG_ENDIAN
+
+#include <grub/test.h>
+#include <grub/types.h>
+#include <grub/zfs/zfs.h>
+#include <grub/zfs/zio.h>
+#include <grub/zfs/zio_checksum.h>
+
+extern grub_err_t lzjb_decompress (void *, void *, grub_size_t, grub_size_t);
+
+#define	NBBY		8
+#define	MATCH_BITS	6
+#define	MATCH_MIN	3
+#define	MATCH_MAX	((1 << MATCH_BITS) + (MATCH_MIN - 1))
+#define	OFFSET_MASK	((1 << (16 - MATCH_BITS)) - 1)
+#define	LEMPEL_SIZE	1024
+
+#define	BLOCK_SIZE	(128 * 1024)
+#define	BENCH_BYTES	(64 * 1024 * 1024)
+
+/* The compressor as found in the ZFS sources.  */
+static grub_size_t
+ref_lzjb_compress (void *s_start, void *d_start, grub_size_t s_len,
+		   grub_size_t d_len)
+{
+  grub_uint8_t *src = s_start;
+  grub_uint8_t *dst = d_start;
+  grub_uint8_t *cpy, *copymap = 0;
+  int copymask = 1 << (NBBY - 1);
+  int mlen, offset, hash;
+  grub_uint16_t *hp;
+  grub_uint16_t lempel[LEMPEL_SIZE];
+
+  memset (lempel, 0, sizeof (lempel));
+  while (src < (grub_uint8_t *) s_start + s_len)
+    {
+      if ((copymask <<= 1) == (1 << NBBY))
+	{
+	  if (dst >= (grub_uint8_t *) d_start + d_len - 1 - 2 * NBBY)
+	    return s_len;
+	  copymask = 1;
+	  copymap = dst;
+	  *dst++ = 0;
+	}
+      if (src > (grub_uint8_t *) s_start + s_len - MATCH_MAX)
+	{
+	  *dst++ = *src++;
+	  continue;
+	}
+      hash = (src[0] << 16) + (src[1] << 8) + src[2];
+      hash += hash >> 9;
+      hash += hash >> 5;
+      hp = &lempel[hash & (LEMPEL_SIZE - 1)];
+      offset = (grub_addr_t) (src - *hp) & OFFSET_MASK;
+      *hp = (grub_uint16_t) (grub_addr_t) src;
+      cpy = src - offset;
+      if (cpy >= (grub_uint8_t *) s_start && cpy != src
+	  && src[0] == cpy[0] && src[1] == cpy[1] && src[2] == cpy[2])
+	{
+	  *copymap |= copymask;
+	  for (mlen = MATCH_MIN; mlen < MATCH_MAX; mlen++)
+	    if (src[mlen] != cpy[mlen])
+	      break;
+	  *dst++ = ((mlen - MATCH_MIN) << (NBBY - MATCH_BITS)) | (offset >> NBBY);
+	  *dst++ = (grub_uint8_t) offset;
+	  src += mlen;
+	}
+      else
+	*dst++ = *src++;
+    }
+  return dst - (grub_uint8_t *) d_start;
+}
+
+/* Byte at a time decompressor, as the module used to have.  */
+static int
+ref_lzjb_decompress (void *s_start, void *d_start, grub_size_t s_len,
+		     grub_size_t d_len)
+{
+  grub_uint8_t *src = s_start;
+  grub_uint8_t *dst = d_start;
+  grub_uint8_t *d_end = (grub_uint8_t *) d_start + d_len;
+  grub_uint8_t *s_end = (grub_uint8_t *) s_start + s_len;
+  grub_uint8_t *cpy, copymap = 0;
+  int copymask = 1 << (NBBY - 1);
+
+  while (dst < d_end && src < s_end)
+    {
+      if ((copymask <<= 1) == (1 << NBBY))
+	{
+	  copymask = 1;
+	  copymap = *src++;
+	}
+      if (src >= s_end)
+	return -1;
+      if (copymap & copymask)
+	{
+	  int mlen = (src[0] >> (NBBY - MATCH_BITS)) + MATCH_MIN;
+	  int offset = ((src[0] << NBBY) | src[1]) & OFFSET_MASK;
+	  src += 2;
+	  cpy = dst - offset;
+	  if (src > s_end || cpy < (grub_uint8_t *) d_start)
+	    return -1;
+	  while (--mlen >= 0 && dst < d_end)
+	    *dst++ = *cpy++;
+	}
+      else
+	*dst++ = *src++;
+    }
+  return dst < d_end ? -1 : 0;
+}
+
+static void
+ref_fletcher_4 (const void *buf, grub_uint64_t size,
+		grub_zfs_endian_t endian, zio_cksum_t *zcp)
+{
+  const grub_uint32_t *ip = buf;
+  const grub_uint32_t *ipend = ip + (size / sizeof (grub_uint32_t));
+  grub_uint64_t a, b, c, d;
+
+  for (a = b = c = d = 0; ip < ipend; ip++)
+    {
+      a += grub_zfs_to_cpu32 (ip[0], endian);
+      b += a;
+      c += b;
+      d += c;
+    }
+
+  zcp->zc_word[0] = grub_cpu_to_zfs64 (a, endian);
+  zcp->zc_word[1] = grub_cpu_to_zfs64 (b, endian);
+  zcp->zc_word[2] = grub_cpu_to_zfs64 (c, endian);
+  zcp->zc_word[3] = grub_cpu_to_zfs64 (d, endian);
+}
+
+/* Something compressible: repeated phrases, runs and some noise.  */
+static void
+fill_block (grub_uint8_t *buf, grub_size_t size)
+{
+  static const char *words[] = { "vmlinuz ", "initrd.img ", "boot ",
+				 "ROOT/", "grub.cfg ", "\n\t" };
+  grub_size_t i = 0;
+
+  while (i < size)
+    {
+      int kind = rand () % 8;
+      int len;
+
+      if (kind < 5)
+	{
+	  const char *w = words[rand () % (sizeof (words) / sizeof (words[0]))];
+	  for (; *w && i < size; w++)
+	    buf[i++] = *w;
+	  continue;
+	}
+      len = rand () % 200;
+      for (; len > 0 && i < size; len--)
+	buf[i++] = kind == 5 ? 0 : rand ();
+    }
+}
+
+static double
+seconds_since (clock_t start)
+{
+  return (double) (clock () - start) / CLOCKS_PER_SEC;
+}
+
+static void
+report (const char *what, double secs)
+{
+  printf ("zfs_kernels_test: %-22s %8.1f MiB/s\n", what,
+	  secs > 0 ? BENCH_BYTES / secs / (1024 * 1024) : 0.0);
+}
+
+static void
+sha256_test (void)
+{
+  static const struct
+  {
+    const char *msg;
+    grub_uint32_t h[8];
+  } vectors[] =
+    {
+      { "abc",
+	{ 0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223,
+	  0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad } },
+      { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	{ 0x248d6a61, 0xd20638b8, 0xe5c02693, 0x0c3e6039,
+	  0xa33ce459, 0x64ff2167, 0xf6ecedd4, 0x19db06c1 } },
+    };
+  grub_uint8_t *buf;
+  zio_cksum_t zc;
+  unsigned i, n;
+  clock_t start;
+
+  for (i = 0; i < sizeof (vectors) / sizeof (vectors[0]); i++)
+    {
+      zio_checksum_SHA256 (vectors[i].msg, strlen (vectors[i].msg),
+			   BIG_ENDIAN, &zc);
+      for (n = 0; n < 4; n++)
+	grub_test_assert (grub_be_to_cpu64 (zc.zc_word[n])
+			  == (((grub_uint64_t) vectors[i].h[2 * n] << 32)
+			      | vectors[i].h[2 * n + 1]),
+			  "SHA-256 of \"%s\" differs in word %u",
+			  vectors[i].msg, n);
+    }
+
+  buf = malloc (BLOCK_SIZE);
+  grub_test_assert (buf != NULL);
+  if (!buf)
+    return;
+  fill_block (buf, BLOCK_SIZE);
+  start = clock ();
+  for (n = 0; n < BENCH_BYTES / BLOCK_SIZE; n++)
+    zio_checksum_SHA256 (buf, BLOCK_SIZE, LITTLE_ENDIAN, &zc);
+  report ("sha256", seconds_since (start));
+  free (buf);
+}
+
+static void
+fletcher_4_test (void)
+{
+  static const grub_uint64_t sizes[] = { 0, 4, 12, 16, 20, 512, 1028,
+					 BLOCK_SIZE };
+  grub_uint8_t *buf;
+  zio_cksum_t zc, ref;
+  unsigned i, n;
+  clock_t start;
+
+  buf = malloc (BLOCK_SIZE);
+  grub_test_assert (buf != NULL);
+  if (!buf)
+    return;
+  for (i = 0; i < BLOCK_SIZE; i++)
+    buf[i] = rand ();
+
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+    {
+      fletcher_4 (buf, sizes[i], LITTLE_ENDIAN, &zc);
+      ref_fletcher_4 (buf, sizes[i], LITTLE_ENDIAN, &ref);
+      grub_test_assert (memcmp (&zc, &ref, sizeof (zc)) == 0,
+			"little-endian fletcher4 of %u bytes differs",
+			(unsigned) sizes[i]);
+      fletcher_4 (buf, sizes[i], BIG_ENDIAN, &zc);
+      ref_fletcher_4 (buf, sizes[i], BIG_ENDIAN, &ref);
+      grub_test_assert (memcmp (&zc, &ref, sizeof (zc)) == 0,
+			"big-endian fletcher4 of %u bytes differs",
+			(unsigned) sizes[i]);
+    }
+
+  start = clock ();
+  for (n = 0; n < BENCH_BYTES / BLOCK_SIZE; n++)
+    ref_fletcher_4 (buf, BLOCK_SIZE, LITTLE_ENDIAN, &ref);
+  report ("fletcher4 (reference)", seconds_since (start));
+  start = clock ();
+  for (n = 0; n < BENCH_BYTES / BLOCK_SIZE; n++)
+    fletcher_4 (buf, BLOCK_SIZE, LITTLE_ENDIAN, &zc);
+  report ("fletcher4", seconds_since (start));
+  free (buf);
+}
+
+static void
+lzjb_test (void)
+{
+  grub_uint8_t *orig, *comp, *out;
+  grub_size_t clen;
+  unsigned n;
+  clock_t start;
+
+  orig = malloc (BLOCK_SIZE);
+  comp = malloc (BLOCK_SIZE);
+  out = malloc (BLOCK_SIZE);
+  grub_test_assert (orig && comp && out);
+  if (!orig || !comp || !out)
+    goto out;
+
+  fill_block (orig, BLOCK_SIZE);
+  clen = ref_lzjb_compress (orig, comp, BLOCK_SIZE, BLOCK_SIZE);
+  grub_test_assert (clen < BLOCK_SIZE, "test data didn't compress");
+  if (clen >= BLOCK_SIZE)
+    goto out;
+
+  memset (out, 0xaa, BLOCK_SIZE);
+  grub_test_assert (lzjb_decompress (comp, out, clen, BLOCK_SIZE)
+		    == GRUB_ERR_NONE);
+  grub_test_assert (memcmp (orig, out, BLOCK_SIZE) == 0,
+		    "lzjb output differs from the original data");
+
+  /* Stopping early must not write past the requested length.  */
+  memset (out, 0xaa, BLOCK_SIZE);
+  grub_test_assert (lzjb_decompress (comp, out, clen, BLOCK_SIZE / 2 + 5)
+		    == GRUB_ERR_NONE);
+  grub_test_assert (memcmp (orig, out, BLOCK_SIZE / 2 + 5) == 0);
+  grub_test_assert (out[BLOCK_SIZE / 2 + 5] == 0xaa,
+		    "lzjb wrote past the end of the output");
+
+  start = clock ();
+  for (n = 0; n < BENCH_BYTES / BLOCK_SIZE; n++)
+    ref_lzjb_decompress (comp, out, clen, BLOCK_SIZE);
+  report ("lzjb (reference)", seconds_since (start));
+  start = clock ();
+  for (n = 0; n < BENCH_BYTES / BLOCK_SIZE; n++)
+    lzjb_decompress (comp, out, clen, BLOCK_SIZE);
+  report ("lzjb", seconds_since (start));
+
+ out:
+  free (orig);
+  free (comp);
+  free (out);
+}
+
+static void
+zfs_kernels_test (void)
+{
+  srand (1);
+  sha256_test ();
+  fletcher_4_test ();
+  lzjb_test ();
+}
+
+GRUB_UNIT_TEST ("zfs_kernels_test", zfs_kernels_test);
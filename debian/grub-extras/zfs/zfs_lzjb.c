@@ -51,6 +51,19 @@
 #define	NBBY	8
 #endif
 
+/*
+ * Matches and literal runs are moved a word at a time where possible.
+ * The struct makes unaligned accesses safe on strict-alignment CPUs.
+ */
+struct lzjb_word
+{
+  grub_uint64_t val;
+} __attribute__ ((packed, may_alias));
+
+#define	LZJB_WORD	sizeof (struct lzjb_word)
+#define	LZJB_COPY_WORD(d, s) \
+	(((struct lzjb_word *) (d))->val = ((const struct lzjb_word *) (s))->val)
+
 grub_err_t
 lzjb_decompress (void *s_start, void *d_start, grub_size_t s_len,
 		 grub_size_t d_len);
@@ -72,6 +85,15 @@ lzjb_decompress (void *s_start, void *d_start, grub_size_t s_len,
 	{
 	  copymask = 1;
 	  copymap = *src++;
+	  /* A whole group of literals.  */
+	  if (copymap == 0 && src + NBBY <= s_end && dst + NBBY <= d_end)
+	    {
+	      LZJB_COPY_WORD (dst, src);
+	      src += NBBY;
+	      dst += NBBY;
+	      copymask = 1 << (NBBY - 1);
+	      continue;
+	    }
 	}
       if (src >= s_end)
 	return grub_error (GRUB_ERR_BAD_FS, "lzjb decompression failed");
@@ -83,7 +105,18 @@ lzjb_decompress (void *s_start, void *d_start, grub_size_t s_len,
 	  cpy = dst - offset;
 	  if (src > s_end || cpy < (grub_uint8_t *) d_start)
 	    return grub_error (GRUB_ERR_BAD_FS, "lzjb decompression failed");
-	  while (--mlen >= 0 && dst < d_end)
+	  if (mlen > d_end - dst)
+	    mlen = d_end - dst;
+	  /* Each word read lies entirely before the word being written
+	     unless the match overlaps itself within a word.  */
+	  if (offset >= (int) LZJB_WORD)
+	    for (; mlen >= (int) LZJB_WORD; mlen -= LZJB_WORD)
+	      {
+		LZJB_COPY_WORD (dst, cpy);
+		dst += LZJB_WORD;
+		cpy += LZJB_WORD;
+	      }
+	  while (--mlen >= 0)
 	    *dst++ = *cpy++;
 	}
       else
@@ -0,0 +1,756 @@
+/* ahci.c - AHCI SATA disk access.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2010  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/ata.h>
+#include <grub/dl.h>
+#include <grub/disk.h>
+#include <grub/mm.h>
+#include <grub/time.h>
+#include <grub/pci.h>
+
+/* Command header, one per command slot in the command list.  */
+struct grub_ahci_cmd_head
+{
+  grub_uint32_t config;
+  grub_uint32_t transferred;
+  grub_uint32_t command_table_base;
+  grub_uint32_t command_table_base_high;
+  grub_uint32_t unused[4];
+} __attribute__ ((packed));
+
+#define GRUB_AHCI_HEAD_FIS_LENGTH	5	/* In dwords.  */
+#define GRUB_AHCI_HEAD_WRITE		(1 << 6)
+#define GRUB_AHCI_HEAD_PRDT_SHIFT	16
+
+/* Physical region descriptor.  A region may hold at most 4MiB.  */
+struct grub_ahci_prd
+{
+  grub_uint32_t data_base;
+  grub_uint32_t data_base_high;
+  grub_uint32_t unused;
+  grub_uint32_t size;
+} __attribute__ ((packed));
+
+/* Command table.  The caller's buffer is contiguous, so one region per
+   command is enough.  */
+struct grub_ahci_command_table
+{
+  grub_uint8_t command[0x40];
+  grub_uint8_t atapi[0x10];
+  grub_uint8_t reserved[0x30];
+  struct grub_ahci_prd prd[1];
+} __attribute__ ((packed));
+
+/* Command tables must be 128-byte aligned.  */
+#define GRUB_AHCI_COMMAND_TABLE_SIZE	0x100
+
+struct grub_ahci_hba_port
+{
+  grub_uint32_t command_list_base;
+  grub_uint32_t command_list_base_high;
+  grub_uint32_t fis_base;
+  grub_uint32_t fis_base_high;
+  grub_uint32_t intstatus;
+  grub_uint32_t inten;
+  grub_uint32_t command;
+  grub_uint32_t unused1;
+  grub_uint32_t task_file_data;
+  grub_uint32_t sig;
+  grub_uint32_t status;
+  grub_uint32_t control;
+  grub_uint32_t error;
+  grub_uint32_t sata_active;
+  grub_uint32_t command_issue;
+  grub_uint32_t unused2[17];
+};
+
+struct grub_ahci_hba
+{
+  grub_uint32_t cap;
+  grub_uint32_t global_control;
+  grub_uint32_t intr_status;
+  grub_uint32_t ports_implemented;
+  grub_uint32_t version;
+  grub_uint32_t ccc_control;
+  grub_uint32_t ccc_ports;
+  grub_uint32_t em_location;
+  grub_uint32_t em_control;
+  grub_uint32_t cap2;
+  grub_uint32_t bios_handoff;
+  grub_uint32_t unused[53];
+  struct grub_ahci_hba_port ports[32];
+};
+
+#define GRUB_AHCI_HBA_CAP_NCS_SHIFT	8
+#define GRUB_AHCI_HBA_CAP_NCS_MASK	0x1f
+#define GRUB_AHCI_HBA_CAP_SNCQ		(1 << 30)
+
+#define GRUB_AHCI_HBA_GC_AHCI_ENABLE	(1U << 31)
+
+#define GRUB_AHCI_HBA_CAP2_BOH		(1 << 0)
+
+#define GRUB_AHCI_HBA_BOHC_BIOS_OWNED	(1 << 0)
+#define GRUB_AHCI_HBA_BOHC_OS_OWNED	(1 << 1)
+#define GRUB_AHCI_HBA_BOHC_BIOS_BUSY	(1 << 4)
+
+#define GRUB_AHCI_HBA_PORT_CMD_ST	(1 << 0)
+#define GRUB_AHCI_HBA_PORT_CMD_SPIN_UP	(1 << 1)
+#define GRUB_AHCI_HBA_PORT_CMD_POWER_ON	(1 << 2)
+#define GRUB_AHCI_HBA_PORT_CMD_FRE	(1 << 4)
+#define GRUB_AHCI_HBA_PORT_CMD_FR	(1 << 14)
+#define GRUB_AHCI_HBA_PORT_CMD_CR	(1 << 15)
+
+#define GRUB_AHCI_HBA_PORT_IS_TFES	(1 << 30)
+
+#define GRUB_AHCI_HBA_PORT_STATUS_DET_MASK	0xf
+#define GRUB_AHCI_HBA_PORT_STATUS_DET_PRESENT	3
+
+#define GRUB_AHCI_SIG_ATA	0x00000101
+
+/* Host to device register FIS.  */
+#define GRUB_AHCI_FIS_H2D		0x27
+#define GRUB_AHCI_FIS_H2D_COMMAND	0x80
+
+/* Largest transfer per command in 512-byte units, bounded by the size
+   of one region.  */
+#define GRUB_AHCI_MAX_SECTORS	8192
+
+struct grub_ahci_device
+{
+  struct grub_ahci_device *next;
+
+  volatile struct grub_ahci_hba *hba;
+  int port;
+
+  /* Number used in the device name.  */
+  int num;
+
+  /* Command slots in use on this port.  With NCQ, up to this many
+     commands are outstanding at once; otherwise only slot 0 is
+     used.  */
+  int nslots;
+  int ncq;
+  int lba48;
+
+  /* Sector count, in logical sectors of 1 << LOG_SECTOR_SIZE bytes.  */
+  grub_uint64_t size;
+  int log_sector_size;
+
+  struct grub_ahci_cmd_head *command_list;
+  void *rfis;
+  char *command_tables;
+};
+
+static struct grub_ahci_device *grub_ahci_devices;
+static int grub_ahci_numdevs;
+
+static inline struct grub_ahci_command_table *
+grub_ahci_command_table (struct grub_ahci_device *dev, int slot)
+{
+  return (struct grub_ahci_command_table *)
+    (dev->command_tables + slot * GRUB_AHCI_COMMAND_TABLE_SIZE);
+}
+
+/* Check whether LEN bytes at P lie below 4GiB.  */
+static inline int
+grub_ahci_addressable (void *p, grub_size_t len)
+{
+  return (grub_uint64_t) (grub_addr_t) p + len <= 0x100000000ULL;
+}
+
+/* Wait until (*REG & MASK) == VAL.  */
+static grub_err_t
+grub_ahci_wait (volatile grub_uint32_t *reg, grub_uint32_t mask,
+		grub_uint32_t val, int milliseconds)
+{
+  grub_uint64_t endtime = grub_get_time_ms () + milliseconds;
+
+  while ((*reg & mask) != val)
+    if (grub_get_time_ms () > endtime)
+      return grub_error (GRUB_ERR_TIMEOUT, "AHCI timeout");
+
+  return GRUB_ERR_NONE;
+}
+
+/* Take the HBA over from the firmware, if it supports the BIOS/OS
+   handoff.  The firmware may still be using it, for instance for its
+   own disk services or SMM emulation of legacy interfaces.  */
+static void
+grub_ahci_take_ownership (volatile struct grub_ahci_hba *hba)
+{
+  if (! (hba->version >= 0x10200 && (hba->cap2 & GRUB_AHCI_HBA_CAP2_BOH)))
+    return;
+
+  hba->bios_handoff |= GRUB_AHCI_HBA_BOHC_OS_OWNED;
+
+  /* The firmware either releases the HBA within 25ms, or reports being
+     busy and then has up to 2s to finish what it is doing.  */
+  grub_millisleep (25);
+  if (hba->bios_handoff & GRUB_AHCI_HBA_BOHC_BIOS_BUSY)
+    grub_ahci_wait (&hba->bios_handoff, GRUB_AHCI_HBA_BOHC_BIOS_OWNED, 0,
+		    2000);
+  grub_errno = GRUB_ERR_NONE;
+
+  if (hba->bios_handoff & GRUB_AHCI_HBA_BOHC_BIOS_OWNED)
+    grub_dprintf ("ahci", "firmware didn't release the HBA\n");
+}
+
+/* Stop command processing on PORT, so that its command list and
+   received FIS area can be changed.  */
+static grub_err_t
+grub_ahci_stop_port (volatile struct grub_ahci_hba_port *port)
+{
+  port->command &= ~GRUB_AHCI_HBA_PORT_CMD_ST;
+  if (grub_ahci_wait (&port->command, GRUB_AHCI_HBA_PORT_CMD_CR, 0, 500))
+    return grub_errno;
+
+  port->command &= ~GRUB_AHCI_HBA_PORT_CMD_FRE;
+  return grub_ahci_wait (&port->command, GRUB_AHCI_HBA_PORT_CMD_FR, 0, 500);
+}
+
+/* Set up command slot SLOT to transfer LEN bytes between BUF and
+   COUNT sectors at SECTOR.  */
+static void
+grub_ahci_prepare (struct grub_ahci_device *dev, int slot, int cmd,
+		   grub_disk_addr_t sector, grub_size_t count,
+		   char *buf, grub_size_t len, int rw)
+{
+  struct grub_ahci_command_table *tbl = grub_ahci_command_table (dev, slot);
+  struct grub_ahci_cmd_head *head = &dev->command_list[slot];
+  grub_uint8_t *fis = tbl->command;
+
+  grub_memset (fis, 0, sizeof (tbl->command));
+  fis[0] = GRUB_AHCI_FIS_H2D;
+  fis[1] = GRUB_AHCI_FIS_H2D_COMMAND;
+  fis[2] = cmd;
+  fis[4] = sector & 0xff;
+  fis[5] = (sector >> 8) & 0xff;
+  fis[6] = (sector >> 16) & 0xff;
+  if (dev->lba48)
+    {
+      fis[7] = 0x40;
+      fis[8] = (sector >> 24) & 0xff;
+      fis[9] = (sector >> 32) & 0xff;
+      fis[10] = (sector >> 40) & 0xff;
+    }
+  else
+    fis[7] = 0x40 | ((sector >> 24) & 0x0f);
+
+  if (cmd == GRUB_ATA_CMD_READ_FPDMA_QUEUED
+      || cmd == GRUB_ATA_CMD_WRITE_FPDMA_QUEUED)
+    {
+      /* The count goes into the features register and the tag into
+	 the count register.  */
+      fis[3] = count & 0xff;
+      fis[11] = (count >> 8) & 0xff;
+      fis[12] = slot << 3;
+    }
+  else
+    {
+      fis[12] = count & 0xff;
+      fis[13] = (count >> 8) & 0xff;
+    }
+
+  head->config = (GRUB_AHCI_HEAD_FIS_LENGTH
+		  | (rw ? GRUB_AHCI_HEAD_WRITE : 0)
+		  | ((len ? 1 : 0) << GRUB_AHCI_HEAD_PRDT_SHIFT));
+  head->transferred = 0;
+  head->command_table_base = (grub_uint32_t) (grub_addr_t) tbl;
+  head->command_table_base_high = 0;
+
+  tbl->prd[0].data_base = (grub_uint32_t) (grub_addr_t) buf;
+  tbl->prd[0].data_base_high = 0;
+  tbl->prd[0].unused = 0;
+  tbl->prd[0].size = len - 1;
+}
+
+/* Issue the prepared commands in MASK and wait for all of them.  */
+static grub_err_t
+grub_ahci_exec (struct grub_ahci_device *dev, grub_uint32_t mask, int rw)
+{
+  volatile struct grub_ahci_hba_port *port = &dev->hba->ports[dev->port];
+  grub_uint64_t endtime;
+
+  port->intstatus = ~0;
+  port->error = ~0;
+
+  if (dev->ncq)
+    port->sata_active = mask;
+  port->command_issue = mask;
+
+  endtime = grub_get_time_ms () + GRUB_ATA_TOUT_DATA;
+  while ((port->command_issue | port->sata_active) & mask)
+    {
+      if (port->intstatus & GRUB_AHCI_HBA_PORT_IS_TFES)
+	break;
+      if (grub_get_time_ms () > endtime)
+	break;
+    }
+
+  if (! ((port->command_issue | port->sata_active) & mask)
+      && ! (port->intstatus & GRUB_AHCI_HBA_PORT_IS_TFES))
+    return GRUB_ERR_NONE;
+
+  grub_dprintf ("ahci", "port %d: error: is=0x%x, tfd=0x%x, serr=0x%x, "
+		"ci=0x%x, sact=0x%x\n", dev->port, port->intstatus,
+		port->task_file_data, port->error, port->command_issue,
+		port->sata_active);
+
+  /* Restarting the port drops all outstanding commands.  */
+  grub_ahci_stop_port (port);
+  grub_errno = GRUB_ERR_NONE;
+  port->error = ~0;
+  port->intstatus = ~0;
+  port->command |= GRUB_AHCI_HBA_PORT_CMD_FRE;
+  port->command |= GRUB_AHCI_HBA_PORT_CMD_ST;
+
+  if (! rw)
+    return grub_error (GRUB_ERR_READ_ERROR, "AHCI read error");
+  else
+    return grub_error (GRUB_ERR_WRITE_ERROR, "AHCI write error");
+}
+
+static grub_err_t
+grub_ahci_identify (struct grub_ahci_device *dev)
+{
+  grub_uint16_t *info16;
+
+  info16 = grub_malloc (GRUB_DISK_SECTOR_SIZE);
+  if (! info16)
+    return grub_errno;
+
+  dev->ncq = 0;
+  dev->lba48 = 0;
+  grub_ahci_prepare (dev, 0, GRUB_ATA_CMD_IDENTIFY_DEVICE, 0, 0,
+		     (char *) info16, GRUB_DISK_SECTOR_SIZE, 0);
+  if (grub_ahci_exec (dev, 1, 0))
+    {
+      grub_free (info16);
+      return grub_errno;
+    }
+
+  /* Only LBA addressing is supported.  */
+  if (! (info16[49] & (1 << 9)))
+    {
+      grub_free (info16);
+      return grub_error (GRUB_ERR_UNKNOWN_DEVICE,
+			 "AHCI device doesn't support LBA");
+    }
+
+  if (info16[83] & (1 << 10))
+    {
+      dev->lba48 = 1;
+      dev->size = grub_le_to_cpu64 (*((grub_uint64_t *) &info16[100]));
+    }
+  else
+    dev->size = grub_le_to_cpu32 (*((grub_uint32_t *) &info16[60]));
+
+  /* Determine the logical sector size, if the device reports one longer
+     than 256 words.  */
+  dev->log_sector_size = GRUB_DISK_SECTOR_BITS;
+  if ((info16[106] & 0xc000) == 0x4000 && (info16[106] & (1 << 12)))
+    {
+      grub_uint32_t bytes;
+
+      bytes = grub_le_to_cpu32 (*((grub_uint32_t *) &info16[117])) * 2;
+      if ((bytes & (bytes - 1)) == 0 && bytes > GRUB_DISK_SECTOR_SIZE
+	  && bytes <= (1U << GRUB_DISK_MAX_LOG_SECTOR_SIZE))
+	while ((1U << dev->log_sector_size) < bytes)
+	  dev->log_sector_size++;
+    }
+
+  /* Use native command queuing if both the HBA and the device support
+     it.  */
+  if (dev->lba48 && (dev->hba->cap & GRUB_AHCI_HBA_CAP_SNCQ)
+      && (info16[76] & (1 << 8)))
+    {
+      int depth = (info16[75] & 0x1f) + 1;
+
+      if (depth < dev->nslots)
+	dev->nslots = depth;
+      dev->ncq = dev->nslots > 1;
+    }
+  if (! dev->ncq)
+    dev->nslots = 1;
+
+  grub_dprintf ("ahci", "port %d: sectors=%llu, sector size=%u, lba48=%d, "
+		"ncq=%d, slots=%d\n", dev->port, (unsigned long long) dev->size,
+		1U << dev->log_sector_size, dev->lba48, dev->ncq, dev->nslots);
+
+  grub_free (info16);
+
+  return GRUB_ERR_NONE;
+}
+
+static void
+grub_ahci_free (struct grub_ahci_device *dev)
+{
+  grub_free (dev->command_list);
+  grub_free (dev->rfis);
+  grub_free (dev->command_tables);
+  grub_free (dev);
+}
+
+static grub_err_t
+grub_ahci_device_initialize (volatile struct grub_ahci_hba *hba, int portno)
+{
+  volatile struct grub_ahci_hba_port *port = &hba->ports[portno];
+  struct grub_ahci_device *dev;
+  struct grub_ahci_device **devp;
+
+  grub_dprintf ("ahci", "detecting port %d: status=0x%x, sig=0x%x\n",
+		portno, port->status, port->sig);
+
+  if (grub_ahci_stop_port (port))
+    return grub_errno;
+
+  dev = grub_zalloc (sizeof (*dev));
+  if (! dev)
+    return grub_errno;
+
+  dev->hba = hba;
+  dev->port = portno;
+  dev->nslots = ((hba->cap >> GRUB_AHCI_HBA_CAP_NCS_SHIFT)
+		 & GRUB_AHCI_HBA_CAP_NCS_MASK) + 1;
+
+  dev->command_list = grub_memalign (1024, sizeof (struct grub_ahci_cmd_head)
+				     * 32);
+  dev->rfis = grub_memalign (256, 256);
+  dev->command_tables = grub_memalign (GRUB_AHCI_COMMAND_TABLE_SIZE,
+				       GRUB_AHCI_COMMAND_TABLE_SIZE
+				       * dev->nslots);
+  if (! dev->command_list || ! dev->rfis || ! dev->command_tables)
+    {
+      grub_ahci_free (dev);
+      return grub_errno;
+    }
+
+  /* Only 32-bit addresses are programmed into the HBA.  */
+  if (! grub_ahci_addressable (dev->command_list,
+			      sizeof (struct grub_ahci_cmd_head) * 32)
+      || ! grub_ahci_addressable (dev->rfis, 256)
+      || ! grub_ahci_addressable (dev->command_tables,
+				  GRUB_AHCI_COMMAND_TABLE_SIZE * dev->nslots))
+    {
+      grub_ahci_free (dev);
+      return grub_error (GRUB_ERR_OUT_OF_MEMORY,
+			 "AHCI structures above 4GiB");
+    }
+
+  grub_memset (dev->command_list, 0, sizeof (struct grub_ahci_cmd_head) * 32);
+  grub_memset (dev->rfis, 0, 256);
+
+  port->command_list_base = (grub_uint32_t) (grub_addr_t) dev->command_list;
+  port->command_list_base_high = 0;
+  port->fis_base = (grub_uint32_t) (grub_addr_t) dev->rfis;
+  port->fis_base_high = 0;
+  port->error = ~0;
+  port->intstatus = ~0;
+  port->inten = 0;
+
+  port->command |= (GRUB_AHCI_HBA_PORT_CMD_FRE
+		    | GRUB_AHCI_HBA_PORT_CMD_SPIN_UP
+		    | GRUB_AHCI_HBA_PORT_CMD_POWER_ON);
+
+  /* Check for an established link and a disk that finished spinning
+     up.  */
+  if (grub_ahci_wait (&port->status, GRUB_AHCI_HBA_PORT_STATUS_DET_MASK,
+		      GRUB_AHCI_HBA_PORT_STATUS_DET_PRESENT, 100)
+      || grub_ahci_wait (&port->task_file_data,
+			 GRUB_ATA_STATUS_BUSY | GRUB_ATA_STATUS_DRQ, 0,
+			 GRUB_ATA_TOUT_DATA)
+      || port->sig != GRUB_AHCI_SIG_ATA)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      goto fail;
+    }
+
+  port->error = ~0;
+  port->intstatus = ~0;
+  port->command |= GRUB_AHCI_HBA_PORT_CMD_ST;
+
+  if (grub_ahci_identify (dev))
+    goto fail;
+
+  dev->num = grub_ahci_numdevs++;
+
+  /* Register the device.  */
+  for (devp = &grub_ahci_devices; *devp; devp = &(*devp)->next);
+  *devp = dev;
+
+  return GRUB_ERR_NONE;
+
+ fail:
+  grub_ahci_stop_port (port);
+  port->command_list_base = 0;
+  port->fis_base = 0;
+  grub_ahci_free (dev);
+  return grub_errno;
+}
+
+static int NESTED_FUNC_ATTR
+grub_ahci_pciinit (grub_pci_device_t dev,
+		   grub_pci_id_t pciid __attribute__ ((unused)))
+{
+  grub_pci_address_t addr;
+  grub_uint32_t class;
+  grub_uint32_t bar;
+  grub_uint16_t cmd;
+  volatile struct grub_ahci_hba *hba;
+  int i;
+
+  /* Read class.  */
+  addr = grub_pci_make_address (dev, GRUB_PCI_REG_CLASS);
+  class = grub_pci_read (addr);
+
+  /* Check if this class ID matches that of a SATA AHCI controller.  */
+  if (class >> 8 != 0x010601)
+    return 0;
+
+  addr = grub_pci_make_address (dev, GRUB_PCI_REG_ADDRESS_REG5);
+  bar = grub_pci_read (addr);
+
+  if ((bar & GRUB_PCI_ADDR_SPACE_MASK) != GRUB_PCI_ADDR_SPACE_MEMORY)
+    return 0;
+
+  /* Enable memory space and bus mastering.  */
+  addr = grub_pci_make_address (dev, GRUB_PCI_REG_COMMAND);
+  cmd = grub_pci_read_word (addr);
+  grub_pci_write_word (addr, cmd | 0x6);
+
+  hba = (volatile struct grub_ahci_hba *) (grub_addr_t)
+    (bar & GRUB_PCI_ADDR_MEM_MASK);
+
+  grub_dprintf ("ahci", "PCI dev (%d,%d,%d) hba=%p cap=0x%x version=0x%x "
+		"ports=0x%x\n", grub_pci_get_bus (dev),
+		grub_pci_get_device (dev), grub_pci_get_function (dev),
+		hba, hba->cap, hba->version, hba->ports_implemented);
+
+  grub_ahci_take_ownership (hba);
+
+  hba->global_control |= GRUB_AHCI_HBA_GC_AHCI_ENABLE;
+
+  for (i = 0; i < 32; i++)
+    if (hba->ports_implemented & (1U << i))
+      {
+	grub_errno = GRUB_ERR_NONE;
+	grub_ahci_device_initialize (hba, i);
+
+	/* Errors here just mean that this port has no usable disk.  */
+	if (grub_errno)
+	  {
+	    grub_print_error ();
+	    grub_errno = GRUB_ERR_NONE;
+	  }
+      }
+
+  return 0;
+}
+
+static grub_err_t
+grub_ahci_readwrite (grub_disk_t disk, grub_disk_addr_t sector,
+		     grub_size_t size, char *buf, int rw)
+{
+  struct grub_ahci_device *dev = (struct grub_ahci_device *) disk->data;
+  int shift = dev->log_sector_size - GRUB_DISK_SECTOR_BITS;
+  grub_size_t max = dev->lba48 ? (GRUB_AHCI_MAX_SECTORS >> shift) : 256;
+  char *bounce = 0;
+  int cmd;
+
+  grub_dprintf ("ahci", "grub_ahci_readwrite (sector=%llu, size=%llu, rw=%d)\n",
+		(unsigned long long) sector, (unsigned long long) size, rw);
+
+  if (dev->ncq)
+    cmd = rw ? GRUB_ATA_CMD_WRITE_FPDMA_QUEUED : GRUB_ATA_CMD_READ_FPDMA_QUEUED;
+  else if (dev->lba48)
+    cmd = rw ? GRUB_ATA_CMD_WRITE_DMA_EXT : GRUB_ATA_CMD_READ_DMA_EXT;
+  else
+    cmd = rw ? GRUB_ATA_CMD_WRITE_DMA : GRUB_ATA_CMD_READ_DMA;
+
+  /* Regions must be word aligned and below 4GiB.  Buffers which are
+     not go through a bounce buffer, one command at a time.  */
+  if (((grub_addr_t) buf & 1)
+      || ! grub_ahci_addressable (buf, size << dev->log_sector_size))
+    {
+      if (max > (128U >> shift))
+	max = 128 >> shift;
+      bounce = grub_malloc (max << dev->log_sector_size);
+      if (! bounce)
+	return grub_errno;
+    }
+
+  while (size)
+    {
+      grub_uint32_t mask = 0;
+      char *start = buf;
+      grub_size_t len = 0;
+      int slot;
+
+      /* Queue up to one command per slot.  */
+      for (slot = 0; slot < (bounce ? 1 : dev->nslots) && size; slot++)
+	{
+	  grub_size_t count = size < max ? size : max;
+	  char *p = bounce ? : buf;
+
+	  if (bounce && rw)
+	    grub_memcpy (bounce, buf, count << dev->log_sector_size);
+
+	  grub_ahci_prepare (dev, slot, cmd, sector, count, p,
+			     count << dev->log_sector_size, rw);
+	  mask |= 1U << slot;
+
+	  sector += count;
+	  size -= count;
+	  buf += count << dev->log_sector_size;
+	  len += count << dev->log_sector_size;
+	}
+
+      if (grub_ahci_exec (dev, mask, rw))
+	break;
+
+      if (bounce && ! rw)
+	grub_memcpy (start, bounce, len);
+    }
+
+  grub_free (bounce);
+
+  return grub_errno;
+}
+
+
+
+static int
+grub_ahci_iterate (int (*hook) (const char *name))
+{
+  struct grub_ahci_device *dev;
+
+  for (dev = grub_ahci_devices; dev; dev = dev->next)
+    {
+      char devname[10];
+
+      grub_snprintf (devname, sizeof (devname), "ahci%d", dev->num);
+
+      if (hook (devname))
+	return 1;
+    }
+
+  return 0;
+}
+
+static grub_err_t
+grub_ahci_open (const char *name, grub_disk_t disk)
+{
+  struct grub_ahci_device *dev;
+
+  for (dev = grub_ahci_devices; dev; dev = dev->next)
+    {
+      char devname[10];
+      grub_snprintf (devname, sizeof (devname), "ahci%d", dev->num);
+      if (grub_strcmp (name, devname) == 0)
+	break;
+    }
+
+  if (! dev)
+    return grub_error (GRUB_ERR_UNKNOWN_DEVICE, "can't open device");
+
+  disk->log_sector_size = dev->log_sector_size;
+  disk->total_sectors = (dev->size
+			 << (dev->log_sector_size - GRUB_DISK_SECTOR_BITS));
+
+  disk->id = (unsigned long) dev;
+
+  disk->has_partitions = 1;
+  disk->data = dev;
+
+  return 0;
+}
+
+static void
+grub_ahci_close (grub_disk_t disk __attribute__((unused)))
+{
+
+}
+
+static grub_err_t
+grub_ahci_read (grub_disk_t disk, grub_disk_addr_t sector,
+		grub_size_t size, char *buf)
+{
+  return grub_ahci_readwrite (disk, sector, size, buf, 0);
+}
+
+static grub_err_t
+grub_ahci_write (grub_disk_t disk,
+		 grub_disk_addr_t sector,
+		 grub_size_t size,
+		 const char *buf)
+{
+  return grub_ahci_readwrite (disk, sector, size, (char *) buf, 1);
+}
+
+static struct grub_disk_dev grub_ahci_dev =
+  {
+    .name = "AHCI",
+    .id = GRUB_DISK_DEVICE_AHCI_ID,
+    .iterate = grub_ahci_iterate,
+    .open = grub_ahci_open,
+    .close = grub_ahci_close,
+    .read = grub_ahci_read,
+    .write = grub_ahci_write,
+    .next = 0
+  };
+
+
+
+GRUB_MOD_INIT(ahci)
+{
+  /* To prevent two drivers operating on the same disks.  */
+  grub_disk_firmware_is_tainted = 1;
+  if (grub_disk_firmware_fini)
+    {
+      grub_disk_firmware_fini ();
+      grub_disk_firmware_fini = NULL;
+    }
+
+  grub_pci_iterate (grub_ahci_pciinit);
+
+  grub_disk_dev_register (&grub_ahci_dev);
+}
+
+GRUB_MOD_FINI(ahci)
+{
+  struct grub_ahci_device *dev, *next;
+
+  grub_disk_dev_unregister (&grub_ahci_dev);
+
+  /* Leave the ports stopped, so that the hardware no longer uses the
+     memory of the command lists.  */
+  for (dev = grub_ahci_devices; dev; dev = next)
+    {
+      volatile struct grub_ahci_hba_port *port = &dev->hba->ports[dev->port];
+
+      next = dev->next;
+      grub_ahci_stop_port (port);
+      grub_errno = GRUB_ERR_NONE;
+      port->command_list_base = 0;
+      port->fis_base = 0;
+      grub_ahci_free (dev);
+    }
+  grub_ahci_devices = 0;
+  grub_ahci_numdevs = 0;
+}
@@ -31,29 +31,65 @@ static const grub_port_t grub_ata_ioaddress2[] = { 0x3f6, 0x376 };
 
 static struct grub_ata_device *grub_ata_devices;
 
+/* Bus master DMA writes straight into the caller's buffer, which needs
+   identity mapped, cache coherent memory.  */
+#ifndef GRUB_MACHINE_MIPS
+#define GRUB_ATA_USE_DMA	1
+#endif
+
+/* Entries in each device's PRD table, and the largest DMA transfer
+   issued with one command, in 512-byte sectors.  Any buffer of
+   GRUB_ATA_DMA_MAX_SECTORS sectors spans at most 17 64KiB regions.  */
+#define GRUB_ATA_PRDT_ENTRIES		32
+#define GRUB_ATA_DMA_MAX_SECTORS	2048
+
+#ifdef GRUB_ATA_USE_DMA
+/* Check whether the bus master can transfer SIZE sectors to or from
+   BUF directly.  */
+static int
+grub_ata_dma_usable (struct grub_ata_device *dev, char *buf,
+		     grub_size_t size)
+{
+  grub_addr_t addr = (grub_addr_t) buf;
+
+  if (! dev->bmaddress)
+    return 0;
+
+  /* Regions must be word aligned and below 4GiB.  */
+  return (! (addr & 1)
+	  && (grub_uint64_t) addr + (size << dev->log_sector_size)
+	     <= 0x100000000ULL);
+}
+#endif
+
 /* Wait for !BSY.  */
 grub_err_t
 grub_ata_wait_not_busy (struct grub_ata_device *dev, int milliseconds)
 {
   /* ATA requires 400ns (after a write to CMD register) or
      1 PIO cycle (after a DRQ block transfer) before
-     first check of BSY.  */
-  grub_millisleep (1);
+     first check of BSY.  Each read of the alternate status
+     register takes at least 100ns.  */
+  int i;
+  for (i = 0; i < 4; i++)
+    grub_ata_regget2 (dev, GRUB_ATA_REG2_ALTSTATUS);
 
-  int i = 1;
   grub_uint8_t sts;
+  grub_uint64_t endtime = 0;
   while ((sts = grub_ata_regget (dev, GRUB_ATA_REG_STATUS))
 	 & GRUB_ATA_STATUS_BUSY)
     {
-      if (i >= milliseconds)
+      /* Most commands complete within a few microseconds of polling,
+	 so only start the clock once the device turns out to be
+	 busy.  */
+      if (! endtime)
+	endtime = grub_get_time_ms () + milliseconds;
+      else if (grub_get_time_ms () > endtime)
         {
 	  grub_dprintf ("ata", "timeout: %dms, status=0x%x\n",
 			milliseconds, sts);
 	  return grub_error (GRUB_ERR_TIMEOUT, "ATA timeout");
 	}
-
-      grub_millisleep (1);
-      i++;
     }
 
   return GRUB_ERR_NONE;
@@ -141,6 +177,8 @@ grub_ata_dumpinfo (struct grub_ata_device *dev, char *info)
     {
       grub_dprintf ("ata", "Addressing: %d\n", dev->addr);
       grub_dprintf ("ata", "Sectors: %lld\n", (unsigned long long) dev->size);
+      grub_dprintf ("ata", "Multiple: %d\n", dev->multiple);
+      grub_dprintf ("ata", "DMA: %s\n", dev->bmaddress ? "yes" : "no");
     }
 }
 
@@ -239,6 +277,42 @@ grub_atapi_packet (struct grub_ata_device *dev, char *packet,
   return GRUB_ERR_NONE;
 }
 
+/* Enable READ/WRITE MULTIPLE with COUNT sectors per DRQ block.  */
+static void
+grub_ata_set_multiple (struct grub_ata_device *dev, int count)
+{
+  dev->multiple = 0;
+
+  /* The count must be a power of two.  */
+  if (count < 2 || (count & (count - 1)))
+    return;
+
+  grub_ata_regset (dev, GRUB_ATA_REG_DISK, 0xE0 | dev->device << 4);
+  if (grub_ata_check_ready (dev))
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  grub_ata_regset (dev, GRUB_ATA_REG_SECTORS, count);
+  grub_ata_regset (dev, GRUB_ATA_REG_CMD, GRUB_ATA_CMD_SET_MULTIPLE_MODE);
+
+  if (grub_ata_wait_not_busy (dev, GRUB_ATA_TOUT_STD))
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  if (grub_ata_regget (dev, GRUB_ATA_REG_STATUS) & GRUB_ATA_STATUS_ERR)
+    {
+      grub_dprintf ("ata", "SET MULTIPLE MODE %d failed, error=0x%x\n",
+		    count, grub_ata_regget (dev, GRUB_ATA_REG_ERROR));
+      return;
+    }
+
+  dev->multiple = count;
+}
+
 static grub_err_t
 grub_ata_identify (struct grub_ata_device *dev)
 {
@@ -319,11 +393,34 @@ grub_ata_identify (struct grub_ata_device *dev)
   else
     dev->size = grub_le_to_cpu64(*((grub_uint64_t *) &info16[100]));
 
+  /* Determine the logical sector size, if the device reports one longer
+     than 256 words.  */
+  dev->log_sector_size = GRUB_DISK_SECTOR_BITS;
+  if ((info16[106] & 0xc000) == 0x4000 && (info16[106] & (1 << 12)))
+    {
+      grub_uint32_t bytes;
+
+      bytes = grub_le_to_cpu32 (*((grub_uint32_t *) &info16[117])) * 2;
+      if ((bytes & (bytes - 1)) == 0 && bytes > GRUB_DISK_SECTOR_SIZE
+	  && bytes <= (1U << GRUB_DISK_MAX_LOG_SECTOR_SIZE))
+	while ((1U << dev->log_sector_size) < bytes)
+	  dev->log_sector_size++;
+    }
+
   /* Read CHS information.  */
   dev->cylinders = info16[1];
   dev->heads = info16[3];
   dev->sectors_per_track = info16[6];
 
+  grub_ata_set_multiple (dev, info16[47] & 0xff);
+
+  /* Only use DMA if the device supports it and the firmware selected
+     a (U)DMA mode; the controller timings are left as they are.  */
+  if (! (info16[49] & (1 << 8))
+      || ! (((info16[53] & (1 << 2)) && (info16[88] & 0x7f00))
+	    || (info16[63] & 0x0700)))
+    dev->bmaddress = 0;
+
   grub_ata_dumpinfo (dev, info);
 
   grub_free(info);
@@ -332,13 +429,14 @@ grub_ata_identify (struct grub_ata_device *dev)
 }
 
 static grub_err_t
-grub_ata_device_initialize (int port, int device, int addr, int addr2)
+grub_ata_device_initialize (int port, int device, int addr, int addr2,
+			    int bmaddr)
 {
   struct grub_ata_device *dev;
   struct grub_ata_device **devp;
 
-  grub_dprintf ("ata", "detecting device %d,%d (0x%x, 0x%x)\n",
-		port, device, addr, addr2);
+  grub_dprintf ("ata", "detecting device %d,%d (0x%x, 0x%x, 0x%x)\n",
+		port, device, addr, addr2, bmaddr);
 
   dev = grub_malloc (sizeof(*dev));
   if (! dev)
@@ -349,6 +447,9 @@ grub_ata_device_initialize (int port, int device, int addr, int addr2)
   dev->device = device;
   dev->ioaddress = addr + GRUB_MACHINE_PCI_IO_BASE;
   dev->ioaddress2 = addr2 + GRUB_MACHINE_PCI_IO_BASE;
+  dev->bmaddress = bmaddr ? bmaddr + GRUB_MACHINE_PCI_IO_BASE : 0;
+  dev->multiple = 0;
+  dev->prdt = 0;
   dev->next = NULL;
 
   grub_ata_regset (dev, GRUB_ATA_REG_DISK, dev->device << 4);
@@ -380,6 +481,30 @@ grub_ata_device_initialize (int port, int device, int addr, int addr2)
       return 0;
     }
 
+#ifdef GRUB_ATA_USE_DMA
+  if (dev->bmaddress && ! dev->atapi)
+    {
+      /* The table must not cross a 64KiB boundary.  */
+      dev->prdt = grub_memalign (sizeof (struct grub_ata_prd)
+				 * GRUB_ATA_PRDT_ENTRIES,
+				 sizeof (struct grub_ata_prd)
+				 * GRUB_ATA_PRDT_ENTRIES);
+      if (! dev->prdt)
+	{
+	  grub_errno = GRUB_ERR_NONE;
+	  dev->bmaddress = 0;
+	}
+      else if (! grub_ata_dma_usable (dev, (char *) dev->prdt, 1))
+	{
+	  grub_free (dev->prdt);
+	  dev->prdt = 0;
+	  dev->bmaddress = 0;
+	}
+    }
+  else
+    dev->bmaddress = 0;
+#endif
+
   /* Register the device.  */
   for (devp = &grub_ata_devices; *devp; devp = &(*devp)->next);
   *devp = dev;
@@ -396,8 +521,10 @@ grub_ata_pciinit (grub_pci_device_t dev,
   grub_uint32_t class;
   grub_uint32_t bar1;
   grub_uint32_t bar2;
+  grub_uint32_t bar4 = 0;
   int rega;
   int regb;
+  int regbm;
   int i;
   static int controller = 0;
   int cs5536 = 0;
@@ -418,6 +545,28 @@ grub_ata_pciinit (grub_pci_device_t dev,
   if (!cs5536 && (class >> 16 != 0x0101))
     return 0;
 
+#ifdef GRUB_ATA_USE_DMA
+  /* Bus master capable controllers have their DMA registers in BAR4.  */
+  if (!cs5536 && (class & (1 << 15)))
+    {
+      addr = grub_pci_make_address (dev, GRUB_PCI_REG_ADDRESS_REG4);
+      bar4 = grub_pci_read (addr);
+      if ((bar4 & GRUB_PCI_ADDR_SPACE_MASK) == GRUB_PCI_ADDR_SPACE_IO
+	  && (bar4 & GRUB_PCI_ADDR_IO_MASK))
+	{
+	  grub_uint16_t cmd;
+
+	  /* Enable bus mastering.  */
+	  addr = grub_pci_make_address (dev, GRUB_PCI_REG_COMMAND);
+	  cmd = grub_pci_read_word (addr);
+	  if (! (cmd & 0x4))
+	    grub_pci_write_word (addr, cmd | 0x4);
+	}
+      else
+	bar4 = 0;
+    }
+#endif
+
   for (i = 0; i < nports; i++)
     {
       /* Set to 0 when the channel operated in compatibility mode.  */
@@ -431,6 +580,7 @@ grub_ata_pciinit (grub_pci_device_t dev,
 
       rega = 0;
       regb = 0;
+      regbm = bar4 ? (bar4 & GRUB_PCI_ADDR_IO_MASK) + 8 * i : 0;
 
       /* If the channel is in compatibility mode, just assign the
 	 default registers.  */
@@ -461,14 +611,16 @@ grub_ata_pciinit (grub_pci_device_t dev,
 	}
 
       grub_dprintf ("ata",
-		    "PCI dev (%d,%d,%d) compat=%d rega=0x%x regb=0x%x\n",
+		    "PCI dev (%d,%d,%d) compat=%d rega=0x%x regb=0x%x "
+		    "regbm=0x%x\n",
 		    grub_pci_get_bus (dev), grub_pci_get_device (dev),
-		    grub_pci_get_function (dev), compat, rega, regb);
+		    grub_pci_get_function (dev), compat, rega, regb, regbm);
 
       if (rega && regb)
 	{
 	  grub_errno = GRUB_ERR_NONE;
-	  grub_ata_device_initialize (controller * 2 + i, 0, rega, regb);
+	  grub_ata_device_initialize (controller * 2 + i, 0, rega, regb,
+				      regbm);
 
 	  /* Most errors raised by grub_ata_device_initialize() are harmless.
 	     They just indicate this particular drive is not responding, most
@@ -480,7 +632,8 @@ grub_ata_pciinit (grub_pci_device_t dev,
 	      grub_errno = GRUB_ERR_NONE;
 	    }
 
-	  grub_ata_device_initialize (controller * 2 + i, 1, rega, regb);
+	  grub_ata_device_initialize (controller * 2 + i, 1, rega, regb,
+				      regbm);
 
 	  /* Likewise.  */
 	  if (grub_errno)
@@ -581,6 +734,93 @@ grub_ata_setaddress (struct grub_ata_device *dev,
   return GRUB_ERR_NONE;
 }
 
+#ifdef GRUB_ATA_USE_DMA
+/* Transfer SIZE sectors starting at SECTOR with bus master DMA.  SIZE
+   may not exceed GRUB_ATA_DMA_MAX_SECTORS or the command's limit.  */
+static grub_err_t
+grub_ata_dma (struct grub_ata_device *dev, grub_ata_addressing_t addressing,
+	      grub_disk_addr_t sector, grub_size_t size, char *buf,
+	      int cmd, int rw)
+{
+  grub_port_t bm = dev->bmaddress;
+  grub_addr_t addr = (grub_addr_t) buf;
+  grub_size_t len = size << dev->log_sector_size;
+  grub_uint8_t dir = rw ? 0 : GRUB_ATA_BM_CMD_READ;
+  grub_uint8_t bmsts;
+  grub_uint64_t endtime;
+  int n;
+
+  /* Describe the buffer, splitting it at 64KiB boundaries.  */
+  for (n = 0; len; n++)
+    {
+      grub_size_t chunk = 0x10000 - (addr & 0xffff);
+
+      if (chunk > len)
+	chunk = len;
+
+      dev->prdt[n].addr = grub_cpu_to_le32 (addr);
+      dev->prdt[n].size = grub_cpu_to_le16 (chunk & 0xffff);
+      dev->prdt[n].flags = 0;
+
+      addr += chunk;
+      len -= chunk;
+    }
+  dev->prdt[n - 1].flags = grub_cpu_to_le16 (GRUB_ATA_PRD_EOT);
+
+  /* Stop any previous transfer and clear the interrupt and error
+     bits, which are cleared by writing ones.  */
+  grub_outb (0, bm + GRUB_ATA_BM_REG_CMD);
+  grub_outb (grub_inb (bm + GRUB_ATA_BM_REG_STATUS)
+	     | GRUB_ATA_BM_STATUS_ERR | GRUB_ATA_BM_STATUS_INTR,
+	     bm + GRUB_ATA_BM_REG_STATUS);
+  grub_outl ((grub_uint32_t) (grub_addr_t) dev->prdt,
+	     bm + GRUB_ATA_BM_REG_PRDT);
+  grub_outb (dir, bm + GRUB_ATA_BM_REG_CMD);
+
+  if (grub_ata_setaddress (dev, addressing, sector, size))
+    return grub_errno;
+
+  grub_ata_regset (dev, GRUB_ATA_REG_CMD, cmd);
+  grub_outb (dir | GRUB_ATA_BM_CMD_START, bm + GRUB_ATA_BM_REG_CMD);
+
+  /* Wait until the device raises its interrupt or the bus master runs
+     out of regions.  */
+  endtime = grub_get_time_ms () + GRUB_ATA_TOUT_DATA;
+  while (((bmsts = grub_inb (bm + GRUB_ATA_BM_REG_STATUS))
+	  & (GRUB_ATA_BM_STATUS_ACTIVE | GRUB_ATA_BM_STATUS_ERR
+	     | GRUB_ATA_BM_STATUS_INTR)) == GRUB_ATA_BM_STATUS_ACTIVE)
+    if (grub_get_time_ms () > endtime)
+      break;
+
+  grub_outb (dir, bm + GRUB_ATA_BM_REG_CMD);
+  grub_outb (bmsts | GRUB_ATA_BM_STATUS_ERR | GRUB_ATA_BM_STATUS_INTR,
+	     bm + GRUB_ATA_BM_REG_STATUS);
+
+  if (grub_ata_wait_not_busy (dev, GRUB_ATA_TOUT_DATA))
+    return grub_errno;
+
+  grub_uint8_t sts = grub_ata_regget (dev, GRUB_ATA_REG_STATUS);
+  if ((bmsts & GRUB_ATA_BM_STATUS_ERR)
+      || (sts & (GRUB_ATA_STATUS_DRQ | GRUB_ATA_STATUS_ERR)))
+    {
+      grub_dprintf ("ata", "DMA error: status=0x%x, bm status=0x%x\n",
+		    sts, bmsts);
+      if (! rw)
+        return grub_error (GRUB_ERR_READ_ERROR, "ATA DMA read error");
+      else
+        return grub_error (GRUB_ERR_WRITE_ERROR, "ATA DMA write error");
+    }
+
+  /* The bus master is still active only if the wait above timed
+     out.  */
+  if ((bmsts & (GRUB_ATA_BM_STATUS_ACTIVE | GRUB_ATA_BM_STATUS_INTR))
+      == GRUB_ATA_BM_STATUS_ACTIVE)
+    return grub_error (GRUB_ERR_TIMEOUT, "ATA DMA timeout");
+
+  return GRUB_ERR_NONE;
+}
+#endif
+
 static grub_err_t
 grub_ata_readwrite (grub_disk_t disk, grub_disk_addr_t sector,
 		    grub_size_t size, char *buf, int rw)
@@ -591,51 +831,111 @@ grub_ata_readwrite (grub_disk_t disk, grub_disk_addr_t sector,
 
   grub_ata_addressing_t addressing = dev->addr;
   grub_size_t batch;
-  int cmd, cmd_write;
+  int ext;
 
   if (addressing == GRUB_ATA_LBA48 && ((sector + size) >> 28) != 0)
     {
       batch = 65536;
-      cmd = GRUB_ATA_CMD_READ_SECTORS_EXT;
-      cmd_write = GRUB_ATA_CMD_WRITE_SECTORS_EXT;
+      ext = 1;
     }
   else
     {
       if (addressing == GRUB_ATA_LBA48)
 	addressing = GRUB_ATA_LBA;
       batch = 256;
-      cmd = GRUB_ATA_CMD_READ_SECTORS;
-      cmd_write = GRUB_ATA_CMD_WRITE_SECTORS;
+      ext = 0;
     }
 
   grub_size_t nsectors = 0;
   while (nsectors < size)
     {
+      int cmd;
+
       if (size - nsectors < batch)
 	batch = size - nsectors;
 
+#ifdef GRUB_ATA_USE_DMA
+      if (grub_ata_dma_usable (dev, buf, batch))
+	{
+	  grub_size_t dmabatch = batch;
+	  grub_size_t dmamax = (GRUB_ATA_DMA_MAX_SECTORS
+				>> (dev->log_sector_size
+				    - GRUB_DISK_SECTOR_BITS));
+
+	  if (dmabatch > dmamax)
+	    dmabatch = dmamax;
+
+	  if (! rw)
+	    cmd = ext ? GRUB_ATA_CMD_READ_DMA_EXT : GRUB_ATA_CMD_READ_DMA;
+	  else
+	    cmd = ext ? GRUB_ATA_CMD_WRITE_DMA_EXT : GRUB_ATA_CMD_WRITE_DMA;
+
+	  grub_dprintf("ata", "DMA rw=%d, sector=%llu, batch=%llu\n", rw, (unsigned long long) sector, (unsigned long long) dmabatch);
+
+	  if (! grub_ata_dma (dev, addressing, sector, dmabatch, buf,
+			      cmd, rw))
+	    {
+	      buf += dmabatch << dev->log_sector_size;
+	      sector += dmabatch;
+	      nsectors += dmabatch;
+	      continue;
+	    }
+
+	  /* Don't use DMA on this device any more and redo the batch
+	     with PIO.  */
+	  grub_dprintf ("ata", "disabling DMA: %s\n", grub_errmsg);
+	  grub_errno = GRUB_ERR_NONE;
+	  dev->bmaddress = 0;
+	}
+#endif
+
       grub_dprintf("ata", "rw=%d, sector=%llu, batch=%llu\n", rw, (unsigned long long) sector, (unsigned long long) batch);
 
+      if (dev->multiple)
+	{
+	  if (! rw)
+	    cmd = (ext ? GRUB_ATA_CMD_READ_MULTIPLE_EXT
+		   : GRUB_ATA_CMD_READ_MULTIPLE);
+	  else
+	    cmd = (ext ? GRUB_ATA_CMD_WRITE_MULTIPLE_EXT
+		   : GRUB_ATA_CMD_WRITE_MULTIPLE);
+	}
+      else
+	{
+	  if (! rw)
+	    cmd = (ext ? GRUB_ATA_CMD_READ_SECTORS_EXT
+		   : GRUB_ATA_CMD_READ_SECTORS);
+	  else
+	    cmd = (ext ? GRUB_ATA_CMD_WRITE_SECTORS_EXT
+		   : GRUB_ATA_CMD_WRITE_SECTORS);
+	}
+
       /* Send read/write command.  */
       if (grub_ata_setaddress (dev, addressing, sector, batch))
 	return grub_errno;
 
-      grub_ata_regset (dev, GRUB_ATA_REG_CMD, (! rw ? cmd : cmd_write));
+      grub_ata_regset (dev, GRUB_ATA_REG_CMD, cmd);
 
-      unsigned sect;
-      for (sect = 0; sect < batch; sect++)
+      /* Each DRQ block is one sector, or up to dev->multiple sectors
+	 in multiple mode.  */
+      grub_size_t sect, block;
+      for (sect = 0; sect < batch; sect += block)
 	{
+	  block = batch - sect;
+	  if (block > (grub_size_t) (dev->multiple ? : 1))
+	    block = dev->multiple ? : 1;
+
 	  /* Wait for !BSY, DRQ.  */
 	  if (grub_ata_wait_drq (dev, rw, GRUB_ATA_TOUT_DATA))
 	    return grub_errno;
 
 	  /* Transfer data.  */
 	  if (! rw)
-	    grub_ata_pio_read (dev, buf, GRUB_DISK_SECTOR_SIZE);
+	    grub_ata_pio_read (dev, buf, block << dev->log_sector_size);
 	  else
-	    grub_ata_pio_write (dev, buf, GRUB_DISK_SECTOR_SIZE);
+	    grub_ata_pio_write (dev, buf, block << dev->log_sector_size);
 
-	  buf += GRUB_DISK_SECTOR_SIZE;
+	  buf += block << dev->log_sector_size;
 	}
 
       if (rw)
@@ -700,7 +1000,9 @@ grub_ata_open (const char *name, grub_disk_t disk)
   if (dev->atapi)
     return grub_error (GRUB_ERR_UNKNOWN_DEVICE, "not an ATA harddisk");
 
-  disk->total_sectors = dev->size;
+  disk->log_sector_size = dev->log_sector_size;
+  disk->total_sectors = (dev->size
+			 << (dev->log_sector_size - GRUB_DISK_SECTOR_BITS));
 
   disk->id = (unsigned long) dev;
 
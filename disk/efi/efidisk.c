@@ -37,6 +37,10 @@ struct grub_efidisk_data
   struct grub_efidisk_data *next;
 };
 
+/* The largest request passed to the firmware at once, in 512-byte
+   sectors.  */
+#define GRUB_EFIDISK_MAX_TRANSFER	8192
+
 /* GUIDs.  */
 static grub_efi_guid_t disk_io_guid = GRUB_EFI_DISK_IO_GUID;
 static grub_efi_guid_t block_io_guid = GRUB_EFI_BLOCK_IO_GUID;
@@ -536,12 +540,22 @@ grub_efidisk_open (const char *name, struct grub_disk *disk)
 
   disk->id = ((num << 8) | name[0]);
   m = d->block_io->media;
-  /* FIXME: Probably it is better to store the block size in the disk,
-     and total sectors should be replaced with total blocks.  */
   grub_dprintf ("efidisk", "m = %p, last block = %llx, block size = %x\n",
 		m, (unsigned long long) m->last_block, m->block_size);
+
+  /* Address the disk in blocks if their size is one we support, and in
+     512-byte units through the disk io interface otherwise.  */
+  if ((m->block_size & (m->block_size - 1)) == 0
+      && m->block_size >= GRUB_DISK_SECTOR_SIZE
+      && m->block_size <= (1U << GRUB_DISK_MAX_LOG_SECTOR_SIZE))
+    while ((1U << disk->log_sector_size) < m->block_size)
+      disk->log_sector_size++;
+
   disk->total_sectors = (m->last_block
 			 * (m->block_size >> GRUB_DISK_SECTOR_BITS));
+  disk->max_transfer = GRUB_EFIDISK_MAX_TRANSFER;
+  if (m->io_align > 1)
+    disk->io_align = m->io_align;
   disk->data = d;
 
   grub_dprintf ("efidisk", "opening %s succeeded\n", name);
@@ -560,23 +574,42 @@ static grub_err_t
 grub_efidisk_read (struct grub_disk *disk, grub_disk_addr_t sector,
 		   grub_size_t size, char *buf)
 {
-  /* For now, use the disk io interface rather than the block io's.  */
   struct grub_efidisk_data *d;
   grub_efi_disk_io_t *dio;
   grub_efi_block_io_t *bio;
+  grub_efi_block_io_media_t *m;
   grub_efi_status_t status;
 
   d = disk->data;
   dio = d->disk_io;
   bio = d->block_io;
+  m = bio->media;
 
   grub_dprintf ("efidisk",
 		"reading 0x%lx sectors at the sector 0x%llx from %s\n",
 		(unsigned long) size, (unsigned long long) sector, disk->name);
 
+  /* Read into suitably aligned buffers with the block io interface
+     directly, which saves the disk io layer splitting and bouncing the
+     request.  */
+  if ((1U << disk->log_sector_size) == m->block_size
+      && (m->io_align <= 1
+	  || ((grub_addr_t) buf & (m->io_align - 1)) == 0))
+    {
+      status = efi_call_5 (bio->read_blocks, bio, m->media_id,
+			   (grub_efi_lba_t) sector,
+			   (grub_efi_uintn_t) size << disk->log_sector_size,
+			   buf);
+      if (status != GRUB_EFI_SUCCESS)
+	return grub_error (GRUB_ERR_READ_ERROR, "efidisk read error");
+
+      return GRUB_ERR_NONE;
+    }
+
+  /* Otherwise use the disk io interface.  */
   status = efi_call_5 (dio->read, dio, bio->media->media_id,
-		      (grub_efi_uint64_t) sector << GRUB_DISK_SECTOR_BITS,
-		      (grub_efi_uintn_t) size << GRUB_DISK_SECTOR_BITS,
+		      (grub_efi_uint64_t) sector << disk->log_sector_size,
+		      (grub_efi_uintn_t) size << disk->log_sector_size,
 		      buf);
   if (status != GRUB_EFI_SUCCESS)
     return grub_error (GRUB_ERR_READ_ERROR, "efidisk read error");
@@ -603,8 +636,8 @@ grub_efidisk_write (struct grub_disk *disk, grub_disk_addr_t sector,
 		(unsigned long) size, (unsigned long long) sector, disk->name);
 
   status = efi_call_5 (dio->write, dio, bio->media->media_id,
-		       (grub_efi_uint64_t) sector << GRUB_DISK_SECTOR_BITS,
-		       (grub_efi_uintn_t) size << GRUB_DISK_SECTOR_BITS,
+		       (grub_efi_uint64_t) sector << disk->log_sector_size,
+		       (grub_efi_uintn_t) size << disk->log_sector_size,
 		       (void *) buf);
   if (status != GRUB_EFI_SUCCESS)
     return grub_error (GRUB_ERR_WRITE_ERROR, "efidisk write error");
@@ -120,6 +120,7 @@ grub_biosdisk_open (const char *name, grub_disk_t disk)
     {
       data->flags = GRUB_BIOSDISK_FLAG_LBA | GRUB_BIOSDISK_FLAG_CDROM;
       data->sectors = 32;
+      disk->log_sector_size = 11;
       total_sectors = GRUB_ULONG_MAX;  /* TODO: get the correct size.  */
     }
   else if (drive & 0x80)
@@ -140,6 +141,17 @@ grub_biosdisk_open (const char *name, grub_disk_t disk)
 	    {
 	      data->flags = GRUB_BIOSDISK_FLAG_LBA;
 
+	      /* Use the native sector size if it is one we support.  */
+	      if (drp->bytes_per_sector > GRUB_DISK_SECTOR_SIZE
+		  && drp->bytes_per_sector <= GRUB_BIOSDISK_MAX_SECTOR_SIZE
+		  && (drp->bytes_per_sector
+		      & (drp->bytes_per_sector - 1)) == 0)
+		{
+		  while ((1U << disk->log_sector_size)
+			 < drp->bytes_per_sector)
+		    disk->log_sector_size++;
+		}
+
 	      if (drp->total_sectors)
 		total_sectors = drp->total_sectors;
 	      else
@@ -178,7 +190,11 @@ grub_biosdisk_open (const char *name, grub_disk_t disk)
         total_sectors = data->cylinders * data->heads * data->sectors;
     }
 
-  disk->total_sectors = total_sectors;
+  if (total_sectors == GRUB_ULONG_MAX)
+    disk->total_sectors = total_sectors;
+  else
+    disk->total_sectors = (total_sectors
+			   << (disk->log_sector_size - GRUB_DISK_SECTOR_BITS));
   disk->data = data;
 
   return GRUB_ERR_NONE;
@@ -196,6 +212,21 @@ grub_biosdisk_close (grub_disk_t disk)
 
 #define GRUB_BIOSDISK_CDROM_RETRY_COUNT 3
 
+/* The number of native sectors which fit in the scratch area together
+   with the disk address packet.  Limit it to 0x7f because of Phoenix
+   EDD.  */
+static grub_size_t
+grub_biosdisk_max_sectors (grub_disk_t disk)
+{
+  grub_size_t max;
+
+  max = (GRUB_MEMORY_MACHINE_SCRATCH_SIZE >> disk->log_sector_size) - 1;
+  if (max > 0x7f)
+    max = 0x7f;
+
+  return max;
+}
+
 static grub_err_t
 grub_biosdisk_rw (int cmd, grub_disk_t disk,
 		  grub_disk_addr_t sector, grub_size_t size,
@@ -208,8 +239,8 @@ grub_biosdisk_rw (int cmd, grub_disk_t disk,
       struct grub_biosdisk_dap *dap;
 
       dap = (struct grub_biosdisk_dap *) (GRUB_MEMORY_MACHINE_SCRATCH_ADDR
-					  + (data->sectors
-					     << GRUB_DISK_SECTOR_BITS));
+					  + (grub_biosdisk_max_sectors (disk)
+					     << disk->log_sector_size));
       dap->length = sizeof (*dap);
       dap->reserved = 0;
       dap->blocks = size;
@@ -223,9 +254,6 @@ grub_biosdisk_rw (int cmd, grub_disk_t disk,
 	  if (cmd)
 	    return grub_error (GRUB_ERR_WRITE_ERROR, "can\'t write to cdrom");
 
-	  dap->blocks = ALIGN_UP (dap->blocks, 4) >> 2;
-	  dap->block >>= 2;
-
 	  for (i = 0; i < GRUB_BIOSDISK_CDROM_RETRY_COUNT; i++)
             if (! grub_biosdisk_rw_int13_extensions (0x42, data->drive, dap))
 	      break;
@@ -238,7 +266,9 @@ grub_biosdisk_rw (int cmd, grub_disk_t disk,
 	  {
 	    /* Fall back to the CHS mode.  */
 	    data->flags &= ~GRUB_BIOSDISK_FLAG_LBA;
-	    disk->total_sectors = data->cylinders * data->heads * data->sectors;
+	    disk->total_sectors = ((data->cylinders * data->heads * data->sectors)
+				   << (disk->log_sector_size
+				       - GRUB_DISK_SECTOR_BITS));
 	    return grub_biosdisk_rw (cmd, disk, sector, size, segment);
 	  }
     }
@@ -281,19 +311,20 @@ grub_biosdisk_rw (int cmd, grub_disk_t disk,
 
 /* Return the number of sectors which can be read safely at a time.  */
 static grub_size_t
-get_safe_sectors (grub_disk_addr_t sector, grub_uint32_t sectors)
+get_safe_sectors (grub_disk_t disk, grub_disk_addr_t sector)
 {
+  struct grub_biosdisk_data *data = disk->data;
   grub_size_t size;
+  grub_size_t max = grub_biosdisk_max_sectors (disk);
   grub_uint32_t offset;
 
   /* OFFSET = SECTOR % SECTORS */
-  grub_divmod64 (sector, sectors, &offset);
+  grub_divmod64 (sector, data->sectors, &offset);
 
-  size = sectors - offset;
+  size = data->sectors - offset;
 
-  /* Limit the max to 0x7f because of Phoenix EDD.  */
-  if (size > 0x7f)
-    size = 0x7f;
+  if (size > max)
+    size = max;
 
   return size;
 }
@@ -302,22 +333,11 @@ static grub_err_t
 grub_biosdisk_read (grub_disk_t disk, grub_disk_addr_t sector,
 		    grub_size_t size, char *buf)
 {
-  struct grub_biosdisk_data *data = disk->data;
-
   while (size)
     {
       grub_size_t len;
-      grub_size_t cdoff = 0;
-
-      len = get_safe_sectors (sector, data->sectors);
-
-      if (data->flags & GRUB_BIOSDISK_FLAG_CDROM)
-	{
-	  cdoff = (sector & 3) << GRUB_DISK_SECTOR_BITS;
-	  len = ALIGN_UP (sector + len, 4) - (sector & ~3);
-	  sector &= ~3;
-	}
 
+      len = get_safe_sectors (disk, sector);
       if (len > size)
 	len = size;
 
@@ -325,9 +345,9 @@ grub_biosdisk_read (grub_disk_t disk, grub_disk_addr_t sector,
 			    GRUB_MEMORY_MACHINE_SCRATCH_SEG))
 	return grub_errno;
 
-      grub_memcpy (buf, (void *) (GRUB_MEMORY_MACHINE_SCRATCH_ADDR + cdoff),
-		   len << GRUB_DISK_SECTOR_BITS);
-      buf += len << GRUB_DISK_SECTOR_BITS;
+      grub_memcpy (buf, (void *) GRUB_MEMORY_MACHINE_SCRATCH_ADDR,
+		   len << disk->log_sector_size);
+      buf += len << disk->log_sector_size;
       sector += len;
       size -= len;
     }
@@ -348,18 +368,18 @@ grub_biosdisk_write (grub_disk_t disk, grub_disk_addr_t sector,
     {
       grub_size_t len;
 
-      len = get_safe_sectors (sector, data->sectors);
+      len = get_safe_sectors (disk, sector);
       if (len > size)
 	len = size;
 
       grub_memcpy ((void *) GRUB_MEMORY_MACHINE_SCRATCH_ADDR, buf,
-		   len << GRUB_DISK_SECTOR_BITS);
+		   len << disk->log_sector_size);
 
       if (grub_biosdisk_rw (GRUB_BIOSDISK_WRITE, disk, sector, len,
 			    GRUB_MEMORY_MACHINE_SCRATCH_SEG))
 	return grub_errno;
 
-      buf += len << GRUB_DISK_SECTOR_BITS;
+      buf += len << disk->log_sector_size;
       sector += len;
       size -= len;
     }
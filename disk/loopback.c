@@ -230,6 +230,7 @@ static struct grub_disk_dev grub_loopback_dev =
     .open = grub_loopback_open,
     .read = grub_loopback_read,
     .write = grub_loopback_write,
+    .passthrough = 1,
     .next = 0
   };
 
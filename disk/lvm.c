@@ -111,86 +111,138 @@ grub_lvm_close (grub_disk_t disk __attribute ((unused)))
   return;
 }
 
-static grub_err_t
-grub_lvm_read (grub_disk_t disk, grub_disk_addr_t sector,
-		grub_size_t size, char *buf)
+/* Return the segment of LV containing EXTENT, or NULL.  The segments are
+   sorted by start extent, see grub_lvm_sort_segments.  */
+static struct grub_lvm_segment *
+grub_lvm_find_segment (struct grub_lvm_lv *lv, grub_uint64_t extent)
 {
-  grub_err_t err = 0;
-  struct grub_lvm_lv *lv = disk->data;
-  struct grub_lvm_vg *vg = lv->vg;
-  struct grub_lvm_segment *seg = lv->segments;
-  struct grub_lvm_pv *pv;
-  grub_uint64_t offset;
-  grub_uint64_t extent;
-  unsigned int i;
-
-  extent = grub_divmod64 (sector, vg->extent_size, NULL);
+  unsigned int lo = 0, hi = lv->segment_count;
 
-  /* Find the right segment.  */
-  for (i = 0; i < lv->segment_count; i++)
+  while (lo < hi)
     {
-      if ((seg->start_extent <= extent)
-	  && ((seg->start_extent + seg->extent_count) > extent))
-	{
-	  break;
-	}
-
-      seg++;
+      unsigned int mid = lo + (hi - lo) / 2;
+      struct grub_lvm_segment *seg = &lv->segments[mid];
+
+      if (extent < seg->start_extent)
+	hi = mid;
+      else if (extent >= (grub_uint64_t) seg->start_extent + seg->extent_count)
+	lo = mid + 1;
+      else
+	return seg;
     }
 
+  return NULL;
+}
+
+/* Map SECTOR of LV to a physical volume and the sector on it.  Return the
+   number of sectors from SECTOR on which are contiguous on that volume,
+   or 0 if SECTOR isn't mapped.  */
+static grub_uint64_t
+grub_lvm_map (struct grub_lvm_lv *lv, grub_disk_addr_t sector,
+	      struct grub_lvm_pv **pv, grub_disk_addr_t *offset)
+{
+  struct grub_lvm_vg *vg = lv->vg;
+  struct grub_lvm_segment *seg;
+  struct grub_lvm_stripe *stripe;
+  grub_uint64_t seg_start, seg_sectors;
+
+  seg = grub_lvm_find_segment (lv, grub_divmod64 (sector, vg->extent_size,
+						  NULL));
+  if (! seg)
+    return 0;
+
+  seg_start = (grub_uint64_t) seg->start_extent * vg->extent_size;
+  seg_sectors = (grub_uint64_t) seg->extent_count * vg->extent_size;
+  stripe = seg->stripes;
+
   if (seg->stripe_count == 1)
     {
-      /* This segment is linear, so that's easy.  We just need to find
-	 out the offset in the physical volume and read SIZE bytes
-	 from that.  */
-      struct grub_lvm_stripe *stripe = seg->stripes;
-      grub_uint64_t seg_offset; /* Offset of the segment in PV device.  */
-
-      pv = stripe->pv;
-      seg_offset = ((grub_uint64_t) stripe->start
-		    * (grub_uint64_t) vg->extent_size) + pv->start;
-
-      offset = sector - ((grub_uint64_t) seg->start_extent
-			 * (grub_uint64_t) vg->extent_size) + seg_offset;
+      /* This segment is linear, so that's easy.  */
+      *pv = stripe->pv;
+      *offset = sector - seg_start + (grub_uint64_t) stripe->start
+	* vg->extent_size + stripe->pv->start;
+      return seg_start + seg_sectors - sector;
     }
   else
     {
       /* This is a striped segment. We have to find the right PV
 	 similar to RAID0. */
-      struct grub_lvm_stripe *stripe = seg->stripes;
-      grub_uint32_t a, b;
-      grub_uint64_t seg_offset; /* Offset of the segment in PV device.  */
-      unsigned int stripenr;
+      grub_uint64_t a, offs;
+      grub_uint32_t b, stripenr;
 
-      offset = sector - ((grub_uint64_t) seg->start_extent
-			 * (grub_uint64_t) vg->extent_size);
+      offs = sector - seg_start;
+      a = grub_divmod64 (offs, seg->stripe_size, &b);
+      a = grub_divmod64 (a, seg->stripe_count, &stripenr);
 
-      a = grub_divmod64 (offset, seg->stripe_size, NULL);
-      grub_divmod64 (a, seg->stripe_count, &stripenr);
+      stripe += stripenr;
+      *pv = stripe->pv;
+      *offset = a * seg->stripe_size + b + (grub_uint64_t) stripe->start
+	* vg->extent_size + stripe->pv->start;
 
-      a = grub_divmod64 (offset, seg->stripe_size * seg->stripe_count, NULL);
-      grub_divmod64 (offset, seg->stripe_size, &b);
-      offset = a * seg->stripe_size + b;
+      /* The rest of this stripe chunk.  */
+      return seg->stripe_size - b;
+    }
+}
 
-      stripe += stripenr;
-      pv = stripe->pv;
+static grub_err_t
+grub_lvm_read (grub_disk_t disk, grub_disk_addr_t sector,
+		grub_size_t size, char *buf)
+{
+  struct grub_lvm_lv *lv = disk->data;
+  struct grub_lvm_pv *run_pv = NULL;
+  grub_disk_addr_t run_offset = 0;
+  grub_size_t run_size = 0;
 
-      seg_offset = ((grub_uint64_t) stripe->start
-		    * (grub_uint64_t) vg->extent_size) + pv->start;
+  /* Read the request in maximal runs of sectors which are contiguous on
+     one physical volume, even across segment boundaries.  */
+  while (size || run_size)
+    {
+      struct grub_lvm_pv *pv = NULL;
+      grub_disk_addr_t offset = 0;
+      grub_uint64_t len = 0;
 
-      offset += seg_offset;
-    }
+      if (size)
+	{
+	  len = grub_lvm_map (lv, sector, &pv, &offset);
+	  if (! len)
+	    return grub_error (GRUB_ERR_OUT_OF_RANGE,
+			       "sector %llu of %s isn't mapped",
+			       (unsigned long long) sector, lv->name);
+	  if (len > size)
+	    len = size;
+
+	  if (run_size && pv == run_pv && offset == run_offset + run_size)
+	    {
+	      run_size += len;
+	      sector += len;
+	      size -= len;
+	      continue;
+	    }
+	}
 
-  /* Check whether we actually know the physical volume we want to
-     read from.  */
-  if (pv->disk)
-    err = grub_disk_read (pv->disk, offset, 0,
-			  size << GRUB_DISK_SECTOR_BITS, buf);
-  else
-    err = grub_error (GRUB_ERR_UNKNOWN_DEVICE,
-		      "physical volume %s not found", pv->name);
+      if (run_size)
+	{
+	  /* Check whether we actually know the physical volume we want to
+	     read from.  */
+	  if (! run_pv->disk)
+	    return grub_error (GRUB_ERR_UNKNOWN_DEVICE,
+			       "physical volume %s not found", run_pv->name);
+
+	  if (grub_disk_read (run_pv->disk, run_offset, 0,
+			      run_size << GRUB_DISK_SECTOR_BITS, buf))
+	    return grub_errno;
 
-  return err;
+	  buf += run_size << GRUB_DISK_SECTOR_BITS;
+	}
+
+      run_pv = pv;
+      run_offset = offset;
+      run_size = len;
+      sector += len;
+      size -= len;
+    }
+
+  return GRUB_ERR_NONE;
 }
 
 static grub_err_t
@@ -202,17 +254,37 @@ grub_lvm_write (grub_disk_t disk __attribute ((unused)),
   return GRUB_ERR_NOT_IMPLEMENTED_YET;
 }
 
+/* Sort the segments of LV by start extent, so that grub_lvm_find_segment
+   can bisect them.  They are normally listed in order already.  */
+static void
+grub_lvm_sort_segments (struct grub_lvm_lv *lv)
+{
+  unsigned int i, j;
+
+  for (i = 1; i < lv->segment_count; i++)
+    {
+      struct grub_lvm_segment seg = lv->segments[i];
+
+      for (j = i; j > 0 && lv->segments[j - 1].start_extent > seg.start_extent;
+	   j--)
+	lv->segments[j] = lv->segments[j - 1];
+      lv->segments[j] = seg;
+    }
+}
+
 static int
 grub_lvm_scan_device (const char *name)
 {
   grub_err_t err;
   grub_disk_t disk;
   grub_uint64_t da_offset, da_size, mda_offset, mda_size;
-  char buf[GRUB_LVM_LABEL_SIZE];
+  grub_uint64_t mdat_offset, mdat_size, mdat_first;
+  char buf[GRUB_LVM_LABEL_SIZE * GRUB_LVM_LABEL_SCAN_SECTORS];
+  char mdah_buf[GRUB_LVM_MDA_HEADER_SIZE];
   char vg_id[GRUB_LVM_ID_STRLEN+1];
   char pv_id[GRUB_LVM_ID_STRLEN+1];
   char *metadatabuf, *p, *q, *vgname;
-  struct grub_lvm_label_header *lh = (struct grub_lvm_label_header *) buf;
+  struct grub_lvm_label_header *lh = 0;
   struct grub_lvm_pv_header *pvh;
   struct grub_lvm_disk_locn *dlocn;
   struct grub_lvm_mda_header *mdah;
@@ -225,12 +297,18 @@ grub_lvm_scan_device (const char *name)
   if (!disk)
     return 0;
 
+  /* The label and the metadata area header are at the start of the
+     device.  */
+  grub_disk_prefetch_metadata (disk);
+
   /* Search for label. */
+  err = grub_disk_read (disk, 0, 0, sizeof (buf), buf);
+  if (err)
+    goto fail;
+
   for (i = 0; i < GRUB_LVM_LABEL_SCAN_SECTORS; i++)
     {
-      err = grub_disk_read (disk, i, 0, sizeof(buf), buf);
-      if (err)
-	goto fail;
+      lh = (struct grub_lvm_label_header *) (buf + i * GRUB_LVM_LABEL_SIZE);
 
       if ((! grub_strncmp ((char *)lh->id, GRUB_LVM_LABEL_ID,
 			   sizeof (lh->id)))
@@ -243,7 +321,8 @@ grub_lvm_scan_device (const char *name)
   if (i == GRUB_LVM_LABEL_SCAN_SECTORS)
     goto fail;
 
-  pvh = (struct grub_lvm_pv_header *) (buf + grub_le_to_cpu32(lh->offset_xl));
+  pvh = (struct grub_lvm_pv_header *) ((char *) lh
+				       + grub_le_to_cpu32(lh->offset_xl));
 
   for (i = 0, j = 0; i < GRUB_LVM_ID_LEN; i++)
     {
@@ -275,42 +354,57 @@ grub_lvm_scan_device (const char *name)
   /* It's possible to have multiple copies of metadata areas, we just use the
      first one.  */
 
-  /* Allocate buffer space for the circular worst-case scenario. */
-  metadatabuf = grub_malloc (2 * mda_size);
-  if (! metadatabuf)
-    goto fail;
-
-  err = grub_disk_read (disk, 0, mda_offset, mda_size, metadatabuf);
+  err = grub_disk_read (disk, 0, mda_offset, sizeof (mdah_buf), mdah_buf);
   if (err)
-    goto fail2;
+    goto fail;
 
-  mdah = (struct grub_lvm_mda_header *) metadatabuf;
+  mdah = (struct grub_lvm_mda_header *) mdah_buf;
   if ((grub_strncmp ((char *)mdah->magic, GRUB_LVM_FMTT_MAGIC,
 		     sizeof (mdah->magic)))
       || (grub_le_to_cpu32 (mdah->version) != GRUB_LVM_FMTT_VERSION))
     {
       grub_error (GRUB_ERR_NOT_IMPLEMENTED_YET,
 		  "unknown LVM metadata header");
-      goto fail2;
+      goto fail;
     }
 
+  /* Only read the current metadata, not the whole area.  */
   rlocn = mdah->raw_locns;
-  if (grub_le_to_cpu64 (rlocn->offset) + grub_le_to_cpu64 (rlocn->size) >
-      grub_le_to_cpu64 (mdah->size))
+  mdat_offset = grub_le_to_cpu64 (rlocn->offset);
+  mdat_size = grub_le_to_cpu64 (rlocn->size);
+  if (grub_le_to_cpu64 (mdah->size) > mda_size
+      || mdat_offset < GRUB_LVM_MDA_HEADER_SIZE
+      || mdat_offset >= grub_le_to_cpu64 (mdah->size)
+      || mdat_size > grub_le_to_cpu64 (mdah->size) - GRUB_LVM_MDA_HEADER_SIZE)
     {
-      /* Metadata is circular. Copy the wrap in place. */
-      grub_memcpy (metadatabuf + mda_size,
-                   metadatabuf + GRUB_LVM_MDA_HEADER_SIZE,
-                   grub_le_to_cpu64 (rlocn->offset) +
-                   grub_le_to_cpu64 (rlocn->size) -
-                   grub_le_to_cpu64 (mdah->size));
+      grub_error (GRUB_ERR_BAD_DEVICE, "invalid LVM metadata location");
+      goto fail;
     }
-  p = q = metadatabuf + grub_le_to_cpu64 (rlocn->offset);
 
-  while (*q != ' ' && q < metadatabuf + mda_size)
+  metadatabuf = grub_malloc (mdat_size + 1);
+  if (! metadatabuf)
+    goto fail;
+
+  mdat_first = mdat_size;
+  if (mdat_offset + mdat_size > grub_le_to_cpu64 (mdah->size))
+    /* Metadata is circular; the rest follows the header.  */
+    mdat_first = grub_le_to_cpu64 (mdah->size) - mdat_offset;
+
+  err = grub_disk_read (disk, 0, mda_offset + mdat_offset, mdat_first,
+			metadatabuf);
+  if (! err && mdat_first < mdat_size)
+    err = grub_disk_read (disk, 0, mda_offset + GRUB_LVM_MDA_HEADER_SIZE,
+			  mdat_size - mdat_first, metadatabuf + mdat_first);
+  if (err)
+    goto fail2;
+  metadatabuf[mdat_size] = '\0';
+
+  p = q = metadatabuf;
+
+  while (*q != ' ' && q < metadatabuf + mdat_size)
     q++;
 
-  if (q == metadatabuf + mda_size)
+  if (q == metadatabuf + mdat_size)
     goto fail2;
 
   vgname_len = q - p;
@@ -530,6 +624,8 @@ grub_lvm_scan_device (const char *name)
 		goto lvs_fail;
 	      p += 3;
 
+	      grub_lvm_sort_segments (lv);
+
 	      lv->number = lv_count++;
 	      lv->vg = vg;
 	      lv->next = vg->lvs;
@@ -591,6 +687,7 @@ static struct grub_disk_dev grub_lvm_dev =
     .close = grub_lvm_close,
     .read = grub_lvm_read,
     .write = grub_lvm_write,
+    .passthrough = 1,
 #ifdef GRUB_UTIL
     .memberlist = grub_lvm_memberlist,
 #endif
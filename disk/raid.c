@@ -188,6 +188,144 @@ grub_raid_block_xor (char *buf1, const char *buf2, int size)
     }
 }
 
+/* Store the XOR of the NSRCS buffers SRCS into BUF, making one pass over
+   memory instead of one per source.  BUF may be one of SRCS.  */
+void
+grub_raid_block_xor_multi (char *buf, const char **srcs, int nsrcs, int size)
+{
+  grub_size_t *p1;
+  const grub_size_t *p2[GRUB_RAID_MAX_DEVICES];
+  int i, j;
+
+  p1 = (grub_size_t *) buf;
+  for (j = 0; j < nsrcs; j++)
+    p2[j] = (const grub_size_t *) srcs[j];
+  size /= GRUB_CPU_SIZEOF_VOID_P;
+
+  for (i = 0; i < size; i++)
+    {
+      grub_size_t x = 0;
+
+      for (j = 0; j < nsrcs; j++)
+	x ^= p2[j][i];
+      p1[i] = x;
+    }
+}
+
+/* Read SIZE sectors at SECTOR from a RAID 0, 1 or near layout RAID 10
+   array whose members form groups of NEAR mirrors.  The chunks a group
+   holds for consecutive stripes are adjacent on its members, so one read
+   per group fetches all of them.  Return 0 on success, -1 on an error
+   which is left in grub_errno, or 1 if the caller should read chunk by
+   chunk instead, for example because a member has a bad sector.  */
+static int
+grub_raid_read_runs (struct grub_raid_array *array, grub_disk_addr_t sector,
+		     grub_size_t size, char *buf, unsigned int near)
+{
+  grub_uint32_t groups, g, rem;
+  grub_uint64_t first, last;
+  grub_disk_addr_t end = sector + size;
+  grub_size_t max_run;
+  char *scratch;
+
+  groups = array->total_devs / near;
+  first = grub_divmod64 (sector, array->chunk_size, 0);
+  last = grub_divmod64 (end - 1, array->chunk_size, 0);
+  grub_divmod64 (first, groups, &rem);
+
+  /* With a single group, as in RAID 1, the request is one run on each
+     member and is read straight into BUF.  */
+  if (groups == 1)
+    scratch = buf;
+  else
+    {
+      max_run = ((grub_divmod64 (last - first, groups, 0) + 1)
+		 * array->chunk_size);
+      scratch = grub_malloc (max_run << GRUB_DISK_SECTOR_BITS);
+      if (! scratch)
+	{
+	  grub_errno = GRUB_ERR_NONE;
+	  return 1;
+	}
+    }
+
+  for (g = 0; g < groups; g++)
+    {
+      grub_uint64_t c, cf, cl;
+      grub_disk_addr_t lo, hi, start, stop;
+      grub_err_t err = GRUB_ERR_READ_ERROR;
+      unsigned int i;
+
+      /* The first and last chunk of the request that live on group G.  */
+      cf = first + (g + groups - rem) % groups;
+      if (cf > last)
+	continue;
+      cl = cf + grub_divmod64 (last - cf, groups, 0) * groups;
+
+#define MEMBER_SECTOR(c, s) (grub_divmod64 ((c), groups, 0) * array->chunk_size \
+			     + (s) - (c) * array->chunk_size)
+      lo = cf * array->chunk_size;
+      start = MEMBER_SECTOR (cf, (sector > lo) ? sector : lo);
+      hi = (cl + 1) * array->chunk_size;
+      stop = MEMBER_SECTOR (cl, (end < hi) ? end : hi);
+
+      for (i = 0; i < near; i++)
+	{
+	  grub_disk_t member = array->device[g * near + i];
+
+	  if (! member)
+	    continue;
+
+	  if (grub_errno == GRUB_ERR_READ_ERROR)
+	    grub_errno = GRUB_ERR_NONE;
+
+	  err = grub_disk_read (member, start, 0,
+				(stop - start) << GRUB_DISK_SECTOR_BITS,
+				scratch);
+	  if (! err)
+	    break;
+	  if (err != GRUB_ERR_READ_ERROR)
+	    {
+	      if (scratch != buf)
+		grub_free (scratch);
+	      return -1;
+	    }
+	}
+
+      if (err)
+	{
+	  grub_errno = GRUB_ERR_NONE;
+	  if (scratch != buf)
+	    grub_free (scratch);
+	  return 1;
+	}
+
+      if (scratch == buf)
+	continue;
+
+      /* Scatter the chunks into their places in BUF.  */
+      for (c = cf; c <= cl; c += groups)
+	{
+	  lo = c * array->chunk_size;
+	  if (lo < sector)
+	    lo = sector;
+	  hi = (c + 1) * array->chunk_size;
+	  if (hi > end)
+	    hi = end;
+
+	  grub_memcpy (buf + ((lo - sector) << GRUB_DISK_SECTOR_BITS),
+		       scratch + ((MEMBER_SECTOR (c, lo) - start)
+				  << GRUB_DISK_SECTOR_BITS),
+		       (hi - lo) << GRUB_DISK_SECTOR_BITS);
+	}
+#undef MEMBER_SECTOR
+    }
+
+  if (scratch != buf)
+    grub_free (scratch);
+  return 0;
+}
+
 static grub_err_t
 grub_raid_read (grub_disk_t disk, grub_disk_addr_t sector,
 		grub_size_t size, char *buf)
@@ -226,6 +364,20 @@ grub_raid_read (grub_disk_t disk, grub_disk_addr_t sector,
             far_ofs *= array->chunk_size;
           }
 
+        /* Requests spanning several chunks are read one group of mirrors
+           at a time when each chunk has a single copy per member.  */
+        if (far == 1 && array->total_devs % near == 0
+            && size > array->chunk_size - b)
+          {
+            int ret;
+
+            ret = grub_raid_read_runs (array, sector, size, buf, near);
+            if (ret < 0)
+              return grub_errno;
+            if (ret == 0)
+              return GRUB_ERR_NONE;
+          }
+
         read_sector = grub_divmod64 (read_sector * near, array->total_devs,
                                      &disknr);
 
@@ -628,6 +780,11 @@ grub_raid_register (grub_raid_t raid)
       if (!disk)
         return 0;
 
+      /* The superblocks are near the start or the end of the device;
+	 read both regions at once for all the detectors.  */
+      if (disk->total_sectors != GRUB_ULONG_MAX)
+	grub_disk_prefetch_metadata (disk);
+
       if ((disk->total_sectors != GRUB_ULONG_MAX) &&
 	  (! grub_raid_list->detect (disk, &array)) &&
 	  (! insert_array (disk, &array, grub_raid_list->name)))
@@ -672,6 +829,7 @@ static struct grub_disk_dev grub_raid_dev =
     .close = grub_raid_close,
     .read = grub_raid_read,
     .write = grub_raid_write,
+    .passthrough = 1,
 #ifdef GRUB_UTIL
     .memberlist = grub_raid_memberlist,
 #endif
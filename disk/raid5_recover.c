@@ -28,35 +28,46 @@ static grub_err_t
 grub_raid5_recover (struct grub_raid_array *array, int disknr,
                     char *buf, grub_disk_addr_t sector, int size)
 {
-  char *buf2;
-  int i;
+  const char *srcs[GRUB_RAID_MAX_DEVICES];
+  char *scratch;
+  int i, n;
 
   size <<= GRUB_DISK_SECTOR_BITS;
-  buf2 = grub_malloc (size);
-  if (!buf2)
-    return grub_errno;
 
-  grub_memset (buf, 0, size);
+  /* Read the rest of the stripe into one buffer and XOR it in one go.  */
+  scratch = grub_malloc ((array->total_devs - 1) * size);
+  if (!scratch)
+    return grub_errno;
 
-  for (i = 0; i < (int) array->total_devs; i++)
+  for (i = 0, n = 0; i < (int) array->total_devs; i++)
     {
       grub_err_t err;
 
       if (i == disknr)
         continue;
 
-      err = grub_disk_read (array->device[i], sector, 0, size, buf2);
+      if (! array->device[i])
+        {
+          grub_free (scratch);
+          return grub_error (GRUB_ERR_READ_ERROR,
+                             "not enough disk to restore");
+        }
+
+      err = grub_disk_read (array->device[i], sector, 0, size,
+                            scratch + n * size);
 
       if (err)
         {
-          grub_free (buf2);
+          grub_free (scratch);
           return err;
         }
 
-      grub_raid_block_xor (buf, buf2, size);
+      srcs[n] = scratch + n * size;
+      n++;
     }
 
-  grub_free (buf2);
+  grub_raid_block_xor_multi (buf, srcs, n, size);
+  grub_free (scratch);
 
   return GRUB_ERR_NONE;
 }
@@ -87,22 +87,64 @@ grub_raid6_init_table (void)
       }
 }
 
+/* Compute the P and Q syndromes of the NDATA data blocks DATA into PBUF
+   and QBUF, treating missing (NULL) blocks as zero.  Q is evaluated with
+   Horner's rule, so the only multiplication needed is by the generator 2,
+   which can be done on a whole word of bytes at once.  */
+static void
+grub_raid6_syndrome (const char **data, int ndata, char *pbuf, char *qbuf,
+                     int size)
+{
+  const grub_size_t ones = ~(grub_size_t) 0 / 0xff;
+  grub_size_t *pp, *qp;
+  int i, j;
+
+  pp = (grub_size_t *) pbuf;
+  qp = (grub_size_t *) qbuf;
+  size /= GRUB_CPU_SIZEOF_VOID_P;
+
+  for (i = 0; i < size; i++)
+    {
+      grub_size_t p = 0, q = 0;
+
+      for (j = ndata - 1; j >= 0; j--)
+        {
+          grub_size_t hi = q & (ones * 0x80);
+
+          q = ((q << 1) & (ones * 0xfe)) ^ ((hi >> 7) * 0x1d);
+          if (data[j])
+            {
+              grub_size_t d = ((const grub_size_t *) data[j])[i];
+
+              p ^= d;
+              q ^= d;
+            }
+        }
+
+      pp[i] = p;
+      qp[i] = q;
+    }
+}
+
 static grub_err_t
 grub_raid6_recover (struct grub_raid_array *array, int disknr, int p,
                     char *buf, grub_disk_addr_t sector, int size)
 {
-  int i, q, pos;
+  int i, q, pos, ndata;
   int bad1 = -1, bad2 = -1;
-  char *pbuf = 0, *qbuf = 0;
+  const char *data[GRUB_RAID_MAX_DEVICES];
+  char *scratch, *pbuf, *qbuf;
 
   size <<= GRUB_DISK_SECTOR_BITS;
-  pbuf = grub_zalloc (size);
-  if (!pbuf)
-    goto quit;
+  ndata = array->total_devs - 2;
 
-  qbuf = grub_zalloc (size);
-  if (!qbuf)
-    goto quit;
+  /* One buffer for the surviving data blocks of the stripe and the
+     partial syndromes.  */
+  scratch = grub_malloc ((ndata + 2) * size);
+  if (!scratch)
+    return grub_errno;
+  pbuf = scratch + ndata * size;
+  qbuf = pbuf + size;
 
   q = p + 1;
   if (q == (int) array->total_devs)
@@ -112,19 +154,17 @@ grub_raid6_recover (struct grub_raid_array *array, int disknr, int p,
   if (pos == (int) array->total_devs)
     pos = 0;
 
-  for (i = 0; i < (int) array->total_devs - 2; i++)
+  for (i = 0; i < ndata; i++)
     {
+      data[i] = 0;
       if (pos == disknr)
         bad1 = i;
       else
         {
           if ((array->device[pos]) &&
-              (! grub_disk_read (array->device[pos], sector, 0, size, buf)))
-            {
-              grub_raid_block_xor (pbuf, buf, size);
-              grub_raid_block_mul (raid6_table2[i][i], buf, size);
-              grub_raid_block_xor (qbuf, buf, size);
-            }
+              (! grub_disk_read (array->device[pos], sector, 0, size,
+                                 scratch + i * size)))
+            data[i] = scratch + i * size;
           else
             {
               /* Too many bad devices */
@@ -151,7 +191,8 @@ grub_raid6_recover (struct grub_raid_array *array, int disknr, int p,
       if ((array->device[p]) &&
           (! grub_disk_read (array->device[p], sector, 0, size, buf)))
         {
-          grub_raid_block_xor (buf, pbuf, size);
+          data[bad1] = buf;
+          grub_raid_block_xor_multi (buf, data, ndata, size);
           goto quit;
         }
 
@@ -165,6 +206,7 @@ grub_raid6_recover (struct grub_raid_array *array, int disknr, int p,
       if (grub_disk_read (array->device[q], sector, 0, size, buf))
         goto quit;
 
+      grub_raid6_syndrome (data, ndata, pbuf, qbuf, size);
       grub_raid_block_xor (buf, qbuf, size);
       grub_raid_block_mul (raid6_table2[255 - bad1][255 - bad1], buf,
                            size);
@@ -180,6 +222,8 @@ grub_raid6_recover (struct grub_raid_array *array, int disknr, int p,
           goto quit;
         }
 
+      grub_raid6_syndrome (data, ndata, pbuf, qbuf, size);
+
       if (grub_disk_read (array->device[p], sector, 0, size, buf))
         goto quit;
 
@@ -201,8 +245,7 @@ grub_raid6_recover (struct grub_raid_array *array, int disknr, int p,
     }
 
 quit:
-  grub_free (pbuf);
-  grub_free (qbuf);
+  grub_free (scratch);
 
   return grub_errno;
 }
@@ -27,6 +27,9 @@
 #include <grub/scsicmd.h>
 
 
+/* The maximum amount of bytes read by a single command.  */
+#define GRUB_SCSI_MAX_TRANSFER	(240 * GRUB_DISK_SECTOR_SIZE)
+
 static grub_scsi_dev_t grub_scsi_dev_list;
 
 void
@@ -76,6 +79,32 @@ grub_scsi_inquiry (grub_scsi_t scsi)
   return GRUB_ERR_NONE;
 }
 
+/* Read the 64 bit capacity and block size of SCSI.  */
+static grub_err_t
+grub_scsi_read_capacity16 (grub_scsi_t scsi)
+{
+  struct grub_scsi_read_capacity16 rc;
+  struct grub_scsi_read_capacity16_data rcd;
+  grub_err_t err;
+
+  rc.opcode = grub_scsi_cmd_service_action_in;
+  rc.service_action = GRUB_SCSI_SAI_READ_CAPACITY16;
+  rc.lba = 0;
+  rc.alloc_length = grub_cpu_to_be32 (sizeof (rcd));
+  rc.reserved = 0;
+  rc.control = 0;
+
+  err = scsi->dev->read (scsi, sizeof (rc), (char *) &rc,
+			 sizeof (rcd), (char *) &rcd);
+  if (err)
+    return err;
+
+  scsi->size = grub_be_to_cpu64 (rcd.size) + 1;
+  scsi->blocksize = grub_be_to_cpu32 (rcd.blocksize);
+
+  return GRUB_ERR_NONE;
+}
+
 /* Read the capacity and block size of SCSI.  */
 static grub_err_t
 grub_scsi_read_capacity (grub_scsi_t scsi)
@@ -93,9 +122,15 @@ grub_scsi_read_capacity (grub_scsi_t scsi)
   if (err)
     return err;
 
-  scsi->size = grub_be_to_cpu32 (rcd.size);
+  /* READ CAPACITY returns the address of the last block.  */
+  scsi->size = (grub_uint64_t) grub_be_to_cpu32 (rcd.size) + 1;
   scsi->blocksize = grub_be_to_cpu32 (rcd.blocksize);
 
+  /* Devices too large for 32 bit block addresses need READ CAPACITY
+     (16).  */
+  if (rcd.size == 0xffffffff)
+    return grub_scsi_read_capacity16 (scsi);
+
   return GRUB_ERR_NONE;
 }
 
@@ -142,6 +177,27 @@ grub_scsi_read12 (grub_disk_t disk, grub_disk_addr_t sector,
   return scsi->dev->read (scsi, sizeof (rd), (char *) &rd, size * scsi->blocksize, buf);
 }
 
+/* Send a SCSI request for DISK: read SIZE sectors starting with
+   sector SECTOR to BUF.  */
+static grub_err_t
+grub_scsi_read16 (grub_disk_t disk, grub_disk_addr_t sector,
+		  grub_size_t size, char *buf)
+{
+  grub_scsi_t scsi;
+  struct grub_scsi_read16 rd;
+
+  scsi = disk->data;
+
+  rd.opcode = grub_scsi_cmd_read16;
+  rd.flags = 0;
+  rd.lba = grub_cpu_to_be64 (sector);
+  rd.size = grub_cpu_to_be32 (size);
+  rd.reserved = 0;
+  rd.control = 0;
+
+  return scsi->dev->read (scsi, sizeof (rd), (char *) &rd, size * scsi->blocksize, buf);
+}
+
 #if 0
 /* Send a SCSI request for DISK: write the data stored in BUF to SIZE
    sectors starting with SECTOR.  */
@@ -300,10 +356,22 @@ grub_scsi_open (const char *name, grub_disk_t disk)
 	  return err;
 	}
 
-      /* SCSI blocks can be something else than 512, although GRUB
-	 wants 512 byte blocks.  */
+      /* SCSI blocks can be something else than 512.  The disk layer
+	 addresses the device in blocks of any power of two size it
+	 supports.  */
+      if ((scsi->blocksize & (scsi->blocksize - 1)) != 0
+	  || scsi->blocksize < GRUB_DISK_SECTOR_SIZE
+	  || scsi->blocksize > (1 << GRUB_DISK_MAX_LOG_SECTOR_SIZE))
+	{
+	  grub_free (scsi);
+	  return grub_error (GRUB_ERR_NOT_IMPLEMENTED_YET,
+			     "unsupported SCSI block size");
+	}
+      while ((1 << disk->log_sector_size) < scsi->blocksize)
+	disk->log_sector_size++;
+
       disk->total_sectors = ((scsi->size * scsi->blocksize)
-			     << GRUB_DISK_SECTOR_BITS);
+			     >> GRUB_DISK_SECTOR_BITS);
 
       grub_dprintf ("scsi", "capacity=%llu, blksize=%d\n",
 		    (unsigned long long) disk->total_sectors,
@@ -335,36 +403,33 @@ grub_scsi_read (grub_disk_t disk, grub_disk_addr_t sector,
 
   scsi = disk->data;
 
-  /* SCSI sectors are variable in size.  GRUB uses 512 byte
-     sectors.  */
-  if (scsi->blocksize != GRUB_DISK_SECTOR_SIZE)
+  /* Issue as few commands as possible, but keep each one within
+     GRUB_SCSI_MAX_TRANSFER bytes, which all mass storage devices
+     are expected to handle.  */
+  while (size)
     {
-      unsigned spb = scsi->blocksize >> GRUB_DISK_SECTOR_BITS;
-      if (! (spb != 0 && (scsi->blocksize & GRUB_DISK_SECTOR_SIZE) == 0))
-	return grub_error (GRUB_ERR_NOT_IMPLEMENTED_YET,
-			   "unsupported SCSI block size");
-
-      grub_uint32_t sector_mod = 0;
-      sector = grub_divmod64 (sector, spb, &sector_mod);
+      grub_size_t len = GRUB_SCSI_MAX_TRANSFER / scsi->blocksize;
+      grub_err_t err;
 
-      if (! (sector_mod == 0 && size % spb == 0))
-	return grub_error (GRUB_ERR_NOT_IMPLEMENTED_YET,
-			   "unaligned SCSI read not supported");
+      if (len > size)
+	len = size;
 
-      size /= spb;
-    }
+      /* Depending on the type, select a read function.  */
+      if (scsi->devtype == grub_scsi_devtype_cdrom)
+	err = grub_scsi_read12 (disk, sector, len, buf);
+      else if ((sector + len) >> 32)
+	err = grub_scsi_read16 (disk, sector, len, buf);
+      else
+	err = grub_scsi_read10 (disk, sector, len, buf);
 
-  /* Depending on the type, select a read function.  */
-  switch (scsi->devtype)
-    {
-    case grub_scsi_devtype_direct:
-      return grub_scsi_read10 (disk, sector, size, buf);
+      if (err)
+	return err;
 
-    case grub_scsi_devtype_cdrom:
-      return grub_scsi_read12 (disk, sector, size, buf);
+      sector += len;
+      size -= len;
+      buf += len * scsi->blocksize;
     }
 
-  /* XXX: Never reached.  */
   return GRUB_ERR_NONE;
 }
 
@@ -25,6 +25,7 @@
 #include <grub/misc.h>
 
 #define GRUB_USBMS_DIRECTION_BIT	7
+#define GRUB_USBMS_CSW_SIGNATURE	0x53425355
 
 /* The USB Mass Storage Command Block Wrapper.  */
 struct grub_usbms_cbw
@@ -59,6 +60,10 @@ struct grub_usbms_dev
   int in_maxsz;
   int out_maxsz;
 
+  /* Set once the device has failed a read with the status stage
+     pipelined, after which its stages are read one by one.  */
+  int no_pipelining;
+
   struct grub_usbms_dev *next;
 };
 typedef struct grub_usbms_dev *grub_usbms_dev_t;
@@ -255,7 +260,48 @@ grub_usbms_transfer (struct grub_scsi *scsi, grub_size_t cmdsize, char *cmd,
     }
 
   /* Read/write the data.  */
-  if (read_write == 0)
+  if (read_write == 0 && ! dev->no_pipelining)
+    {
+      struct grub_usb_bulk_segment segs[2] =
+	{
+	  { .size = size, .data = buf },
+	  { .size = sizeof (status), .data = (char *) &status }
+	};
+
+      /* Read the data and the status in a single transfer, which
+	 saves a round trip through the host controller per
+	 command.  */
+      grub_memset (&status, 0, sizeof (status));
+      if (size)
+	err = grub_usb_bulk_read_segments (dev->dev, dev->in->endp_addr & 15,
+					   2, segs);
+      else
+	err = grub_usb_bulk_read_segments (dev->dev, dev->in->endp_addr & 15,
+					   1, segs + 1);
+      grub_dprintf ("usb", "read+status: %d %d\n", err, GRUB_USB_ERR_STALL);
+      if (err)
+	{
+	  if (err == GRUB_USB_ERR_STALL)
+	    {
+	      grub_usb_clear_halt (dev->dev, dev->in->endp_addr);
+	      goto retry;
+	    }
+
+	  /* The host controller failed the transfer.  Reset the device
+	     and read its stages one by one from now on.  */
+	  grub_usbms_reset (dev->dev, dev->interface);
+	  grub_usb_clear_halt (dev->dev, dev->in->endp_addr);
+	  grub_usb_clear_halt (dev->dev, dev->out->endp_addr);
+	  dev->no_pipelining = 1;
+	  goto retry;
+	}
+
+      /* A short data stage ends the transfer before the status was
+	 received, read it on its own then.  */
+      if (status.signature == grub_cpu_to_le32 (GRUB_USBMS_CSW_SIGNATURE))
+	goto check_status;
+    }
+  else if (read_write == 0)
     {
       err = grub_usb_bulk_read (dev->dev, dev->in->endp_addr & 15, size, buf);
       grub_dprintf ("usb", "read: %d %d\n", err, GRUB_USB_ERR_STALL);
@@ -272,7 +318,7 @@ grub_usbms_transfer (struct grub_scsi *scsi, grub_size_t cmdsize, char *cmd,
     }
   else
     {
-      err = grub_usb_bulk_write (dev->dev, dev->in->endp_addr & 15, size, buf);
+      err = grub_usb_bulk_write (dev->dev, dev->out->endp_addr & 15, size, buf);
       grub_dprintf ("usb", "write: %d %d\n", err, GRUB_USB_ERR_STALL);
       if (err)
 	{
@@ -300,6 +346,7 @@ grub_usbms_transfer (struct grub_scsi *scsi, grub_size_t cmdsize, char *cmd,
 			 "can't read status from USB Mass Storage device");
     }
 
+ check_status:
   /* XXX: Magic and check this code.  */
   if (status.status == 2)
     {
@@ -43,9 +43,36 @@ struct char_index_entry
   grub_uint32_t offset;
 
   /* Glyph if loaded, or NULL otherwise.  */
-  struct grub_font_glyph *glyph;
+  struct glyph_node *node;
+};
+
+/* A glyph loaded from a font file.  Loaded glyphs are kept on a list in
+   order of use, and the least recently used ones are freed once they
+   take more than GLYPH_CACHE_MAX_BYTES.  */
+struct glyph_node
+{
+  struct glyph_node *prev;
+  struct glyph_node *next;
+  struct char_index_entry *entry;
+  grub_size_t size;
+
+  /* Must be last, as the glyph bitmap follows it.  */
+  struct grub_font_glyph glyph;
 };
 
+#define GLYPH_CACHE_MAX_BYTES (2 * 1024 * 1024)
+
+/* Number of most recently used glyphs which are never freed, so that
+   the glyphs a caller is holding stay valid.  */
+#define GLYPH_CACHE_MIN_GLYPHS 64
+
+/* The Basic Multilingual Plane index is a table of pages, each holding
+   the char_index position of 256 code points, or 0xffff if absent.
+   Pages without characters are not allocated.  */
+#define FONT_BMP_PAGE_BITS 8
+#define FONT_BMP_PAGE_SIZE (1 << FONT_BMP_PAGE_BITS)
+#define FONT_BMP_PAGES (0x10000 >> FONT_BMP_PAGE_BITS)
+
 #define FONT_WEIGHT_NORMAL 100
 #define FONT_WEIGHT_BOLD 200
 #define ASCII_BITMAP_SIZE 16
@@ -64,16 +91,28 @@ struct grub_font
   short leading;
   grub_uint32_t num_chars;
   struct char_index_entry *char_index;
-  grub_uint16_t *bmp_idx;
+  grub_uint16_t *bmp_idx[FONT_BMP_PAGES];
+
+  /* Contents of the DATA section if read into memory, or NULL.  */
+  grub_uint8_t *data;
+  grub_off_t data_start;
+  grub_size_t data_size;
 };
 
 /* Definition of font registry.  */
 struct grub_font_node *grub_font_list;
 
+/* Glyphs loaded from font files, most recently used first.  */
+static struct glyph_node *glyph_lru_head;
+static struct glyph_node *glyph_lru_tail;
+static grub_size_t glyph_lru_bytes;
+static unsigned int glyph_lru_count;
+
 static int register_font (grub_font_t font);
 static void font_init (grub_font_t font);
 static void free_font (grub_font_t font);
 static void remove_font (grub_font_t font);
+static void forget_rendered_glyph (struct grub_font_glyph *glyph);
 
 struct font_file_section
 {
@@ -216,7 +255,10 @@ font_init (grub_font_t font)
   font->descent = 0;
   font->num_chars = 0;
   font->char_index = 0;
-  font->bmp_idx = 0;
+  grub_memset (font->bmp_idx, 0, sizeof (font->bmp_idx));
+  font->data = 0;
+  font->data_start = 0;
+  font->data_size = 0;
 }
 
 /* Open the next section in the file.
@@ -276,6 +318,26 @@ open_section (grub_file_t file, struct font_file_section *section)
    entry in the font file.  */
 #define FONT_CHAR_INDEX_ENTRY_SIZE (4 + 1 + 4)
 
+/* Size of the glyph header in the DATA section: width, height, x offset,
+   y offset and device width, all 16-bit big-endian.  */
+#define FONT_GLYPH_HEADER_SIZE 10
+
+/* Fonts whose DATA section is at most this large have it read into memory
+   when loaded.  */
+#define FONT_DATA_MAX_BYTES (512 * 1024)
+
+static inline grub_uint16_t
+get_be16 (const grub_uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+
+static inline grub_uint32_t
+get_be32 (const grub_uint8_t *p)
+{
+  return ((grub_uint32_t) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
 /* Load the character index (CHIX) section contents from the font file.  This
    presumes that the position of FILE is positioned immediately after the
    section length for the CHIX section (i.e., at the start of the section
@@ -287,6 +349,8 @@ load_font_index (grub_file_t file, grub_uint32_t sect_length, struct
 {
   unsigned i;
   grub_uint32_t last_code;
+  grub_uint8_t *raw;
+  int ret = 1;
 
 #if FONT_DEBUG >= 2
   grub_printf("load_font_index(sect_length=%d)\n", sect_length);
@@ -310,30 +374,36 @@ load_font_index (grub_file_t file, grub_uint32_t sect_length, struct
                                   * sizeof (struct char_index_entry));
   if (! font->char_index)
     return 1;
-  font->bmp_idx = grub_malloc (0x10000 * sizeof (grub_uint16_t));
-  if (! font->bmp_idx)
-    {
-      grub_free (font->char_index);
-      return 1;
-    }
-  grub_memset (font->bmp_idx, 0xff, 0x10000 * sizeof (grub_uint16_t));
-
 
 #if FONT_DEBUG >= 2
   grub_printf("num_chars=%d)\n", font->num_chars);
 #endif
 
+  /* Read the whole index at once and parse it in place, rather than
+     reading each field of each entry from the file.  */
+  raw = grub_malloc (sect_length);
+  if (! raw)
+    return 1;
+  if (grub_file_read (file, raw, sect_length) != (grub_ssize_t) sect_length)
+    {
+      if (grub_errno == GRUB_ERR_NONE)
+        grub_error (GRUB_ERR_BAD_FONT,
+                    "font file format error: character index is truncated");
+      goto fail;
+    }
+
   last_code = 0;
 
-  /* Load the character index data from the file.  */
+  /* Load the character index data.  */
   for (i = 0; i < font->num_chars; i++)
     {
       struct char_index_entry *entry = &font->char_index[i];
+      const grub_uint8_t *p = raw + i * FONT_CHAR_INDEX_ENTRY_SIZE;
 
-      /* Read code point value; convert to native byte order.  */
-      if (grub_file_read (file, &entry->code, 4) != 4)
-        return 1;
-      entry->code = grub_be_to_cpu32 (entry->code);
+      /* Code point value, storage flags byte and glyph data offset.  */
+      entry->code = get_be32 (p);
+      entry->storage_flags = p[4];
+      entry->offset = get_be32 (p + 5);
 
       /* Verify that characters are in ascending order.  */
       if (i != 0 && entry->code <= last_code)
@@ -341,25 +411,29 @@ load_font_index (grub_file_t file, grub_uint32_t sect_length, struct
           grub_error (GRUB_ERR_BAD_FONT,
                       "font characters not in ascending order: %u <= %u",
                       entry->code, last_code);
-          return 1;
+          goto fail;
         }
 
       if (entry->code < 0x10000)
-	font->bmp_idx[entry->code] = i;
+	{
+	  grub_uint16_t **page;
+
+	  page = &font->bmp_idx[entry->code >> FONT_BMP_PAGE_BITS];
+	  if (! *page)
+	    {
+	      *page = grub_malloc (FONT_BMP_PAGE_SIZE * sizeof (grub_uint16_t));
+	      if (! *page)
+		goto fail;
+	      grub_memset (*page, 0xff,
+			   FONT_BMP_PAGE_SIZE * sizeof (grub_uint16_t));
+	    }
+	  (*page)[entry->code & (FONT_BMP_PAGE_SIZE - 1)] = i;
+	}
 
       last_code = entry->code;
 
-      /* Read storage flags byte.  */
-      if (grub_file_read (file, &entry->storage_flags, 1) != 1)
-        return 1;
-
-      /* Read glyph data offset; convert to native byte order.  */
-      if (grub_file_read (file, &entry->offset, 4) != 4)
-        return 1;
-      entry->offset = grub_be_to_cpu32 (entry->offset);
-
       /* No glyph loaded.  Will be loaded on demand and cached thereafter.  */
-      entry->glyph = 0;
+      entry->node = 0;
 
 #if FONT_DEBUG >= 5
       /* Print the 1st 10 characters.  */
@@ -368,7 +442,48 @@ load_font_index (grub_file_t file, grub_uint32_t sect_length, struct
 #endif
     }
 
-  return 0;
+  ret = 0;
+
+ fail:
+  grub_free (raw);
+  return ret;
+}
+
+/* Read the DATA section of FONT into memory if it is small enough, so that
+   glyphs are loaded without reading FILE.  This presumes that FILE is
+   positioned at the start of the section contents.  Failing to read it is
+   not an error; the glyphs are then read from the file on demand.  */
+static void
+load_font_data (grub_file_t file, grub_font_t font)
+{
+  grub_off_t start;
+  grub_off_t size;
+
+  start = grub_file_tell (file);
+  if (start >= grub_file_size (file))
+    return;
+
+  size = grub_file_size (file) - start;
+  if (size > FONT_DATA_MAX_BYTES)
+    return;
+
+  font->data = grub_malloc (size);
+  if (! font->data)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  if (grub_file_read (file, font->data, size) != (grub_ssize_t) size)
+    {
+      grub_free (font->data);
+      font->data = 0;
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  font->data_start = start;
+  font->data_size = size;
 }
 
 /* Read the contents of the specified section as a string, which is
@@ -584,6 +699,7 @@ grub_font_load (const char *filename)
       			    sizeof(FONT_FORMAT_SECTION_NAMES_DATA) - 1) == 0)
         {
           /* When the DATA section marker is reached, we stop reading.  */
+          load_font_data (file, font);
           break;
         }
       else
@@ -668,11 +784,14 @@ find_glyph (const grub_font_t font, grub_uint32_t code)
   table = font->char_index;
 
   /* Use BMP index if possible.  */
-  if (code < 0x10000 && font->bmp_idx)
+  if (code < 0x10000 && table)
     {
-      if (font->bmp_idx[code] == 0xffff)
+      grub_uint16_t *page;
+
+      page = font->bmp_idx[code >> FONT_BMP_PAGE_BITS];
+      if (! page || page[code & (FONT_BMP_PAGE_SIZE - 1)] == 0xffff)
 	return 0;
-      return &table[font->bmp_idx[code]];
+      return &table[page[code & (FONT_BMP_PAGE_SIZE - 1)]];
     }
 
   /* Do a binary search in `char_index', which is ordered by code point.  */
@@ -696,6 +815,110 @@ find_glyph (const grub_font_t font, grub_uint32_t code)
   return 0;
 }
 
+/* Remove NODE from the list of loaded glyphs.  */
+static void
+glyph_lru_unlink (struct glyph_node *node)
+{
+  if (node->prev)
+    node->prev->next = node->next;
+  else
+    glyph_lru_head = node->next;
+  if (node->next)
+    node->next->prev = node->prev;
+  else
+    glyph_lru_tail = node->prev;
+}
+
+/* Put NODE at the head of the list of loaded glyphs.  */
+static void
+glyph_lru_push (struct glyph_node *node)
+{
+  node->prev = 0;
+  node->next = glyph_lru_head;
+  if (glyph_lru_head)
+    glyph_lru_head->prev = node;
+  else
+    glyph_lru_tail = node;
+  glyph_lru_head = node;
+}
+
+/* Add the newly loaded NODE for ENTRY to the list of loaded glyphs, and
+   free the least recently used glyphs if they take too much memory.  */
+static void
+glyph_lru_add (struct char_index_entry *entry, struct glyph_node *node)
+{
+  node->entry = entry;
+  entry->node = node;
+  glyph_lru_push (node);
+  glyph_lru_bytes += node->size;
+  glyph_lru_count++;
+
+  while (glyph_lru_bytes > GLYPH_CACHE_MAX_BYTES
+         && glyph_lru_count > GLYPH_CACHE_MIN_GLYPHS)
+    {
+      struct glyph_node *victim = glyph_lru_tail;
+
+      glyph_lru_unlink (victim);
+      glyph_lru_bytes -= victim->size;
+      glyph_lru_count--;
+      victim->entry->node = 0;
+      forget_rendered_glyph (&victim->glyph);
+      grub_free (victim);
+    }
+}
+
+/* Allocate a glyph node for a glyph of the given dimensions, with room for
+   its bitmap.  Returns 0 if out of memory.  */
+static struct glyph_node *
+new_glyph_node (grub_font_t font, grub_uint16_t width, grub_uint16_t height,
+                grub_int16_t xoff, grub_int16_t yoff, grub_int16_t dwidth)
+{
+  struct glyph_node *node;
+  grub_size_t size;
+
+  size = sizeof (struct glyph_node) + (width * height + 7) / 8;
+  node = grub_malloc (size);
+  if (! node)
+    return 0;
+
+  node->size = size;
+  node->glyph.font = font;
+  node->glyph.width = width;
+  node->glyph.height = height;
+  node->glyph.offset_x = xoff;
+  node->glyph.offset_y = yoff;
+  node->glyph.device_width = dwidth;
+
+  return node;
+}
+
+/* Make a glyph node from the glyph stored at P in the DATA section, of
+   which AVAIL bytes are available.  Returns 0 if the glyph is truncated
+   or out of memory.  */
+static struct glyph_node *
+parse_glyph (grub_font_t font, const grub_uint8_t *p, grub_size_t avail)
+{
+  struct glyph_node *node;
+  grub_size_t len;
+
+  if (avail < FONT_GLYPH_HEADER_SIZE)
+    return 0;
+
+  len = (get_be16 (p) * get_be16 (p + 2) + 7) / 8;
+  if (avail - FONT_GLYPH_HEADER_SIZE < len)
+    return 0;
+
+  node = new_glyph_node (font, get_be16 (p), get_be16 (p + 2),
+                         (grub_int16_t) get_be16 (p + 4),
+                         (grub_int16_t) get_be16 (p + 6),
+                         (grub_int16_t) get_be16 (p + 8));
+  if (! node)
+    return 0;
+
+  grub_memcpy (node->glyph.bitmap, p + FONT_GLYPH_HEADER_SIZE, len);
+  return node;
+}
+
 /* Get a glyph for the Unicode character CODE in FONT.  The glyph is loaded
    from the font file if has not been loaded yet.
    Returns a pointer to the glyph if found, or 0 if it is not found.  */
@@ -707,7 +930,7 @@ grub_font_get_glyph_internal (grub_font_t font, grub_uint32_t code)
   index_entry = find_glyph (font, code);
   if (index_entry)
     {
-      struct grub_font_glyph *glyph = 0;
+      struct glyph_node *node;
       grub_uint16_t width;
       grub_uint16_t height;
       grub_int16_t xoff;
@@ -715,9 +938,32 @@ grub_font_get_glyph_internal (grub_font_t font, grub_uint32_t code)
       grub_int16_t dwidth;
       int len;
 
-      if (index_entry->glyph)
-        /* Return cached glyph.  */
-        return index_entry->glyph;
+      if (index_entry->node)
+        {
+          /* Return cached glyph.  */
+          node = index_entry->node;
+          if (node != glyph_lru_head)
+            {
+              glyph_lru_unlink (node);
+              glyph_lru_push (node);
+            }
+          return &node->glyph;
+        }
+
+      if (font->data && index_entry->offset >= font->data_start
+          && index_entry->offset - font->data_start < font->data_size)
+        {
+          grub_size_t pos = index_entry->offset - font->data_start;
+
+          /* The glyph is already in memory.  */
+          node = parse_glyph (font, font->data + pos, font->data_size - pos);
+          if (node)
+            {
+              glyph_lru_add (index_entry, node);
+              return &node->glyph;
+            }
+          grub_errno = GRUB_ERR_NONE;
+        }
 
       if (! font->file)
         /* No open file, can't load any glyphs.  */
@@ -741,25 +987,19 @@ grub_font_get_glyph_internal (grub_font_t font, grub_uint32_t code)
         }
 
       len = (width * height + 7) / 8;
-      glyph = grub_malloc (sizeof (struct grub_font_glyph) + len);
-      if (! glyph)
+      node = new_glyph_node (font, width, height, xoff, yoff, dwidth);
+      if (! node)
         {
           remove_font (font);
           return 0;
         }
 
-      glyph->font = font;
-      glyph->width = width;
-      glyph->height = height;
-      glyph->offset_x = xoff;
-      glyph->offset_y = yoff;
-      glyph->device_width = dwidth;
-
       /* Don't try to read empty bitmaps (e.g., space characters).  */
       if (len != 0)
         {
-          if (grub_file_read (font->file, glyph->bitmap, len) != len)
+          if (grub_file_read (font->file, node->glyph.bitmap, len) != len)
             {
+              grub_free (node);
               remove_font (font);
               return 0;
             }
@@ -769,14 +1009,107 @@ grub_font_get_glyph_internal (grub_font_t font, grub_uint32_t code)
       grub_error_pop ();
 
       /* Cache the glyph.  */
-      index_entry->glyph = glyph;
+      glyph_lru_add (index_entry, node);
 
-      return glyph;
+      return &node->glyph;
     }
 
   return 0;
 }
 
+/* Largest span of the DATA section read at once by grub_font_preload.  */
+#define FONT_PRELOAD_MAX_BYTES (GLYPH_CACHE_MAX_BYTES / 4)
+
+/* Load the glyphs of FONT for the code points FIRST to LAST with one read
+   of the DATA section, rather than a seek and several reads per glyph.
+   Glyphs which are already loaded are left alone.  Falls back to loading
+   the glyphs one by one if they are not stored in order.  */
+grub_err_t
+grub_font_preload (grub_font_t font, grub_uint32_t first, grub_uint32_t last)
+{
+  struct char_index_entry *table;
+  grub_uint32_t lo;
+  grub_uint32_t hi;
+  grub_uint32_t i;
+  grub_off_t start;
+  grub_off_t end;
+  grub_uint8_t *buf;
+
+  if (! font || ! font->file || ! font->char_index || first > last)
+    return GRUB_ERR_NONE;
+
+  table = font->char_index;
+
+  /* Find the entries for the range; the index is ordered by code point.  */
+  for (lo = 0; lo < font->num_chars && table[lo].code < first; lo++);
+  for (hi = lo; hi < font->num_chars && table[hi].code <= last; hi++);
+  if (lo == hi)
+    return GRUB_ERR_NONE;
+
+  /* Glyphs in memory already need no reading.  */
+  if (font->data)
+    goto one_by_one;
+
+  /* The glyphs must be stored in index order for one read to cover them.
+     Shrink the range until the span fits.  */
+  for (i = lo + 1; i <= hi && i < font->num_chars; i++)
+    if (table[i].offset <= table[i - 1].offset)
+      break;
+  if (i <= hi && i < font->num_chars)
+    goto one_by_one;
+
+  start = table[lo].offset;
+  while (1)
+    {
+      end = (hi < font->num_chars) ? table[hi].offset
+        : grub_file_size (font->file);
+      if (end - start <= FONT_PRELOAD_MAX_BYTES || hi == lo + 1)
+        break;
+      hi--;
+    }
+  if (end <= start || end - start > FONT_PRELOAD_MAX_BYTES)
+    goto one_by_one;
+
+  buf = grub_malloc (end - start);
+  if (! buf)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      goto one_by_one;
+    }
+
+  grub_file_seek (font->file, start);
+  if (grub_file_read (font->file, buf, end - start)
+      != (grub_ssize_t) (end - start))
+    {
+      grub_free (buf);
+      return grub_errno;
+    }
+
+  for (i = lo; i < hi; i++)
+    {
+      struct glyph_node *node;
+
+      if (table[i].node)
+        continue;
+
+      node = parse_glyph (font, buf + (table[i].offset - start),
+                          end - table[i].offset);
+      if (! node)
+        break;
+
+      glyph_lru_add (&table[i], node);
+    }
+
+  grub_free (buf);
+  grub_errno = GRUB_ERR_NONE;
+  return GRUB_ERR_NONE;
+
+ one_by_one:
+  for (i = lo; i < hi; i++)
+    grub_font_get_glyph_internal (font, table[i].code);
+  return GRUB_ERR_NONE;
+}
+
 /* Free the memory used by FONT.
    This should not be called if the font has been made available to
    users (once it is added to the global font list), since there would
@@ -784,6 +1117,8 @@ grub_font_get_glyph_internal (grub_font_t font, grub_uint32_t code)
 static void
 free_font (grub_font_t font)
 {
+  int i;
+
   if (font)
     {
       if (font->file)
@@ -791,6 +1126,9 @@ free_font (grub_font_t font)
       grub_free (font->name);
       grub_free (font->family);
       grub_free (font->char_index);
+      for (i = 0; i < FONT_BMP_PAGES; i++)
+	grub_free (font->bmp_idx[i]);
+      grub_free (font->data);
       grub_free (font);
     }
 }
@@ -1048,6 +1386,104 @@ grub_font_get_glyph_with_fallback (grub_font_t font, grub_uint32_t code)
 }
 
 
+/* Glyphs already expanded to RGBA8888 bitmaps in one color.  Drawing one
+   of these is a blend of whole runs of opaque and transparent pixels,
+   instead of testing every bit of the glyph for every pixel.  The cache
+   is direct-mapped on the glyph and color, and bounded in size.  */
+#define RENDERED_GLYPH_CACHE_SIZE 256
+#define RENDERED_GLYPH_CACHE_MAX_BYTES (1024 * 1024)
+
+struct rendered_glyph
+{
+  struct grub_font_glyph *glyph;
+  grub_uint32_t rgba;
+  struct grub_video_bitmap *bitmap;
+};
+
+static struct rendered_glyph rendered_glyphs[RENDERED_GLYPH_CACHE_SIZE];
+static grub_size_t rendered_glyphs_bytes;
+
+static inline struct rendered_glyph *
+rendered_glyph_slot (struct grub_font_glyph *glyph, grub_uint32_t rgba)
+{
+  grub_uint32_t hash;
+
+  hash = ((grub_addr_t) glyph >> 3) ^ ((rgba * 0x9e3779b1) >> 20);
+  return &rendered_glyphs[hash % RENDERED_GLYPH_CACHE_SIZE];
+}
+
+/* Release the cached rendering in ENTRY.  */
+static void
+drop_rendered_glyph (struct rendered_glyph *entry)
+{
+  if (! entry->bitmap)
+    return;
+
+  rendered_glyphs_bytes -= entry->bitmap->mode_info.pitch
+    * entry->bitmap->mode_info.height;
+  grub_video_bitmap_destroy (entry->bitmap);
+  entry->bitmap = 0;
+  entry->glyph = 0;
+}
+
+/* Release every cached rendering of GLYPH, which is about to be freed.  */
+static void
+forget_rendered_glyph (struct grub_font_glyph *glyph)
+{
+  unsigned int i;
+
+  for (i = 0; i < RENDERED_GLYPH_CACHE_SIZE; i++)
+    if (rendered_glyphs[i].glyph == glyph)
+      drop_rendered_glyph (&rendered_glyphs[i]);
+}
+
+/* Return GLYPH expanded to an RGBA8888 bitmap whose opaque pixels have
+   the color R, G, B, A, from the cache if possible.  Returns 0 if the
+   bitmap could not be made; the caller then draws the glyph from its
+   1-bit bitmap.  */
+static struct grub_video_bitmap *
+get_rendered_glyph (struct grub_font_glyph *glyph, grub_uint8_t r,
+		    grub_uint8_t g, grub_uint8_t b, grub_uint8_t a)
+{
+  struct rendered_glyph *entry;
+  struct grub_video_bitmap *bitmap;
+  grub_uint32_t rgba;
+  grub_uint32_t *data;
+  grub_size_t size;
+  unsigned int i;
+
+  rgba = r | (g << 8) | (b << 16) | ((grub_uint32_t) a << 24);
+  entry = rendered_glyph_slot (glyph, rgba);
+  if (entry->bitmap && entry->glyph == glyph && entry->rgba == rgba)
+    return entry->bitmap;
+
+  drop_rendered_glyph (entry);
+
+  size = (grub_size_t) glyph->width * glyph->height * 4;
+  if (rendered_glyphs_bytes + size > RENDERED_GLYPH_CACHE_MAX_BYTES)
+    return 0;
+
+  if (grub_video_bitmap_create (&bitmap, glyph->width, glyph->height,
+				GRUB_VIDEO_BLIT_FORMAT_RGBA_8888)
+      != GRUB_ERR_NONE)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return 0;
+    }
+
+  data = grub_video_bitmap_get_data (bitmap);
+  rgba = grub_cpu_to_le32 (rgba);
+  for (i = 0; i < (unsigned int) glyph->width * glyph->height; i++)
+    data[i] = (glyph->bitmap[i / 8] & (0x80 >> (i % 8))) ? rgba : 0;
+
+  entry->glyph = glyph;
+  entry->rgba = grub_le_to_cpu32 (rgba);
+  entry->bitmap = bitmap;
+  rendered_glyphs_bytes += size;
+
+  return bitmap;
+}
+
 /* Draw the specified glyph at (x, y).  The y coordinate designates the
    baseline of the character, while the x coordinate designates the left
    side location of the character.  */
@@ -1057,6 +1493,8 @@ grub_font_draw_glyph (struct grub_font_glyph *glyph,
                       int left_x, int baseline_y)
 {
   struct grub_video_bitmap glyph_bitmap;
+  struct grub_video_bitmap *rendered;
+  struct grub_video_mode_info mode_info;
 
   /* Don't try to draw empty glyphs (U+0020, etc.).  */
   if (glyph->width == 0 || glyph->height == 0)
@@ -1092,7 +1530,23 @@ grub_font_draw_glyph (struct grub_font_glyph *glyph,
   int bitmap_bottom = baseline_y - glyph->offset_y;
   int bitmap_top = bitmap_bottom - glyph->height;
 
-  return grub_video_blit_bitmap (&glyph_bitmap, GRUB_VIDEO_BLIT_BLEND,
+  /* Targets of 24 and 32 bits have blenders which copy and skip whole
+     runs of RGBA8888 pixels, so draw a cached rendering of the glyph
+     on those.  */
+  rendered = 0;
+  if (grub_video_get_info (&mode_info) != GRUB_ERR_NONE)
+    grub_errno = GRUB_ERR_NONE;
+  else if (mode_info.blit_format == GRUB_VIDEO_BLIT_FORMAT_RGBA_8888
+           || mode_info.blit_format == GRUB_VIDEO_BLIT_FORMAT_BGRA_8888
+           || mode_info.blit_format == GRUB_VIDEO_BLIT_FORMAT_RGB_888
+           || mode_info.blit_format == GRUB_VIDEO_BLIT_FORMAT_BGR_888)
+    rendered = get_rendered_glyph (glyph, glyph_bitmap.mode_info.fg_red,
+                                   glyph_bitmap.mode_info.fg_green,
+                                   glyph_bitmap.mode_info.fg_blue,
+                                   glyph_bitmap.mode_info.fg_alpha);
+
+  return grub_video_blit_bitmap (rendered ? rendered : &glyph_bitmap,
+                                 GRUB_VIDEO_BLIT_BLEND,
                                  bitmap_left, bitmap_top,
                                  0, 0,
                                  glyph->width, glyph->height);
@@ -233,6 +233,7 @@ grub_fshelp_read_file (grub_disk_t disk, grub_fshelp_node_t node,
 		       grub_off_t filesize, int log2blocksize)
 {
   grub_disk_addr_t i, blockcnt;
+  grub_disk_addr_t blknr, next = 0;
   int blocksize = 1 << (log2blocksize + GRUB_DISK_SECTOR_BITS);
 
   /* Adjust LEN so it we can't read past the end of the file.  */
@@ -241,35 +242,50 @@ grub_fshelp_read_file (grub_disk_t disk, grub_fshelp_node_t node,
 
   blockcnt = ((len + pos) + blocksize - 1) >> (log2blocksize + GRUB_DISK_SECTOR_BITS);
 
-  for (i = pos >> (log2blocksize + GRUB_DISK_SECTOR_BITS); i < blockcnt; i++)
+  i = pos >> (log2blocksize + GRUB_DISK_SECTOR_BITS);
+  if (i < blockcnt)
     {
-      grub_disk_addr_t blknr;
-      int blockoff = pos & (blocksize - 1);
-      int blockend = blocksize;
-
-      int skipfirst = 0;
-
       blknr = get_block (node, i);
       if (grub_errno)
 	return -1;
+    }
+
+  while (i < blockcnt)
+    {
+      grub_disk_addr_t count;
+      grub_size_t size;
+      int skipfirst = 0;
+
+      /* Read the following blocks with the same request as long as they
+	 are contiguous on disk.  */
+      for (count = 1; i + count < blockcnt; count++)
+	{
+	  next = get_block (node, i + count);
+	  if (grub_errno)
+	    return -1;
+
+	  if (! blknr || next != blknr + count)
+	    break;
+	}
 
-      blknr = blknr << log2blocksize;
+      size = (grub_size_t) count << (log2blocksize + GRUB_DISK_SECTOR_BITS);
 
       /* Last block.  */
-      if (i == blockcnt - 1)
+      if (i + count == blockcnt)
 	{
-	  blockend = (len + pos) & (blocksize - 1);
+	  int blockend = (len + pos) & (blocksize - 1);
 
-	  /* The last portion is exactly blocksize.  */
-	  if (! blockend)
-	    blockend = blocksize;
+	  /* The last portion is exactly blocksize unless BLOCKEND says
+	     otherwise.  */
+	  if (blockend)
+	    size -= blocksize - blockend;
 	}
 
       /* First block.  */
       if (i == (pos >> (log2blocksize + GRUB_DISK_SECTOR_BITS)))
 	{
-	  skipfirst = blockoff;
-	  blockend -= skipfirst;
+	  skipfirst = pos & (blocksize - 1);
+	  size -= skipfirst;
 	}
 
       /* If the block number is 0 this block is not stored on disk but
@@ -278,16 +294,18 @@ grub_fshelp_read_file (grub_disk_t disk, grub_fshelp_node_t node,
 	{
 	  disk->read_hook = read_hook;
 
-	  grub_disk_read (disk, blknr, skipfirst,
-			  blockend, buf);
+	  grub_disk_read (disk, blknr << log2blocksize, skipfirst,
+			  size, buf);
 	  disk->read_hook = 0;
 	  if (grub_errno)
 	    return -1;
 	}
       else
-	grub_memset (buf, 0, blockend);
+	grub_memset (buf, 0, size);
 
-      buf += blocksize - skipfirst;
+      buf += size;
+      i += count;
+      blknr = next;
     }
 
   return len;
@@ -60,6 +60,9 @@
 
 #define S_IFLNK 0xA000
 
+/* Number of internal tree nodes kept per mount.  */
+#define GRUB_REISERFS_NODE_CACHE_SIZE 16
+
 static grub_dl_t my_mod;
 
 #define assert(boolean) real_assert (boolean, __FILE__, __LINE__)
@@ -226,11 +229,27 @@ struct grub_fshelp_node
   struct grub_reiserfs_item_header header;
 };
 
+/* An internal tree node held in memory.  */
+struct grub_reiserfs_node_cache
+{
+  grub_uint32_t block_number;
+  unsigned int last_use;
+  struct grub_reiserfs_block_header *node; /* 0 if the slot is unused.  */
+};
+
 /* Returned when opening a file.  */
 struct grub_reiserfs_data
 {
   struct grub_reiserfs_superblock superblock;
   grub_disk_t disk;
+  /* Internal nodes walked through by grub_reiserfs_get_item.  */
+  struct grub_reiserfs_node_cache node_cache[GRUB_REISERFS_NODE_CACHE_SIZE];
+  unsigned int node_cache_clock;
+  /* Last indirect item used by grub_reiserfs_read.  A mount only ever
+     serves one open file, so this does not need to be keyed by object.  */
+  grub_uint32_t *indirect_blocks; /* 0 if nothing is cached.  */
+  grub_uint64_t indirect_offset; /* Key offset of the first byte.  */
+  unsigned int indirect_count;
 };
 
 /* Internal-only functions. Not to be used outside of this file.  */
@@ -460,6 +479,60 @@ grub_reiserfs_compare_keys (const struct grub_reiserfs_key *key1,
   return 0;
 }
 
+/* Return tree node BLOCK_NUMBER of mounted filesystem DATA.  Internal nodes
+   are served from the node cache when possible; everything else is read into
+   BUF.  Return 0 on error.  */
+static struct grub_reiserfs_block_header *
+grub_reiserfs_read_node (struct grub_reiserfs_data *data,
+                         grub_uint32_t block_number,
+                         struct grub_reiserfs_block_header *buf)
+{
+  grub_uint16_t block_size = grub_le_to_cpu16 (data->superblock.block_size);
+  struct grub_reiserfs_node_cache *slot = &(data->node_cache[0]);
+  unsigned int i;
+
+  for (i = 0; i < GRUB_REISERFS_NODE_CACHE_SIZE; i++)
+    {
+      struct grub_reiserfs_node_cache *entry = &(data->node_cache[i]);
+
+      if (entry->node && entry->block_number == block_number)
+        {
+          entry->last_use = ++data->node_cache_clock;
+          return entry->node;
+        }
+      /* Remember the least recently used slot, preferring empty ones.  */
+      if (slot->node && (! entry->node || entry->last_use < slot->last_use))
+        slot = entry;
+    }
+
+  grub_disk_read (data->disk,
+                  block_number * (block_size >> GRUB_DISK_SECTOR_BITS),
+                  (((grub_off_t) block_number * block_size)
+                   & (GRUB_DISK_SECTOR_SIZE - 1)),
+                  block_size, buf);
+  if (grub_errno)
+    return 0;
+
+  /* Leaves are left to the disk cache.  */
+  if (grub_le_to_cpu16 (buf->level) <= 1)
+    return buf;
+
+  if (! slot->node)
+    {
+      slot->node = grub_malloc (block_size);
+      if (! slot->node)
+        {
+          /* Not being able to cache is not an error.  */
+          grub_errno = GRUB_ERR_NONE;
+          return buf;
+        }
+    }
+  grub_memcpy (slot->node, buf, block_size);
+  slot->block_number = block_number;
+  slot->last_use = ++data->node_cache_clock;
+  return slot->node;
+}
+
 /* Find the item identified by KEY in mounted filesystem DATA, and fill ITEM
    accordingly to what was found.  */
 static grub_err_t
@@ -468,7 +541,7 @@ grub_reiserfs_get_item (struct grub_reiserfs_data *data,
                         struct grub_fshelp_node *item)
 {
   grub_uint32_t block_number;
-  struct grub_reiserfs_block_header *block_header = 0;
+  struct grub_reiserfs_block_header *block_header = 0, *node;
   struct grub_reiserfs_key *block_key = 0;
   grub_uint16_t block_size, item_count, current_level;
   grub_uint16_t i;
@@ -506,14 +579,10 @@ grub_reiserfs_get_item (struct grub_reiserfs_data *data,
   item->next_offset = 0;
   do
     {
-      grub_disk_read (data->disk,
-                      block_number * (block_size >> GRUB_DISK_SECTOR_BITS),
-                      (((grub_off_t) block_number * block_size)
-                       & (GRUB_DISK_SECTOR_SIZE - 1)),
-                      block_size, block_header);
-      if (grub_errno)
+      node = grub_reiserfs_read_node (data, block_number, block_header);
+      if (! node)
         goto fail;
-      current_level = grub_le_to_cpu16 (block_header->level);
+      current_level = grub_le_to_cpu16 (node->level);
       grub_dprintf ("reiserfs_tree", " at level %d\n", current_level);
       if (current_level >= previous_level)
         {
@@ -522,7 +591,7 @@ grub_reiserfs_get_item (struct grub_reiserfs_data *data,
           goto fail;
         }
       previous_level = current_level;
-      item_count = grub_le_to_cpu16 (block_header->item_count);
+      item_count = grub_le_to_cpu16 (node->item_count);
       grub_dprintf ("reiserfs_tree", " number of contained items : %d\n",
                     item_count);
       if (current_level > 1)
@@ -530,7 +599,7 @@ grub_reiserfs_get_item (struct grub_reiserfs_data *data,
           /* Internal node. Navigate to the child that should contain
              the searched key.  */
           struct grub_reiserfs_key *keys
-            = (struct grub_reiserfs_key *) (block_header + 1);
+            = (struct grub_reiserfs_key *) (node + 1);
           struct grub_reiserfs_disk_child *children
             = ((struct grub_reiserfs_disk_child *)
                (keys + item_count));
@@ -574,7 +643,7 @@ grub_reiserfs_get_item (struct grub_reiserfs_data *data,
         {
           /* Leaf node.  Check that the key is actually present.  */
           item_headers
-            = (struct grub_reiserfs_item_header *) (block_header + 1);
+            = (struct grub_reiserfs_item_header *) (node + 1);
           for (i = 0;
                i < item_count
                  && (grub_reiserfs_compare_keys (key, &(item_headers[i].key))
@@ -681,7 +750,7 @@ static struct grub_reiserfs_data *
 grub_reiserfs_mount (grub_disk_t disk)
 {
   struct grub_reiserfs_data *data = 0;
-  data = grub_malloc (sizeof (*data));
+  data = grub_zalloc (sizeof (*data));
   if (! data)
     goto fail;
   grub_disk_read (disk, REISERFS_SUPER_BLOCK_OFFSET / GRUB_DISK_SECTOR_SIZE,
@@ -706,6 +775,20 @@ grub_reiserfs_mount (grub_disk_t disk)
   return 0;
 }
 
+/* Free the mounted filesystem structure DATA and everything cached in it.  */
+static void
+grub_reiserfs_unmount (struct grub_reiserfs_data *data)
+{
+  unsigned int i;
+
+  if (! data)
+    return;
+  for (i = 0; i < GRUB_REISERFS_NODE_CACHE_SIZE; i++)
+    grub_free (data->node_cache[i].node);
+  grub_free (data->indirect_blocks);
+  grub_free (data);
+}
+
 /* Call HOOK for each file in directory ITEM.  */
 static int
 grub_reiserfs_iterate_dir (grub_fshelp_node_t item,
@@ -1056,11 +1139,42 @@ grub_reiserfs_open (struct grub_file *file, const char *name)
  fail:
   assert (grub_errno != GRUB_ERR_NONE);
   grub_free (found);
-  grub_free (data);
+  grub_reiserfs_unmount (data);
   grub_dl_unref (my_mod);
   return grub_errno;
 }
 
+/* Read the block pointers of indirect item ITEM, whose key offset is OFFSET,
+   into the indirect item cache of DATA.  */
+static grub_err_t
+grub_reiserfs_load_indirect (struct grub_reiserfs_data *data,
+                             const struct grub_fshelp_node *item,
+                             grub_uint64_t offset)
+{
+  grub_uint16_t block_size = grub_le_to_cpu16 (data->superblock.block_size);
+  grub_uint16_t item_size = grub_le_to_cpu16 (item->header.item_size);
+  grub_uint32_t *blocks;
+
+  blocks = grub_malloc (item_size);
+  if (! blocks)
+    return grub_errno;
+  grub_disk_read (data->disk,
+                  item->block_number * (block_size >> GRUB_DISK_SECTOR_BITS),
+                  grub_le_to_cpu16 (item->header.item_location),
+                  item_size, blocks);
+  if (grub_errno)
+    {
+      grub_free (blocks);
+      return grub_errno;
+    }
+
+  grub_free (data->indirect_blocks);
+  data->indirect_blocks = blocks;
+  data->indirect_offset = offset;
+  data->indirect_count = item_size / sizeof (*blocks);
+  return GRUB_ERR_NONE;
+}
+
 static grub_ssize_t
 grub_reiserfs_read (grub_file_t file, char *buf, grub_size_t len)
 {
@@ -1071,7 +1185,7 @@ grub_reiserfs_read (grub_file_t file, char *buf, grub_size_t len)
   struct grub_fshelp_node found;
   grub_uint16_t block_size = grub_le_to_cpu16 (data->superblock.block_size);
   grub_uint16_t item_size;
-  grub_uint32_t *indirect_block_ptr = 0;
+  grub_uint32_t *indirect_block_ptr;
   grub_uint64_t current_key_offset = 1;
   grub_off_t initial_position, current_position, final_position, length;
   grub_disk_addr_t block;
@@ -1083,6 +1197,14 @@ grub_reiserfs_read (grub_file_t file, char *buf, grub_size_t len)
   grub_reiserfs_set_key_type (&key, GRUB_REISERFS_ANY, 2);
   initial_position = file->offset;
   current_position = 0;
+  /* Items are found by their exact starting offset, so they have to be
+     walked in order.  Resume at the last indirect item instead of the
+     beginning of the file when it does not start after the read.  */
+  if (data->indirect_blocks && data->indirect_offset - 1 <= initial_position)
+    {
+      current_key_offset = data->indirect_offset;
+      current_position = current_key_offset - 1;
+    }
   final_position = MIN (len + initial_position, file->size);
   grub_dprintf ("reiserfs",
 		"Reading from %lld to %lld (%lld instead of requested %ld)\n",
@@ -1094,14 +1216,25 @@ grub_reiserfs_read (grub_file_t file, char *buf, grub_size_t len)
     {
       grub_reiserfs_set_key_offset (&key, current_key_offset);
 
-      if (grub_reiserfs_get_item (data, &key, &found) != GRUB_ERR_NONE)
-        goto fail;
-      if (found.block_number == 0)
-        goto fail;
-      item_size = grub_le_to_cpu16 (found.header.item_size);
+      if (data->indirect_blocks
+          && data->indirect_offset == current_key_offset)
+        /* Already resolved, no need to walk the tree again.  */
+        found.type = GRUB_REISERFS_INDIRECT;
+      else
+        {
+          if (grub_reiserfs_get_item (data, &key, &found) != GRUB_ERR_NONE)
+            goto fail;
+          if (found.block_number == 0)
+            goto fail;
+          if (found.type == GRUB_REISERFS_INDIRECT
+              && grub_reiserfs_load_indirect (data, &found,
+                                              current_key_offset))
+            goto fail;
+        }
       switch (found.type)
         {
         case GRUB_REISERFS_DIRECT:
+          item_size = grub_le_to_cpu16 (found.header.item_size);
           block = found.block_number * (block_size  >> GRUB_DISK_SECTOR_BITS);
           grub_dprintf ("reiserfs_blocktype", "D: %u\n", (unsigned) block);
           if (initial_position < current_position + item_size)
@@ -1129,17 +1262,9 @@ grub_reiserfs_read (grub_file_t file, char *buf, grub_size_t len)
             current_position += item_size;
           break;
         case GRUB_REISERFS_INDIRECT:
-          indirect_block_count = item_size / sizeof (*indirect_block_ptr);
-          indirect_block_ptr = grub_malloc (item_size);
-          if (! indirect_block_ptr)
-            goto fail;
-          grub_disk_read (found.data->disk,
-                          found.block_number * (block_size >> GRUB_DISK_SECTOR_BITS),
-                          grub_le_to_cpu16 (found.header.item_location),
-                          item_size, indirect_block_ptr);
-          if (grub_errno)
-            goto fail;
-          found.data->disk->read_hook = file->read_hook;
+          indirect_block_count = data->indirect_count;
+          indirect_block_ptr = data->indirect_blocks;
+          data->disk->read_hook = file->read_hook;
           for (indirect_block = 0;
                indirect_block < indirect_block_count
                  && current_position < final_position;
@@ -1165,18 +1290,19 @@ grub_reiserfs_read (grub_file_t file, char *buf, grub_size_t len)
                                 initial_position, current_position,
                                 final_position, offset, length, len);
 #endif
-                  grub_disk_read (found.data->disk, block, offset, length, buf);
+                  grub_disk_read (data->disk, block, offset, length, buf);
                   if (grub_errno)
-                    goto fail;
+                    {
+                      data->disk->read_hook = 0;
+                      goto fail;
+                    }
                   buf += length;
                   current_position += offset + length;
                 }
               else
                 current_position += block_size;
             }
-          found.data->disk->read_hook = 0;
-          grub_free (indirect_block_ptr);
-          indirect_block_ptr = 0;
+          data->disk->read_hook = 0;
           break;
         default:
           goto fail;
@@ -1237,7 +1363,6 @@ grub_reiserfs_read (grub_file_t file, char *buf, grub_size_t len)
 #endif
 
  fail:
-  grub_free (indirect_block_ptr);
   return 0;
 }
 
@@ -1248,7 +1373,7 @@ grub_reiserfs_close (grub_file_t file)
   struct grub_fshelp_node *node = file->data;
   struct grub_reiserfs_data *data = node->data;
 
-  grub_free (data);
+  grub_reiserfs_unmount (data);
   grub_free (node);
   grub_dl_unref (my_mod);
   return GRUB_ERR_NONE;
@@ -1299,12 +1424,12 @@ grub_reiserfs_dir (grub_device_t device, const char *path,
   if (grub_errno)
     goto fail;
   grub_reiserfs_iterate_dir (found, iterate);
-  grub_free (data);
+  grub_reiserfs_unmount (data);
   grub_dl_unref (my_mod);
   return GRUB_ERR_NONE;
 
  fail:
-  grub_free (data);
+  grub_reiserfs_unmount (data);
   grub_dl_unref (my_mod);
   return grub_errno;
 }
@@ -1352,7 +1477,7 @@ grub_reiserfs_uuid (grub_device_t device, char **uuid)
 
   grub_dl_unref (my_mod);
 
-  grub_free (data);
+  grub_reiserfs_unmount (data);
 
   return grub_errno;
 }
@@ -23,6 +23,7 @@
 #include <grub/gui_string_util.h>
 #include <grub/bitmap.h>
 #include <grub/bitmap_scale.h>
+#include <grub/bitmap_cache.h>
 
 struct grub_gui_image
 {
@@ -142,12 +143,12 @@ rescale_image (grub_gui_image_t self)
   if (width == 0 || height == 0)
     return grub_errno;
 
-  /* Create the scaled bitmap.  */
-  grub_video_bitmap_create_scaled (&self->bitmap,
-                                   width,
-                                   height,
-                                   self->raw_bitmap,
-                                   GRUB_VIDEO_BITMAP_SCALE_METHOD_BEST);
+  /* Create the scaled bitmap, or share one made before.  */
+  grub_video_bitmap_scale_cached (&self->bitmap,
+                                  width,
+                                  height,
+                                  self->raw_bitmap,
+                                  GRUB_VIDEO_BITMAP_SCALE_METHOD_BEST);
   if (grub_errno != GRUB_ERR_NONE)
     {
       grub_error_push ();
@@ -193,7 +194,7 @@ static grub_err_t
 load_image (grub_gui_image_t self, const char *path)
 {
   struct grub_video_bitmap *bitmap;
-  if (grub_video_bitmap_load (&bitmap, path) != GRUB_ERR_NONE)
+  if (grub_video_bitmap_load_cached (&bitmap, path) != GRUB_ERR_NONE)
     return grub_errno;
 
   if (self->bitmap && (self->bitmap != self->raw_bitmap))
@@ -201,6 +202,8 @@ load_image (grub_gui_image_t self, const char *path)
   if (self->raw_bitmap)
     grub_video_bitmap_destroy (self->raw_bitmap);
 
+  /* Drop the old scaled bitmap before rescale_image looks at it.  */
+  self->bitmap = 0;
   self->raw_bitmap = bitmap;
   return rescale_image (self);
 }
@@ -24,6 +24,7 @@
 #include <grub/gui_string_util.h>
 #include <grub/bitmap.h>
 #include <grub/bitmap_scale.h>
+#include <grub/bitmap_cache.h>
 #include <grub/menu.h>
 #include <grub/icon_manager.h>
 #include <grub/env.h>
@@ -155,25 +156,13 @@ try_loading_icon (grub_gfxmenu_icon_manager_t mgr,
   grub_strcat (path, class_name);
   grub_strcat (path, icon_extension);
 
-  struct grub_video_bitmap *raw_bitmap;
-  grub_video_bitmap_load (&raw_bitmap, path);
+  /* Missing icons are not an error.  */
+  struct grub_video_bitmap *scaled_bitmap;
+  grub_video_bitmap_load_scaled (&scaled_bitmap, path,
+                                 mgr->icon_width, mgr->icon_height,
+                                 GRUB_VIDEO_BITMAP_SCALE_METHOD_BEST);
   grub_free (path);
   grub_errno = GRUB_ERR_NONE;  /* Critical to clear the error!!  */
-  if (! raw_bitmap)
-    return 0;
-
-  struct grub_video_bitmap *scaled_bitmap;
-  grub_video_bitmap_create_scaled (&scaled_bitmap,
-                                   mgr->icon_width, mgr->icon_height,
-                                   raw_bitmap,
-                                   GRUB_VIDEO_BITMAP_SCALE_METHOD_BEST);
-  grub_video_bitmap_destroy (raw_bitmap);
-  if (! scaled_bitmap)
-    {
-      grub_error_push ();
-      grub_error (grub_errno, "failed to scale icon");
-      return 0;
-    }
 
   return scaled_bitmap;
 }
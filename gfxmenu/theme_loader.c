@@ -27,6 +27,7 @@
 #include <grub/gui_string_util.h>
 #include <grub/bitmap.h>
 #include <grub/bitmap_scale.h>
+#include <grub/bitmap_cache.h>
 #include <grub/gfxwidgets.h>
 #include <grub/gfxmenu_view.h>
 #include <grub/gui.h>
@@ -142,28 +143,20 @@ theme_set_string (grub_gfxmenu_view_t view,
     grub_gui_parse_color (value, &view->message_bg_color);
   else if (! grub_strcmp ("desktop-image", name))
     {
-      struct grub_video_bitmap *raw_bitmap;
       struct grub_video_bitmap *scaled_bitmap;
       char *path;
       path = grub_resolve_relative_path (theme_dir, value);
       if (! path)
         return grub_errno;
-      if (grub_video_bitmap_load (&raw_bitmap, path) != GRUB_ERR_NONE)
-        {
-          grub_free (path);
-          return grub_errno;
-        }
+      grub_video_bitmap_load_scaled (&scaled_bitmap, path,
+                                     view->screen.width,
+                                     view->screen.height,
+                                     GRUB_VIDEO_BITMAP_SCALE_METHOD_BEST);
       grub_free(path);
-      grub_video_bitmap_create_scaled (&scaled_bitmap,
-                                       view->screen.width,
-                                       view->screen.height,
-                                       raw_bitmap,
-                                       GRUB_VIDEO_BITMAP_SCALE_METHOD_BEST);
-      grub_video_bitmap_destroy (raw_bitmap);
       if (! scaled_bitmap)
         {
           grub_error_push ();
-          return grub_error (grub_errno, "error scaling desktop image");
+          return grub_error (grub_errno, "error loading desktop image");
         }
 
       grub_video_bitmap_destroy (view->desktop_image);
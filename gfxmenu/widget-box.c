@@ -24,6 +24,7 @@
 #include <grub/video.h>
 #include <grub/bitmap.h>
 #include <grub/bitmap_scale.h>
+#include <grub/bitmap_cache.h>
 #include <grub/gfxwidgets.h>
 
 enum box_pixmaps
@@ -140,8 +141,8 @@ scale_pixmap (grub_gfxmenu_box_t self, int i, int w, int h)
 
       /* Don't try to create a bitmap with a zero dimension.  */
       if (w != 0 && h != 0)
-        grub_video_bitmap_create_scaled (scaled, w, h, raw,
-                                         GRUB_VIDEO_BITMAP_SCALE_METHOD_BEST);
+        grub_video_bitmap_scale_cached (scaled, w, h, raw,
+                                        GRUB_VIDEO_BITMAP_SCALE_METHOD_BEST);
       if (grub_errno != GRUB_ERR_NONE)
         {
           grub_error_push ();
@@ -290,7 +291,7 @@ grub_gfxmenu_create_box (const char *pixmaps_prefix,
           path_end = grub_stpcpy (path_end, box_pixmap_names[i]);
           path_end = grub_stpcpy (path_end, pixmaps_suffix);
 
-          grub_video_bitmap_load (&box->raw_pixmaps[i], path);
+          grub_video_bitmap_load_cached (&box->raw_pixmaps[i], path);
           grub_free (path);
 
           /* Ignore missing pixmaps.  */
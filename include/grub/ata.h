@@ -50,6 +50,19 @@ typedef enum
 #define GRUB_ATA_REG_STATUS	7
 
 #define GRUB_ATA_REG2_CONTROL	0
+#define GRUB_ATA_REG2_ALTSTATUS	0
+
+/* Bus master IDE registers, relative to the channel's base in BAR4.  */
+#define GRUB_ATA_BM_REG_CMD	0
+#define GRUB_ATA_BM_REG_STATUS	2
+#define GRUB_ATA_BM_REG_PRDT	4
+
+#define GRUB_ATA_BM_CMD_START	0x01
+#define GRUB_ATA_BM_CMD_READ	0x08
+
+#define GRUB_ATA_BM_STATUS_ACTIVE	0x01
+#define GRUB_ATA_BM_STATUS_ERR		0x02
+#define GRUB_ATA_BM_STATUS_INTR		0x04
 
 #define GRUB_ATA_STATUS_ERR	0x01
 #define GRUB_ATA_STATUS_INDEX	0x02
@@ -74,13 +87,24 @@ enum grub_ata_commands
     GRUB_ATA_CMD_IDENTIFY_PACKET_DEVICE	= 0xa1,
     GRUB_ATA_CMD_IDLE			= 0xe3,
     GRUB_ATA_CMD_PACKET			= 0xa0,
+    GRUB_ATA_CMD_READ_DMA		= 0xc8,
+    GRUB_ATA_CMD_READ_DMA_EXT		= 0x25,
+    GRUB_ATA_CMD_READ_FPDMA_QUEUED	= 0x60,
+    GRUB_ATA_CMD_READ_MULTIPLE		= 0xc4,
+    GRUB_ATA_CMD_READ_MULTIPLE_EXT	= 0x29,
     GRUB_ATA_CMD_READ_SECTORS		= 0x20,
     GRUB_ATA_CMD_READ_SECTORS_EXT	= 0x24,
     GRUB_ATA_CMD_SECURITY_FREEZE_LOCK	= 0xf5,
     GRUB_ATA_CMD_SET_FEATURES		= 0xef,
+    GRUB_ATA_CMD_SET_MULTIPLE_MODE	= 0xc6,
     GRUB_ATA_CMD_SLEEP			= 0xe6,
     GRUB_ATA_CMD_SMART			= 0xb0,
     GRUB_ATA_CMD_STANDBY_IMMEDIATE	= 0xe0,
+    GRUB_ATA_CMD_WRITE_DMA		= 0xca,
+    GRUB_ATA_CMD_WRITE_DMA_EXT		= 0x35,
+    GRUB_ATA_CMD_WRITE_FPDMA_QUEUED	= 0x61,
+    GRUB_ATA_CMD_WRITE_MULTIPLE		= 0xc5,
+    GRUB_ATA_CMD_WRITE_MULTIPLE_EXT	= 0x39,
     GRUB_ATA_CMD_WRITE_SECTORS		= 0x30,
     GRUB_ATA_CMD_WRITE_SECTORS_EXT	= 0x34,
   };
@@ -91,6 +115,17 @@ enum grub_ata_timeout_milliseconds
     GRUB_ATA_TOUT_DATA = 10000   /* 10s DATA I/O timeout.  */
   };
 
+/* Physical region descriptor for bus master DMA.  A region may not
+   cross a 64KiB boundary; a size of 0 means 64KiB.  */
+struct grub_ata_prd
+{
+  grub_uint32_t addr;
+  grub_uint16_t size;
+  grub_uint16_t flags;
+} __attribute__ ((packed));
+
+#define GRUB_ATA_PRD_EOT	0x8000
+
 struct grub_ata_device
 {
   /* IDE port to use.  */
@@ -114,6 +149,9 @@ struct grub_ata_device
   /* Sector count.  */
   grub_uint64_t size;
 
+  /* The logarithm of the logical sector size.  */
+  unsigned int log_sector_size;
+
   /* CHS maximums.  */
   grub_uint16_t cylinders;
   grub_uint16_t heads;
@@ -122,6 +160,18 @@ struct grub_ata_device
   /* Set to 0 for ATA, set to 1 for ATAPI.  */
   int atapi;
 
+  /* Sectors per DRQ block for READ/WRITE MULTIPLE, or 0 if multiple
+     mode is not enabled.  */
+  int multiple;
+
+  /* Bus master IDE registers of this channel, or 0 if DMA is not
+     used.  Cleared when a DMA transfer fails, so that the device
+     falls back to PIO.  */
+  grub_port_t bmaddress;
+
+  /* PRD table for bus master DMA.  */
+  struct grub_ata_prd *prdt;
+
   struct grub_ata_device *next;
 };
 
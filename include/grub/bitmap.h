@@ -31,6 +31,10 @@ struct grub_video_bitmap
 
   /* Pointer to bitmap data formatted according to mode_info.  */
   void *data;
+
+  /* Number of references; grub_video_bitmap_destroy frees the bitmap
+     when the last one is dropped.  */
+  unsigned int refcount;
 };
 
 struct grub_video_bitmap_reader
@@ -56,6 +60,9 @@ grub_err_t EXPORT_FUNC (grub_video_bitmap_create) (struct grub_video_bitmap **bi
 
 grub_err_t EXPORT_FUNC (grub_video_bitmap_destroy) (struct grub_video_bitmap *bitmap);
 
+struct grub_video_bitmap *
+EXPORT_FUNC (grub_video_bitmap_ref) (struct grub_video_bitmap *bitmap);
+
 grub_err_t EXPORT_FUNC (grub_video_bitmap_load) (struct grub_video_bitmap **bitmap,
 						 const char *filename);
 
@@ -0,0 +1,61 @@
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2010  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRUB_BITMAP_CACHE_HEADER
+#define GRUB_BITMAP_CACHE_HEADER	1
+
+#include <grub/err.h>
+#include <grub/symbol.h>
+#include <grub/bitmap.h>
+#include <grub/bitmap_scale.h>
+
+/* Bitmaps returned by these functions are shared: they must not be
+   modified, and are released with grub_video_bitmap_destroy.  The cache
+   keeps its own references, up to 32 MiB of bitmap data, after the caller
+   is done with the bitmaps.  They are dropped by
+   grub_video_bitmap_cache_flush, which is also called before booting,
+   when memory runs out while loading or scaling, and when the module is
+   unloaded.  */
+
+/* Load FILENAME like grub_video_bitmap_load, reusing the bitmap decoded
+   by an earlier call if the file hasn't changed since.  */
+grub_err_t EXPORT_FUNC (grub_video_bitmap_load_cached) (struct grub_video_bitmap **bitmap,
+							 const char *filename);
+
+/* Scale SRC like grub_video_bitmap_create_scaled, reusing the result of
+   an earlier call for the same bitmap, size and method.  No file is
+   read.  Only bitmaps scaled from one the cache holds, as returned by
+   grub_video_bitmap_load_cached, are kept, one size per method.  */
+grub_err_t EXPORT_FUNC (grub_video_bitmap_scale_cached) (struct grub_video_bitmap **dst,
+							  int dst_width, int dst_height,
+							  struct grub_video_bitmap *src,
+							  enum grub_video_bitmap_scale_method
+							  scale_method);
+
+/* Load FILENAME with grub_video_bitmap_load_cached and scale it to WIDTH
+   by HEIGHT with grub_video_bitmap_scale_cached.  */
+grub_err_t EXPORT_FUNC (grub_video_bitmap_load_scaled) (struct grub_video_bitmap **bitmap,
+							 const char *filename,
+							 int width, int height,
+							 enum grub_video_bitmap_scale_method
+							 scale_method);
+
+/* Drop the cache's references to its bitmaps.  */
+void EXPORT_FUNC (grub_video_bitmap_cache_flush) (void);
+
+#endif /* ! GRUB_BITMAP_CACHE_HEADER */
@@ -22,7 +22,40 @@
 
 #include <grub/file.h>
 
+struct grub_bufio
+{
+  grub_file_t file;
+  grub_size_t block_size;
+
+  /* The buffer holds BUFFER_LEN bytes from the offset of FILE.  */
+  grub_size_t buffer_len;
+  char buffer[0];
+};
+typedef struct grub_bufio *grub_bufio_t;
+
 grub_file_t EXPORT_FUNC (grub_bufio_open) (grub_file_t io, int size);
 grub_file_t EXPORT_FUNC (grub_buffile_open) (const char *name, int size);
 
+/* Return the next byte of FILE, which must have been opened with
+   grub_bufio_open or grub_buffile_open, or -1 at the end of the file or
+   on error.  Bytes already buffered are returned without a read call.  */
+static inline int
+grub_bufio_getc (grub_file_t file)
+{
+  grub_bufio_t bufio = file->data;
+  grub_off_t pos = file->offset - bufio->file->offset;
+  grub_uint8_t c;
+
+  if (pos < bufio->buffer_len)
+    {
+      file->offset++;
+      return (grub_uint8_t) bufio->buffer[pos];
+    }
+
+  if (grub_file_read (file, &c, 1) != 1)
+    return -1;
+
+  return c;
+}
+
 #endif /* ! GRUB_BUFIO_H */
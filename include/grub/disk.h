@@ -42,7 +42,8 @@ enum grub_disk_dev_id
     GRUB_DISK_DEVICE_PXE_ID,
     GRUB_DISK_DEVICE_SCSI_ID,
     GRUB_DISK_DEVICE_FILE_ID,
-    GRUB_DISK_DEVICE_LUKS_ID
+    GRUB_DISK_DEVICE_LUKS_ID,
+    GRUB_DISK_DEVICE_AHCI_ID
   };
 
 struct grub_disk;
@@ -68,14 +69,20 @@ struct grub_disk_dev
   /* Close the disk DISK.  */
   void (*close) (struct grub_disk *disk);
 
-  /* Read SIZE sectors from the sector SECTOR of the disk DISK into BUF.  */
+  /* Read SIZE sectors from the sector SECTOR of the disk DISK into BUF.
+     SECTOR and SIZE are in units of the native sector size of DISK.  */
   grub_err_t (*read) (struct grub_disk *disk, grub_disk_addr_t sector,
 		      grub_size_t size, char *buf);
 
-  /* Write SIZE sectors from BUF into the sector SECTOR of the disk DISK.  */
+  /* Write SIZE sectors from BUF into the sector SECTOR of the disk DISK.
+     SECTOR and SIZE are in units of the native sector size of DISK.  */
   grub_err_t (*write) (struct grub_disk *disk, grub_disk_addr_t sector,
 		       grub_size_t size, const char *buf);
 
+  /* Set by devices which only pass requests on to other disks, such as
+     RAID, LVM and loopback devices.  See grub_disk_cache_layer.  */
+  int passthrough;
+
 #ifdef GRUB_UTIL
   struct grub_disk_memberlist *(*memberlist) (struct grub_disk *disk);
 #endif
@@ -96,9 +103,14 @@ struct grub_disk
   /* The underlying disk device.  */
   grub_disk_dev_t dev;
 
-  /* The total number of sectors.  */
+  /* The total number of sectors, in GRUB_DISK_SECTOR_SIZE units.  */
   grub_uint64_t total_sectors;
 
+  /* The logarithm of the native sector size of the device, set by the
+     driver if it is not GRUB_DISK_SECTOR_BITS.  Only the read and write
+     functions of the driver use this unit.  */
+  unsigned int log_sector_size;
+
   /* If partitions can be stored.  */
   int has_partitions;
 
@@ -108,6 +120,14 @@ struct grub_disk
   /* The partition information. This is machine-specific.  */
   struct grub_partition *partition;
 
+  /* The largest request the device should get at once, in
+     GRUB_DISK_SECTOR_SIZE units, or 0 if there is no limit.  */
+  grub_size_t max_transfer;
+
+  /* The alignment the device needs for the buffers of requests, a
+     power of two, or 0 if any buffer will do.  */
+  grub_size_t io_align;
+
   /* Called when a sector was read. OFFSET is between 0 and
      the sector size minus 1, and LENGTH is between 0 and the sector size.  */
   void NESTED_FUNC_ATTR (*read_hook) (grub_disk_addr_t sector,
@@ -131,6 +151,19 @@ typedef struct grub_disk_memberlist *grub_disk_memberlist_t;
 #define GRUB_DISK_SECTOR_SIZE	0x200
 #define GRUB_DISK_SECTOR_BITS	9
 
+/* The largest native sector size supported, which is the size of a
+   cache block.  */
+#define GRUB_DISK_MAX_LOG_SECTOR_SIZE	(GRUB_DISK_SECTOR_BITS \
+					 + GRUB_DISK_CACHE_BITS)
+
+/* Convert SECTOR in the native sector size of DISK to
+   GRUB_DISK_SECTOR_SIZE units.  */
+static inline grub_disk_addr_t
+grub_disk_from_native_sector (grub_disk_t disk, grub_disk_addr_t sector)
+{
+  return sector << (disk->log_sector_size - GRUB_DISK_SECTOR_BITS);
+}
+
 /* The maximum number of disk caches.  */
 #define GRUB_DISK_CACHE_NUM	1021
 
@@ -138,9 +171,32 @@ typedef struct grub_disk_memberlist *grub_disk_memberlist_t;
 #define GRUB_DISK_CACHE_SIZE	8
 #define GRUB_DISK_CACHE_BITS	3
 
+/* Reads of at least this many sectors bypass the cache.  */
+#define GRUB_DISK_DIRECT_MIN_SECTORS	128
+
+/* The regions at the start and at the end of a disk which hold the RAID
+   and LVM metadata (MD 0.90 superblocks are up to 128KiB from the end),
+   in sectors.  */
+#define GRUB_DISK_METADATA_HEAD_SECTORS	128
+#define GRUB_DISK_METADATA_TAIL_SECTORS	256
+
 /* This is called from the memory manager.  */
 void grub_disk_cache_invalidate_all (void);
 
+/* Which disks of a stack such as LVM on RAID are cached: the bottom-most
+   (the physical disks) or the top-most (the ones file systems read from).
+   Set with the environment variable `disk_cache'.  */
+enum grub_disk_cache_layer
+  {
+    GRUB_DISK_CACHE_BOTTOM,
+    GRUB_DISK_CACHE_TOP
+  };
+
+extern int EXPORT_VAR(grub_disk_cache_layer);
+
+struct grub_env_var;
+char *grub_disk_env_write_cache (struct grub_env_var *var, const char *val);
+
 void EXPORT_FUNC(grub_disk_dev_register) (grub_disk_dev_t dev);
 void EXPORT_FUNC(grub_disk_dev_unregister) (grub_disk_dev_t dev);
 int EXPORT_FUNC(grub_disk_dev_iterate) (int (*hook) (const char *name));
@@ -159,6 +215,10 @@ grub_err_t EXPORT_FUNC(grub_disk_write) (grub_disk_t disk,
 					 const void *buf);
 
 grub_uint64_t EXPORT_FUNC(grub_disk_get_size) (grub_disk_t disk);
+void EXPORT_FUNC(grub_disk_prefetch) (grub_disk_t disk,
+				     grub_disk_addr_t sector,
+				     grub_size_t size);
+void EXPORT_FUNC(grub_disk_prefetch_metadata) (grub_disk_t disk);
 
 extern void (* EXPORT_VAR(grub_disk_firmware_fini)) (void);
 extern int EXPORT_VAR(grub_disk_firmware_is_tainted);
@@ -24,6 +24,19 @@
 
 struct grub_video_fbblit_info;
 
+/* The number of damaged regions tracked separately in a render target.
+   Further regions are merged into the ones there are.  */
+#define GRUB_VIDEO_FB_MAX_DAMAGE	16
+
+/* A region of a render target in absolute coordinates.  */
+struct grub_video_fb_damage
+{
+  unsigned int x;
+  unsigned int y;
+  unsigned int width;
+  unsigned int height;
+};
+
 struct grub_video_fbrender_target
 {
   /* Copy of the screen's mode info structure, except that width, height and
@@ -45,6 +58,13 @@ struct grub_video_fbrender_target
   /* Pointer to data.  Can either be in video card memory or in local host's
      memory.  */
   grub_uint8_t *data;
+
+  /* Regions drawn to since the damage was last copied to another render
+     target.  */
+  struct grub_video_fb_damage damage[GRUB_VIDEO_FB_MAX_DAMAGE];
+
+  /* Number of used entries in `damage'.  */
+  unsigned int damage_count;
 };
 
 void
@@ -106,6 +106,12 @@ struct grub_font_glyph *EXPORT_FUNC (grub_font_get_glyph) (grub_font_t font,
 struct grub_font_glyph *EXPORT_FUNC (grub_font_get_glyph_with_fallback) (grub_font_t font,
 									 grub_uint32_t code);
 
+/* Load the glyphs of FONT for the code points FIRST to LAST at once,
+   ahead of their use.  */
+grub_err_t EXPORT_FUNC (grub_font_preload) (grub_font_t font,
+					    grub_uint32_t first,
+					    grub_uint32_t last);
+
 grub_err_t EXPORT_FUNC (grub_font_draw_glyph) (struct grub_font_glyph *glyph,
 					       grub_video_color_t color,
 					       int left_x, int baseline_y);
@@ -33,6 +33,9 @@
 
 #define GRUB_BIOSDISK_CDTYPE_MASK	0xF
 
+/* The largest native sector size of hard disks which is used.  */
+#define GRUB_BIOSDISK_MAX_SECTOR_SIZE	4096
+
 struct grub_biosdisk_data
 {
   int drive;
@@ -182,7 +182,7 @@ struct grub_msdos_partition
   /* The BSD partition type.  */
   int bsd_type;
 
-  /* The offset of the extended partition.  */
+  /* The offset of the extended partition, in native sectors.  */
   unsigned long ext_offset;
 };
 
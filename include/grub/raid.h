@@ -68,6 +68,8 @@ void grub_raid_register (grub_raid_t raid);
 void grub_raid_unregister (grub_raid_t raid);
 
 void grub_raid_block_xor (char *buf1, const char *buf2, int size);
+void grub_raid_block_xor_multi (char *buf, const char **srcs, int nsrcs,
+				int size);
 
 typedef grub_err_t (*grub_raid5_recover_func_t) (struct grub_raid_array *array,
                                                  int disknr, char *buf,
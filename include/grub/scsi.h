@@ -75,7 +75,7 @@ struct grub_scsi
   int removable;
 
   /* Size of the device in blocks.  */
-  int size;
+  grub_uint64_t size;
 
   /* Size of one block.  */
   int blocksize;
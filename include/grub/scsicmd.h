@@ -61,6 +61,23 @@ struct grub_scsi_read_capacity_data
   grub_uint32_t blocksize;
 } __attribute__((packed));
 
+struct grub_scsi_read_capacity16
+{
+  grub_uint8_t opcode;
+  grub_uint8_t service_action;
+  grub_uint64_t lba;
+  grub_uint32_t alloc_length;
+  grub_uint8_t reserved;
+  grub_uint8_t control;
+} __attribute__((packed));
+
+struct grub_scsi_read_capacity16_data
+{
+  grub_uint64_t size;
+  grub_uint32_t blocksize;
+  grub_uint8_t pad[20];
+} __attribute__((packed));
+
 struct grub_scsi_read10
 {
   grub_uint8_t opcode;
@@ -82,6 +99,16 @@ struct grub_scsi_read12
   grub_uint8_t control;
 } __attribute__((packed));
 
+struct grub_scsi_read16
+{
+  grub_uint8_t opcode;
+  grub_uint8_t flags;
+  grub_uint64_t lba;
+  grub_uint32_t size;
+  grub_uint8_t reserved;
+  grub_uint8_t control;
+} __attribute__((packed));
+
 struct grub_scsi_write10
 {
   grub_uint8_t opcode;
@@ -109,10 +136,15 @@ typedef enum
     grub_scsi_cmd_read_capacity = 0x25,
     grub_scsi_cmd_read10 = 0x28,
     grub_scsi_cmd_write10 = 0x2a,
+    grub_scsi_cmd_read16 = 0x88,
+    grub_scsi_cmd_service_action_in = 0x9e,
     grub_scsi_cmd_read12 = 0xa8,
     grub_scsi_cmd_write12 = 0xaa
   } grub_scsi_cmd_t;
 
+/* Service actions of grub_scsi_cmd_service_action_in.  */
+#define GRUB_SCSI_SAI_READ_CAPACITY16	0x10
+
 typedef enum
   {
     grub_scsi_devtype_direct = 0x00,
@@ -83,6 +83,17 @@ grub_usb_err_t
 grub_usb_bulk_write (grub_usb_device_t dev,
 		     int endpoint, grub_size_t size, char *data);
 
+/* One buffer of a bulk transfer made of several buffers.  */
+struct grub_usb_bulk_segment
+{
+  grub_size_t size;
+  char *data;
+};
+
+grub_usb_err_t
+grub_usb_bulk_read_segments (grub_usb_device_t dev, int endpoint,
+			     int nsegs, struct grub_usb_bulk_segment *segs);
+
 grub_usb_err_t
 grub_usb_root_hub (grub_usb_controller_t controller);
 
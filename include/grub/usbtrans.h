@@ -58,6 +58,10 @@ struct grub_usb_transfer
   struct grub_usb_device *dev;
 
   struct grub_usb_transaction *transactions;
+
+  /* The transaction in which a short packet ended the transfer, or -1
+     if it ran to completion.  Set by the host controller driver.  */
+  int last_trans;
 };
 typedef struct grub_usb_transfer *grub_usb_transfer_t;
 
@@ -115,6 +115,10 @@ grub_video_fb_get_active_render_target (struct grub_video_fbrender_target **targ
 grub_err_t
 grub_video_fb_set_active_render_target (struct grub_video_fbrender_target *target);
 
+void
+grub_video_fb_copy_damage (struct grub_video_fbrender_target *dst,
+			   struct grub_video_fbrender_target *src);
+
 typedef grub_err_t
 (*grub_video_fb_doublebuf_update_screen_t) (struct grub_video_fbrender_target *front,
 					  struct grub_video_fbrender_target *back);
@@ -27,15 +27,6 @@
 #define GRUB_BUFIO_DEF_SIZE	8192
 #define GRUB_BUFIO_MAX_SIZE	1048576
 
-struct grub_bufio
-{
-  grub_file_t file;
-  grub_size_t block_size;
-  grub_size_t buffer_len;
-  char buffer[0];
-};
-typedef struct grub_bufio *grub_bufio_t;
-
 static struct grub_fs grub_bufio_fs;
 
 grub_file_t
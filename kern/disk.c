@@ -24,6 +24,7 @@
 #include <grub/misc.h>
 #include <grub/time.h>
 #include <grub/file.h>
+#include <grub/env.h>
 
 #define	GRUB_CACHE_TIMEOUT	2
 
@@ -49,6 +50,11 @@ int grub_disk_firmware_is_tainted;
 grub_err_t (* grub_disk_ata_pass_through) (grub_disk_t,
 	    struct grub_disk_ata_pass_through_parms *);
 
+int grub_disk_cache_layer = GRUB_DISK_CACHE_BOTTOM;
+
+/* How many reads of pass-through devices are in progress.  */
+static unsigned grub_disk_passthrough_depth;
+
 
 #if 0
 static unsigned long grub_disk_cache_hits;
@@ -267,6 +273,7 @@ grub_disk_open (const char *name)
 
   for (dev = grub_disk_dev_list; dev; dev = dev->next)
     {
+      disk->log_sector_size = GRUB_DISK_SECTOR_BITS;
       if ((dev->open) (raw, disk) == GRUB_ERR_NONE)
 	break;
       else if (grub_errno == GRUB_ERR_UNKNOWN_DEVICE)
@@ -289,6 +296,15 @@ grub_disk_open (const char *name)
 
   disk->dev = dev;
 
+  if (disk->log_sector_size < GRUB_DISK_SECTOR_BITS
+      || disk->log_sector_size > GRUB_DISK_MAX_LOG_SECTOR_SIZE)
+    {
+      grub_error (GRUB_ERR_NOT_IMPLEMENTED_YET,
+		  "sector size of %u bytes not supported",
+		  1U << disk->log_sector_size);
+      goto fail;
+    }
+
   if (p)
     {
       disk->partition = grub_partition_probe (disk, p + 1);
@@ -378,6 +394,276 @@ grub_disk_adjust_range (grub_disk_t disk, grub_disk_addr_t *sector,
   return GRUB_ERR_NONE;
 }
 
+/* Write hook for the environment variable disk_cache.  */
+char *
+grub_disk_env_write_cache (struct grub_env_var *var __attribute__ ((unused)),
+			   const char *val)
+{
+  if (grub_strcmp (val, "bottom") == 0)
+    grub_disk_cache_layer = GRUB_DISK_CACHE_BOTTOM;
+  else if (grub_strcmp (val, "top") == 0)
+    grub_disk_cache_layer = GRUB_DISK_CACHE_TOP;
+  else
+    {
+      grub_error (GRUB_ERR_BAD_ARGUMENT, "disk_cache must be top or bottom");
+      return 0;
+    }
+
+  /* Blocks cached at the other layer would not be found any more.  */
+  grub_disk_cache_invalidate_all ();
+
+  return grub_strdup (val);
+}
+
+/* Whether reads from DISK go through the cache.  Stacked disks would
+   otherwise be cached once per layer.  */
+static int
+grub_disk_cacheable (grub_disk_t disk)
+{
+  if (grub_disk_cache_layer == GRUB_DISK_CACHE_TOP)
+    return grub_disk_passthrough_depth == 0;
+
+  return ! disk->dev->passthrough;
+}
+
+/* Read SIZE sectors from SECTOR of DISK into BUF with one request to the
+   device.  Both must be multiples of the native sector size.  */
+static grub_err_t
+grub_disk_dev_read (grub_disk_t disk, grub_disk_addr_t sector,
+		    grub_size_t size, char *buf)
+{
+  unsigned shift = disk->log_sector_size - GRUB_DISK_SECTOR_BITS;
+  grub_err_t err;
+
+  sector >>= shift;
+  size >>= shift;
+
+  if (! disk->dev->passthrough)
+    return (disk->dev->read) (disk, sector, size, buf);
+
+  grub_disk_passthrough_depth++;
+  err = (disk->dev->read) (disk, sector, size, buf);
+  grub_disk_passthrough_depth--;
+
+  return err;
+}
+
+/* Call the read hook of DISK, if any, for SIZE bytes from REAL_OFFSET
+   in SECTOR.  */
+static void
+grub_disk_call_read_hook (grub_disk_t disk, grub_disk_addr_t sector,
+			  unsigned real_offset, grub_size_t size)
+{
+  if (! disk->read_hook)
+    return;
+
+  while (size)
+    {
+      grub_size_t to_read = GRUB_DISK_SECTOR_SIZE - real_offset;
+
+      if (to_read > size)
+	to_read = size;
+      (disk->read_hook) (sector, real_offset, to_read);
+      if (grub_errno != GRUB_ERR_NONE)
+	break;
+
+      sector++;
+      size -= to_read;
+      real_offset = 0;
+    }
+}
+
+/* Read SIZE bytes from REAL_OFFSET in SECTOR of DISK into BUF with one
+   request to the device, bypassing the cache.  */
+static grub_err_t
+grub_disk_read_direct (grub_disk_t disk, grub_disk_addr_t sector,
+		       unsigned real_offset, grub_size_t size, void *buf)
+{
+  grub_disk_addr_t aligned_sector;
+  grub_size_t num;
+  grub_size_t offset;
+  char *tmp_buf = buf;
+
+  /* Read whole native sectors.  */
+  aligned_sector = (sector
+		    & ~((grub_disk_addr_t) (1 << (disk->log_sector_size
+						  - GRUB_DISK_SECTOR_BITS))
+			- 1));
+  offset = ((sector - aligned_sector) << GRUB_DISK_SECTOR_BITS) + real_offset;
+  num = (((size + offset + (1 << disk->log_sector_size) - 1)
+	  >> disk->log_sector_size)
+	 << (disk->log_sector_size - GRUB_DISK_SECTOR_BITS));
+
+  if (offset != 0 || (size & ((1 << disk->log_sector_size) - 1)) != 0)
+    {
+      tmp_buf = grub_malloc (num << GRUB_DISK_SECTOR_BITS);
+      if (! tmp_buf)
+	return grub_errno;
+    }
+
+  if (grub_disk_dev_read (disk, aligned_sector, num, tmp_buf))
+    {
+      grub_error_push ();
+      grub_dprintf ("disk", "%s read failed\n", disk->name);
+      grub_error_pop ();
+      if (tmp_buf != buf)
+	grub_free (tmp_buf);
+      return grub_errno;
+    }
+
+  if (tmp_buf != buf)
+    {
+      grub_memcpy (buf, tmp_buf + offset, size);
+      grub_free (tmp_buf);
+    }
+
+  grub_disk_call_read_hook (disk, sector, real_offset, size);
+
+  return grub_errno;
+}
+
+/* Read SIZE whole sectors from SECTOR of DISK into BUF without going
+   through the cache, in requests of at most DISK->max_transfer sectors.
+   Buffers not aligned as the device wants are bounced.  */
+static grub_err_t
+grub_disk_read_bulk (grub_disk_t disk, grub_disk_addr_t sector,
+		     grub_size_t size, char *buf)
+{
+  grub_size_t spn = 1 << (disk->log_sector_size - GRUB_DISK_SECTOR_BITS);
+  grub_size_t max = disk->max_transfer & ~(spn - 1);
+  char *bounce = 0;
+
+  /* Keep the requests multiples of the native sector size.  */
+  if (! disk->max_transfer)
+    max = size;
+  else if (! max)
+    max = spn;
+
+  if (disk->io_align
+      && ((grub_addr_t) buf & (disk->io_align - 1)) != 0)
+    {
+      bounce = grub_memalign (disk->io_align,
+			      (size < max ? size : max)
+			      << GRUB_DISK_SECTOR_BITS);
+      if (! bounce)
+	return grub_errno;
+    }
+
+  while (size)
+    {
+      grub_size_t len = size < max ? size : max;
+
+      if (grub_disk_dev_read (disk, sector, len, bounce ? : buf)
+	  != GRUB_ERR_NONE)
+	break;
+
+      if (bounce)
+	grub_memcpy (buf, bounce, len << GRUB_DISK_SECTOR_BITS);
+
+      grub_disk_call_read_hook (disk, sector, 0,
+				len << GRUB_DISK_SECTOR_BITS);
+      if (grub_errno != GRUB_ERR_NONE)
+	break;
+
+      sector += len;
+      buf += len << GRUB_DISK_SECTOR_BITS;
+      size -= len;
+    }
+
+  grub_free (bounce);
+
+  return grub_errno;
+}
+
+/* Read SIZE sectors from SECTOR of DISK into the cache with one request,
+   so that the small reads which follow are served from memory.  Errors
+   are ignored: the reads themselves will report them.  */
+void
+grub_disk_prefetch (grub_disk_t disk, grub_disk_addr_t sector,
+		    grub_size_t size)
+{
+  grub_disk_addr_t start, end, limit;
+  grub_off_t offset = 0;
+  char *buf;
+
+  if (! size || ! grub_disk_cacheable (disk))
+    return;
+
+  if (grub_disk_adjust_range (disk, &sector, &offset,
+			      size << GRUB_DISK_SECTOR_BITS) != GRUB_ERR_NONE)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  /* Only whole cache blocks within the disk are cached.  */
+  start = sector & ~(GRUB_DISK_CACHE_SIZE - 1);
+  end = ((sector + size + GRUB_DISK_CACHE_SIZE - 1)
+	 & ~(GRUB_DISK_CACHE_SIZE - 1));
+  limit = disk->total_sectors & ~(GRUB_DISK_CACHE_SIZE - 1);
+  if (end > limit)
+    end = limit;
+
+  /* Skip the blocks which are cached already.  */
+  while (start < end)
+    {
+      if (! grub_disk_cache_fetch (disk->dev->id, disk->id, start))
+	break;
+      grub_disk_cache_unlock (disk->dev->id, disk->id, start);
+      start += GRUB_DISK_CACHE_SIZE;
+    }
+  while (end > start)
+    {
+      grub_disk_addr_t last = end - GRUB_DISK_CACHE_SIZE;
+
+      if (! grub_disk_cache_fetch (disk->dev->id, disk->id, last))
+	break;
+      grub_disk_cache_unlock (disk->dev->id, disk->id, last);
+      end = last;
+    }
+
+  if (start >= end)
+    return;
+
+  buf = grub_malloc ((end - start) << GRUB_DISK_SECTOR_BITS);
+  if (! buf)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return;
+    }
+
+  if (grub_disk_dev_read (disk, start, end - start, buf) == GRUB_ERR_NONE)
+    for (sector = start; sector < end; sector += GRUB_DISK_CACHE_SIZE)
+      grub_disk_cache_store (disk->dev->id, disk->id, sector,
+			     buf + ((sector - start) << GRUB_DISK_SECTOR_BITS));
+
+  grub_errno = GRUB_ERR_NONE;
+  grub_free (buf);
+}
+
+/* Prefetch the regions at the start and at the end of DISK where RAID
+   and LVM drivers look for their metadata, so that the probes of all of
+   them cost two reads.  */
+void
+grub_disk_prefetch_metadata (grub_disk_t disk)
+{
+  grub_uint64_t size = grub_disk_get_size (disk);
+
+  if (size == GRUB_ULONG_MAX)
+    return;
+
+  if (size <= (GRUB_DISK_METADATA_HEAD_SECTORS
+	       + GRUB_DISK_METADATA_TAIL_SECTORS))
+    {
+      grub_disk_prefetch (disk, 0, size);
+      return;
+    }
+
+  grub_disk_prefetch (disk, 0, GRUB_DISK_METADATA_HEAD_SECTORS);
+  grub_disk_prefetch (disk, size - GRUB_DISK_METADATA_TAIL_SECTORS,
+		      GRUB_DISK_METADATA_TAIL_SECTORS);
+}
+
 /* Read data from the disk.  */
 grub_err_t
 grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
@@ -398,6 +684,9 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
 
   real_offset = offset;
 
+  if (! grub_disk_cacheable (disk))
+    return grub_disk_read_direct (disk, sector, real_offset, size, buf);
+
   /* Allocate a temporary buffer.  */
   tmp_buf = grub_malloc (GRUB_DISK_SECTOR_SIZE << GRUB_DISK_CACHE_BITS);
   if (! tmp_buf)
@@ -414,6 +703,26 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
       /* For reading bulk data.  */
       start_sector = sector & ~(GRUB_DISK_CACHE_SIZE - 1);
       pos = (sector - start_sector) << GRUB_DISK_SECTOR_BITS;
+
+      /* Hand large requests for whole cache blocks to the device as
+	 they are.  They are rarely read again, so don't cache them.  */
+      if (pos == 0 && real_offset == 0
+	  && (size >> GRUB_DISK_SECTOR_BITS) >= GRUB_DISK_DIRECT_MIN_SECTORS)
+	{
+	  grub_size_t num;
+
+	  num = ((size >> GRUB_DISK_SECTOR_BITS)
+		 & ~(GRUB_DISK_CACHE_SIZE - 1));
+
+	  if (grub_disk_read_bulk (disk, sector, num, buf) != GRUB_ERR_NONE)
+	    goto finish;
+
+	  sector += num;
+	  buf = (char *) buf + (num << GRUB_DISK_SECTOR_BITS);
+	  size -= num << GRUB_DISK_SECTOR_BITS;
+	  continue;
+	}
+
       len = ((GRUB_DISK_SECTOR_SIZE << GRUB_DISK_CACHE_BITS)
 	     - pos - real_offset);
       if (len > size)
@@ -431,49 +740,13 @@ grub_disk_read (grub_disk_t disk, grub_disk_addr_t sector,
 	{
 	  /* Otherwise read data from the disk actually.  */
 	  if (start_sector + GRUB_DISK_CACHE_SIZE > disk->total_sectors
-	      || (disk->dev->read) (disk, start_sector,
-				    GRUB_DISK_CACHE_SIZE, tmp_buf)
+	      || grub_disk_dev_read (disk, start_sector,
+				     GRUB_DISK_CACHE_SIZE, tmp_buf)
 	      != GRUB_ERR_NONE)
 	    {
 	      /* Uggh... Failed. Instead, just read necessary data.  */
-	      unsigned num;
-	      char *p;
-
 	      grub_errno = GRUB_ERR_NONE;
-
-	      num = ((size + real_offset + GRUB_DISK_SECTOR_SIZE - 1)
-		     >> GRUB_DISK_SECTOR_BITS);
-
-	      p = grub_realloc (tmp_buf, num << GRUB_DISK_SECTOR_BITS);
-	      if (!p)
-		goto finish;
-
-	      tmp_buf = p;
-
-	      if ((disk->dev->read) (disk, sector, num, tmp_buf))
-		{
-		  grub_error_push ();
-		  grub_dprintf ("disk", "%s read failed\n", disk->name);
-		  grub_error_pop ();
-		  goto finish;
-		}
-
-	      grub_memcpy (buf, tmp_buf + real_offset, size);
-
-	      /* Call the read hook, if any.  */
-	      if (disk->read_hook)
-		while (size)
-		  {
-		    grub_size_t to_read = (size > GRUB_DISK_SECTOR_SIZE) ? GRUB_DISK_SECTOR_SIZE : size;
-		    (disk->read_hook) (sector, real_offset,
-				       to_read);
-		    if (grub_errno != GRUB_ERR_NONE)
-		      goto finish;
-
-		    sector++;
-		    size -= to_read - real_offset;
-		    real_offset = 0;
-		  }
+	      grub_disk_read_direct (disk, sector, real_offset, size, buf);
 
 	      /* This must be the end.  */
 	      goto finish;
@@ -525,25 +798,37 @@ grub_disk_write (grub_disk_t disk, grub_disk_addr_t sector,
 		 grub_off_t offset, grub_size_t size, const void *buf)
 {
   unsigned real_offset;
+  unsigned shift = disk->log_sector_size - GRUB_DISK_SECTOR_BITS;
+  grub_size_t native_size = 1 << disk->log_sector_size;
+  char *tmp_buf = 0;
 
   grub_dprintf ("disk", "Writing `%s'...\n", disk->name);
 
   if (grub_disk_adjust_range (disk, &sector, &offset, size) != GRUB_ERR_NONE)
     return -1;
 
-  real_offset = offset;
+  /* Work on native sectors.  */
+  real_offset = (((sector & ((1 << shift) - 1)) << GRUB_DISK_SECTOR_BITS)
+		 + offset);
+  sector >>= shift;
 
   while (size)
     {
-      if (real_offset != 0 || (size < GRUB_DISK_SECTOR_SIZE && size != 0))
+      if (real_offset != 0 || (size < native_size && size != 0))
 	{
-	  char tmp_buf[GRUB_DISK_SECTOR_SIZE];
 	  grub_size_t len;
 	  grub_partition_t part;
 
+	  if (! tmp_buf)
+	    {
+	      tmp_buf = grub_malloc (native_size);
+	      if (! tmp_buf)
+		goto finish;
+	    }
+
 	  part = disk->partition;
 	  disk->partition = 0;
-	  if (grub_disk_read (disk, sector, 0, GRUB_DISK_SECTOR_SIZE, tmp_buf)
+	  if (grub_disk_read (disk, sector << shift, 0, native_size, tmp_buf)
 	      != GRUB_ERR_NONE)
 	    {
 	      disk->partition = part;
@@ -551,13 +836,13 @@ grub_disk_write (grub_disk_t disk, grub_disk_addr_t sector,
 	    }
 	  disk->partition = part;
 
-	  len = GRUB_DISK_SECTOR_SIZE - real_offset;
+	  len = native_size - real_offset;
 	  if (len > size)
 	    len = size;
 
 	  grub_memcpy (tmp_buf + real_offset, buf, len);
 
-	  grub_disk_cache_invalidate (disk->dev->id, disk->id, sector);
+	  grub_disk_cache_invalidate (disk->dev->id, disk->id, sector << shift);
 
 	  if ((disk->dev->write) (disk, sector, 1, tmp_buf) != GRUB_ERR_NONE)
 	    goto finish;
@@ -571,16 +856,21 @@ grub_disk_write (grub_disk_t disk, grub_disk_addr_t sector,
 	{
 	  grub_size_t len;
 	  grub_size_t n;
+	  grub_disk_addr_t s;
 
-	  len = size & ~(GRUB_DISK_SECTOR_SIZE - 1);
-	  n = size >> GRUB_DISK_SECTOR_BITS;
+	  len = size & ~(native_size - 1);
+	  n = size >> disk->log_sector_size;
 
 	  if ((disk->dev->write) (disk, sector, n, buf) != GRUB_ERR_NONE)
 	    goto finish;
 
-	  while (n--)
-	    grub_disk_cache_invalidate (disk->dev->id, disk->id, sector++);
+	  for (s = sector << shift; s < (sector + n) << shift;
+	       s += GRUB_DISK_CACHE_SIZE)
+	    grub_disk_cache_invalidate (disk->dev->id, disk->id, s);
+	  grub_disk_cache_invalidate (disk->dev->id, disk->id,
+				      ((sector + n) << shift) - 1);
 
+	  sector += n;
 	  buf = (char *) buf + len;
 	  size -= len;
 	}
@@ -588,6 +878,8 @@ grub_disk_write (grub_disk_t disk, grub_disk_addr_t sector,
 
  finish:
 
+  grub_free (tmp_buf);
+
   return grub_errno;
 }
 
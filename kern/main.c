@@ -24,6 +24,7 @@
 #include <grub/term.h>
 #include <grub/file.h>
 #include <grub/device.h>
+#include <grub/disk.h>
 #include <grub/env.h>
 #include <grub/mm.h>
 #include <grub/command.h>
@@ -169,6 +170,9 @@ grub_main (void)
   grub_machine_set_prefix ();
   grub_set_root_dev ();
 
+  grub_env_set ("disk_cache", "bottom");
+  grub_register_variable_hook ("disk_cache", 0, grub_disk_env_write_cache);
+
   grub_register_core_commands ();
   grub_register_rescue_parser ();
 
@@ -66,8 +66,10 @@ gpt_partition_map_iterate (grub_disk_t disk,
   if (mbr.entries[0].type != GRUB_PC_PARTITION_TYPE_GPT_DISK)
     return grub_error (GRUB_ERR_BAD_PART_TABLE, "no GPT partition map found");
 
-  /* Read the GPT header.  */
-  if (grub_disk_read (&raw, 1, 0, sizeof (gpt), &gpt))
+  /* Read the GPT header.  It is in the second native sector, and all
+     the addresses in the table are in native sectors too.  */
+  if (grub_disk_read (&raw, grub_disk_from_native_sector (&raw, 1), 0,
+		      sizeof (gpt), &gpt))
     return grub_errno;
 
   if (grub_memcmp (gpt.magic, grub_gpt_magic, sizeof (grub_gpt_magic)))
@@ -75,7 +77,8 @@ gpt_partition_map_iterate (grub_disk_t disk,
 
   grub_dprintf ("gpt", "Read a valid GPT header\n");
 
-  entries = grub_le_to_cpu64 (gpt.partitions);
+  entries = grub_disk_from_native_sector (&raw,
+					  grub_le_to_cpu64 (gpt.partitions));
   for (i = 0; i < grub_le_to_cpu32 (gpt.maxpart); i++)
     {
       if (grub_disk_read (&raw, entries, last_offset,
@@ -86,9 +89,12 @@ gpt_partition_map_iterate (grub_disk_t disk,
 		       sizeof (grub_gpt_partition_type_empty)))
 	{
 	  /* Calculate the first block and the size of the partition.  */
-	  part.start = grub_le_to_cpu64 (entry.start);
-	  part.len = (grub_le_to_cpu64 (entry.end)
-		      - grub_le_to_cpu64 (entry.start) + 1);
+	  part.start = grub_disk_from_native_sector (disk,
+						     grub_le_to_cpu64 (entry.start));
+	  part.len = grub_disk_from_native_sector (disk,
+						   grub_le_to_cpu64 (entry.end)
+						   - grub_le_to_cpu64 (entry.start)
+						   + 1);
 	  part.offset = entries;
 	  part.index = i;
 	  part.partmap = &grub_gpt_partition_map;
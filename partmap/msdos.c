@@ -148,8 +148,10 @@ pc_partition_map_iterate (grub_disk_t disk,
 	{
 	  e = mbr.entries + p.index;
 
-	  p.start = p.offset + grub_le_to_cpu32 (e->start);
-	  p.len = grub_le_to_cpu32 (e->length);
+	  p.start = p.offset + grub_disk_from_native_sector (disk,
+							     grub_le_to_cpu32 (e->start));
+	  p.len = grub_disk_from_native_sector (disk,
+						grub_le_to_cpu32 (e->length));
 	  pcdata.bsd_part = -1;
 	  pcdata.dos_type = e->type;
 	  pcdata.bsd_type = -1;
@@ -177,7 +179,8 @@ pc_partition_map_iterate (grub_disk_t disk,
 	      if (grub_msdos_partition_is_bsd (e->type))
 		{
 		  /* Check if the BSD label is within the DOS partition.  */
-		  if (p.len <= GRUB_PC_PARTITION_BSD_LABEL_SECTOR)
+		  if (p.len <= grub_disk_from_native_sector
+		      (disk, GRUB_PC_PARTITION_BSD_LABEL_SECTOR))
 		    {
 		      grub_dprintf ("partition", "no space for disk label\n");
 		      continue;
@@ -185,7 +188,8 @@ pc_partition_map_iterate (grub_disk_t disk,
 		  /* Read the BSD label.  */
 		  if (grub_disk_read (&raw,
 				      (p.start
-				       + GRUB_PC_PARTITION_BSD_LABEL_SECTOR),
+				       + grub_disk_from_native_sector
+				       (disk, GRUB_PC_PARTITION_BSD_LABEL_SECTOR)),
 				      0,
 				      sizeof (label),
 				      &label))
@@ -207,8 +211,12 @@ pc_partition_map_iterate (grub_disk_t disk,
 		      struct grub_msdos_partition_bsd_entry *be
 			= label.entries + pcdata.bsd_part;
 
-		      p.start = grub_le_to_cpu32 (be->offset);
-		      p.len = grub_le_to_cpu32 (be->size);
+		      p.start
+			= grub_disk_from_native_sector (disk,
+							grub_le_to_cpu32 (be->offset));
+		      p.len
+			= grub_disk_from_native_sector (disk,
+							grub_le_to_cpu32 (be->size));
 		      pcdata.bsd_type = be->fs_type;
 
 		      if (be->fs_type != GRUB_PC_PARTITION_BSD_TYPE_UNUSED)
@@ -230,9 +238,13 @@ pc_partition_map_iterate (grub_disk_t disk,
 
 	  if (grub_msdos_partition_is_extended (e->type))
 	    {
-	      p.offset = pcdata.ext_offset + grub_le_to_cpu32 (e->start);
+	      p.offset
+		= grub_disk_from_native_sector (disk, pcdata.ext_offset
+						+ grub_le_to_cpu32 (e->start));
 	      if (! pcdata.ext_offset)
-		pcdata.ext_offset = p.offset;
+		pcdata.ext_offset = (p.offset
+				     >> (disk->log_sector_size
+					 - GRUB_DISK_SECTOR_BITS));
 
 	      break;
 	    }
@@ -37,6 +37,9 @@
 #define DEFAULT_NORMAL_COLOR    0x07
 #define DEFAULT_HIGHLIGHT_COLOR 0x70
 
+/* Number of separate regions kept dirty before they are merged.  */
+#define MAX_DIRTY_REGIONS	8
+
 struct grub_dirty_region
 {
   int top_left_x;
@@ -101,10 +104,16 @@ struct grub_virtual_screen
   grub_video_color_t bg_color_display;
 
   /* Text buffer for virtual screen.  Contains (columns * rows) number
-     of entries.  */
+     of entries, used as a ring of rows of which first_row is at the
+     top.  */
   struct grub_colored_char *text_buffer;
+  unsigned int first_row;
 
   int total_scroll;
+
+  /* The rows of characters in the text layer are a ring too, so that
+     scrolling needs no copying; this one is at the top.  */
+  unsigned int first_layer_row;
 };
 
 struct grub_gfxterm_window
@@ -132,7 +141,8 @@ static unsigned int bitmap_width;
 static unsigned int bitmap_height;
 static struct grub_video_bitmap *bitmap;
 
-static struct grub_dirty_region dirty_region;
+static struct grub_dirty_region dirty_regions[MAX_DIRTY_REGIONS];
+static int dirty_region_count;
 
 static void dirty_region_reset (void);
 
@@ -173,6 +183,25 @@ set_term_color (grub_uint8_t term_color)
   grub_video_set_active_render_target (old_target);
 }
 
+/* Return the first character of the row ROW of the text buffer.  */
+static inline struct grub_colored_char *
+text_row (unsigned int row)
+{
+  row += virtual_screen.first_row;
+  if (row >= virtual_screen.rows)
+    row -= virtual_screen.rows;
+  return virtual_screen.text_buffer + row * virtual_screen.columns;
+}
+
+/* Return the y coordinate in the text layer of the row ROW of
+   characters, counted from the top of the virtual screen.  */
+static inline unsigned int
+text_layer_y (unsigned int row)
+{
+  row = (row + virtual_screen.first_layer_row) % virtual_screen.rows;
+  return row * virtual_screen.normal_char_height;
+}
+
 static void
 clear_char (struct grub_colored_char *c)
 {
@@ -225,6 +254,8 @@ grub_virtual_screen_setup (unsigned int x, unsigned int y,
   virtual_screen.cursor_y = 0;
   virtual_screen.cursor_state = 1;
   virtual_screen.total_scroll = 0;
+  virtual_screen.first_row = 0;
+  virtual_screen.first_layer_row = 0;
 
   /* Calculate size of text buffer.  */
   virtual_screen.columns = virtual_screen.width / virtual_screen.normal_char_width;
@@ -408,6 +439,55 @@ grub_gfxterm_fini (void)
   return GRUB_ERR_NONE;
 }
 
+/* Blit the part of the text layer shown at X, Y of the window, which is
+   in pieces where the ring of rows wraps around.  */
+static void
+blit_text_layer (enum grub_video_blit_operators oper, int x, int y,
+                 int width, int height)
+{
+  int ring_height;
+  int origin;
+  int ty;
+
+  ring_height = virtual_screen.rows * virtual_screen.normal_char_height;
+  origin = virtual_screen.first_layer_row * virtual_screen.normal_char_height;
+  ty = y - virtual_screen.offset_y;
+
+  while (height > 0)
+    {
+      int ly;
+      int h;
+
+      h = height;
+      ly = ty;
+      if (ty < 0)
+        {
+          /* Above the virtual screen, where there is no text.  */
+          if (h > -ty)
+            h = -ty;
+          ly = -1;
+        }
+      else if (ty < ring_height)
+        {
+          ly = ty + origin;
+          if (ly >= ring_height)
+            ly -= ring_height;
+          if (h > ring_height - ly)
+            h = ring_height - ly;
+          if (h > ring_height - ty)
+            h = ring_height - ty;
+        }
+
+      if (ly >= 0)
+        grub_video_blit_render_target (text_layer, oper, x, y,
+                                       x - virtual_screen.offset_x, ly,
+                                       width, h);
+      y += h;
+      ty += h;
+      height -= h;
+    }
+}
+
 static void
 redraw_screen_rect (unsigned int x, unsigned int y,
                     unsigned int width, unsigned int height)
@@ -471,10 +551,7 @@ redraw_screen_rect (unsigned int x, unsigned int y,
         }
 
       /* Render text layer as blended.  */
-      grub_video_blit_render_target (text_layer, GRUB_VIDEO_BLIT_BLEND, x, y,
-                                     x - virtual_screen.offset_x,
-                                     y - virtual_screen.offset_y,
-                                     width, height);
+      blit_text_layer (GRUB_VIDEO_BLIT_BLEND, x, y, width, height);
     }
   else
     {
@@ -483,10 +560,7 @@ redraw_screen_rect (unsigned int x, unsigned int y,
       grub_video_fill_rect (color, x, y, width, height);
 
       /* Render text layer as replaced (to get texts background color).  */
-      grub_video_blit_render_target (text_layer, GRUB_VIDEO_BLIT_REPLACE, x, y,
-                                     x - virtual_screen.offset_x,
-                                     y - virtual_screen.offset_y,
-				     width, height);
+      blit_text_layer (GRUB_VIDEO_BLIT_REPLACE, x, y, width, height);
     }
 
   /* Restore saved viewport.  */
@@ -501,27 +575,54 @@ redraw_screen_rect (unsigned int x, unsigned int y,
 static void
 dirty_region_reset (void)
 {
-  dirty_region.top_left_x = -1;
-  dirty_region.top_left_y = -1;
-  dirty_region.bottom_right_x = -1;
-  dirty_region.bottom_right_y = -1;
+  dirty_region_count = 0;
   repaint_was_schedulded = 0;
 }
 
 static int
 dirty_region_is_empty (void)
 {
-  if ((dirty_region.top_left_x == -1)
-      || (dirty_region.top_left_y == -1)
-      || (dirty_region.bottom_right_x == -1)
-      || (dirty_region.bottom_right_y == -1))
-    return 1;
-  return 0;
+  return dirty_region_count == 0;
+}
+
+/* Return the area of the union of regions A and B, storing the union in
+   U.  */
+static int
+dirty_region_union (const struct grub_dirty_region *a,
+                    const struct grub_dirty_region *b,
+                    struct grub_dirty_region *u)
+{
+  u->top_left_x = a->top_left_x < b->top_left_x
+    ? a->top_left_x : b->top_left_x;
+  u->top_left_y = a->top_left_y < b->top_left_y
+    ? a->top_left_y : b->top_left_y;
+  u->bottom_right_x = a->bottom_right_x > b->bottom_right_x
+    ? a->bottom_right_x : b->bottom_right_x;
+  u->bottom_right_y = a->bottom_right_y > b->bottom_right_y
+    ? a->bottom_right_y : b->bottom_right_y;
+
+  return (u->bottom_right_x - u->top_left_x + 1)
+    * (u->bottom_right_y - u->top_left_y + 1);
 }
 
+static int
+dirty_region_area (const struct grub_dirty_region *r)
+{
+  return (r->bottom_right_x - r->top_left_x + 1)
+    * (r->bottom_right_y - r->top_left_y + 1);
+}
+
+/* Regions are kept separate, so that a cursor and a line of text far
+   apart don't make the whole of the screen between them be redrawn.
+   Regions which overlap or adjoin are merged, and once there are too
+   many a new one is merged into the region it enlarges least.  */
 static void
 dirty_region_add (int x, int y, unsigned int width, unsigned int height)
 {
+  struct grub_dirty_region r;
+  struct grub_dirty_region u;
+  int i;
+
   if ((width == 0) || (height == 0))
     return;
 
@@ -535,24 +636,48 @@ dirty_region_add (int x, int y, unsigned int width, unsigned int height)
       repaint_was_schedulded = 1;
     }
 
-  if (dirty_region_is_empty ())
-    {
-      dirty_region.top_left_x = x;
-      dirty_region.top_left_y = y;
-      dirty_region.bottom_right_x = x + width - 1;
-      dirty_region.bottom_right_y = y + height - 1;
-    }
-  else
+  r.top_left_x = x;
+  r.top_left_y = y;
+  r.bottom_right_x = x + width - 1;
+  r.bottom_right_y = y + height - 1;
+
+  /* Absorb every region which costs nothing extra to redraw along with
+     R.  Merging can make R overlap regions checked before, so start over
+     after each.  */
+  for (i = 0; i < dirty_region_count; i++)
+    if (dirty_region_union (&dirty_regions[i], &r, &u)
+        <= dirty_region_area (&dirty_regions[i]) + dirty_region_area (&r))
+      {
+        r = u;
+        dirty_regions[i] = dirty_regions[--dirty_region_count];
+        i = -1;
+      }
+
+  if (dirty_region_count < MAX_DIRTY_REGIONS)
     {
-      if (x < dirty_region.top_left_x)
-        dirty_region.top_left_x = x;
-      if (y < dirty_region.top_left_y)
-        dirty_region.top_left_y = y;
-      if ((x + (int)width - 1) > dirty_region.bottom_right_x)
-        dirty_region.bottom_right_x = x + width - 1;
-      if ((y + (int)height - 1) > dirty_region.bottom_right_y)
-        dirty_region.bottom_right_y = y + height - 1;
+      dirty_regions[dirty_region_count++] = r;
+      return;
     }
+
+  /* Out of slots: merge R into the region which grows least.  */
+  {
+    int best = 0;
+    int best_growth = -1;
+
+    for (i = 0; i < dirty_region_count; i++)
+      {
+        int growth = dirty_region_union (&dirty_regions[i], &r, &u)
+          - dirty_region_area (&dirty_regions[i]);
+
+        if (best_growth < 0 || growth < best_growth)
+          {
+            best = i;
+            best_growth = growth;
+          }
+      }
+
+    dirty_region_union (&dirty_regions[best], &r, &dirty_regions[best]);
+  }
 }
 
 static void
@@ -567,24 +692,21 @@ dirty_region_add_virtualscreen (void)
 static void
 dirty_region_redraw (void)
 {
-  int x;
-  int y;
-  int width;
-  int height;
+  int i;
 
   if (dirty_region_is_empty ())
     return;
 
-  x = dirty_region.top_left_x;
-  y = dirty_region.top_left_y;
-
-  width = dirty_region.bottom_right_x - x + 1;
-  height = dirty_region.bottom_right_y - y + 1;
-
   if (repaint_was_schedulded && grub_gfxterm_decorator_hook)
     grub_gfxterm_decorator_hook ();
 
-  redraw_screen_rect (x, y, width, height);
+  for (i = 0; i < dirty_region_count; i++)
+    redraw_screen_rect (dirty_regions[i].top_left_x,
+                        dirty_regions[i].top_left_y,
+                        dirty_regions[i].bottom_right_x
+                        - dirty_regions[i].top_left_x + 1,
+                        dirty_regions[i].bottom_right_y
+                        - dirty_regions[i].top_left_y + 1);
 }
 
 static inline void
@@ -604,8 +726,7 @@ paint_char (unsigned cx, unsigned cy)
     return;
 
   /* Find out active character.  */
-  p = (virtual_screen.text_buffer
-       + cx + (cy * virtual_screen.columns));
+  p = text_row (cy) + cx;
 
   p -= p->index;
 
@@ -620,7 +741,7 @@ paint_char (unsigned cx, unsigned cy)
   bgcolor = p->bg_color;
 
   x = cx * virtual_screen.normal_char_width;
-  y = (cy + virtual_screen.total_scroll) * virtual_screen.normal_char_height;
+  y = text_layer_y (cy + virtual_screen.total_scroll);
 
   /* Render glyph to text layer.  */
   grub_video_set_active_render_target (text_layer);
@@ -629,6 +750,7 @@ paint_char (unsigned cx, unsigned cy)
   grub_video_set_active_render_target (render_target);
 
   /* Mark character to be drawn.  */
+  y = (cy + virtual_screen.total_scroll) * virtual_screen.normal_char_height;
   dirty_region_add (virtual_screen.offset_x + x, virtual_screen.offset_y + y,
                     width, height);
 }
@@ -661,8 +783,7 @@ draw_cursor (int show)
   x = virtual_screen.cursor_x * virtual_screen.normal_char_width;
   width = virtual_screen.normal_char_width;
   color = virtual_screen.fg_color;
-  y = ((virtual_screen.cursor_y + virtual_screen.total_scroll)
-       * virtual_screen.normal_char_height
+  y = (text_layer_y (virtual_screen.cursor_y + virtual_screen.total_scroll)
        + grub_font_get_ascent (virtual_screen.font));
   height = 2;
   
@@ -670,6 +791,10 @@ draw_cursor (int show)
   grub_video_set_active_render_target (text_layer);
   grub_video_fill_rect (color, x, y, width, height);
   grub_video_set_active_render_target (render_target);
+
+  y = ((virtual_screen.cursor_y + virtual_screen.total_scroll)
+       * virtual_screen.normal_char_height
+       + grub_font_get_ascent (virtual_screen.font));
   
   /* Mark cursor to be redrawn.  */
   dirty_region_add (virtual_screen.offset_x + x,
@@ -677,6 +802,31 @@ draw_cursor (int show)
 		    width, height);
 }
 
+/* Scroll the text layer up by total_scroll rows.  Only the start of its
+   ring of rows moves; the rows which come in at the bottom are
+   cleared.  */
+static void
+scroll_text_layer (void)
+{
+  unsigned int count;
+  unsigned int i;
+
+  count = virtual_screen.total_scroll;
+  if (count > virtual_screen.rows)
+    count = virtual_screen.rows;
+
+  virtual_screen.first_layer_row = ((virtual_screen.first_layer_row
+                                     + virtual_screen.total_scroll)
+                                    % virtual_screen.rows);
+
+  grub_video_set_active_render_target (text_layer);
+  for (i = virtual_screen.rows - count; i < virtual_screen.rows; i++)
+    grub_video_fill_rect (virtual_screen.bg_color, 0, text_layer_y (i),
+                          virtual_screen.width,
+                          virtual_screen.normal_char_height);
+  grub_video_set_active_render_target (render_target);
+}
+
 static void
 real_scroll (void)
 {
@@ -689,11 +839,8 @@ real_scroll (void)
   /* If we have bitmap, re-draw screen, otherwise scroll physical screen too.  */
   if (bitmap)
     {
-      /* Scroll physical screen.  */
-      grub_video_set_active_render_target (text_layer);
-      color = virtual_screen.bg_color;
-      grub_video_scroll (color, 0, -virtual_screen.normal_char_height
-			 * virtual_screen.total_scroll);
+      /* Scroll text layer.  */
+      scroll_text_layer ();
 
       /* Mark virtual screen to be redrawn.  */
       dirty_region_add_virtualscreen ();
@@ -739,11 +886,8 @@ real_scroll (void)
 	}
       dirty_region_reset ();
 
-      /* Scroll physical screen.  */
-      grub_video_set_active_render_target (text_layer);
-      color = virtual_screen.bg_color;
-      grub_video_scroll (color, 0, -virtual_screen.normal_char_height
-			 * virtual_screen.total_scroll);
+      /* Scroll text layer.  */
+      scroll_text_layer ();
 
       /* Restore saved viewport.  */
       grub_video_set_viewport (saved_view.x, saved_view.y,
@@ -775,20 +919,19 @@ real_scroll (void)
 static void
 scroll_up (void)
 {
+  struct grub_colored_char *p;
   unsigned int i;
 
-  /* Scroll text buffer with one line to up.  */
-  grub_memmove (virtual_screen.text_buffer,
-                virtual_screen.text_buffer + virtual_screen.columns,
-                sizeof (*virtual_screen.text_buffer)
-                * virtual_screen.columns
-                * (virtual_screen.rows - 1));
+  /* Scroll text buffer with one line to up, by moving the top of the
+     ring of rows.  */
+  virtual_screen.first_row++;
+  if (virtual_screen.first_row >= virtual_screen.rows)
+    virtual_screen.first_row = 0;
 
   /* Clear last line in text buffer.  */
-  for (i = virtual_screen.columns * (virtual_screen.rows - 1);
-       i < virtual_screen.columns * virtual_screen.rows;
-       i++)
-    clear_char (&(virtual_screen.text_buffer[i]));
+  p = text_row (virtual_screen.rows - 1);
+  for (i = 0; i < virtual_screen.columns; i++)
+    clear_char (&p[i]);
 
   virtual_screen.total_scroll++;
 }
@@ -843,9 +986,7 @@ grub_gfxterm_putchar (grub_uint32_t c)
         grub_putchar ('\n');
 
       /* Find position on virtual screen, and fill information.  */
-      p = (virtual_screen.text_buffer +
-           virtual_screen.cursor_x +
-           virtual_screen.cursor_y * virtual_screen.columns);
+      p = text_row (virtual_screen.cursor_y) + virtual_screen.cursor_x;
       p->code = c;
       p->fg_color = virtual_screen.fg_color;
       p->bg_color = virtual_screen.bg_color;
@@ -897,6 +1038,7 @@ calculate_normal_character_width (grub_font_t font)
   unsigned int i;
 
   /* Get properties of every printable ASCII character.  */
+  grub_font_preload (font, 32, 126);
   for (i = 32; i < 127; i++)
     {
       glyph = grub_font_get_glyph (font, i);
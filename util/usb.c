@@ -175,6 +175,23 @@ grub_usb_bulk_write (grub_usb_device_t dev,
   return GRUB_USB_ERR_STALL;
 }
 
+grub_usb_err_t
+grub_usb_bulk_read_segments (grub_usb_device_t dev, int endpoint,
+			     int nsegs, struct grub_usb_bulk_segment *segs)
+{
+  int i;
+  grub_usb_err_t err;
+
+  for (i = 0; i < nsegs; i++)
+    {
+      err = grub_usb_bulk_read (dev, endpoint, segs[i].size, segs[i].data);
+      if (err)
+	return err;
+    }
+
+  return GRUB_USB_ERR_NONE;
+}
+
 GRUB_MOD_INIT (libusb)
 {
   usb_init();
@@ -69,6 +69,8 @@ grub_video_bitmap_create (struct grub_video_bitmap **bitmap,
   if (! *bitmap)
     return grub_errno;
 
+  (*bitmap)->refcount = 1;
+
   mode_info = &((*bitmap)->mode_info);
 
   /* Populate mode_info.  */
@@ -149,19 +151,34 @@ grub_video_bitmap_create (struct grub_video_bitmap **bitmap,
   return GRUB_ERR_NONE;
 }
 
-/* Frees all resources allocated by bitmap.  */
+/* Drops a reference to bitmap, and frees all resources allocated by it
+   if that was the last one.  */
 grub_err_t
 grub_video_bitmap_destroy (struct grub_video_bitmap *bitmap)
 {
   if (! bitmap)
     return GRUB_ERR_NONE;
 
+  if (--bitmap->refcount)
+    return GRUB_ERR_NONE;
+
   grub_free (bitmap->data);
   grub_free (bitmap);
 
   return GRUB_ERR_NONE;
 }
 
+/* Adds a reference to bitmap, so that it is shared rather than copied.
+   The data must not be modified while it is shared.  */
+struct grub_video_bitmap *
+grub_video_bitmap_ref (struct grub_video_bitmap *bitmap)
+{
+  if (bitmap)
+    bitmap->refcount++;
+
+  return bitmap;
+}
+
 /* Match extension to filename.  */
 static int
 match_extension (const char *filename, const char *ext)
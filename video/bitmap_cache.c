@@ -0,0 +1,439 @@
+/* bitmap_cache.c - Cache of decoded and scaled bitmaps.  */
+/*
+ *  GRUB  --  GRand Unified Bootloader
+ *  Copyright (C) 2010  Free Software Foundation, Inc.
+ *
+ *  GRUB is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  GRUB is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with GRUB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <grub/bitmap.h>
+#include <grub/bitmap_scale.h>
+#include <grub/bitmap_cache.h>
+#include <grub/types.h>
+#include <grub/dl.h>
+#include <grub/mm.h>
+#include <grub/misc.h>
+#include <grub/fs.h>
+#include <grub/device.h>
+#include <grub/file.h>
+#include <grub/loader.h>
+
+/* Total size of the cached bitmaps' data.  Bitmaps still in use stay
+   allocated when they are evicted; only the cache's reference goes.  */
+#define BITMAP_CACHE_MAX_BYTES	(32 * 1024 * 1024)
+
+/* What identifies a version of a file.  */
+struct file_id
+{
+  grub_off_t size;
+  int mtimeset;
+  grub_int32_t mtime;
+};
+
+struct bitmap_cache_entry
+{
+  struct bitmap_cache_entry *next;
+
+  /* File a decoded bitmap came from, or 0 for a scaled bitmap.  */
+  char *filename;
+  struct file_id id;
+
+  /* Decoded bitmap a scaled bitmap was made from, and how.  The entry
+     holding the decoded bitmap keeps it alive, and is never dropped
+     without dropping the bitmaps scaled from it.  */
+  struct grub_video_bitmap *source;
+  int width, height;
+  enum grub_video_bitmap_scale_method scale_method;
+
+  struct grub_video_bitmap *bitmap;
+  grub_size_t bytes;
+  unsigned long last_use;
+};
+
+static struct bitmap_cache_entry *bitmap_cache;
+static grub_size_t bitmap_cache_bytes;
+static unsigned long bitmap_cache_clock;
+
+/* Fill ID for FILENAME.  The modification time comes from the directory
+   listing, as not every filesystem provides it.  */
+static grub_err_t
+get_file_id (const char *filename, struct file_id *id)
+{
+  grub_file_t file;
+  char *device_name, *path, *basename;
+  const char *pathname;
+  grub_device_t dev;
+  grub_fs_t fs;
+
+  auto int find_file (const char *cur_filename,
+		      const struct grub_dirhook_info *info);
+  int find_file (const char *cur_filename,
+		 const struct grub_dirhook_info *info)
+  {
+    if ((info->case_insensitive ? grub_strcasecmp (cur_filename, basename)
+	 : grub_strcmp (cur_filename, basename)) == 0)
+      {
+	id->mtimeset = info->mtimeset;
+	id->mtime = info->mtime;
+	return 1;
+      }
+    return 0;
+  }
+
+  file = grub_file_open (filename);
+  if (! file)
+    return grub_errno;
+
+  id->size = file->size;
+  id->mtimeset = 0;
+  id->mtime = 0;
+  grub_file_close (file);
+
+  pathname = grub_strchr (filename, ')');
+  if (! pathname)
+    pathname = filename;
+  else
+    pathname++;
+
+  path = grub_strdup (pathname);
+  if (! path)
+    return grub_errno;
+
+  basename = grub_strrchr (path, '/');
+  if (! basename || ! basename[1])
+    {
+      grub_free (path);
+      return GRUB_ERR_NONE;
+    }
+
+  /* Split into directory and file name.  */
+  *basename++ = 0;
+
+  device_name = grub_file_get_device_name (filename);
+  dev = grub_device_open (device_name);
+  if (dev)
+    {
+      fs = grub_fs_probe (dev);
+      if (fs)
+	(fs->dir) (dev, *path ? path : "/", find_file);
+      grub_device_close (dev);
+    }
+
+  grub_free (device_name);
+  grub_free (path);
+
+  /* Without a modification time, the size alone identifies the file.  */
+  grub_errno = GRUB_ERR_NONE;
+  return GRUB_ERR_NONE;
+}
+
+static void
+free_entry (struct bitmap_cache_entry *entry)
+{
+  bitmap_cache_bytes -= entry->bytes;
+  grub_video_bitmap_destroy (entry->bitmap);
+  grub_free (entry->filename);
+  grub_free (entry);
+}
+
+/* Unlink the entry at *P and free it, along with the bitmaps scaled from
+   it if it is a decoded one.  Links into the list other than P may no
+   longer be valid afterwards.  */
+static void
+drop_entry (struct bitmap_cache_entry **p)
+{
+  struct bitmap_cache_entry *entry = *p, *scaled;
+
+  *p = entry->next;
+
+  if (entry->filename)
+    {
+      for (p = &bitmap_cache; (scaled = *p); )
+	if (scaled->source == entry->bitmap)
+	  {
+	    *p = scaled->next;
+	    free_entry (scaled);
+	  }
+	else
+	  p = &scaled->next;
+    }
+
+  free_entry (entry);
+}
+
+/* Find the decoded bitmap of FILENAME, and drop any made from an older
+   version of the file.  */
+static struct bitmap_cache_entry *
+find_decoded (const char *filename, const struct file_id *id)
+{
+  struct bitmap_cache_entry **p, *entry;
+
+  for (p = &bitmap_cache; (entry = *p); p = &entry->next)
+    {
+      if (! entry->filename || grub_strcmp (entry->filename, filename) != 0)
+	continue;
+
+      if (entry->id.size != id->size || entry->id.mtimeset != id->mtimeset
+	  || entry->id.mtime != id->mtime)
+	{
+	  drop_entry (p);
+	  return 0;
+	}
+
+      entry->last_use = ++bitmap_cache_clock;
+      return entry;
+    }
+
+  return 0;
+}
+
+/* Find the entry holding the decoded bitmap BITMAP.  */
+static struct bitmap_cache_entry *
+find_source (struct grub_video_bitmap *bitmap)
+{
+  struct bitmap_cache_entry *entry;
+
+  for (entry = bitmap_cache; entry; entry = entry->next)
+    if (entry->filename && entry->bitmap == bitmap)
+      return entry;
+
+  return 0;
+}
+
+/* Add an entry holding a reference to BITMAP to the cache, evicting the
+   least recently used entries to stay within BITMAP_CACHE_MAX_BYTES.
+   Failing to cache it is not an error.  */
+static struct bitmap_cache_entry *
+insert_entry (struct grub_video_bitmap *bitmap)
+{
+  struct bitmap_cache_entry *entry;
+  grub_size_t bytes;
+
+  bytes = bitmap->mode_info.pitch * bitmap->mode_info.height;
+  if (bytes > BITMAP_CACHE_MAX_BYTES)
+    return 0;
+
+  while (bitmap_cache_bytes + bytes > BITMAP_CACHE_MAX_BYTES)
+    {
+      struct bitmap_cache_entry **p, **oldest;
+
+      oldest = &bitmap_cache;
+      for (p = &bitmap_cache; *p; p = &(*p)->next)
+	if ((*p)->last_use < (*oldest)->last_use)
+	  oldest = p;
+
+      drop_entry (oldest);
+    }
+
+  entry = grub_zalloc (sizeof (*entry));
+  if (! entry)
+    {
+      grub_errno = GRUB_ERR_NONE;
+      return 0;
+    }
+
+  entry->bitmap = grub_video_bitmap_ref (bitmap);
+  entry->bytes = bytes;
+  entry->last_use = ++bitmap_cache_clock;
+
+  entry->next = bitmap_cache;
+  bitmap_cache = entry;
+  bitmap_cache_bytes += bytes;
+
+  return entry;
+}
+
+grub_err_t
+grub_video_bitmap_load_cached (struct grub_video_bitmap **bitmap,
+			       const char *filename)
+{
+  struct bitmap_cache_entry *entry;
+  struct file_id id;
+
+  if (! bitmap)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, "invalid argument");
+
+  *bitmap = 0;
+
+  if (get_file_id (filename, &id) != GRUB_ERR_NONE)
+    return grub_errno;
+
+  entry = find_decoded (filename, &id);
+  if (entry)
+    {
+      *bitmap = grub_video_bitmap_ref (entry->bitmap);
+      return GRUB_ERR_NONE;
+    }
+
+  if (grub_video_bitmap_load (bitmap, filename) != GRUB_ERR_NONE)
+    {
+      if (grub_errno != GRUB_ERR_OUT_OF_MEMORY || ! bitmap_cache)
+	return grub_errno;
+
+      /* Make room by dropping the cache and try again.  */
+      grub_errno = GRUB_ERR_NONE;
+      grub_video_bitmap_cache_flush ();
+      if (grub_video_bitmap_load (bitmap, filename) != GRUB_ERR_NONE)
+	return grub_errno;
+    }
+
+  entry = insert_entry (*bitmap);
+  if (entry)
+    {
+      entry->filename = grub_strdup (filename);
+      if (! entry->filename)
+	{
+	  /* Without a name it could not be found anyway.  */
+	  grub_errno = GRUB_ERR_NONE;
+	  drop_entry (&bitmap_cache);
+	  return GRUB_ERR_NONE;
+	}
+      entry->id = id;
+    }
+
+  return GRUB_ERR_NONE;
+}
+
+grub_err_t
+grub_video_bitmap_scale_cached (struct grub_video_bitmap **dst,
+				int dst_width, int dst_height,
+				struct grub_video_bitmap *src,
+				enum grub_video_bitmap_scale_method scale_method)
+{
+  struct bitmap_cache_entry **p, *entry, *source;
+
+  if (! dst || ! src || dst_width <= 0 || dst_height <= 0)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, "invalid argument");
+
+  *dst = 0;
+
+  /* Already the right size.  */
+  if ((int) src->mode_info.width == dst_width
+      && (int) src->mode_info.height == dst_height)
+    {
+      *dst = grub_video_bitmap_ref (src);
+      return GRUB_ERR_NONE;
+    }
+
+  /* Only the last size SRC was scaled to is kept, so that a bitmap
+     resized over and over, like a progress bar's, takes one entry.  */
+  for (p = &bitmap_cache; (entry = *p); p = &entry->next)
+    if (entry->source == src && entry->scale_method == scale_method)
+      {
+	if (entry->width == dst_width && entry->height == dst_height)
+	  {
+	    entry->last_use = ++bitmap_cache_clock;
+	    *dst = grub_video_bitmap_ref (entry->bitmap);
+	    return GRUB_ERR_NONE;
+	  }
+
+	drop_entry (p);
+	break;
+      }
+
+  if (grub_video_bitmap_create_scaled (dst, dst_width, dst_height, src,
+				       scale_method) != GRUB_ERR_NONE)
+    {
+      if (grub_errno != GRUB_ERR_OUT_OF_MEMORY || ! bitmap_cache)
+	return grub_errno;
+
+      grub_errno = GRUB_ERR_NONE;
+      grub_video_bitmap_cache_flush ();
+      if (grub_video_bitmap_create_scaled (dst, dst_width, dst_height, src,
+					   scale_method) != GRUB_ERR_NONE)
+	return grub_errno;
+    }
+
+  /* Only bitmaps scaled from a cached decoded bitmap are cached, so that
+     their sources count towards the budget.  */
+  source = find_source (src);
+  if (! source)
+    return GRUB_ERR_NONE;
+
+  source->last_use = ++bitmap_cache_clock;
+  entry = insert_entry (*dst);
+  if (! entry)
+    return GRUB_ERR_NONE;
+
+  entry->source = src;
+  entry->width = dst_width;
+  entry->height = dst_height;
+  entry->scale_method = scale_method;
+
+  /* Making room may have evicted the source.  */
+  if (! find_source (src))
+    drop_entry (&bitmap_cache);
+
+  return GRUB_ERR_NONE;
+}
+
+grub_err_t
+grub_video_bitmap_load_scaled (struct grub_video_bitmap **bitmap,
+			       const char *filename, int width, int height,
+			       enum grub_video_bitmap_scale_method scale_method)
+{
+  struct grub_video_bitmap *raw;
+
+  if (! bitmap || width <= 0 || height <= 0)
+    return grub_error (GRUB_ERR_BAD_ARGUMENT, "invalid argument");
+
+  *bitmap = 0;
+
+  if (grub_video_bitmap_load_cached (&raw, filename) != GRUB_ERR_NONE)
+    return grub_errno;
+
+  grub_video_bitmap_scale_cached (bitmap, width, height, raw, scale_method);
+  grub_video_bitmap_destroy (raw);
+
+  return grub_errno;
+}
+
+void
+grub_video_bitmap_cache_flush (void)
+{
+  while (bitmap_cache)
+    drop_entry (&bitmap_cache);
+}
+
+static grub_err_t
+bitmap_cache_preboot (int noreturn __attribute__ ((unused)))
+{
+  grub_video_bitmap_cache_flush ();
+  return GRUB_ERR_NONE;
+}
+
+static grub_err_t
+bitmap_cache_preboot_rest (void)
+{
+  return GRUB_ERR_NONE;
+}
+
+static void *preboot_hook;
+
+GRUB_MOD_INIT(bitmap_cache)
+{
+  /* Release the cache before booting, rather than leave the loaded
+     kernel to start with its memory still allocated.  */
+  preboot_hook
+    = grub_loader_register_preboot_hook (bitmap_cache_preboot,
+					 bitmap_cache_preboot_rest,
+					 GRUB_LOADER_PREBOOT_HOOK_PRIO_NORMAL);
+}
+
+GRUB_MOD_FINI(bitmap_cache)
+{
+  grub_loader_unregister_preboot_hook (preboot_hook);
+  preboot_hook = 0;
+  grub_video_bitmap_cache_flush ();
+}
@@ -34,7 +34,228 @@
 #include <grub/types.h>
 #include <grub/video.h>
 
-/* Generic replacing blitter (slow).  Works for every supported format.  */
+/* Exchange the red and blue components of a 32-bit pixel.  */
+#define SWAP_RB(color)	(((color) & 0xff00ff00) | (((color) >> 16) & 0xff) \
+			 | (((color) & 0xff) << 16))
+
+/* Number of pixels converted at a time by the generic blitters.  */
+#define GRUB_VIDEO_FBBLIT_CHUNK	64
+
+/* Read COUNT pixels from X, Y of SRC into COLORS.  */
+static void
+get_scanline (struct grub_video_fbblit_info *src, int x, int y, int count,
+	      grub_video_color_t *colors)
+{
+  int i;
+
+  switch (src->mode_info->bpp)
+    {
+    case 32:
+      {
+	grub_uint32_t *ptr;
+
+	ptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, x, y);
+	for (i = 0; i < count; i++)
+	  colors[i] = *ptr++;
+      }
+      break;
+
+    case 24:
+      {
+	grub_uint8_t *ptr = grub_video_fb_get_video_ptr (src, x, y);
+
+	for (i = 0; i < count; i++, ptr += 3)
+	  colors[i] = ptr[0] | (ptr[1] << 8) | (ptr[2] << 16);
+      }
+      break;
+
+    case 16:
+    case 15:
+      {
+	grub_uint16_t *ptr;
+
+	ptr = (grub_uint16_t *) grub_video_fb_get_video_ptr (src, x, y);
+	for (i = 0; i < count; i++)
+	  colors[i] = *ptr++;
+      }
+      break;
+
+    case 8:
+      {
+	grub_uint8_t *ptr = grub_video_fb_get_video_ptr (src, x, y);
+
+	for (i = 0; i < count; i++)
+	  colors[i] = *ptr++;
+      }
+      break;
+
+    default:
+      for (i = 0; i < count; i++)
+	colors[i] = get_pixel (src, x + i, y);
+      break;
+    }
+}
+
+/* Write COUNT pixels from COLORS to X, Y of DST.  */
+static void
+set_scanline (struct grub_video_fbblit_info *dst, int x, int y, int count,
+	      const grub_video_color_t *colors)
+{
+  int i;
+
+  switch (dst->mode_info->bpp)
+    {
+    case 32:
+      {
+	grub_uint32_t *ptr;
+
+	ptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (dst, x, y);
+	for (i = 0; i < count; i++)
+	  *ptr++ = colors[i];
+      }
+      break;
+
+    case 24:
+      {
+	grub_uint8_t *ptr = grub_video_fb_get_video_ptr (dst, x, y);
+
+	for (i = 0; i < count; i++)
+	  {
+	    *ptr++ = colors[i];
+	    *ptr++ = colors[i] >> 8;
+	    *ptr++ = colors[i] >> 16;
+	  }
+      }
+      break;
+
+    case 16:
+    case 15:
+      {
+	grub_uint16_t *ptr;
+
+	ptr = (grub_uint16_t *) grub_video_fb_get_video_ptr (dst, x, y);
+	for (i = 0; i < count; i++)
+	  *ptr++ = colors[i];
+      }
+      break;
+
+    case 8:
+      {
+	grub_uint8_t *ptr = grub_video_fb_get_video_ptr (dst, x, y);
+
+	for (i = 0; i < count; i++)
+	  *ptr++ = colors[i];
+      }
+      break;
+
+    default:
+      for (i = 0; i < count; i++)
+	set_pixel (dst, x + i, y, colors[i]);
+      break;
+    }
+}
+
+/* Convert WIDTH pixels from 24-bit SRC to 32-bit DST with opaque alpha,
+   exchanging red and blue if SWAP.  Four pixels are loaded as three
+   words once SRC is aligned.  */
+static inline void
+unpack_24 (grub_uint32_t *dst, const grub_uint8_t *src, int width, int swap)
+{
+  grub_uint32_t c0, c1, c2, c3;
+
+  while (width && ((grub_addr_t) src & 3))
+    {
+      c0 = src[0] | (src[1] << 8) | (src[2] << 16);
+      if (swap)
+	c0 = SWAP_RB (c0);
+      *dst++ = grub_cpu_to_le32 (c0 | 0xff000000);
+      src += 3;
+      width--;
+    }
+
+  for (; width >= 4; width -= 4, src += 12, dst += 4)
+    {
+      grub_uint32_t w0 = grub_le_to_cpu32 (((const grub_uint32_t *) src)[0]);
+      grub_uint32_t w1 = grub_le_to_cpu32 (((const grub_uint32_t *) src)[1]);
+      grub_uint32_t w2 = grub_le_to_cpu32 (((const grub_uint32_t *) src)[2]);
+
+      c0 = w0 & 0xffffff;
+      c1 = (w0 >> 24) | ((w1 & 0xffff) << 8);
+      c2 = (w1 >> 16) | ((w2 & 0xff) << 16);
+      c3 = w2 >> 8;
+      if (swap)
+	{
+	  c0 = SWAP_RB (c0);
+	  c1 = SWAP_RB (c1);
+	  c2 = SWAP_RB (c2);
+	  c3 = SWAP_RB (c3);
+	}
+      dst[0] = grub_cpu_to_le32 (c0 | 0xff000000);
+      dst[1] = grub_cpu_to_le32 (c1 | 0xff000000);
+      dst[2] = grub_cpu_to_le32 (c2 | 0xff000000);
+      dst[3] = grub_cpu_to_le32 (c3 | 0xff000000);
+    }
+
+  for (; width; width--, src += 3)
+    {
+      c0 = src[0] | (src[1] << 8) | (src[2] << 16);
+      if (swap)
+	c0 = SWAP_RB (c0);
+      *dst++ = grub_cpu_to_le32 (c0 | 0xff000000);
+    }
+}
+
+/* Convert WIDTH pixels from 32-bit SRC to 24-bit DST, exchanging red and
+   blue if SWAP.  Four pixels are stored as three words once DST is
+   aligned.  */
+static inline void
+pack_24 (grub_uint8_t *dst, const grub_uint32_t *src, int width, int swap)
+{
+  grub_uint32_t c0, c1, c2, c3;
+
+  while (width && ((grub_addr_t) dst & 3))
+    {
+      c0 = grub_le_to_cpu32 (*src++);
+      if (swap)
+	c0 = SWAP_RB (c0);
+      *dst++ = c0;
+      *dst++ = c0 >> 8;
+      *dst++ = c0 >> 16;
+      width--;
+    }
+
+  for (; width >= 4; width -= 4, src += 4, dst += 12)
+    {
+      c0 = grub_le_to_cpu32 (src[0]) & 0xffffff;
+      c1 = grub_le_to_cpu32 (src[1]) & 0xffffff;
+      c2 = grub_le_to_cpu32 (src[2]) & 0xffffff;
+      c3 = grub_le_to_cpu32 (src[3]) & 0xffffff;
+      if (swap)
+	{
+	  c0 = SWAP_RB (c0);
+	  c1 = SWAP_RB (c1);
+	  c2 = SWAP_RB (c2);
+	  c3 = SWAP_RB (c3);
+	}
+      ((grub_uint32_t *) dst)[0] = grub_cpu_to_le32 (c0 | (c1 << 24));
+      ((grub_uint32_t *) dst)[1] = grub_cpu_to_le32 ((c1 >> 8) | (c2 << 16));
+      ((grub_uint32_t *) dst)[2] = grub_cpu_to_le32 ((c2 >> 16) | (c3 << 8));
+    }
+
+  for (; width; width--)
+    {
+      c0 = grub_le_to_cpu32 (*src++);
+      if (swap)
+	c0 = SWAP_RB (c0);
+      *dst++ = c0;
+      *dst++ = c0 >> 8;
+      *dst++ = c0 >> 16;
+    }
+}
+
+/* Generic replacing blitter.  Works for every supported format.  Pixels
+   are converted a piece of scanline at a time, and runs of one color
+   are mapped once.  */
 void
 grub_video_fbblit_replace (struct grub_video_fbblit_info *dst,
 			   struct grub_video_fbblit_info *src,
@@ -43,26 +264,44 @@ grub_video_fbblit_replace (struct grub_video_fbblit_info *dst,
 {
   int i;
   int j;
+  int n;
   grub_uint8_t src_red;
   grub_uint8_t src_green;
   grub_uint8_t src_blue;
   grub_uint8_t src_alpha;
-  grub_video_color_t src_color;
-  grub_video_color_t dst_color;
+  grub_video_color_t colors[GRUB_VIDEO_FBBLIT_CHUNK];
+  grub_video_color_t last_src = 0;
+  grub_video_color_t last_dst = 0;
+  int have_last = 0;
 
   for (j = 0; j < height; j++)
     {
-      for (i = 0; i < width; i++)
+      for (i = 0; i < width; i += n)
 	{
-	  src_color = get_pixel (src, i + offset_x, j + offset_y);
+	  int k;
+
+	  n = width - i;
+	  if (n > GRUB_VIDEO_FBBLIT_CHUNK)
+	    n = GRUB_VIDEO_FBBLIT_CHUNK;
 
-	  grub_video_fb_unmap_color_int (src, src_color, &src_red, &src_green,
-					 &src_blue, &src_alpha);
+	  get_scanline (src, offset_x + i, offset_y + j, n, colors);
 
-	  dst_color = grub_video_fb_map_rgba (src_red, src_green,
-					      src_blue, src_alpha);
+	  for (k = 0; k < n; k++)
+	    {
+	      if (! have_last || colors[k] != last_src)
+		{
+		  last_src = colors[k];
+		  grub_video_fb_unmap_color_int (src, last_src, &src_red,
+						 &src_green, &src_blue,
+						 &src_alpha);
+		  last_dst = grub_video_fb_map_rgba (src_red, src_green,
+						     src_blue, src_alpha);
+		  have_last = 1;
+		}
+	      colors[k] = last_dst;
+	    }
 
-	  set_pixel (dst, x + i, y + j, dst_color);
+	  set_scanline (dst, x + i, y + j, n, colors);
 	}
     }
 }
@@ -396,36 +635,21 @@ grub_video_fbblit_replace_BGRX8888_RGBX8888 (struct grub_video_fbblit_info *dst,
 {
   int i;
   int j;
-  grub_uint8_t *srcptr;
-  grub_uint8_t *dstptr;
-  unsigned int srcrowskip;
-  unsigned int dstrowskip;
-
-  /* Calculate the number of bytes to advance from the end of one line
-     to the beginning of the next line.  */
-  srcrowskip = src->mode_info->pitch - src->mode_info->bytes_per_pixel * width;
-  dstrowskip = dst->mode_info->pitch - dst->mode_info->bytes_per_pixel * width;
-
-  srcptr = (grub_uint8_t *) grub_video_fb_get_video_ptr (src, offset_x, offset_y);
-  dstptr = (grub_uint8_t *) grub_video_fb_get_video_ptr (dst, x, y);
+  grub_uint32_t *srcptr;
+  grub_uint32_t *dstptr;
+  grub_uint32_t color;
 
   for (j = 0; j < height; j++)
     {
-      for (i = 0; i < width; i++)
-        {
-          grub_uint8_t r = *srcptr++;
-          grub_uint8_t g = *srcptr++;
-          grub_uint8_t b = *srcptr++;
-          grub_uint8_t a = *srcptr++;
-
-          *dstptr++ = b;
-          *dstptr++ = g;
-          *dstptr++ = r;
-          *dstptr++ = a;
-        }
+      srcptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x,
+							      offset_y + j);
+      dstptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (dst, x, y + j);
 
-      srcptr += srcrowskip;
-      dstptr += dstrowskip;
+      for (i = 0; i < width; i++)
+	{
+	  color = grub_le_to_cpu32 (*srcptr++);
+	  *dstptr++ = grub_cpu_to_le32 (SWAP_RB (color));
+	}
     }
 }
 
@@ -437,40 +661,12 @@ grub_video_fbblit_replace_BGRX8888_RGB888 (struct grub_video_fbblit_info *dst,
 					   int width, int height,
 					   int offset_x, int offset_y)
 {
-  int i;
   int j;
-  grub_uint8_t *srcptr;
-  grub_uint8_t *dstptr;
-  unsigned int srcrowskip;
-  unsigned int dstrowskip;
-
-  /* Calculate the number of bytes to advance from the end of one line
-     to the beginning of the next line.  */
-  srcrowskip = src->mode_info->pitch - src->mode_info->bytes_per_pixel * width;
-  dstrowskip = dst->mode_info->pitch - dst->mode_info->bytes_per_pixel * width;
-
-  srcptr = (grub_uint8_t *) grub_video_fb_get_video_ptr (src, offset_x, offset_y);
-  dstptr = (grub_uint8_t *) grub_video_fb_get_video_ptr (dst, x, y);
 
   for (j = 0; j < height; j++)
-    {
-      for (i = 0; i < width; i++)
-        {
-          grub_uint8_t r = *srcptr++;
-          grub_uint8_t g = *srcptr++;
-          grub_uint8_t b = *srcptr++;
-
-          *dstptr++ = b;
-          *dstptr++ = g;
-          *dstptr++ = r;
-
-          /* Set alpha component as opaque.  */
-          *dstptr++ = 255;
-        }
-
-      srcptr += srcrowskip;
-      dstptr += dstrowskip;
-    }
+    unpack_24 ((grub_uint32_t *) grub_video_fb_get_video_ptr (dst, x, y + j),
+	       grub_video_fb_get_video_ptr (src, offset_x, offset_y + j),
+	       width, 1);
 }
 
 /* Optimized replacing blitter for RGBX8888 to BGR888.  */
@@ -481,44 +677,13 @@ grub_video_fbblit_replace_BGR888_RGBX8888 (struct grub_video_fbblit_info *dst,
 					   int width, int height,
 					   int offset_x, int offset_y)
 {
-  grub_uint32_t *srcptr;
-  grub_uint8_t *dstptr;
-  unsigned int srcrowskip;
-  unsigned int dstrowskip;
-  int i;
   int j;
 
-  /* Calculate the number of bytes to advance from the end of one line
-     to the beginning of the next line.  */
-  srcrowskip = src->mode_info->pitch - src->mode_info->bytes_per_pixel * width;
-  dstrowskip = dst->mode_info->pitch - dst->mode_info->bytes_per_pixel * width;
-
-  srcptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x, offset_y);
-  dstptr = (grub_uint8_t *) grub_video_fb_get_video_ptr (dst, x, y);
-
   for (j = 0; j < height; j++)
-    {
-      for (i = 0; i < width; i++)
-        {
-          grub_uint32_t color;
-          grub_uint8_t sr;
-          grub_uint8_t sg;
-          grub_uint8_t sb;
-
-          color = *srcptr++;
-
-          sr = (color >> 0) & 0xFF;
-          sg = (color >> 8) & 0xFF;
-          sb = (color >> 16) & 0xFF;
-
-          *dstptr++ = sb;
-          *dstptr++ = sg;
-          *dstptr++ = sr;
-        }
-
-      srcptr = (grub_uint32_t *) (((grub_uint8_t *) srcptr) + srcrowskip);
-      dstptr += dstrowskip;
-    }
+    pack_24 (grub_video_fb_get_video_ptr (dst, x, y + j),
+	     (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x,
+							    offset_y + j),
+	     width, 1);
 }
 
 /* Optimized replacing blitter for RGB888 to BGR888.  */
@@ -570,32 +735,12 @@ grub_video_fbblit_replace_RGBX8888_RGB888 (struct grub_video_fbblit_info *dst,
 					   int width, int height,
 					   int offset_x, int offset_y)
 {
-  grub_uint32_t color;
-  int i;
   int j;
-  grub_uint8_t *srcptr;
-  grub_uint32_t *dstptr;
-  unsigned int sr;
-  unsigned int sg;
-  unsigned int sb;
 
   for (j = 0; j < height; j++)
-    {
-      srcptr = (grub_uint8_t *)grub_video_fb_get_video_ptr (src, offset_x, j + offset_y);
-      dstptr = (grub_uint32_t *)grub_video_fb_get_video_ptr (dst, x, y + j);
-
-      for (i = 0; i < width; i++)
-        {
-          sr = *srcptr++;
-          sg = *srcptr++;
-          sb = *srcptr++;
-
-          /* Set alpha as opaque.  */
-          color = 0xFF000000 | (sb << 16) | (sg << 8) | sr;
-
-          *dstptr++ = color;
-        }
-    }
+    unpack_24 ((grub_uint32_t *) grub_video_fb_get_video_ptr (dst, x, y + j),
+	       grub_video_fb_get_video_ptr (src, offset_x, offset_y + j),
+	       width, 0);
 }
 
 /* Optimized replacing blitter for RGBX8888 to RGB888.  */
@@ -606,33 +751,13 @@ grub_video_fbblit_replace_RGB888_RGBX8888 (struct grub_video_fbblit_info *dst,
 					   int width, int height,
 					   int offset_x, int offset_y)
 {
-  grub_uint32_t color;
-  int i;
   int j;
-  grub_uint32_t *srcptr;
-  grub_uint8_t *dstptr;
-  unsigned int sr;
-  unsigned int sg;
-  unsigned int sb;
 
   for (j = 0; j < height; j++)
-    {
-      srcptr = (grub_uint32_t *)grub_video_fb_get_video_ptr (src, offset_x, j + offset_y);
-      dstptr = (grub_uint8_t *)grub_video_fb_get_video_ptr (dst, x, y + j);
-
-      for (i = 0; i < width; i++)
-	{
-	  color = *srcptr++;
-
-	  sr = (color >> 0) & 0xFF;
-	  sg = (color >> 8) & 0xFF;
-	  sb = (color >> 16) & 0xFF;
-
-	  *dstptr++ = sr;
-	  *dstptr++ = sg;
-	  *dstptr++ = sb;
-	}
-    }
+    pack_24 (grub_video_fb_get_video_ptr (dst, x, y + j),
+	     (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x,
+							    offset_y + j),
+	     width, 0);
 }
 
 /* Optimized replacing blitter for RGBX8888 to indexed color.  */
@@ -651,6 +776,9 @@ grub_video_fbblit_replace_index_RGBX8888 (struct grub_video_fbblit_info *dst,
   unsigned int sr;
   unsigned int sg;
   unsigned int sb;
+  grub_uint32_t last_src = 0;
+  grub_video_color_t last_dst = 0;
+  int have_last = 0;
 
   for (j = 0; j < height; j++)
     {
@@ -661,12 +789,19 @@ grub_video_fbblit_replace_index_RGBX8888 (struct grub_video_fbblit_info *dst,
 	{
 	  color = *srcptr++;
 
-	  sr = (color >> 0) & 0xFF;
-	  sg = (color >> 8) & 0xFF;
-	  sb = (color >> 16) & 0xFF;
+	  /* Searching the palette is slow, so map runs of one color
+	     once.  */
+	  if (! have_last || (color & 0xffffff) != last_src)
+	    {
+	      last_src = color & 0xffffff;
+	      sr = (color >> 0) & 0xFF;
+	      sg = (color >> 8) & 0xFF;
+	      sb = (color >> 16) & 0xFF;
 
-	  color = grub_video_fb_map_rgb(sr, sg, sb);
-	  *dstptr++ = color & 0xFF;
+	      last_dst = grub_video_fb_map_rgb (sr, sg, sb);
+	      have_last = 1;
+	    }
+	  *dstptr++ = last_dst & 0xFF;
 	}
     }
 }
@@ -687,6 +822,9 @@ grub_video_fbblit_replace_index_RGB888 (struct grub_video_fbblit_info *dst,
   unsigned int sr;
   unsigned int sg;
   unsigned int sb;
+  grub_uint32_t last_src = 0;
+  grub_video_color_t last_dst = 0;
+  int have_last = 0;
 
   for (j = 0; j < height; j++)
     {
@@ -699,14 +837,61 @@ grub_video_fbblit_replace_index_RGB888 (struct grub_video_fbblit_info *dst,
           sg = *srcptr++;
           sb = *srcptr++;
 
-          color = grub_video_fb_map_rgb(sr, sg, sb);
+          /* Searching the palette is slow, so map runs of one color
+             once.  */
+          color = sr | (sg << 8) | (sb << 16);
+          if (! have_last || color != last_src)
+            {
+              last_src = color;
+              last_dst = grub_video_fb_map_rgb (sr, sg, sb);
+              have_last = 1;
+            }
 
-          *dstptr++ = color & 0xFF;
+          *dstptr++ = last_dst & 0xFF;
         }
     }
 }
 
-/* Generic blending blitter.  Works for every supported format.  */
+/* Divide X, at most 255 * 255, by 255 exactly, without dividing.  */
+#define DIV255(x)	(((x) + 1 + ((x) >> 8)) >> 8)
+
+/* Blend the color components of the 32-bit pixel SRC over DST with
+   alpha A, which must be 1 to 254.  Bytes 0 and 2 are blended together
+   in one word; their sums never carry into each other.  Byte 3 of the
+   result is zero.  */
+static inline grub_uint32_t
+blend_color_32 (grub_uint32_t src, grub_uint32_t dst, unsigned int a)
+{
+  grub_uint32_t rb;
+  grub_uint32_t g;
+
+  rb = (src & 0x00ff00ff) * a + (dst & 0x00ff00ff) * (255 - a);
+  g = ((src >> 8) & 0xff) * a + ((dst >> 8) & 0xff) * (255 - a);
+
+  rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+  g = DIV255 (g);
+
+  return rb | (g << 8);
+}
+
+/* Return the length of the run of pixels starting at SRC, at most WIDTH
+   long, whose alpha is A.  */
+static inline int
+alpha_run (const grub_uint32_t *src, int width, unsigned int a)
+{
+  int n;
+
+  for (n = 1; n < width; n++)
+    if ((grub_le_to_cpu32 (src[n]) >> 24) != a)
+      break;
+
+  return n;
+}
+
+/* Generic blending blitter.  Works for every supported format.  Pixels
+   are handled a piece of scanline at a time, pieces which are wholly
+   transparent are not written back, and runs of one source color are
+   unmapped once.  */
 void
 grub_video_fbblit_blend (struct grub_video_fbblit_info *dst,
 			 struct grub_video_fbblit_info *src,
@@ -715,55 +900,82 @@ grub_video_fbblit_blend (struct grub_video_fbblit_info *dst,
 {
   int i;
   int j;
+  int n;
+  grub_uint8_t src_red = 0;
+  grub_uint8_t src_green = 0;
+  grub_uint8_t src_blue = 0;
+  grub_uint8_t src_alpha = 0;
+  grub_video_color_t src_colors[GRUB_VIDEO_FBBLIT_CHUNK];
+  grub_video_color_t dst_colors[GRUB_VIDEO_FBBLIT_CHUNK];
+  grub_video_color_t last_src = 0;
+  grub_video_color_t last_opaque = 0;
+  int have_last = 0;
 
   for (j = 0; j < height; j++)
     {
-      for (i = 0; i < width; i++)
-        {
-          grub_uint8_t src_red;
-          grub_uint8_t src_green;
-          grub_uint8_t src_blue;
-          grub_uint8_t src_alpha;
-          grub_uint8_t dst_red;
-          grub_uint8_t dst_green;
-          grub_uint8_t dst_blue;
-          grub_uint8_t dst_alpha;
-          grub_video_color_t src_color;
-          grub_video_color_t dst_color;
-
-          src_color = get_pixel (src, i + offset_x, j + offset_y);
-          grub_video_fb_unmap_color_int (src, src_color, &src_red, &src_green,
-					 &src_blue, &src_alpha);
-
-          if (src_alpha == 0)
-            continue;
-
-          if (src_alpha == 255)
-            {
-              dst_color = grub_video_fb_map_rgba (src_red, src_green,
-						  src_blue, src_alpha);
-              set_pixel (dst, x + i, y + j, dst_color);
-              continue;
-            }
-
-          dst_color = get_pixel (dst, x + i, y + j);
+      for (i = 0; i < width; i += n)
+	{
+	  int k;
+	  int loaded = 0;
 
-          grub_video_fb_unmap_color_int (dst, dst_color, &dst_red,
-					 &dst_green, &dst_blue, &dst_alpha);
+	  n = width - i;
+	  if (n > GRUB_VIDEO_FBBLIT_CHUNK)
+	    n = GRUB_VIDEO_FBBLIT_CHUNK;
 
-          dst_red = (((src_red * src_alpha)
-                      + (dst_red * (255 - src_alpha))) / 255);
-          dst_green = (((src_green * src_alpha)
-                        + (dst_green * (255 - src_alpha))) / 255);
-          dst_blue = (((src_blue * src_alpha)
-                       + (dst_blue * (255 - src_alpha))) / 255);
+	  get_scanline (src, offset_x + i, offset_y + j, n, src_colors);
 
-          dst_alpha = src_alpha;
-          dst_color = grub_video_fb_map_rgba (dst_red, dst_green, dst_blue,
-					      dst_alpha);
+	  for (k = 0; k < n; k++)
+	    {
+	      grub_uint8_t dst_red;
+	      grub_uint8_t dst_green;
+	      grub_uint8_t dst_blue;
+	      grub_uint8_t dst_alpha;
+	      unsigned int a;
+
+	      if (! have_last || src_colors[k] != last_src)
+		{
+		  last_src = src_colors[k];
+		  grub_video_fb_unmap_color_int (src, last_src, &src_red,
+						 &src_green, &src_blue,
+						 &src_alpha);
+		  if (src_alpha == 255)
+		    last_opaque = grub_video_fb_map_rgba (src_red, src_green,
+							  src_blue, src_alpha);
+		  have_last = 1;
+		}
+
+	      if (src_alpha == 0)
+		continue;
+
+	      /* The destination is only read once something is to be
+		 drawn over it.  */
+	      if (! loaded)
+		{
+		  get_scanline (dst, x + i, y + j, n, dst_colors);
+		  loaded = 1;
+		}
+
+	      if (src_alpha == 255)
+		{
+		  dst_colors[k] = last_opaque;
+		  continue;
+		}
+
+	      grub_video_fb_unmap_color_int (dst, dst_colors[k], &dst_red,
+					     &dst_green, &dst_blue, &dst_alpha);
+
+	      a = src_alpha;
+	      dst_red = DIV255 (src_red * a + dst_red * (255 - a));
+	      dst_green = DIV255 (src_green * a + dst_green * (255 - a));
+	      dst_blue = DIV255 (src_blue * a + dst_blue * (255 - a));
+
+	      dst_colors[k] = grub_video_fb_map_rgba (dst_red, dst_green,
+						      dst_blue, src_alpha);
+	    }
 
-          set_pixel (dst, x + i, y + j, dst_color);
-        }
+	  if (loaded)
+	    set_scanline (dst, x + i, y + j, n, dst_colors);
+	}
     }
 }
 
@@ -777,74 +989,46 @@ grub_video_fbblit_blend_BGRA8888_RGBA8888 (struct grub_video_fbblit_info *dst,
 {
   grub_uint32_t *srcptr;
   grub_uint32_t *dstptr;
-  unsigned int srcrowskip;
-  unsigned int dstrowskip;
   int i;
   int j;
-
-  /* Calculate the number of bytes to advance from the end of one line
-     to the beginning of the next line.  */
-  srcrowskip = src->mode_info->pitch - src->mode_info->bytes_per_pixel * width;
-  dstrowskip = dst->mode_info->pitch - dst->mode_info->bytes_per_pixel * width;
-
-  srcptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x, offset_y);
-  dstptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (dst, x, y);
+  int n;
 
   for (j = 0; j < height; j++)
     {
-      for (i = 0; i < width; i++)
+      srcptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x, j + offset_y);
+      dstptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (dst, x, y + j);
+
+      for (i = 0; i < width; i += n)
         {
           grub_uint32_t color;
-          unsigned int sr;
-          unsigned int sg;
-          unsigned int sb;
           unsigned int a;
-          unsigned int dr;
-          unsigned int dg;
-          unsigned int db;
-
-          color = *srcptr++;
+          int k;
 
+          color = grub_le_to_cpu32 (srcptr[i]);
           a = color >> 24;
 
           if (a == 0)
             {
-              /* Skip transparent source pixels.  */
-              dstptr++;
+              /* Skip runs of transparent source pixels.  */
+              n = alpha_run (srcptr + i, width - i, 0);
               continue;
             }
 
-          sr = (color >> 0) & 0xFF;
-          sg = (color >> 8) & 0xFF;
-          sb = (color >> 16) & 0xFF;
-
           if (a == 255)
             {
-              /* Opaque pixel shortcut.  */
-              dr = sr;
-              dg = sg;
-              db = sb;
-            }
-          else
-            {
-              /* General pixel color blending.  */
-              color = *dstptr;
-
-              dr = (color >> 16) & 0xFF;
-              dr = (dr * (255 - a) + sr * a) / 255;
-              dg = (color >> 8) & 0xFF;
-              dg = (dg * (255 - a) + sg * a) / 255;
-              db = (color >> 0) & 0xFF;
-              db = (db * (255 - a) + sb * a) / 255;
+              /* Runs of opaque pixels only need their components
+                 exchanged.  */
+              n = alpha_run (srcptr + i, width - i, 255);
+              for (k = i; k < i + n; k++)
+                dstptr[k] = grub_cpu_to_le32 (SWAP_RB (grub_le_to_cpu32 (srcptr[k])));
+              continue;
             }
 
-          color = (a << 24) | (dr << 16) | (dg << 8) | db;
-
-          *dstptr++ = color;
+          n = 1;
+          color = blend_color_32 (SWAP_RB (color),
+                                  grub_le_to_cpu32 (dstptr[i]), a);
+          dstptr[i] = grub_cpu_to_le32 (color | (a << 24));
         }
-
-      srcptr = (grub_uint32_t *) (((grub_uint8_t *) srcptr) + srcrowskip);
-      dstptr = (grub_uint32_t *) (((grub_uint8_t *) dstptr) + dstrowskip);
     }
 }
 
@@ -858,74 +1042,47 @@ grub_video_fbblit_blend_BGR888_RGBA8888 (struct grub_video_fbblit_info *dst,
 {
   grub_uint32_t *srcptr;
   grub_uint8_t *dstptr;
-  unsigned int srcrowskip;
-  unsigned int dstrowskip;
   int i;
   int j;
-
-  /* Calculate the number of bytes to advance from the end of one line
-     to the beginning of the next line.  */
-  srcrowskip = src->mode_info->pitch - src->mode_info->bytes_per_pixel * width;
-  dstrowskip = dst->mode_info->pitch - dst->mode_info->bytes_per_pixel * width;
-
-  srcptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x, offset_y);
-  dstptr = (grub_uint8_t *) grub_video_fb_get_video_ptr (dst, x, y);
+  int n;
 
   for (j = 0; j < height; j++)
     {
-      for (i = 0; i < width; i++)
+      srcptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x, j + offset_y);
+      dstptr = (grub_uint8_t *) grub_video_fb_get_video_ptr (dst, x, y + j);
+
+      for (i = 0; i < width; i += n)
         {
           grub_uint32_t color;
-          unsigned int sr;
-          unsigned int sg;
-          unsigned int sb;
+          grub_uint8_t *d;
           unsigned int a;
-          unsigned int dr;
-          unsigned int dg;
-          unsigned int db;
-
-          color = *srcptr++;
 
+          color = grub_le_to_cpu32 (srcptr[i]);
           a = color >> 24;
 
           if (a == 0)
             {
-              /* Skip transparent source pixels.  */
-              dstptr += 3;
+              /* Skip runs of transparent source pixels.  */
+              n = alpha_run (srcptr + i, width - i, 0);
               continue;
             }
 
-          sr = (color >> 0) & 0xFF;
-          sg = (color >> 8) & 0xFF;
-          sb = (color >> 16) & 0xFF;
-
           if (a == 255)
             {
-              /* Opaque pixel shortcut.  */
-              dr = sr;
-              dg = sg;
-              db = sb;
-            }
-          else
-            {
-              /* General pixel color blending.  */
-              color = *dstptr;
-
-              db = dstptr[0];
-              db = (db * (255 - a) + sb * a) / 255;
-              dg = dstptr[1];
-              dg = (dg * (255 - a) + sg * a) / 255;
-              dr = dstptr[2];
-              dr = (dr * (255 - a) + sr * a) / 255;
+              /* Runs of opaque pixels are packed a word at a time.  */
+              n = alpha_run (srcptr + i, width - i, 255);
+              pack_24 (dstptr + 3 * i, srcptr + i, n, 1);
+              continue;
             }
 
-          *dstptr++ = db;
-          *dstptr++ = dg;
-          *dstptr++ = dr;
+          n = 1;
+          d = dstptr + 3 * i;
+          color = blend_color_32 (SWAP_RB (color),
+                                  d[0] | (d[1] << 8) | (d[2] << 16), a);
+          d[0] = color;
+          d[1] = color >> 8;
+          d[2] = color >> 16;
         }
-
-      srcptr = (grub_uint32_t *) (((grub_uint8_t *) srcptr) + srcrowskip);
-      dstptr += dstrowskip;
     }
 }
 
@@ -937,59 +1094,43 @@ grub_video_fbblit_blend_RGBA8888_RGBA8888 (struct grub_video_fbblit_info *dst,
 					   int width, int height,
 					   int offset_x, int offset_y)
 {
-  grub_uint32_t color;
-  int i;
-  int j;
   grub_uint32_t *srcptr;
   grub_uint32_t *dstptr;
-  unsigned int sr;
-  unsigned int sg;
-  unsigned int sb;
-  unsigned int a;
-  unsigned int dr;
-  unsigned int dg;
-  unsigned int db;
+  int i;
+  int j;
+  int n;
 
   for (j = 0; j < height; j++)
     {
-      srcptr = (grub_uint32_t *)grub_video_fb_get_video_ptr (src, offset_x, j + offset_y);
-      dstptr = (grub_uint32_t *)grub_video_fb_get_video_ptr (dst, x, y + j);
+      srcptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x, j + offset_y);
+      dstptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (dst, x, y + j);
 
-      for (i = 0; i < width; i++)
+      for (i = 0; i < width; i += n)
         {
-          color = *srcptr++;
+          grub_uint32_t color;
+          unsigned int a;
 
+          color = grub_le_to_cpu32 (srcptr[i]);
           a = color >> 24;
 
           if (a == 0)
             {
-              dstptr++;
+              /* Skip runs of transparent source pixels.  */
+              n = alpha_run (srcptr + i, width - i, 0);
               continue;
             }
 
           if (a == 255)
             {
-              *dstptr++ = color;
+              /* Runs of opaque pixels are copied as they are.  */
+              n = alpha_run (srcptr + i, width - i, 255);
+              grub_memmove (dstptr + i, srcptr + i, n * 4);
               continue;
             }
 
-          sr = (color >> 0) & 0xFF;
-          sg = (color >> 8) & 0xFF;
-          sb = (color >> 16) & 0xFF;
-
-          color = *dstptr;
-
-          dr = (color >> 0) & 0xFF;
-          dg = (color >> 8) & 0xFF;
-          db = (color >> 16) & 0xFF;
-
-          dr = (dr * (255 - a) + sr * a) / 255;
-          dg = (dg * (255 - a) + sg * a) / 255;
-          db = (db * (255 - a) + sb * a) / 255;
-
-          color = (a << 24) | (db << 16) | (dg << 8) | dr;
-
-          *dstptr++ = color;
+          n = 1;
+          color = blend_color_32 (color, grub_le_to_cpu32 (dstptr[i]), a);
+          dstptr[i] = grub_cpu_to_le32 (color | (a << 24));
         }
     }
 }
@@ -1002,60 +1143,47 @@ grub_video_fbblit_blend_RGB888_RGBA8888 (struct grub_video_fbblit_info *dst,
 					 int width, int height,
 					 int offset_x, int offset_y)
 {
-  grub_uint32_t color;
-  int i;
-  int j;
   grub_uint32_t *srcptr;
   grub_uint8_t *dstptr;
-  unsigned int sr;
-  unsigned int sg;
-  unsigned int sb;
-  unsigned int a;
-  unsigned int dr;
-  unsigned int dg;
-  unsigned int db;
+  int i;
+  int j;
+  int n;
 
   for (j = 0; j < height; j++)
     {
-      srcptr = (grub_uint32_t *)grub_video_fb_get_video_ptr (src, offset_x, j + offset_y);
-      dstptr = (grub_uint8_t *)grub_video_fb_get_video_ptr (dst, x, y + j);
+      srcptr = (grub_uint32_t *) grub_video_fb_get_video_ptr (src, offset_x, j + offset_y);
+      dstptr = (grub_uint8_t *) grub_video_fb_get_video_ptr (dst, x, y + j);
 
-      for (i = 0; i < width; i++)
+      for (i = 0; i < width; i += n)
         {
-          color = *srcptr++;
+          grub_uint32_t color;
+          grub_uint8_t *d;
+          unsigned int a;
 
+          color = grub_le_to_cpu32 (srcptr[i]);
           a = color >> 24;
 
           if (a == 0)
             {
-              dstptr += 3;
+              /* Skip runs of transparent source pixels.  */
+              n = alpha_run (srcptr + i, width - i, 0);
               continue;
             }
 
-          sr = (color >> 0) & 0xFF;
-          sg = (color >> 8) & 0xFF;
-          sb = (color >> 16) & 0xFF;
-
           if (a == 255)
             {
-              *dstptr++ = sr;
-              *dstptr++ = sg;
-              *dstptr++ = sb;
-
+              /* Runs of opaque pixels are packed a word at a time.  */
+              n = alpha_run (srcptr + i, width - i, 255);
+              pack_24 (dstptr + 3 * i, srcptr + i, n, 0);
               continue;
             }
 
-          dr = dstptr[0];
-          dg = dstptr[1];
-          db = dstptr[2];
-
-          dr = (dr * (255 - a) + sr * a) / 255;
-          dg = (dg * (255 - a) + sg * a) / 255;
-          db = (db * (255 - a) + sb * a) / 255;
-
-          *dstptr++ = dr;
-          *dstptr++ = dg;
-          *dstptr++ = db;
+          n = 1;
+          d = dstptr + 3 * i;
+          color = blend_color_32 (color, d[0] | (d[1] << 8) | (d[2] << 16), a);
+          d[0] = color;
+          d[1] = color >> 8;
+          d[2] = color >> 16;
         }
     }
 }
@@ -1112,9 +1240,9 @@ grub_video_fbblit_blend_index_RGBA8888 (struct grub_video_fbblit_info *dst,
 
           grub_video_fb_unmap_color_int (dst, *dstptr, &dr, &dg, &db, &da);
 
-          dr = (dr * (255 - a) + sr * a) / 255;
-          dg = (dg * (255 - a) + sg * a) / 255;
-          db = (db * (255 - a) + sb * a) / 255;
+          dr = DIV255 (dr * (255 - a) + sr * a);
+          dg = DIV255 (dg * (255 - a) + sg * a);
+          db = DIV255 (db * (255 - a) + sb * a);
 
           color = grub_video_fb_map_rgb(dr, dg, db);
 
@@ -1187,9 +1315,9 @@ grub_video_fbblit_blend_XXXA8888_1bit (struct grub_video_fbblit_info *dst,
 	      grub_uint8_t d2 = (*(grub_uint32_t *) dstptr >> 8) & 0xFF;
 	      grub_uint8_t d3 = (*(grub_uint32_t *) dstptr >> 16) & 0xFF;
 
-	      d1 = (d1 * (255 - a) + s1 * a) / 255;
-	      d2 = (d2 * (255 - a) + s2 * a) / 255;
-	      d3 = (d3 * (255 - a) + s3 * a) / 255;
+	      d1 = DIV255 (d1 * (255 - a) + s1 * a);
+	      d2 = DIV255 (d2 * (255 - a) + s2 * a);
+	      d3 = DIV255 (d3 * (255 - a) + s3 * a);
 
 	      *(grub_uint32_t *) dstptr = (a << 24) | (d3 << 16) | (d2 << 8)
 		| d1;
@@ -1289,9 +1417,9 @@ grub_video_fbblit_blend_XXX888_1bit (struct grub_video_fbblit_info *dst,
 	      grub_uint8_t d2 = (*(grub_uint32_t *) dstptr >> 8) & 0xFF;
 	      grub_uint8_t d3 = (*(grub_uint32_t *) dstptr >> 16) & 0xFF;
 
-	      ((grub_uint8_t *) dstptr)[0] = (d1 * (255 - a) + s1 * a) / 255;
-	      ((grub_uint8_t *) dstptr)[1] = (d2 * (255 - a) + s2 * a) / 255;
-	      ((grub_uint8_t *) dstptr)[2] = (d3 * (255 - a) + s3 * a) / 255;
+	      ((grub_uint8_t *) dstptr)[0] = DIV255 (d1 * (255 - a) + s1 * a);
+	      ((grub_uint8_t *) dstptr)[1] = DIV255 (d2 * (255 - a) + s2 * a);
+	      ((grub_uint8_t *) dstptr)[2] = DIV255 (d3 * (255 - a) + s3 * a);
 	    }
 
 	  srcmask >>= 1;
@@ -1384,9 +1512,9 @@ grub_video_fbblit_blend_XXX565_1bit (struct grub_video_fbblit_info *dst,
 	      grub_uint8_t d2 = (*(grub_uint16_t *) dstptr >> 5) & 0x3F;
 	      grub_uint8_t d3 = (*(grub_uint16_t *) dstptr >> 11) & 0x1F;
 
-	      d1 = (d1 * (255 - a) + s1 * a) / 255;
-	      d2 = (d2 * (255 - a) + s2 * a) / 255;
-	      d3 = (d3 * (255 - a) + s3 * a) / 255;
+	      d1 = DIV255 (d1 * (255 - a) + s1 * a);
+	      d2 = DIV255 (d2 * (255 - a) + s2 * a);
+	      d3 = DIV255 (d3 * (255 - a) + s3 * a);
 
 	      *(grub_uint16_t *) dstptr = (d1 & 0x1f) | ((d2 & 0x3f) << 5)
 		| ((d3 & 0x1f) << 11);
@@ -399,6 +399,79 @@ grub_video_fb_unmap_color_int (struct grub_video_fbblit_info * source,
     }
 }
 
+/* Compute in *RESULT the smallest rectangle containing both A and B.  */
+static void
+grub_video_fb_union (struct grub_video_fb_damage *result,
+		     const struct grub_video_fb_damage *a,
+		     const struct grub_video_fb_damage *b)
+{
+  unsigned int x1, y1;
+
+  x1 = a->x + a->width;
+  if (b->x + b->width > x1)
+    x1 = b->x + b->width;
+  y1 = a->y + a->height;
+  if (b->y + b->height > y1)
+    y1 = b->y + b->height;
+
+  result->x = (a->x < b->x) ? a->x : b->x;
+  result->y = (a->y < b->y) ? a->y : b->y;
+  result->width = x1 - result->x;
+  result->height = y1 - result->y;
+}
+
+/* Record that the region of WIDTH x HEIGHT pixels at X, Y of TARGET,
+   in absolute coordinates, has been drawn to.  */
+static void
+grub_video_fb_add_damage (struct grub_video_fbrender_target *target,
+			  unsigned int x, unsigned int y,
+			  unsigned int width, unsigned int height)
+{
+  struct grub_video_fb_damage new = { x, y, width, height };
+  struct grub_video_fb_damage u;
+  unsigned int i;
+  unsigned int best = 0;
+  grub_uint64_t best_growth = ~0ULL;
+
+  if (width == 0 || height == 0)
+    return;
+
+  for (i = 0; i < target->damage_count; i++)
+    {
+      grub_uint64_t growth;
+
+      grub_video_fb_union (&u, &target->damage[i], &new);
+      growth = ((grub_uint64_t) u.width * u.height
+		- (grub_uint64_t) target->damage[i].width
+		* target->damage[i].height);
+
+      /* Merge right away if the union is no larger than the two
+	 areas added together, as when one contains the other or they
+	 are adjacent.  Overlapping regions may then also bring in up
+	 to as many pixels as they share.  */
+      if (growth <= (grub_uint64_t) width * height)
+	{
+	  target->damage[i] = u;
+	  return;
+	}
+
+      if (growth < best_growth)
+	{
+	  best = i;
+	  best_growth = growth;
+	}
+    }
+
+  if (target->damage_count < GRUB_VIDEO_FB_MAX_DAMAGE)
+    {
+      target->damage[target->damage_count++] = new;
+      return;
+    }
+
+  /* Otherwise grow the region which grows the least.  */
+  grub_video_fb_union (&target->damage[best], &target->damage[best], &new);
+}
+
 grub_err_t
 grub_video_fb_fill_rect (grub_video_color_t color, int x, int y,
 			 unsigned int width, unsigned int height)
@@ -432,6 +505,8 @@ grub_video_fb_fill_rect (grub_video_color_t color, int x, int y,
   x += render_target->viewport.x;
   y += render_target->viewport.y;
 
+  grub_video_fb_add_damage (render_target, x, y, width, height);
+
   /* Use fbblit_info to encapsulate rendering.  */
   target.mode_info = &render_target->mode_info;
   target.data = render_target->data;
@@ -827,6 +902,8 @@ grub_video_fb_blit_bitmap (struct grub_video_bitmap *bitmap,
   x += render_target->viewport.x;
   y += render_target->viewport.y;
 
+  grub_video_fb_add_damage (render_target, x, y, width, height);
+
   /* Use fbblit_info to encapsulate rendering.  */
   source.mode_info = &bitmap->mode_info;
   source.data = bitmap->data;
@@ -918,6 +995,8 @@ grub_video_fb_blit_render_target (struct grub_video_fbrender_target *source,
   x += render_target->viewport.x;
   y += render_target->viewport.y;
 
+  grub_video_fb_add_damage (render_target, x, y, width, height);
+
   /* Use fbblit_info to encapsulate rendering.  */
   source_info.mode_info = &source->mode_info;
   source_info.data = source->data;
@@ -982,6 +1061,8 @@ grub_video_fb_scroll (grub_video_color_t color, int dx, int dy)
       target.mode_info = &render_target->mode_info;
       target.data = render_target->data;
 
+      grub_video_fb_add_damage (render_target, dst_x, dst_y, width, height);
+
       linedelta = target.mode_info->pitch
 	- width * target.mode_info->bytes_per_pixel;
       linelen = width * target.mode_info->bytes_per_pixel;
@@ -1115,6 +1196,7 @@ grub_video_fb_create_render_target (struct grub_video_fbrender_target **result,
 
   /* Mark render target as allocated.  */
   target->is_allocated = 1;
+  target->damage_count = 0;
 
   /* Maximize viewport.  */
   target->viewport.x = 0;
@@ -1179,6 +1261,7 @@ grub_video_fb_create_render_target_from_pointer (struct grub_video_fbrender_targ
   /* Mark framebuffer memory as non allocated.  */
   target->is_allocated = 0;
   target->data = ptr;
+  target->damage_count = 0;
 
   grub_memcpy (&(target->mode_info), mode_info, sizeof (target->mode_info));
 
@@ -1238,12 +1321,45 @@ grub_video_fb_get_active_render_target (struct grub_video_fbrender_target **targ
   return GRUB_ERR_NONE;
 }
 
+/* Copy the regions of SRC drawn to since the last call to DST, which
+   must have the same mode, and forget about them.  */
+void
+grub_video_fb_copy_damage (struct grub_video_fbrender_target *dst,
+			   struct grub_video_fbrender_target *src)
+{
+  unsigned int bytes_per_pixel = src->mode_info.bytes_per_pixel;
+  unsigned int pitch = src->mode_info.pitch;
+  unsigned int i, y;
+
+  for (i = 0; i < src->damage_count; i++)
+    {
+      struct grub_video_fb_damage *d = &src->damage[i];
+      grub_size_t offset, len;
+
+      /* Copy whole lines if pixels are smaller than bytes.  */
+      if (bytes_per_pixel)
+	{
+	  offset = d->y * pitch + d->x * bytes_per_pixel;
+	  len = d->width * bytes_per_pixel;
+	}
+      else
+	{
+	  offset = d->y * pitch;
+	  len = pitch;
+	}
+
+      for (y = 0; y < d->height; y++, offset += pitch)
+	grub_memcpy (dst->data + offset, src->data + offset, len);
+    }
+
+  src->damage_count = 0;
+}
+
 static grub_err_t
 doublebuf_blit_update_screen (struct grub_video_fbrender_target *front,
 			      struct grub_video_fbrender_target *back)
 {
-  grub_memcpy (front->data, back->data,
-	       front->mode_info.pitch * front->mode_info.height);
+  grub_video_fb_copy_damage (front, back);
   return GRUB_ERR_NONE;
 }
 
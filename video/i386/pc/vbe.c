@@ -426,11 +426,11 @@ doublebuf_pageflipping_update_screen (struct grub_video_fbrender_target *front
       return err;
     }
 
+  /* Bring the new back buffer up to date with what was drawn to the
+     page now displayed.  */
   if (framebuffer.mode_info.mode_type & GRUB_VIDEO_MODE_TYPE_UPDATING_SWAP)
-    grub_memcpy (framebuffer.ptr + framebuffer.render_page
-		 * framebuffer.page_size, framebuffer.ptr
-		 + framebuffer.displayed_page * framebuffer.page_size,
-		 framebuffer.page_size);
+    grub_video_fb_copy_damage (framebuffer.front_target,
+			       framebuffer.back_target);
 
   target = framebuffer.back_target;
   framebuffer.back_target = framebuffer.front_target;
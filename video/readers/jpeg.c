@@ -23,6 +23,7 @@
 #include <grub/mm.h>
 #include <grub/misc.h>
 #include <grub/bufio.h>
+#include <grub/time.h>
 
 /* Uncomment following define to enable JPEG debug.  */
 //#define JPEG_DEBUG
@@ -43,6 +44,42 @@
 
 #define JPEG_UNIT_SIZE		8
 
+/* Fixed-point precision of the AAN IDCT: multipliers have 8 fraction
+   bits, and the prescaled quantization tables leave 2 extra bits in the
+   coefficients until the final descale.  */
+#define AAN_CONST_BITS		8
+#define AAN_PASS1_BITS		2
+#define AAN_MULTIPLY(v, c)	(((v) * (c)) >> AAN_CONST_BITS)
+#define AAN_1_082392200		277
+#define AAN_1_414213562		362
+#define AAN_1_847759065		473
+#define AAN_2_613125930		669
+
+/* Scale factors of the AAN IDCT, with 14 fraction bits, in natural
+   order.  They are folded into the quantization tables.  */
+static const grub_uint16_t jpeg_aan_scales[64] = {
+  16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+  22725, 31521, 29692, 26722, 22725, 17855, 12299, 6270,
+  21407, 29692, 27969, 25172, 21407, 16819, 11585, 5906,
+  19266, 26722, 25172, 22654, 19266, 15137, 10426, 5315,
+  16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+  12873, 17855, 16819, 15137, 12873, 10114, 6967, 3552,
+  8867, 12299, 11585, 10426, 8867, 6967, 4799, 2446,
+  4520, 6270, 5906, 5315, 4520, 3552, 2446, 1247
+};
+
+/* Saturates a sample to 0 to 255 when indexed with it masked by 1023,
+   for samples from -384 to 639.  As in libjpeg, the window is centred
+   on 128, so that IDCT output overshooting on either side of 0 to 255
+   saturates instead of wrapping round.  */
+static grub_uint8_t jpeg_range_limit[1024];
+
+/* Chroma contributions to the red, green and blue components.  */
+static int jpeg_cr_r[256];
+static int jpeg_cb_b[256];
+static int jpeg_cr_g[256];
+static int jpeg_cb_g[256];
+
 static const grub_uint8_t jpeg_zigzag_order[64] = {
   0, 1, 8, 16, 9, 2, 3, 10,
   17, 24, 32, 25, 18, 11, 4, 5,
@@ -72,7 +109,8 @@ struct grub_jpeg_data
   int huff_offset[4][16];
   int huff_maxval[4][16];
 
-  grub_uint8_t quan_table[2][64];
+  /* Quantization tables in zigzag order, prescaled for the IDCT.  */
+  int quan_table[2][64];
   int comp_index[3][3];
 
   jpeg_data_unit_t ydu[4];
@@ -86,13 +124,14 @@ struct grub_jpeg_data
   int bit_mask, bit_save;
 };
 
-static grub_uint8_t
+static inline grub_uint8_t
 grub_jpeg_get_byte (struct grub_jpeg_data *data)
 {
-  grub_uint8_t r;
+  int r;
 
-  r = 0;
-  grub_file_read (data->file, &r, 1);
+  r = grub_bufio_getc (data->file);
+  if (r < 0)
+    return 0;
 
   return r;
 }
@@ -102,10 +141,10 @@ grub_jpeg_get_word (struct grub_jpeg_data *data)
 {
   grub_uint16_t r;
 
-  r = 0;
-  grub_file_read (data->file, &r, sizeof (grub_uint16_t));
+  r = grub_jpeg_get_byte (data) << 8;
+  r |= grub_jpeg_get_byte (data);
 
-  return grub_be_to_cpu16 (r);
+  return r;
 }
 
 static int
@@ -185,8 +224,7 @@ grub_jpeg_decode_huff_table (struct grub_jpeg_data *data)
     return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 		       "jpeg: too many huffman tables");
 
-  if (grub_file_read (data->file, &count, sizeof (count)) !=
-      sizeof (count))
+  if (grub_file_read (data->file, &count, sizeof (count)) != sizeof (count))
     return grub_errno;
 
   n = 0;
@@ -223,8 +261,9 @@ grub_jpeg_decode_huff_table (struct grub_jpeg_data *data)
 static grub_err_t
 grub_jpeg_decode_quan_table (struct grub_jpeg_data *data)
 {
-  int id;
+  int id, i;
   grub_uint32_t next_marker;
+  grub_uint8_t table[64];
 
   next_marker = data->file->offset;
   next_marker += grub_jpeg_get_word (data);
@@ -238,9 +277,14 @@ grub_jpeg_decode_quan_table (struct grub_jpeg_data *data)
     return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 		       "jpeg: too many quantization tables");
 
-  if (grub_file_read (data->file, &data->quan_table[id], 64) != 64)
+  if (grub_file_read (data->file, table, 64) != 64)
     return grub_errno;
 
+  /* Fold the AAN scale factors into the table.  */
+  for (i = 0; i < 64; i++)
+    data->quan_table[id][i] =
+      (table[i] * jpeg_aan_scales[jpeg_zigzag_order[i]] + (1 << 11)) >> 12;
+
   if (data->file->offset != next_marker)
     grub_error (GRUB_ERR_BAD_FILE_TYPE,
 		"jpeg: extra byte in quantization table");
@@ -285,7 +329,7 @@ grub_jpeg_decode_sof (struct grub_jpeg_data *data)
 	{
 	  data->vs = ss & 0xF;	/* Vertical sampling.  */
 	  data->hs = ss >> 4;	/* Horizontal sampling.  */
-	  if ((data->vs > 2) || (data->hs > 2))
+	  if ((data->vs > 2) || (data->hs > 2) || (!data->vs) || (!data->hs))
 	    return grub_error (GRUB_ERR_BAD_FILE_TYPE,
 			       "jpeg: sampling method not supported");
 	}
@@ -301,13 +345,18 @@ grub_jpeg_decode_sof (struct grub_jpeg_data *data)
   return grub_errno;
 }
 
+/* Inverse DCT of a dequantized data unit, with the AAN algorithm of
+   libjpeg's jidctfst.c.  The quantization tables are prescaled, so the
+   column pass needs no multiplications for the scale factors; the row
+   pass descales, level shifts and saturates the samples.  */
 static void
 grub_jpeg_idct_transform (jpeg_data_unit_t du)
 {
   int *pd;
   int i;
   int t0, t1, t2, t3, t4, t5, t6, t7;
-  int v0, v1, v2, v3, v4;
+  int t10, t11, t12, t13;
+  int z5, z10, z11, z12, z13;
 
   pd = du;
   for (i = 0; i < JPEG_UNIT_SIZE; i++, pd++)
@@ -317,8 +366,6 @@ grub_jpeg_idct_transform (jpeg_data_unit_t du)
 	   pd[JPEG_UNIT_SIZE * 5] | pd[JPEG_UNIT_SIZE * 6] |
 	   pd[JPEG_UNIT_SIZE * 7]) == 0)
 	{
-	  pd[JPEG_UNIT_SIZE * 0] <<= SHIFT_BITS;
-
 	  pd[JPEG_UNIT_SIZE * 1] = pd[JPEG_UNIT_SIZE * 2]
 	    = pd[JPEG_UNIT_SIZE * 3] = pd[JPEG_UNIT_SIZE * 4]
 	    = pd[JPEG_UNIT_SIZE * 5] = pd[JPEG_UNIT_SIZE * 6]
@@ -327,44 +374,42 @@ grub_jpeg_idct_transform (jpeg_data_unit_t du)
 	  continue;
 	}
 
+      /* Even part.  */
       t0 = pd[JPEG_UNIT_SIZE * 0];
       t1 = pd[JPEG_UNIT_SIZE * 2];
       t2 = pd[JPEG_UNIT_SIZE * 4];
       t3 = pd[JPEG_UNIT_SIZE * 6];
 
-      v4 = (t1 + t3) * CONST (0.541196100);
-
-      v0 = ((t0 + t2) << SHIFT_BITS);
-      v1 = ((t0 - t2) << SHIFT_BITS);
-      v2 = v4 - t3 * CONST (1.847759065);
-      v3 = v4 + t1 * CONST (0.765366865);
-
-      t0 = v0 + v3;
-      t3 = v0 - v3;
-      t1 = v1 + v2;
-      t2 = v1 - v2;
-
-      t4 = pd[JPEG_UNIT_SIZE * 7];
-      t5 = pd[JPEG_UNIT_SIZE * 5];
-      t6 = pd[JPEG_UNIT_SIZE * 3];
-      t7 = pd[JPEG_UNIT_SIZE * 1];
-
-      v0 = t4 + t7;
-      v1 = t5 + t6;
-      v2 = t4 + t6;
-      v3 = t5 + t7;
-
-      v4 = (v2 + v3) * CONST (1.175875602);
-
-      v0 *= CONST (0.899976223);
-      v1 *= CONST (2.562915447);
-      v2 = v2 * CONST (1.961570560) - v4;
-      v3 = v3 * CONST (0.390180644) - v4;
-
-      t4 = t4 * CONST (0.298631336) - v0 - v2;
-      t5 = t5 * CONST (2.053119869) - v1 - v3;
-      t6 = t6 * CONST (3.072711026) - v1 - v2;
-      t7 = t7 * CONST (1.501321110) - v0 - v3;
+      t10 = t0 + t2;
+      t11 = t0 - t2;
+      t13 = t1 + t3;
+      t12 = AAN_MULTIPLY (t1 - t3, AAN_1_414213562) - t13;
+
+      t0 = t10 + t13;
+      t3 = t10 - t13;
+      t1 = t11 + t12;
+      t2 = t11 - t12;
+
+      /* Odd part.  */
+      t4 = pd[JPEG_UNIT_SIZE * 1];
+      t5 = pd[JPEG_UNIT_SIZE * 3];
+      t6 = pd[JPEG_UNIT_SIZE * 5];
+      t7 = pd[JPEG_UNIT_SIZE * 7];
+
+      z13 = t6 + t5;
+      z10 = t6 - t5;
+      z11 = t4 + t7;
+      z12 = t4 - t7;
+
+      t7 = z11 + z13;
+      t11 = AAN_MULTIPLY (z11 - z13, AAN_1_414213562);
+      z5 = AAN_MULTIPLY (z10 + z12, AAN_1_847759065);
+      t10 = AAN_MULTIPLY (z12, AAN_1_082392200) - z5;
+      t12 = z5 - AAN_MULTIPLY (z10, AAN_2_613125930);
+
+      t6 = t12 - t7;
+      t5 = t11 - t6;
+      t4 = t10 + t5;
 
       pd[JPEG_UNIT_SIZE * 0] = t0 + t7;
       pd[JPEG_UNIT_SIZE * 7] = t0 - t7;
@@ -372,73 +417,64 @@ grub_jpeg_idct_transform (jpeg_data_unit_t du)
       pd[JPEG_UNIT_SIZE * 6] = t1 - t6;
       pd[JPEG_UNIT_SIZE * 2] = t2 + t5;
       pd[JPEG_UNIT_SIZE * 5] = t2 - t5;
-      pd[JPEG_UNIT_SIZE * 3] = t3 + t4;
-      pd[JPEG_UNIT_SIZE * 4] = t3 - t4;
+      pd[JPEG_UNIT_SIZE * 4] = t3 + t4;
+      pd[JPEG_UNIT_SIZE * 3] = t3 - t4;
     }
 
+#define AAN_DESCALE(x)	(jpeg_range_limit[((x) >> (AAN_PASS1_BITS + 3)) & 1023])
+
   pd = du;
   for (i = 0; i < JPEG_UNIT_SIZE; i++, pd += JPEG_UNIT_SIZE)
     {
+      /* Adding the level shift and rounding to the DC term carries them
+	 into every output.  */
+      pd[0] += (128 << (AAN_PASS1_BITS + 3)) + (1 << (AAN_PASS1_BITS + 2));
+
       if ((pd[1] | pd[2] | pd[3] | pd[4] | pd[5] | pd[6] | pd[7]) == 0)
 	{
-	  pd[0] >>= (SHIFT_BITS + 3);
+	  pd[0] = AAN_DESCALE (pd[0]);
 	  pd[1] = pd[2] = pd[3] = pd[4] = pd[5] = pd[6] = pd[7] = pd[0];
 	  continue;
 	}
 
-      v4 = (pd[2] + pd[6]) * CONST (0.541196100);
-
-      v0 = (pd[0] + pd[4]) << SHIFT_BITS;
-      v1 = (pd[0] - pd[4]) << SHIFT_BITS;
-      v2 = v4 - pd[6] * CONST (1.847759065);
-      v3 = v4 + pd[2] * CONST (0.765366865);
-
-      t0 = v0 + v3;
-      t3 = v0 - v3;
-      t1 = v1 + v2;
-      t2 = v1 - v2;
-
-      t4 = pd[7];
-      t5 = pd[5];
-      t6 = pd[3];
-      t7 = pd[1];
-
-      v0 = t4 + t7;
-      v1 = t5 + t6;
-      v2 = t4 + t6;
-      v3 = t5 + t7;
-
-      v4 = (v2 + v3) * CONST (1.175875602);
-
-      v0 *= CONST (0.899976223);
-      v1 *= CONST (2.562915447);
-      v2 = v2 * CONST (1.961570560) - v4;
-      v3 = v3 * CONST (0.390180644) - v4;
-
-      t4 = t4 * CONST (0.298631336) - v0 - v2;
-      t5 = t5 * CONST (2.053119869) - v1 - v3;
-      t6 = t6 * CONST (3.072711026) - v1 - v2;
-      t7 = t7 * CONST (1.501321110) - v0 - v3;
-
-      pd[0] = (t0 + t7) >> (SHIFT_BITS * 2 + 3);
-      pd[7] = (t0 - t7) >> (SHIFT_BITS * 2 + 3);
-      pd[1] = (t1 + t6) >> (SHIFT_BITS * 2 + 3);
-      pd[6] = (t1 - t6) >> (SHIFT_BITS * 2 + 3);
-      pd[2] = (t2 + t5) >> (SHIFT_BITS * 2 + 3);
-      pd[5] = (t2 - t5) >> (SHIFT_BITS * 2 + 3);
-      pd[3] = (t3 + t4) >> (SHIFT_BITS * 2 + 3);
-      pd[4] = (t3 - t4) >> (SHIFT_BITS * 2 + 3);
+      /* Even part.  */
+      t10 = pd[0] + pd[4];
+      t11 = pd[0] - pd[4];
+      t13 = pd[2] + pd[6];
+      t12 = AAN_MULTIPLY (pd[2] - pd[6], AAN_1_414213562) - t13;
+
+      t0 = t10 + t13;
+      t3 = t10 - t13;
+      t1 = t11 + t12;
+      t2 = t11 - t12;
+
+      /* Odd part.  */
+      z13 = pd[5] + pd[3];
+      z10 = pd[5] - pd[3];
+      z11 = pd[1] + pd[7];
+      z12 = pd[1] - pd[7];
+
+      t7 = z11 + z13;
+      t11 = AAN_MULTIPLY (z11 - z13, AAN_1_414213562);
+      z5 = AAN_MULTIPLY (z10 + z12, AAN_1_847759065);
+      t10 = AAN_MULTIPLY (z12, AAN_1_082392200) - z5;
+      t12 = z5 - AAN_MULTIPLY (z10, AAN_2_613125930);
+
+      t6 = t12 - t7;
+      t5 = t11 - t6;
+      t4 = t10 + t5;
+
+      pd[0] = AAN_DESCALE (t0 + t7);
+      pd[7] = AAN_DESCALE (t0 - t7);
+      pd[1] = AAN_DESCALE (t1 + t6);
+      pd[6] = AAN_DESCALE (t1 - t6);
+      pd[2] = AAN_DESCALE (t2 + t5);
+      pd[5] = AAN_DESCALE (t2 - t5);
+      pd[4] = AAN_DESCALE (t3 + t4);
+      pd[3] = AAN_DESCALE (t3 - t4);
     }
 
-  for (i = 0; i < JPEG_UNIT_SIZE * JPEG_UNIT_SIZE; i++)
-    {
-      du[i] += 128;
-
-      if (du[i] < 0)
-	du[i] = 0;
-      if (du[i] > 255)
-	du[i] = 255;
-    }
+#undef AAN_DESCALE
 }
 
 static void
@@ -455,7 +491,7 @@ grub_jpeg_decode_du (struct grub_jpeg_data *data, int id, jpeg_data_unit_t du)
   data->dc_value[id] +=
     grub_jpeg_get_number (data, grub_jpeg_get_huff_code (data, h1));
 
-  du[0] = data->dc_value[id] * (int) data->quan_table[qt][0];
+  du[0] = data->dc_value[id] * data->quan_table[qt][0];
   pos = 1;
   while (pos < 64)
     {
@@ -468,50 +504,26 @@ grub_jpeg_decode_du (struct grub_jpeg_data *data, int id, jpeg_data_unit_t du)
       val = grub_jpeg_get_number (data, num & 0xF);
       num >>= 4;
       pos += num;
-      du[jpeg_zigzag_order[pos]] = val * (int) data->quan_table[qt][pos];
+      du[jpeg_zigzag_order[pos]] = val * data->quan_table[qt][pos];
       pos++;
     }
 
   grub_jpeg_idct_transform (du);
 }
 
-static void
+static inline void
 grub_jpeg_ycrcb_to_rgb (int yy, int cr, int cb, grub_uint8_t * rgb)
 {
-  int dd;
-
-  cr -= 128;
-  cb -= 128;
-
-  /* Red  */
-  dd = yy + ((cr * CONST (1.402)) >> SHIFT_BITS);
-  if (dd < 0)
-    dd = 0;
-  if (dd > 255)
-    dd = 255;
-  *(rgb++) = dd;
-
-  /* Green  */
-  dd = yy - ((cb * CONST (0.34414) + cr * CONST (0.71414)) >> SHIFT_BITS);
-  if (dd < 0)
-    dd = 0;
-  if (dd > 255)
-    dd = 255;
-  *(rgb++) = dd;
-
-  /* Blue  */
-  dd = yy + ((cb * CONST (1.772)) >> SHIFT_BITS);
-  if (dd < 0)
-    dd = 0;
-  if (dd > 255)
-    dd = 255;
-  *(rgb++) = dd;
+  rgb[0] = jpeg_range_limit[(yy + jpeg_cr_r[cr]) & 1023];
+  rgb[1] = jpeg_range_limit[(yy - ((jpeg_cb_g[cb] + jpeg_cr_g[cr])
+				   >> SHIFT_BITS)) & 1023];
+  rgb[2] = jpeg_range_limit[(yy + jpeg_cb_b[cb]) & 1023];
 }
 
 static grub_err_t
 grub_jpeg_decode_sos (struct grub_jpeg_data *data)
 {
-  int i, cc, r1, c1, nr1, nc1, vb, hb;
+  int i, cc, r1, c1, nr1, nc1, vb, hb, vshift, hshift;
   grub_uint8_t *ptr1;
   grub_uint32_t data_offset;
 
@@ -552,6 +564,8 @@ grub_jpeg_decode_sos (struct grub_jpeg_data *data)
 
   vb = data->vs * 8;
   hb = data->hs * 8;
+  vshift = data->vs - 1;
+  hshift = data->hs - 1;
   nr1 = (data->image_height + vb - 1) / vb;
   nc1 = (data->image_width + hb - 1) / hb;
 
@@ -578,18 +592,23 @@ grub_jpeg_decode_sos (struct grub_jpeg_data *data)
 
 	ptr2 = ptr1;
 	for (r2 = 0; r2 < nr2; r2++, ptr2 += (data->image_width - nc2) * 3)
-	  for (c2 = 0; c2 < nc2; c2++, ptr2 += 3)
-	    {
-	      int i0, yy, cr, cb;
+	  {
+	    const int *yrow, *crrow, *cbrow;
 
-	      i0 = (r2 / data->vs) * 8 + (c2 / data->hs);
-	      cr = data->crdu[i0];
-	      cb = data->cbdu[i0];
-	      yy =
-		data->ydu[(r2 / 8) * 2 + (c2 / 8)][(r2 % 8) * 8 + (c2 % 8)];
+	    yrow = data->ydu[(r2 >> 3) * 2] + (r2 & 7) * 8;
+	    crrow = data->crdu + (r2 >> vshift) * 8;
+	    cbrow = data->cbdu + (r2 >> vshift) * 8;
 
-	      grub_jpeg_ycrcb_to_rgb (yy, cr, cb, ptr2);
-	    }
+	    for (c2 = 0; c2 < nc2; c2++, ptr2 += 3)
+	      {
+		int yy, i0;
+
+		/* The second Y unit of a row follows the first.  */
+		yy = yrow[(c2 & 7) + (c2 >> 3) * 64];
+		i0 = c2 >> hshift;
+		grub_jpeg_ycrcb_to_rgb (yy, crrow[i0], cbrow[i0], ptr2);
+	      }
+	  }
       }
 
   return grub_errno;
@@ -703,14 +722,20 @@ grub_cmd_jpegtest (grub_command_t cmd __attribute__ ((unused)),
                    int argc, char **args)
 {
   struct grub_video_bitmap *bitmap = 0;
+  grub_uint64_t start;
 
   if (argc != 1)
     return grub_error (GRUB_ERR_BAD_ARGUMENT, "file name required");
 
+  start = grub_get_time_ms ();
   grub_video_reader_jpeg (&bitmap, args[0]);
   if (grub_errno != GRUB_ERR_NONE)
     return grub_errno;
 
+  grub_printf ("%ux%u decoded in %u ms\n", bitmap->mode_info.width,
+	       bitmap->mode_info.height,
+	       (unsigned) (grub_get_time_ms () - start));
+
   grub_video_bitmap_destroy (bitmap);
 
   return GRUB_ERR_NONE;
@@ -729,8 +754,30 @@ static struct grub_video_bitmap_reader jpeg_reader = {
   .next = 0
 };
 
+static void
+grub_jpeg_init_tables (void)
+{
+  int i;
+
+  for (i = 0; i < 1024; i++)
+    {
+      int v = (i < 640) ? i : i - 1024;
+
+      jpeg_range_limit[i] = (v < 0) ? 0 : ((v > 255) ? 255 : v);
+    }
+
+  for (i = 0; i < 256; i++)
+    {
+      jpeg_cr_r[i] = ((i - 128) * CONST (1.402)) >> SHIFT_BITS;
+      jpeg_cb_b[i] = ((i - 128) * CONST (1.772)) >> SHIFT_BITS;
+      jpeg_cr_g[i] = (i - 128) * CONST (0.71414);
+      jpeg_cb_g[i] = (i - 128) * CONST (0.34414);
+    }
+}
+
 GRUB_MOD_INIT (video_reader_jpeg)
 {
+  grub_jpeg_init_tables ();
   grub_video_bitmap_reader_register (&jpg_reader);
   grub_video_bitmap_reader_register (&jpeg_reader);
 #if defined(JPEG_DEBUG)
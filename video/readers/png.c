@@ -23,6 +23,7 @@
 #include <grub/mm.h>
 #include <grub/misc.h>
 #include <grub/bufio.h>
+#include <grub/time.h>
 
 /* Uncomment following define to enable PNG debug.  */
 //#define PNG_DEBUG
@@ -73,6 +74,9 @@
 
 #define DEFLATE_HUFF_LEN	16
 
+/* Codes of up to PNG_FAST_BITS bits are decoded with one table lookup.  */
+#define PNG_FAST_BITS		9
+
 #ifdef PNG_DEBUG
 static grub_command_t cmd;
 #endif
@@ -81,6 +85,10 @@ struct huff_table
 {
   int *values, *maxval, *offset;
   int num_values, max_length;
+
+  /* Indexed by the next PNG_FAST_BITS bits of input, gives the symbol
+     shifted left by 4 and the code length, or 0 for longer codes.  */
+  grub_uint16_t *fast;
 };
 
 struct grub_png_data
@@ -88,11 +96,14 @@ struct grub_png_data
   grub_file_t file;
   struct grub_video_bitmap **bitmap;
 
-  int bit_count, bit_save;
+  int bit_count;
+  grub_uint32_t bit_save;
 
   grub_uint32_t next_offset;
 
-  int image_width, image_height, bpp, is_16bit, raw_bytes;
+  int image_width, image_height, bpp, is_16bit, raw_bytes, row_bytes;
+
+  /* A blank line, followed for 16-bit images by two raw lines.  */
   grub_uint8_t *image_data;
 
   int inside_idat, idat_remain;
@@ -100,10 +111,12 @@ struct grub_png_data
   int code_values[DEFLATE_HLIT_MAX];
   int code_maxval[DEFLATE_HUFF_LEN];
   int code_offset[DEFLATE_HUFF_LEN];
+  grub_uint16_t code_fast[1 << PNG_FAST_BITS];
 
   int dist_values[DEFLATE_HDIST_MAX];
   int dist_maxval[DEFLATE_HUFF_LEN];
   int dist_offset[DEFLATE_HUFF_LEN];
+  grub_uint16_t dist_fast[1 << PNG_FAST_BITS];
 
   struct huff_table code_table;
   struct huff_table dist_table;
@@ -111,27 +124,42 @@ struct grub_png_data
   grub_uint8_t slide[WSIZE];
   int wp;
 
-  grub_uint8_t *cur_rgb;
+  /* CUR_RGB is where the next byte of the current line goes, and
+     PREV_ROW is the previous line, already unfiltered.  For 16-bit
+     images, unfiltered lines are reduced to 8 bits at OUT_RGB.  */
+  grub_uint8_t *cur_rgb, *prev_row, *out_rgb;
 
-  int cur_column, cur_filter, first_line;
+  int cur_column, cur_filter;
 };
 
+static inline grub_uint8_t
+grub_png_get_input_byte (struct grub_png_data *data)
+{
+  int r;
+
+  r = grub_bufio_getc (data->file);
+  if (r < 0)
+    return 0;
+
+  return r;
+}
+
 static grub_uint32_t
 grub_png_get_dword (struct grub_png_data *data)
 {
   grub_uint32_t r;
 
-  r = 0;
-  grub_file_read (data->file, &r, sizeof (grub_uint32_t));
+  r = (grub_uint32_t) grub_png_get_input_byte (data) << 24;
+  r |= grub_png_get_input_byte (data) << 16;
+  r |= grub_png_get_input_byte (data) << 8;
+  r |= grub_png_get_input_byte (data);
 
-  return grub_be_to_cpu32 (r);
+  return r;
 }
 
 static grub_uint8_t
 grub_png_get_byte (struct grub_png_data *data)
 {
-  grub_uint8_t r;
-
   if ((data->inside_idat) && (data->idat_remain == 0))
     {
       grub_uint32_t len, type;
@@ -163,51 +191,46 @@ grub_png_get_byte (struct grub_png_data *data)
       data->idat_remain = len;
     }
 
-  r = 0;
-  grub_file_read (data->file, &r, 1);
-
   if (data->inside_idat)
     data->idat_remain--;
 
-  return r;
+  return grub_png_get_input_byte (data);
 }
 
-static int
-grub_png_get_bits (struct grub_png_data *data, int num)
+/* Top up the bit buffer, without crossing into the next chunk.  */
+static inline void
+grub_png_fill_bits (struct grub_png_data *data)
 {
-  int code, shift;
-
-  if (data->bit_count == 0)
+  while ((data->bit_count <= 24) && (data->idat_remain > 0))
     {
-      data->bit_save = grub_png_get_byte (data);
-      data->bit_count = 8;
-    }
-
-  code = 0;
-  shift = 0;
-  while (grub_errno == 0)
-    {
-      int n;
+      int r;
 
-      n = data->bit_count;
-      if (n > num)
-	n = num;
+      r = grub_bufio_getc (data->file);
+      if (r < 0)
+	break;
 
-      code += (int) (data->bit_save & ((1 << n) - 1)) << shift;
-      num -= n;
-      if (!num)
-	{
-	  data->bit_count -= n;
-	  data->bit_save >>= n;
-	  break;
-	}
+      data->bit_save |= (grub_uint32_t) r << data->bit_count;
+      data->bit_count += 8;
+      data->idat_remain--;
+    }
+}
 
-      shift += n;
+static int
+grub_png_get_bits (struct grub_png_data *data, int num)
+{
+  int code;
 
-      data->bit_save = grub_png_get_byte (data);
-      data->bit_count = 8;
+  while (data->bit_count < num)
+    {
+      data->bit_save |= ((grub_uint32_t) grub_png_get_byte (data)
+			 << data->bit_count);
+      data->bit_count += 8;
     }
 
+  code = data->bit_save & ((1 << num) - 1);
+  data->bit_save >>= num;
+  data->bit_count -= num;
+
   return code;
 }
 
@@ -251,26 +274,25 @@ grub_png_decode_image_header (struct grub_png_data *data)
 		       "png: color type not supported");
 
   if (data->is_16bit)
-    {
-      data->bpp <<= 1;
+    data->bpp <<= 1;
 
-      data->image_data = grub_malloc (data->image_height *
-                                      data->image_width *  data->bpp);
-      if (grub_errno)
-        return grub_errno;
+  data->row_bytes = data->image_width * data->bpp;
+  data->image_data = grub_zalloc (data->row_bytes * (data->is_16bit ? 3 : 1));
+  if (! data->image_data)
+    return grub_errno;
 
-      data->cur_rgb = data->image_data;
-    }
-  else
+  data->prev_row = data->image_data;
+  if (data->is_16bit)
     {
-      data->image_data = 0;
-      data->cur_rgb = (*data->bitmap)->data;
+      data->cur_rgb = data->image_data + data->row_bytes;
+      data->out_rgb = (*data->bitmap)->data;
     }
+  else
+    data->cur_rgb = (*data->bitmap)->data;
 
   data->raw_bytes = data->image_height * (data->image_width + 1) * data->bpp;
 
   data->cur_column = 0;
-  data->first_line = 1;
 
   if (grub_png_get_byte (data) != PNG_COMPRESSION_BASE)
     return grub_error (GRUB_ERR_BAD_FILE_TYPE,
@@ -323,11 +345,13 @@ static const grub_uint8_t cpdext[] = {
 
 static void
 grub_png_init_huff_table (struct huff_table *ht, int cur_maxlen,
-			  int *cur_values, int *cur_maxval, int *cur_offset)
+			  int *cur_values, int *cur_maxval, int *cur_offset,
+			  grub_uint16_t *cur_fast)
 {
   ht->values = cur_values;
   ht->maxval = cur_maxval;
   ht->offset = cur_offset;
+  ht->fast = cur_fast;
   ht->num_values = 0;
   ht->max_length = cur_maxlen;
   grub_memset (cur_maxval, 0, sizeof (int) * cur_maxlen);
@@ -368,12 +392,37 @@ grub_png_build_huff_table (struct huff_table *ht)
   ofs = 0;
   for (i = 0; i < ht->max_length; i++)
     {
+      int first, code;
+
+      first = base;
       base += ht->maxval[i];
       ofs += ht->maxval[i];
 
       ht->maxval[i] = base;
       ht->offset[i] = ofs - base;
 
+      if ((ht->fast) && (i < PNG_FAST_BITS))
+	{
+	  if (i == 0)
+	    grub_memset (ht->fast, 0, sizeof (ht->fast[0]) << PNG_FAST_BITS);
+
+	  /* Codes are sent most significant bit first, so the table is
+	     indexed with them reversed.  */
+	  for (code = first; code < base; code++)
+	    {
+	      int rev, j;
+	      grub_uint16_t entry;
+
+	      rev = 0;
+	      for (j = 0; j <= i; j++)
+		rev |= ((code >> j) & 1) << (i - j);
+
+	      entry = (ht->values[code + ht->offset[i]] << 4) | (i + 1);
+	      for (j = rev; j < (1 << PNG_FAST_BITS); j += 2 << i)
+		ht->fast[j] = entry;
+	    }
+	}
+
       base <<= 1;
     }
 }
@@ -383,6 +432,22 @@ grub_png_get_huff_code (struct grub_png_data *data, struct huff_table *ht)
 {
   int code, i;
 
+  if (ht->fast)
+    {
+      grub_uint16_t entry;
+      int len;
+
+      grub_png_fill_bits (data);
+      entry = ht->fast[data->bit_save & ((1 << PNG_FAST_BITS) - 1)];
+      len = entry & 0xf;
+      if ((len) && (len <= data->bit_count))
+	{
+	  data->bit_save >>= len;
+	  data->bit_count -= len;
+	  return entry >> 4;
+	}
+    }
+
   code = 0;
   for (i = 0; i < ht->max_length; i++)
     {
@@ -400,7 +465,7 @@ grub_png_init_fixed_block (struct grub_png_data *data)
 
   grub_png_init_huff_table (&data->code_table, DEFLATE_HUFF_LEN,
 			    data->code_values, data->code_maxval,
-			    data->code_offset);
+			    data->code_offset, data->code_fast);
 
   for (i = 0; i < 144; i++)
     grub_png_insert_huff_item (&data->code_table, i, 8);
@@ -418,7 +483,7 @@ grub_png_init_fixed_block (struct grub_png_data *data)
 
   grub_png_init_huff_table (&data->dist_table, DEFLATE_HUFF_LEN,
 			    data->dist_values, data->dist_maxval,
-			    data->dist_offset);
+			    data->dist_offset, data->dist_fast);
 
   for (i = 0; i < DEFLATE_HDIST_MAX; i++)
     grub_png_insert_huff_item (&data->dist_table, i, 5);
@@ -446,7 +511,7 @@ grub_png_init_dynamic_block (struct grub_png_data *data)
       (nb > DEFLATE_HCLEN_MAX))
     return grub_error (GRUB_ERR_BAD_FILE_TYPE, "png: too much data");
 
-  grub_png_init_huff_table (&cl, 8, cl_values, cl_maxval, cl_offset);
+  grub_png_init_huff_table (&cl, 8, cl_values, cl_maxval, cl_offset, 0);
 
   for (i = 0; i < nb; i++)
     lens[bitorder[i]] = grub_png_get_bits (data, 3);
@@ -461,11 +526,11 @@ grub_png_init_dynamic_block (struct grub_png_data *data)
 
   grub_png_init_huff_table (&data->code_table, DEFLATE_HUFF_LEN,
 			    data->code_values, data->code_maxval,
-			    data->code_offset);
+			    data->code_offset, data->code_fast);
 
   grub_png_init_huff_table (&data->dist_table, DEFLATE_HUFF_LEN,
 			    data->dist_values, data->dist_maxval,
-			    data->dist_offset);
+			    data->dist_offset, data->dist_fast);
 
   prev = 0;
   for (i = 0; i < nl + nd; i++)
@@ -518,119 +583,111 @@ grub_png_init_dynamic_block (struct grub_png_data *data)
   return grub_errno;
 }
 
-static grub_err_t
-grub_png_output_byte (struct grub_png_data *data, grub_uint8_t n)
+static void
+grub_png_unfilter_line (struct grub_png_data *data, grub_uint8_t *cur,
+			const grub_uint8_t *up)
 {
-  int row_bytes;
-
-  if (--data->raw_bytes < 0)
-    return grub_error (GRUB_ERR_BAD_FILE_TYPE, "image size overflown");
+  const grub_uint8_t *left = cur;
+  int row_bytes = data->row_bytes;
+  int bpp = data->bpp;
+  int i;
 
-  if (data->cur_column == 0)
+  switch (data->cur_filter)
     {
-      if (n >= PNG_FILTER_VALUE_LAST)
-	return grub_error (GRUB_ERR_BAD_FILE_TYPE, "invalid filter value");
+    case PNG_FILTER_VALUE_SUB:
+      for (i = bpp; i < row_bytes; i++)
+	cur[i] += left[i - bpp];
+      break;
 
-      data->cur_filter = n;
-    }
-  else
-    *(data->cur_rgb++) = n;
+    case PNG_FILTER_VALUE_UP:
+      for (i = 0; i < row_bytes; i++)
+	cur[i] += up[i];
+      break;
 
-  data->cur_column++;
-  row_bytes = data->image_width * data->bpp;
-  if (data->cur_column == row_bytes + 1)
-    {
-      grub_uint8_t *blank_line = NULL;
-      grub_uint8_t *cur = data->cur_rgb - row_bytes;
-      grub_uint8_t *left = cur;
-      grub_uint8_t *up;
+    case PNG_FILTER_VALUE_AVG:
+      for (i = 0; i < bpp; i++)
+	cur[i] += up[i] >> 1;
 
-      if (data->first_line)
-	{
-	  blank_line = grub_zalloc (row_bytes);
-	  if (blank_line == NULL)
-	    return grub_errno;
+      for (; i < row_bytes; i++)
+	cur[i] += ((int) up[i] + (int) left[i - bpp]) >> 1;
+      break;
 
-	  up = blank_line;
-	}
-      else
-	up = cur - row_bytes;
+    case PNG_FILTER_VALUE_PAETH:
+      for (i = 0; i < bpp; i++)
+	cur[i] += up[i];
 
-      switch (data->cur_filter)
+      for (; i < row_bytes; i++)
 	{
-	case PNG_FILTER_VALUE_SUB:
-	  {
-	    int i;
-
-	    cur += data->bpp;
-	    for (i = data->bpp; i < row_bytes; i++, cur++, left++)
-	      *cur += *left;
-
-	    break;
-	  }
-	case PNG_FILTER_VALUE_UP:
-	  {
-	    int i;
+	  int a, b, c, pa, pb, pc;
 
-	    for (i = 0; i < row_bytes; i++, cur++, up++)
-	      *cur += *up;
-
-	    break;
-	  }
-	case PNG_FILTER_VALUE_AVG:
-	  {
-	    int i;
+	  a = left[i - bpp];
+	  b = up[i];
+	  c = up[i - bpp];
 
-	    for (i = 0; i < data->bpp; i++, cur++, up++)
-	      *cur += *up >> 1;
+	  pa = b - c;
+	  pb = a - c;
+	  pc = pa + pb;
 
-	    for (; i < row_bytes; i++, cur++, up++, left++)
-	      *cur += ((int) *up + (int) *left) >> 1;
+	  if (pa < 0)
+	    pa = -pa;
 
-	    break;
-	  }
-	case PNG_FILTER_VALUE_PAETH:
-	  {
-	    int i;
-	    grub_uint8_t *upper_left = up;
+	  if (pb < 0)
+	    pb = -pb;
 
-	    for (i = 0; i < data->bpp; i++, cur++, up++)
-	      *cur += *up;
+	  if (pc < 0)
+	    pc = -pc;
 
-	    for (; i < row_bytes; i++, cur++, up++, left++, upper_left++)
-	      {
-		int a, b, c, pa, pb, pc;
+	  cur[i] += ((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c;
+	}
+      break;
+    }
+}
 
-                a = *left;
-                b = *up;
-                c = *upper_left;
+static void
+grub_png_finish_line (struct grub_png_data *data)
+{
+  grub_uint8_t *cur = data->cur_rgb - data->row_bytes;
 
-                pa = b - c;
-                pb = a - c;
-                pc = pa + pb;
+  grub_png_unfilter_line (data, cur, data->prev_row);
+  data->prev_row = cur;
+  data->cur_column = 0;
 
-                if (pa < 0)
-                  pa = -pa;
+  if (data->is_16bit)
+    {
+      int i;
 
-                if (pb < 0)
-                  pb = -pb;
+      /* Keep the most significant byte of each sample, and decode the
+	 next line into the other line buffer.  */
+      for (i = 0; i < data->row_bytes; i += 2)
+	*(data->out_rgb++) = cur[i];
 
-                if (pc < 0)
-                  pc = -pc;
+      data->cur_rgb = data->image_data + data->row_bytes;
+      if (cur == data->cur_rgb)
+	data->cur_rgb += data->row_bytes;
+    }
+}
 
-                *cur += ((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c;
-	      }
-	  }
-	}
+static inline grub_err_t
+grub_png_output_byte (struct grub_png_data *data, grub_uint8_t n)
+{
+  if (--data->raw_bytes < 0)
+    return grub_error (GRUB_ERR_BAD_FILE_TYPE, "image size overflown");
 
-      if (blank_line)
-	grub_free (blank_line);
+  if (data->cur_column == 0)
+    {
+      if (n >= PNG_FILTER_VALUE_LAST)
+	return grub_error (GRUB_ERR_BAD_FILE_TYPE, "invalid filter value");
 
-      data->cur_column = 0;
-      data->first_line = 0;
+      data->cur_filter = n;
+      data->cur_column++;
+      return GRUB_ERR_NONE;
     }
 
-  return grub_errno;
+  *(data->cur_rgb++) = n;
+  if (data->cur_column++ == data->row_bytes)
+    grub_png_finish_line (data);
+
+  return GRUB_ERR_NONE;
 }
 
 static grub_err_t
@@ -646,9 +703,7 @@ grub_png_read_dynamic_block (struct grub_png_data *data)
 	  data->slide[data->wp] = n;
 	  grub_png_output_byte (data, n);
 
-	  data->wp++;
-	  if (data->wp >= WSIZE)
-	    data->wp = 0;
+	  data->wp = (data->wp + 1) & (WSIZE - 1);
 	}
       else if (n == 256)
 	break;
@@ -657,32 +712,33 @@ grub_png_read_dynamic_block (struct grub_png_data *data)
 	  int len, dist, pos;
 
 	  n -= 257;
+	  if (cplext[n] == 99)
+	    return grub_error (GRUB_ERR_BAD_FILE_TYPE, "png: invalid code");
+
 	  len = cplens[n];
 	  if (cplext[n])
 	    len += grub_png_get_bits (data, cplext[n]);
 
 	  n = grub_png_get_huff_code (data, &data->dist_table);
+	  if (n >= DEFLATE_HDIST_MAX)
+	    return grub_error (GRUB_ERR_BAD_FILE_TYPE, "png: invalid code");
+
 	  dist = cpdist[n];
 	  if (cpdext[n])
 	    dist += grub_png_get_bits (data, cpdext[n]);
 
-	  pos = data->wp - dist;
-	  if (pos < 0)
-	    pos += WSIZE;
+	  pos = (data->wp - dist) & (WSIZE - 1);
 
 	  while (len > 0)
 	    {
-	      data->slide[data->wp] = data->slide[pos];
-	      grub_png_output_byte (data, data->slide[data->wp]);
-
-	      data->wp++;
-	      if (data->wp >= WSIZE)
-		data->wp = 0;
+	      grub_uint8_t c;
 
-	      pos++;
-	      if (pos >= WSIZE)
-		pos = 0;
+	      c = data->slide[pos];
+	      data->slide[data->wp] = c;
+	      grub_png_output_byte (data, c);
 
+	      data->wp = (data->wp + 1) & (WSIZE - 1);
+	      pos = (pos + 1) & (WSIZE - 1);
 	      len--;
 	    }
 	}
@@ -721,16 +777,24 @@ grub_png_decode_image_data (struct grub_png_data *data)
 	  {
 	    grub_uint16_t i, len;
 
-	    data->bit_count = 0;
-	    len = grub_png_get_byte (data);
-	    len += ((grub_uint16_t) grub_png_get_byte (data)) << 8;
+	    /* Skip to the byte boundary.  Whole bytes may remain in the
+	       bit buffer, so read through it.  */
+	    grub_png_get_bits (data, data->bit_count & 7);
+	    len = grub_png_get_bits (data, 16);
 
             /* Skip NLEN field.  */
-	    grub_png_get_byte (data);
-	    grub_png_get_byte (data);
+	    grub_png_get_bits (data, 16);
 
 	    for (i = 0; i < len; i++)
-	      grub_png_output_byte (data, grub_png_get_byte (data));
+	      {
+		grub_uint8_t c;
+
+		c = grub_png_get_bits (data, 8);
+		data->slide[data->wp] = c;
+		grub_png_output_byte (data, c);
+
+		data->wp = (data->wp + 1) & (WSIZE - 1);
+	      }
 
 	    break;
 	  }
@@ -753,7 +817,9 @@ grub_png_decode_image_data (struct grub_png_data *data)
   while ((!final) && (grub_errno == 0));
 
   /* Skip adler checksum.  */
-  grub_png_get_dword (data);
+  grub_png_get_bits (data, data->bit_count & 7);
+  grub_png_get_bits (data, 16);
+  grub_png_get_bits (data, 16);
 
   /* Skip crc checksum.  */
   grub_png_get_dword (data);
@@ -764,21 +830,6 @@ grub_png_decode_image_data (struct grub_png_data *data)
 static const grub_uint8_t png_magic[8] =
   { 0x89, 0x50, 0x4e, 0x47, 0xd, 0xa, 0x1a, 0x0a };
 
-static void
-grub_png_convert_image (struct grub_png_data *data)
-{
-  int i;
-  grub_uint8_t *d1, *d2;
-
-  d1 = (*data->bitmap)->data;
-  d2 = data->image_data + 1;
-
-  /* Only copy the upper 8 bit.  */
-  for (i = 0; i < (data->image_width * data->image_height * data->bpp >> 1);
-       i++, d1++, d2+=2)
-    *d1 = *d2;
-}
-
 static grub_err_t
 grub_png_decode_png (struct grub_png_data *data)
 {
@@ -808,6 +859,7 @@ grub_png_decode_png (struct grub_png_data *data)
 	  data->inside_idat = 1;
 	  data->idat_remain = len;
 	  data->bit_count = 0;
+	  data->bit_save = 0;
 
 	  grub_png_decode_image_data (data);
 
@@ -815,9 +867,6 @@ grub_png_decode_png (struct grub_png_data *data)
 	  break;
 
 	case PNG_CHUNK_IEND:
-          if (data->is_16bit)
-            grub_png_convert_image (data);
-
 	  return grub_errno;
 
 	default:
@@ -874,14 +923,20 @@ grub_cmd_pngtest (grub_command_t cmd __attribute__ ((unused)),
 		  int argc, char **args)
 {
   struct grub_video_bitmap *bitmap = 0;
+  grub_uint64_t start;
 
   if (argc != 1)
     return grub_error (GRUB_ERR_BAD_ARGUMENT, "file name required");
 
+  start = grub_get_time_ms ();
   grub_video_reader_png (&bitmap, args[0]);
   if (grub_errno != GRUB_ERR_NONE)
     return grub_errno;
 
+  grub_printf ("%ux%u decoded in %u ms\n", bitmap->mode_info.width,
+	       bitmap->mode_info.height,
+	       (unsigned) (grub_get_time_ms () - start));
+
   grub_video_bitmap_destroy (bitmap);
 
   return GRUB_ERR_NONE;